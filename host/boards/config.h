@@ -0,0 +1,14 @@
+#ifndef _BOARD_CONFIG_H_
+#define _BOARD_CONFIG_H_
+
+// Linux host board: WAV files instead of a codec chip, in-memory transports instead of a network
+
+#define AUDIO_INPUT_SAMPLE_RATE  16000
+#define AUDIO_OUTPUT_SAMPLE_RATE 24000
+
+// Where the WAV codec reads and writes unless the host app or a test says otherwise
+#define HOST_WAV_INPUT_ENV   "XIAOZHI_HOST_INPUT_WAV"
+#define HOST_WAV_OUTPUT_ENV  "XIAOZHI_HOST_OUTPUT_WAV"
+#define HOST_WAV_SPEED_ENV   "XIAOZHI_HOST_SPEED"
+
+#endif // _BOARD_CONFIG_H_
@@ -0,0 +1,61 @@
+#include "host_board.h"
+#include "config.h"
+#include "codecs/wav_file_audio_codec.h"
+
+#include <esp_log.h>
+#include <cstdlib>
+
+#define TAG "HostBoard"
+
+static std::string GetEnv(const char* name, const char* default_value = "") {
+    auto value = getenv(name);
+    return value != nullptr ? value : default_value;
+}
+
+HostBoard::HostBoard() {
+    uuid_ = "00000000-0000-4000-8000-000000000001";
+    input_path_ = GetEnv(HOST_WAV_INPUT_ENV);
+    output_path_ = GetEnv(HOST_WAV_OUTPUT_ENV);
+    speed_ = atoi(GetEnv(HOST_WAV_SPEED_ENV, "1").c_str());
+}
+
+void HostBoard::SetWavFiles(const std::string& input_path, const std::string& output_path, int speed) {
+    input_path_ = input_path;
+    output_path_ = output_path;
+    speed_ = speed;
+}
+
+AudioCodec* HostBoard::GetAudioCodec() {
+    static WavFileAudioCodec audio_codec(input_path_, output_path_, AUDIO_OUTPUT_SAMPLE_RATE, speed_);
+    return &audio_codec;
+}
+
+std::string HostBoard::GetDeviceStatusJson() {
+    return "{\"audio_speaker\":{\"volume\":" + std::to_string(GetAudioCodec()->output_volume()) + "}}";
+}
+
+WebSocket* HostBoard::CreateWebSocket() {
+    auto websocket = new HostWebSocket();
+    if (on_websocket_created_ != nullptr) {
+        on_websocket_created_(websocket);
+    }
+    return websocket;
+}
+
+Mqtt* HostBoard::CreateMqtt() {
+    auto mqtt = new HostMqtt();
+    if (on_mqtt_created_ != nullptr) {
+        on_mqtt_created_(mqtt);
+    }
+    return mqtt;
+}
+
+Udp* HostBoard::CreateUdp() {
+    auto udp = new HostUdp();
+    if (on_udp_created_ != nullptr) {
+        on_udp_created_(udp);
+    }
+    return udp;
+}
+
+DECLARE_BOARD(HostBoard);
@@ -0,0 +1,48 @@
+#ifndef _HOST_BOARD_H_
+#define _HOST_BOARD_H_
+
+#include "board.h"
+#include "host_transports.h"
+
+#include <functional>
+#include <string>
+
+/*
+ * Board of the Linux host build. The audio codec is a WavFileAudioCodec, the transports are the
+ * in-memory ones from host_transports.h, handed to whoever installed a hook before the protocol
+ * creates them.
+ */
+class HostBoard : public Board {
+public:
+    static HostBoard& GetInstance() {
+        return static_cast<HostBoard&>(Board::GetInstance());
+    }
+
+    HostBoard();
+
+    std::string GetBoardType() override { return "host"; }
+    // Input and output paths come from SetWavFiles(), else from the XIAOZHI_HOST_*_WAV variables
+    AudioCodec* GetAudioCodec() override;
+    std::string GetDeviceStatusJson() override;
+    WebSocket* CreateWebSocket() override;
+    Mqtt* CreateMqtt() override;
+    Udp* CreateUdp() override;
+
+    // Must be called before the first GetAudioCodec(), speed > 1 runs the files faster than real time
+    void SetWavFiles(const std::string& input_path, const std::string& output_path, int speed = 1);
+
+    // Called with every new transport before the protocol uses it, tests install the server side here
+    void OnWebSocketCreated(std::function<void(HostWebSocket*)> callback) { on_websocket_created_ = callback; }
+    void OnMqttCreated(std::function<void(HostMqtt*)> callback) { on_mqtt_created_ = callback; }
+    void OnUdpCreated(std::function<void(HostUdp*)> callback) { on_udp_created_ = callback; }
+
+private:
+    std::string input_path_;
+    std::string output_path_;
+    int speed_ = 1;
+    std::function<void(HostWebSocket*)> on_websocket_created_;
+    std::function<void(HostMqtt*)> on_mqtt_created_;
+    std::function<void(HostUdp*)> on_udp_created_;
+};
+
+#endif // _HOST_BOARD_H_
@@ -0,0 +1,90 @@
+#include "host_transports.h"
+
+#include <esp_log.h>
+
+#define TAG "HostTransport"
+
+bool HostWebSocket::Connect(const char* uri) {
+    if (on_connect_ == nullptr || !on_connect_(uri)) {
+        ESP_LOGE(TAG, "No server for %s", uri);
+        return false;
+    }
+    connected_ = true;
+    if (on_connected_ != nullptr) {
+        on_connected_();
+    }
+    return true;
+}
+
+bool HostWebSocket::Send(const void* data, size_t len, bool binary, bool fin) {
+    if (!connected_ || on_send_ == nullptr) {
+        return false;
+    }
+    return on_send_(data, len, binary);
+}
+
+void HostWebSocket::Close() {
+    connected_ = false;
+}
+
+void HostWebSocket::Deliver(const char* data, size_t len, bool binary) {
+    if (connected_ && on_data_ != nullptr) {
+        on_data_(data, len, binary);
+    }
+}
+
+void HostWebSocket::Disconnect() {
+    if (connected_.exchange(false) && on_disconnected_ != nullptr) {
+        on_disconnected_();
+    }
+}
+
+bool HostMqtt::Connect(const std::string broker_address, int broker_port, const std::string client_id,
+    const std::string username, const std::string password) {
+    if (on_connect_ == nullptr || !on_connect_(broker_address, broker_port)) {
+        ESP_LOGE(TAG, "No broker at %s:%d", broker_address.c_str(), broker_port);
+        return false;
+    }
+    connected_ = true;
+    if (on_connected_callback_ != nullptr) {
+        on_connected_callback_();
+    }
+    return true;
+}
+
+void HostMqtt::Disconnect() {
+    if (connected_.exchange(false) && on_disconnected_callback_ != nullptr) {
+        on_disconnected_callback_();
+    }
+}
+
+bool HostMqtt::Publish(const std::string topic, const std::string payload, int qos) {
+    if (!connected_ || on_publish_ == nullptr) {
+        return false;
+    }
+    return on_publish_(topic, payload);
+}
+
+void HostMqtt::Deliver(const std::string& topic, const std::string& payload) {
+    if (connected_ && on_message_callback_ != nullptr) {
+        on_message_callback_(topic, payload);
+    }
+}
+
+bool HostUdp::Connect(const std::string& host, int port) {
+    connected_ = true;
+    return true;
+}
+
+int HostUdp::Send(const void* data, size_t len) {
+    if (!connected_ || on_send_ == nullptr) {
+        return -1;
+    }
+    return on_send_(data, len);
+}
+
+void HostUdp::Deliver(const std::string& data) {
+    if (connected_ && message_callback_ != nullptr) {
+        message_callback_(data);
+    }
+}
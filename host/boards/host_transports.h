@@ -0,0 +1,79 @@
+#ifndef _HOST_TRANSPORTS_H_
+#define _HOST_TRANSPORTS_H_
+
+#include <web_socket.h>
+#include <mqtt.h>
+#include <udp.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+
+/*
+ * In-memory transports of the host board. What the device sends goes to the OnSend / OnPublish
+ * callback a test or tool installs as the server, Deliver() plays the server side back into the
+ * protocol on the caller's thread. Without a server installed, connecting fails.
+ */
+class HostWebSocket : public WebSocket {
+public:
+    void SetHeader(const char* key, const char* value) override { headers_[key] = value; }
+    bool Connect(const char* uri) override;
+    bool Send(const std::string& data) override { return Send(data.data(), data.size(), false, true); }
+    bool Send(const void* data, size_t len, bool binary = false, bool fin = true) override;
+    void Close() override;
+    bool IsConnected() const override { return connected_; }
+
+    // Server side
+    void OnConnect(std::function<bool(const std::string& uri)> callback) { on_connect_ = callback; }
+    void OnSend(std::function<bool(const void* data, size_t len, bool binary)> callback) { on_send_ = callback; }
+    void Deliver(const char* data, size_t len, bool binary);
+    // Drop the connection as if the server went away
+    void Disconnect();
+    const std::map<std::string, std::string>& headers() const { return headers_; }
+
+private:
+    std::map<std::string, std::string> headers_;
+    std::function<bool(const std::string& uri)> on_connect_;
+    std::function<bool(const void* data, size_t len, bool binary)> on_send_;
+    std::atomic<bool> connected_ = false;
+};
+
+class HostMqtt : public Mqtt {
+public:
+    bool Connect(const std::string broker_address, int broker_port, const std::string client_id,
+        const std::string username, const std::string password) override;
+    void Disconnect() override;
+    bool Publish(const std::string topic, const std::string payload, int qos = 0) override;
+    bool Subscribe(const std::string topic, int qos = 0) override { return connected_; }
+    bool Unsubscribe(const std::string topic) override { return connected_; }
+    bool IsConnected() override { return connected_; }
+
+    // Server side
+    void OnConnect(std::function<bool(const std::string& broker_address, int broker_port)> callback) { on_connect_ = callback; }
+    void OnPublish(std::function<bool(const std::string& topic, const std::string& payload)> callback) { on_publish_ = callback; }
+    void Deliver(const std::string& topic, const std::string& payload);
+
+private:
+    std::function<bool(const std::string& broker_address, int broker_port)> on_connect_;
+    std::function<bool(const std::string& topic, const std::string& payload)> on_publish_;
+    std::atomic<bool> connected_ = false;
+};
+
+class HostUdp : public Udp {
+public:
+    bool Connect(const std::string& host, int port) override;
+    void Disconnect() override { connected_ = false; }
+    int Send(const std::string& data) override { return Send(data.data(), data.size()); }
+    int Send(const void* data, size_t len) override;
+
+    // Server side, OnSend returns the bytes accepted like a socket send
+    void OnSend(std::function<int(const void* data, size_t len)> callback) { on_send_ = callback; }
+    void Deliver(const std::string& data);
+
+private:
+    std::function<int(const void* data, size_t len)> on_send_;
+    std::atomic<bool> connected_ = false;
+};
+
+#endif // _HOST_TRANSPORTS_H_
@@ -0,0 +1,109 @@
+#include "host_board.h"
+#include "audio_service.h"
+#include "loopback_protocol.h"
+#include "codecs/wav_file_audio_codec.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define TAG "XiaozhiHost"
+
+#define HOST_EVENT_SEND_QUEUE  (1 << 0)
+#define HOST_EVENT_TTS_STOP    (1 << 1)
+
+#define HOST_IDLE_TIMEOUT_MS   10000
+
+/*
+ * One listening turn through the real audio pipeline on Linux: input.wav is the microphone, the
+ * loopback protocol plays the recorded uplink back as TTS, and the speaker writes output.wav.
+ * Prints the latency monitor JSON and the pipeline counters when done.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s input.wav output.wav [speed]\n", argv[0]);
+        return 2;
+    }
+    int speed = argc > 3 ? atoi(argv[3]) : 1;
+
+    auto& board = HostBoard::GetInstance();
+    board.SetWavFiles(argv[1], argv[2], speed);
+    auto codec = static_cast<WavFileAudioCodec*>(board.GetAudioCodec());
+
+    EventGroupHandle_t events = xEventGroupCreate();
+    AudioService audio_service;
+    audio_service.Initialize(codec);
+    AudioServiceCallbacks callbacks;
+    callbacks.on_send_queue_available = [events]() {
+        xEventGroupSetBits(events, HOST_EVENT_SEND_QUEUE);
+    };
+    audio_service.SetCallbacks(callbacks);
+    audio_service.Start();
+
+    LoopbackProtocol protocol(speed);
+    protocol.SetPacketAllocator([&audio_service]() {
+        return audio_service.AcquirePacket();
+    });
+    protocol.OnIncomingAudio([&audio_service](std::unique_ptr<AudioStreamPacket> packet) {
+        audio_service.PushPacketToDecodeQueue(std::move(packet), true);
+    });
+    protocol.OnIncomingMessage([events](ControlMessage& message) {
+        auto state = message.GetString("state");
+        if (strcmp(message.type(), "tts") == 0 && state != nullptr && strcmp(state, "stop") == 0) {
+            xEventGroupSetBits(events, HOST_EVENT_TTS_STOP);
+        }
+    });
+    protocol.Start();
+    if (!protocol.OpenAudioChannel()) {
+        ESP_LOGE(TAG, "Failed to open the loopback channel");
+        return 1;
+    }
+
+    auto send_audio = [&]() {
+        while (auto packet = audio_service.PopPacketFromSendQueue()) {
+            if (protocol.SendAudio(*packet)) {
+                audio_service.RecordPacketSent(*packet);
+            } else {
+                audio_service.RecordSendFailure();
+            }
+            audio_service.RecyclePacket(std::move(packet));
+        }
+    };
+
+    int64_t start_time = esp_timer_get_time();
+    protocol.SendStartListening(kListeningModeManualStop);
+    audio_service.EnableVoiceProcessing(true);
+    while (!codec->input_finished()) {
+        xEventGroupWaitBits(events, HOST_EVENT_SEND_QUEUE, pdTRUE, pdFALSE, pdMS_TO_TICKS(20));
+        send_audio();
+    }
+    // The last frames read are still in the processor and the encoder, they belong to this turn
+    vTaskDelay(pdMS_TO_TICKS(OPUS_FRAME_DURATION_MS * 2));
+    audio_service.EnableVoiceProcessing(false);
+    send_audio();
+    protocol.SendStopListening();
+
+    xEventGroupWaitBits(events, HOST_EVENT_TTS_STOP, pdTRUE, pdFALSE, portMAX_DELAY);
+    int64_t idle_deadline = esp_timer_get_time() + HOST_IDLE_TIMEOUT_MS * 1000LL;
+    while (!audio_service.IsIdle() && esp_timer_get_time() < idle_deadline) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    int64_t elapsed_ms = (esp_timer_get_time() - start_time) / 1000;
+
+    auto& stats = audio_service.GetDebugStatistics();
+    printf("%s\n", audio_service.GetLatencyMonitor().GetJson().c_str());
+    printf("{\"elapsed_ms\":%lld,\"input\":%u,\"encode\":%u,\"decode\":%u,\"playback\":%u,"
+        "\"packet_pool_misses\":%u,\"task_pool_misses\":%u,\"jitter_lost\":%u}\n",
+        (long long)elapsed_ms, (unsigned)stats.input_count, (unsigned)stats.encode_count,
+        (unsigned)stats.decode_count, (unsigned)stats.playback_count, (unsigned)stats.packet_pool_misses,
+        (unsigned)stats.task_pool_misses, (unsigned)stats.jitter.lost_count);
+
+    protocol.CloseAudioChannel();
+    audio_service.Stop();
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include "application.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#define SCHEDULE_QUEUE_LENGTH 16
+
+static QueueHandle_t schedule_queue = nullptr;
+
+Application::Application() {
+    schedule_queue = xQueueCreate(SCHEDULE_QUEUE_LENGTH, sizeof(std::function<void()>*));
+    xTaskCreate([](void* arg) {
+        while (true) {
+            std::function<void()>* callback;
+            if (xQueueReceive(schedule_queue, &callback, portMAX_DELAY) == pdTRUE) {
+                (*callback)();
+                delete callback;
+            }
+        }
+    }, "main", 4096 * 2, nullptr, 3, nullptr);
+}
+
+void Application::Schedule(std::function<void()> callback) {
+    auto pending = new std::function<void()>(std::move(callback));
+    xQueueSend(schedule_queue, &pending, portMAX_DELAY);
+}
+
+void Application::SendMcpMessage(const std::string& payload) {
+    if (on_mcp_message_ != nullptr) {
+        on_mcp_message_(payload);
+    }
+}
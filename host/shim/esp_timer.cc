@@ -0,0 +1,146 @@
+#include <esp_timer.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+
+struct HostTimer {
+    esp_timer_cb_t callback;
+    void* arg;
+    std::string name;
+    bool active = false;
+    uint64_t period_us = 0;
+    int64_t due_us = 0;
+};
+
+static const auto kStartTime = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time(void) {
+    auto elapsed = std::chrono::steady_clock::now() - kStartTime;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+namespace {
+
+// Armed timers ordered by due time, served by one thread started with the first timer
+class TimerService {
+public:
+    static TimerService& GetInstance() {
+        static TimerService* instance = new TimerService();
+        return *instance;
+    }
+
+    std::mutex mutex_;
+
+    void Arm(HostTimer* timer, int64_t due_us) {
+        timer->active = true;
+        timer->due_us = due_us;
+        armed_.emplace(due_us, timer);
+        cv_.notify_all();
+    }
+
+    void Disarm(HostTimer* timer) {
+        armed_.erase({timer->due_us, timer});
+        timer->active = false;
+    }
+
+private:
+    std::condition_variable cv_;
+    std::set<std::pair<int64_t, HostTimer*>> armed_;
+
+    TimerService() {
+        std::thread([this]() { Run(); }).detach();
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            if (armed_.empty()) {
+                cv_.wait(lock);
+                continue;
+            }
+            auto [due_us, timer] = *armed_.begin();
+            int64_t now = esp_timer_get_time();
+            if (due_us > now) {
+                cv_.wait_for(lock, std::chrono::microseconds(due_us - now));
+                continue;
+            }
+            armed_.erase(armed_.begin());
+            if (timer->period_us > 0) {
+                // Missed periods are skipped rather than run back to back
+                int64_t next = due_us + timer->period_us;
+                Arm(timer, next > now ? next : now + timer->period_us);
+            } else {
+                timer->active = false;
+            }
+            auto callback = timer->callback;
+            auto arg = timer->arg;
+            lock.unlock();
+            callback(arg);
+            lock.lock();
+        }
+    }
+};
+
+} // namespace
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+    if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto timer = new HostTimer();
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    timer->name = create_args->name != nullptr ? create_args->name : "";
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t Start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us) {
+    auto& service = TimerService::GetInstance();
+    std::lock_guard<std::mutex> lock(service.mutex_);
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = period_us;
+    service.Arm(timer, esp_timer_get_time() + timeout_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return Start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return Start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    auto& service = TimerService::GetInstance();
+    std::lock_guard<std::mutex> lock(service.mutex_);
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    service.Disarm(timer);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    auto& service = TimerService::GetInstance();
+    std::lock_guard<std::mutex> lock(service.mutex_);
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    auto& service = TimerService::GetInstance();
+    std::lock_guard<std::mutex> lock(service.mutex_);
+    return timer->active;
+}
@@ -0,0 +1,303 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct HostTask {
+    std::string name;
+    uint32_t stack_depth = 0;
+    std::atomic<UBaseType_t> priority{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notification_value = 0;
+    bool notification_pending = false;
+};
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+struct HostQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t length;
+    size_t item_size;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+static const auto kStartTime = std::chrono::steady_clock::now();
+static thread_local HostTask* current_task = nullptr;
+static std::atomic<int> fail_next_task_create{0};
+static std::atomic<UBaseType_t> running_tasks{0};
+
+// Deadline of a wait, portMAX_DELAY waits forever
+static std::chrono::steady_clock::time_point Deadline(TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(pdTICKS_TO_MS(ticks));
+}
+
+template <typename Predicate>
+static bool WaitUntil(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+    std::chrono::steady_clock::time_point deadline, Predicate predicate) {
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        cv.wait(lock, predicate);
+        return true;
+    }
+    return cv.wait_until(lock, deadline, predicate);
+}
+
+void host_task_create_fail_next(int count) {
+    fail_next_task_create = count;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth,
+    void* parameters, UBaseType_t priority, TaskHandle_t* created_task, BaseType_t core_id) {
+    (void)core_id;
+    int fail = fail_next_task_create.load();
+    while (fail > 0 && !fail_next_task_create.compare_exchange_weak(fail, fail - 1)) {
+    }
+    if (fail > 0) {
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+
+    // Task handles stay valid for the whole run, a notification may still reach a task that ended
+    auto task = new HostTask();
+    task->name = name != nullptr ? name : "";
+    task->stack_depth = stack_depth;
+    task->priority = priority;
+    if (created_task != nullptr) {
+        *created_task = task;
+    }
+    running_tasks++;
+    std::thread([task, function, parameters]() {
+        current_task = task;
+        function(parameters);
+        running_tasks--;
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* parameters,
+    UBaseType_t priority, TaskHandle_t* created_task) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, parameters, priority, created_task, -1);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    // The task function returns right after, which ends the thread
+    (void)task;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    if (current_task == nullptr) {
+        // A thread the shim did not start, such as main() or a test runner
+        current_task = new HostTask();
+        current_task->name = "host";
+    }
+    return current_task;
+}
+
+static HostTask* Resolve(TaskHandle_t task) {
+    return task != nullptr ? task : xTaskGetCurrentTaskHandle();
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    return Resolve(task)->name.c_str();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    return Resolve(task)->priority;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+    Resolve(task)->priority = priority;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return Resolve(task)->stack_depth;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(pdTICKS_TO_MS(ticks)));
+}
+
+TickType_t xTaskGetTickCount(void) {
+    auto elapsed = std::chrono::steady_clock::now() - kStartTime;
+    return pdMS_TO_TICKS(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+// Tasks the shim started whose function has not returned yet
+UBaseType_t uxTaskGetNumberOfTasks(void) {
+    return running_tasks;
+}
+
+void vTaskDelayUntil(TickType_t* previous_wake_time, TickType_t increment) {
+    *previous_wake_time += increment;
+    auto wake_time = kStartTime + std::chrono::milliseconds(pdTICKS_TO_MS(*previous_wake_time));
+    std::this_thread::sleep_until(wake_time);
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    switch (action) {
+    case eSetBits:
+        task->notification_value |= value;
+        break;
+    case eIncrement:
+        task->notification_value++;
+        break;
+    case eSetValueWithOverwrite:
+        task->notification_value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->notification_pending) {
+            return pdFAIL;
+        }
+        task->notification_value = value;
+        break;
+    default:
+        break;
+    }
+    task->notification_pending = true;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t bits_to_clear_on_entry, uint32_t bits_to_clear_on_exit,
+    uint32_t* notification_value, TickType_t ticks_to_wait) {
+    auto task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (!task->notification_pending) {
+        task->notification_value &= ~bits_to_clear_on_entry;
+    }
+    bool notified = WaitUntil(task->cv, lock, Deadline(ticks_to_wait), [task] { return task->notification_pending; });
+    if (notification_value != nullptr) {
+        *notification_value = task->notification_value;
+    }
+    if (!notified) {
+        return pdFALSE;
+    }
+    task->notification_value &= ~bits_to_clear_on_exit;
+    task->notification_pending = false;
+    return pdTRUE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    auto task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    WaitUntil(task->cv, lock, Deadline(ticks_to_wait), [task] { return task->notification_value != 0; });
+    uint32_t value = task->notification_value;
+    if (value != 0) {
+        task->notification_value = clear_on_exit ? 0 : value - 1;
+    }
+    task->notification_pending = false;
+    return value;
+}
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    return new HostEventGroup();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits_to_wait_for, BaseType_t clear_on_exit,
+    BaseType_t wait_for_all_bits, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto satisfied = [&] {
+        EventBits_t set = group->bits & bits_to_wait_for;
+        return wait_for_all_bits ? set == bits_to_wait_for : set != 0;
+    };
+    bool success = WaitUntil(group->cv, lock, Deadline(ticks_to_wait), satisfied);
+    EventBits_t bits = group->bits;
+    if (success && clear_on_exit) {
+        group->bits &= ~bits_to_wait_for;
+    }
+    return bits;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    auto queue = new HostQueue();
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!WaitUntil(queue->cv, lock, Deadline(ticks_to_wait), [queue] { return queue->items.size() < queue->length; })) {
+        return errQUEUE_FULL;
+    }
+    auto data = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(data, data + queue->item_size);
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!WaitUntil(queue->cv, lock, Deadline(ticks_to_wait), [queue] { return !queue->items.empty(); })) {
+        return errQUEUE_EMPTY;
+    }
+    memcpy(buffer, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->items.size();
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->items.clear();
+    queue->cv.notify_all();
+    return pdPASS;
+}
@@ -0,0 +1,37 @@
+#ifndef _APPLICATION_H_
+#define _APPLICATION_H_
+
+#include <functional>
+#include <string>
+
+#include "audio_service.h"
+
+/*
+ * The part of main/application.h that protocol and MCP code uses. Scheduled callbacks run in order
+ * on a "main" task, like the main event loop on the device.
+ */
+class Application {
+public:
+    static Application& GetInstance() {
+        static Application instance;
+        return instance;
+    }
+    Application(const Application&) = delete;
+    Application& operator=(const Application&) = delete;
+
+    void Schedule(std::function<void()> callback);
+    // Goes to the OnMcpMessage() callback instead of a protocol, dropped without one
+    void SendMcpMessage(const std::string& payload);
+    AudioService& GetAudioService() { return audio_service_; }
+
+    // Host only: tests install the server side of MCP here
+    void OnMcpMessage(std::function<void(const std::string&)> callback) { on_mcp_message_ = callback; }
+
+private:
+    Application();
+
+    AudioService audio_service_;
+    std::function<void(const std::string&)> on_mcp_message_;
+};
+
+#endif // _APPLICATION_H_
@@ -0,0 +1,21 @@
+#ifndef _HOST_BACKLIGHT_H_
+#define _HOST_BACKLIGHT_H_
+
+#include <cstdint>
+
+// The part of main/boards/common/backlight.h that tools use, the host has no screen to light
+class Backlight {
+public:
+    virtual ~Backlight() = default;
+
+    void SetBrightness(uint8_t brightness, bool permanent = false) {
+        (void)permanent;
+        brightness_ = brightness;
+    }
+    inline uint8_t brightness() const { return brightness_; }
+
+protected:
+    uint8_t brightness_ = 0;
+};
+
+#endif // _HOST_BACKLIGHT_H_
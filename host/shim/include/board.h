@@ -0,0 +1,55 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <string>
+
+#include "backlight.h"
+
+/*
+ * The part of main/boards/common/board.h that audio, protocol and MCP code uses. The real header
+ * pulls in display, backlight and network drivers, none of which exist on the host.
+ */
+
+// Forward declarations
+void* create_board();
+class AudioCodec;
+class WebSocket;
+class Mqtt;
+class Udp;
+class Display;
+class Board {
+private:
+    Board(const Board&) = delete;
+    Board& operator=(const Board&) = delete;
+
+protected:
+    Board() = default;
+
+    std::string uuid_;
+
+public:
+    static Board& GetInstance() {
+        static Board* instance = static_cast<Board*>(create_board());
+        return *instance;
+    }
+
+    virtual ~Board() = default;
+    virtual std::string GetBoardType() = 0;
+    virtual std::string GetUuid() { return uuid_; }
+
+    virtual AudioCodec* GetAudioCodec() = 0;
+    virtual Backlight* GetBacklight() { return nullptr; }
+    virtual Display* GetDisplay() { return nullptr; }
+    virtual std::string GetDeviceStatusJson() = 0;
+
+    virtual WebSocket* CreateWebSocket() = 0;
+    virtual Mqtt* CreateMqtt() = 0;
+    virtual Udp* CreateUdp() = 0;
+};
+
+#define DECLARE_BOARD(BOARD_CLASS_NAME) \
+void* create_board() { \
+    return new BOARD_CLASS_NAME(); \
+}
+
+#endif // BOARD_H
@@ -0,0 +1,18 @@
+#ifndef _HOST_DISPLAY_H_
+#define _HOST_DISPLAY_H_
+
+#include <string>
+
+// The part of main/display/display.h that tools use, the host board has no display
+class Display {
+public:
+    virtual ~Display() = default;
+
+    virtual void SetTheme(const std::string& theme_name) { current_theme_name_ = theme_name; }
+    virtual std::string GetTheme() { return current_theme_name_; }
+
+protected:
+    std::string current_theme_name_;
+};
+
+#endif // _HOST_DISPLAY_H_
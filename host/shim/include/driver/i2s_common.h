@@ -0,0 +1,25 @@
+#ifndef _HOST_DRIVER_I2S_COMMON_H_
+#define _HOST_DRIVER_I2S_COMMON_H_
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The host has no I2S peripheral, codecs there read and write files and leave their channels unset
+typedef struct i2s_channel_obj_t* i2s_chan_handle_t;
+
+static inline esp_err_t i2s_channel_enable(i2s_chan_handle_t handle) {
+    return handle != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+static inline esp_err_t i2s_channel_disable(i2s_chan_handle_t handle) {
+    return handle != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_DRIVER_I2S_COMMON_H_
@@ -0,0 +1,6 @@
+#ifndef _HOST_DRIVER_I2S_STD_H_
+#define _HOST_DRIVER_I2S_STD_H_
+
+#include "driver/i2s_common.h"
+
+#endif // _HOST_DRIVER_I2S_STD_H_
@@ -0,0 +1,26 @@
+#ifndef _HOST_ESP_APP_DESC_H_
+#define _HOST_ESP_APP_DESC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The fields of esp_app_desc_t that firmware code reads
+typedef struct {
+    char version[32];
+    char project_name[32];
+    char time[16];
+    char date[16];
+    char idf_ver[32];
+} esp_app_desc_t;
+
+static inline const esp_app_desc_t* esp_app_get_description(void) {
+    static const esp_app_desc_t desc = {"host", "xiaozhi", "00:00:00", "Jan  1 2025", "host"};
+    return &desc;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_ESP_APP_DESC_H_
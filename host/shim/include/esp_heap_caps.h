@@ -0,0 +1,29 @@
+#ifndef _HOST_ESP_HEAP_CAPS_H_
+#define _HOST_ESP_HEAP_CAPS_H_
+
+#include <malloc.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+// A nominal heap whose free size drops with every byte malloc hands out, only differences are meaningful
+#define HOST_HEAP_CAPS_SIZE ((size_t)512 * 1024 * 1024)
+
+static inline size_t heap_caps_get_free_size(unsigned int caps) {
+    (void)caps;
+    return HOST_HEAP_CAPS_SIZE - mallinfo2().uordblks;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_ESP_HEAP_CAPS_H_
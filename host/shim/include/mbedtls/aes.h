@@ -0,0 +1,28 @@
+#ifndef _HOST_MBEDTLS_AES_H_
+#define _HOST_MBEDTLS_AES_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MBEDTLS_ERR_AES_INVALID_KEY_LENGTH -0x0020
+#define MBEDTLS_ERR_AES_BAD_INPUT_DATA     -0x0021
+
+// The AES subset the firmware uses, backed by OpenSSL on the host
+typedef struct {
+    void* cipher;  // EVP_CIPHER_CTX in ECB mode, encrypts the counter blocks
+} mbedtls_aes_context;
+
+void mbedtls_aes_init(mbedtls_aes_context* ctx);
+void mbedtls_aes_free(mbedtls_aes_context* ctx);
+int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits);
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context* ctx, size_t length, size_t* nc_off, unsigned char nonce_counter[16],
+    unsigned char stream_block[16], const unsigned char* input, unsigned char* output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_MBEDTLS_AES_H_
@@ -0,0 +1,31 @@
+#ifndef _HOST_MODEL_PATH_H_
+#define _HOST_MODEL_PATH_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// esp-sr is not built for the host, there are never any models, so no wake word engine is created
+typedef struct {
+    char** model_name;
+    char** model_info;
+    int num;
+} srmodel_list_t;
+
+#define ESP_WN_PREFIX "wn"
+#define ESP_MN_PREFIX "mn"
+
+static inline char* esp_srmodel_filter(srmodel_list_t* models, const char* keyword1, const char* keyword2) {
+    (void)models;
+    (void)keyword1;
+    (void)keyword2;
+    return NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_MODEL_PATH_H_
@@ -0,0 +1,29 @@
+#ifndef _HOST_OPUS_RESAMPLER_H_
+#define _HOST_OPUS_RESAMPLER_H_
+
+#include <cstdint>
+
+/*
+ * Host stand-in for the esp-opus-encoder resampler, same interface. The device uses the SILK
+ * resampler from libopus internals, which a system libopus does not export, so the host
+ * interpolates linearly. Output lengths match the device, sample values do not.
+ */
+class OpusResampler {
+public:
+    OpusResampler();
+    ~OpusResampler();
+
+    void Configure(int input_sample_rate, int output_sample_rate);
+    void Process(const int16_t* input, int input_samples, int16_t* output);
+    int GetOutputSamples(int input_samples) const;
+
+    int input_sample_rate() const { return input_sample_rate_; }
+    int output_sample_rate() const { return output_sample_rate_; }
+
+private:
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    int16_t last_sample_ = 0;
+};
+
+#endif // _HOST_OPUS_RESAMPLER_H_
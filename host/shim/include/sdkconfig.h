@@ -0,0 +1,21 @@
+#ifndef _HOST_SDKCONFIG_H_
+#define _HOST_SDKCONFIG_H_
+
+/*
+ * Configuration of the Linux host build, force-included into every source like the generated
+ * sdkconfig.h of a firmware build. Options follow the Kconfig defaults of main/Kconfig.projbuild.
+ */
+
+#define CONFIG_IDF_TARGET "linux"
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_HZ 1000
+
+#define CONFIG_IOT_PROTOCOL_MCP 1
+#define CONFIG_OPUS_UPLINK_FRAME_DURATION_60 1
+#define CONFIG_OPUS_UPLINK_FRAME_DURATION 60
+#define CONFIG_OPUS_UPLINK_BITRATE 0
+#define CONFIG_OPUS_UPLINK_ADAPTIVE 1
+#define CONFIG_UPLINK_BACKPRESSURE_DROP_OLDEST 1
+#define CONFIG_LOOPBACK_REPLAY_SPEED 1
+
+#endif // _HOST_SDKCONFIG_H_
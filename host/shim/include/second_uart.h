@@ -0,0 +1,41 @@
+#ifndef _HOST_SECOND_UART_H_
+#define _HOST_SECOND_UART_H_
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * The part of main/second_uart.h that tools and the robot sequencer use. There is no robot on the
+ * host, commands are kept in order so tests can check what would have gone out.
+ */
+class SecondUart {
+public:
+    static SecondUart& GetInstance() {
+        static SecondUart instance;
+        return instance;
+    }
+    SecondUart(const SecondUart&) = delete;
+    SecondUart& operator=(const SecondUart&) = delete;
+
+    void SendString(const std::string& str) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sent_.push_back(str);
+    }
+
+    // Host only: commands sent since the last call
+    std::vector<std::string> TakeSent() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::string> sent;
+        sent.swap(sent_);
+        return sent;
+    }
+
+private:
+    SecondUart() = default;
+
+    std::mutex mutex_;
+    std::vector<std::string> sent_;
+};
+
+#endif // _HOST_SECOND_UART_H_
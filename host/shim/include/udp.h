@@ -0,0 +1,25 @@
+#ifndef _HOST_UDP_H_
+#define _HOST_UDP_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// The esp-ml307 Udp interface the protocols use, the host board supplies the implementation
+class Udp {
+public:
+    virtual ~Udp() = default;
+
+    virtual bool Connect(const std::string& host, int port) = 0;
+    virtual void Disconnect() = 0;
+    virtual int Send(const std::string& data) = 0;
+    // Not in esp-ml307, MqttProtocol uses it where a transport has it to send a datagram without copying
+    virtual int Send(const void* data, size_t len) = 0;
+
+    virtual void OnMessage(std::function<void(const std::string& data)> callback) { message_callback_ = callback; }
+
+protected:
+    std::function<void(const std::string& data)> message_callback_;
+};
+
+#endif // _HOST_UDP_H_
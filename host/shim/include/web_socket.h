@@ -0,0 +1,31 @@
+#ifndef _HOST_WEB_SOCKET_H_
+#define _HOST_WEB_SOCKET_H_
+
+#include <functional>
+#include <string>
+
+// The esp-ml307 WebSocket interface the protocols use, the host board supplies the implementation
+class WebSocket {
+public:
+    virtual ~WebSocket() = default;
+
+    virtual void SetHeader(const char* key, const char* value) = 0;
+    virtual bool Connect(const char* uri) = 0;
+    virtual bool Send(const std::string& data) = 0;
+    virtual bool Send(const void* data, size_t len, bool binary = false, bool fin = true) = 0;
+    virtual void Close() = 0;
+    virtual bool IsConnected() const = 0;
+
+    void OnConnected(std::function<void()> callback) { on_connected_ = callback; }
+    void OnDisconnected(std::function<void()> callback) { on_disconnected_ = callback; }
+    void OnData(std::function<void(const char*, size_t, bool binary)> callback) { on_data_ = callback; }
+    void OnError(std::function<void(int)> callback) { on_error_ = callback; }
+
+protected:
+    std::function<void()> on_connected_;
+    std::function<void()> on_disconnected_;
+    std::function<void(const char*, size_t, bool binary)> on_data_;
+    std::function<void(int)> on_error_;
+};
+
+#endif // _HOST_WEB_SOCKET_H_
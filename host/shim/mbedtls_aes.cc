@@ -0,0 +1,62 @@
+#include <mbedtls/aes.h>
+
+#include <openssl/evp.h>
+
+#include <cstring>
+
+void mbedtls_aes_init(mbedtls_aes_context* ctx) {
+    ctx->cipher = nullptr;
+}
+
+void mbedtls_aes_free(mbedtls_aes_context* ctx) {
+    if (ctx->cipher != nullptr) {
+        EVP_CIPHER_CTX_free(static_cast<EVP_CIPHER_CTX*>(ctx->cipher));
+        ctx->cipher = nullptr;
+    }
+}
+
+int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+    const EVP_CIPHER* type;
+    switch (keybits) {
+    case 128: type = EVP_aes_128_ecb(); break;
+    case 192: type = EVP_aes_192_ecb(); break;
+    case 256: type = EVP_aes_256_ecb(); break;
+    default: return MBEDTLS_ERR_AES_INVALID_KEY_LENGTH;
+    }
+    mbedtls_aes_free(ctx);
+    auto cipher = EVP_CIPHER_CTX_new();
+    if (cipher == nullptr || EVP_EncryptInit_ex(cipher, type, nullptr, key, nullptr) != 1) {
+        EVP_CIPHER_CTX_free(cipher);
+        return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+    }
+    EVP_CIPHER_CTX_set_padding(cipher, 0);
+    ctx->cipher = cipher;
+    return 0;
+}
+
+// Same counter handling as mbedtls: the whole 16-byte block is a big endian counter
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context* ctx, size_t length, size_t* nc_off, unsigned char nonce_counter[16],
+    unsigned char stream_block[16], const unsigned char* input, unsigned char* output) {
+    auto cipher = static_cast<EVP_CIPHER_CTX*>(ctx->cipher);
+    if (cipher == nullptr || *nc_off > 15) {
+        return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+    }
+    size_t n = *nc_off;
+    for (size_t i = 0; i < length; i++) {
+        if (n == 0) {
+            int out_length = 0;
+            if (EVP_EncryptUpdate(cipher, stream_block, &out_length, nonce_counter, 16) != 1 || out_length != 16) {
+                return MBEDTLS_ERR_AES_BAD_INPUT_DATA;
+            }
+            for (int j = 15; j >= 0; j--) {
+                if (++nonce_counter[j] != 0) {
+                    break;
+                }
+            }
+        }
+        output[i] = input[i] ^ stream_block[n];
+        n = (n + 1) & 0x0f;
+    }
+    *nc_off = n;
+    return 0;
+}
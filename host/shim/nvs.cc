@@ -0,0 +1,135 @@
+#include <nvs.h>
+#include <nvs_flash.h>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <variant>
+
+namespace {
+
+using Value = std::variant<std::string, int32_t>;
+using Namespace = std::map<std::string, Value>;
+
+std::mutex store_mutex;
+std::map<std::string, Namespace> store;
+std::map<nvs_handle_t, std::string> open_handles;
+nvs_handle_t next_handle = 1;
+
+Namespace* Find(nvs_handle_t handle) {
+    auto it = open_handles.find(handle);
+    if (it == open_handles.end()) {
+        return nullptr;
+    }
+    return &store[it->second];
+}
+
+} // namespace
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    store.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* namespace_name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    if (open_mode == NVS_READONLY && store.find(namespace_name) == store.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    store[namespace_name];
+    *out_handle = next_handle++;
+    open_handles[*out_handle] = namespace_name;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    open_handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    return Find(handle) != nullptr ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    auto ns = Find(handle);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto it = ns->find(key);
+    if (it == ns->end() || !std::holds_alternative<std::string>(it->second)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    auto& value = std::get<std::string>(it->second);
+    if (out_value == nullptr) {
+        *length = value.size() + 1;
+        return ESP_OK;
+    }
+    if (*length < value.size() + 1) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, value.c_str(), value.size() + 1);
+    *length = value.size() + 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    auto ns = Find(handle);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    (*ns)[key] = std::string(value);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* out_value) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    auto ns = Find(handle);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto it = ns->find(key);
+    if (it == ns->end() || !std::holds_alternative<int32_t>(it->second)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *out_value = std::get<int32_t>(it->second);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    auto ns = Find(handle);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    (*ns)[key] = value;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    auto ns = Find(handle);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ns->erase(key) > 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    auto ns = Find(handle);
+    if (ns == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ns->clear();
+    return ESP_OK;
+}
@@ -0,0 +1,36 @@
+#include <opus_resampler.h>
+
+OpusResampler::OpusResampler() {
+}
+
+OpusResampler::~OpusResampler() {
+}
+
+void OpusResampler::Configure(int input_sample_rate, int output_sample_rate) {
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    last_sample_ = 0;
+}
+
+int OpusResampler::GetOutputSamples(int input_samples) const {
+    if (input_sample_rate_ <= 0) {
+        return input_samples;
+    }
+    return input_samples * output_sample_rate_ / input_sample_rate_;
+}
+
+void OpusResampler::Process(const int16_t* input, int input_samples, int16_t* output) {
+    int output_samples = GetOutputSamples(input_samples);
+    for (int i = 0; i < output_samples; ++i) {
+        // Position in the input, one sample behind so the previous block's last sample joins the blocks
+        int64_t position = (int64_t)i * input_sample_rate_ * 256 / output_sample_rate_;
+        int index = position >> 8;
+        int fraction = position & 0xff;
+        int16_t previous = index == 0 ? last_sample_ : input[index - 1];
+        int16_t current = input[index];
+        output[i] = previous + ((current - previous) * fraction >> 8);
+    }
+    if (input_samples > 0) {
+        last_sample_ = input[input_samples - 1];
+    }
+}
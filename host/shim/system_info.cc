@@ -0,0 +1,34 @@
+#include "system_info.h"
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+
+#define TAG "SystemInfo"
+
+size_t SystemInfo::GetFlashSize() {
+    return 16 * 1024 * 1024;
+}
+
+size_t SystemInfo::GetMinimumFreeHeapSize() {
+    return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+size_t SystemInfo::GetFreeHeapSize() {
+    return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+std::string SystemInfo::GetMacAddress() {
+    return "02:00:00:00:00:01";
+}
+
+std::string SystemInfo::GetChipModelName() {
+    return "linux";
+}
+
+std::string SystemInfo::GetUserAgent() {
+    return std::string(BOARD_NAME "/host");
+}
+
+void SystemInfo::PrintHeapStats() {
+    ESP_LOGI(TAG, "free heap: %u", (unsigned)GetFreeHeapSize());
+}
@@ -0,0 +1,183 @@
+#include "audio_service.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#define INPUT_SAMPLE_RATE 24000
+#define FEED_SAMPLES      480     // 30 ms at 16 kHz, what NoAudioProcessor asks for
+#define BENCHMARK_FRAMES  5000
+
+// Heap allocations made by the calling thread, other tasks of the shim do not count
+static thread_local size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// Stereo I2S at 24 kHz with the playback reference on the second channel, like lichuang-c3-dev
+class StereoCodec : public AudioCodec {
+public:
+    StereoCodec() {
+        duplex_ = true;
+        input_reference_ = true;
+        input_channels_ = 2;
+        input_sample_rate_ = INPUT_SAMPLE_RATE;
+        output_sample_rate_ = INPUT_SAMPLE_RATE;
+        // One second of signal, precomputed so that the benchmark measures the read path and not sin()
+        signal_.resize(INPUT_SAMPLE_RATE * 2);
+        for (int i = 0; i < INPUT_SAMPLE_RATE; i++) {
+            signal_[2 * i] = (int16_t)(8000 * sin(2 * M_PI * 440 * i / INPUT_SAMPLE_RATE));
+            signal_[2 * i + 1] = (int16_t)(4000 * sin(2 * M_PI * 1000 * i / INPUT_SAMPLE_RATE));
+        }
+    }
+
+private:
+    std::vector<int16_t> signal_;
+    size_t position_ = 0;
+
+    virtual int Read(int16_t* dest, int samples) override {
+        for (int copied = 0; copied < samples;) {
+            size_t count = std::min<size_t>(samples - copied, signal_.size() - position_);
+            std::copy_n(signal_.begin() + position_, count, dest + copied);
+            position_ = (position_ + count) % signal_.size();
+            copied += count;
+        }
+        return samples;
+    }
+
+    virtual int Write(const int16_t* data, int samples) override {
+        return samples;
+    }
+};
+
+/*
+ * ReadAudioData before the input buffers were made persistent: deinterleave into two new vectors,
+ * resample both into two more, re-interleave, and then the processor deinterleaves the mic again.
+ */
+class PreviousInputPath {
+public:
+    explicit PreviousInputPath(AudioCodec* codec) : codec_(codec) {
+        input_resampler_.Configure(codec->input_sample_rate(), 16000);
+        reference_resampler_.Configure(codec->input_sample_rate(), 16000);
+    }
+
+    bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
+        data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
+        if (!codec_->InputData(data)) {
+            return false;
+        }
+        auto mic_channel = std::vector<int16_t>(data.size() / 2);
+        auto reference_channel = std::vector<int16_t>(data.size() / 2);
+        for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
+            mic_channel[i] = data[j];
+            reference_channel[i] = data[j + 1];
+        }
+        auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
+        auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
+        input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
+        reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
+        data.resize(resampled_mic.size() + resampled_reference.size());
+        for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
+            data[j] = resampled_mic[i];
+            data[j + 1] = resampled_reference[i];
+        }
+        return true;
+    }
+
+    // NoAudioProcessor::Feed() took the interleaved vector and split off the mic channel
+    std::vector<int16_t> FeedMono(std::vector<int16_t>&& data) {
+        auto mono_data = std::vector<int16_t>(data.size() / 2);
+        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
+            mono_data[i] = data[j];
+        }
+        return mono_data;
+    }
+
+private:
+    AudioCodec* codec_;
+    OpusResampler input_resampler_;
+    OpusResampler reference_resampler_;
+};
+
+TEST(AudioInputTest, FusedReadMatchesPreviousPath) {
+    StereoCodec codec;
+    StereoCodec previous_codec;
+    AudioService audio_service;
+    audio_service.Initialize(&codec);
+    PreviousInputPath previous(&previous_codec);
+
+    AudioInputFrame frame;
+    std::vector<int16_t> data;
+    for (int n = 0; n < 20; n++) {
+        ASSERT_TRUE(audio_service.ReadAudioData(frame, FEED_SAMPLES));
+        ASSERT_TRUE(previous.ReadAudioData(data, 16000, FEED_SAMPLES));
+        ASSERT_EQ(frame.channels(), 2);
+        ASSERT_EQ(frame.mic.size(), (size_t)FEED_SAMPLES);
+        ASSERT_EQ(frame.reference.size(), (size_t)FEED_SAMPLES);
+        for (size_t i = 0; i < frame.mic.size(); i++) {
+            ASSERT_EQ(frame.mic[i], data[2 * i]) << "frame " << n << " sample " << i;
+            ASSERT_EQ(frame.reference[i], data[2 * i + 1]) << "frame " << n << " sample " << i;
+        }
+    }
+}
+
+TEST(AudioInputBenchmark, FusedReadVersusTemporaryVectors) {
+    StereoCodec codec;
+    AudioService audio_service;
+    audio_service.Initialize(&codec);
+    StereoCodec previous_codec;
+    PreviousInputPath previous(&previous_codec);
+    int64_t checksum = 0;
+
+    // Warm up both, so only the steady state is counted
+    AudioInputFrame frame;
+    std::vector<int16_t> data;
+    ASSERT_TRUE(audio_service.ReadAudioData(frame, FEED_SAMPLES));
+    ASSERT_TRUE(previous.ReadAudioData(data, 16000, FEED_SAMPLES));
+
+    size_t start_allocations = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCHMARK_FRAMES; n++) {
+        previous.ReadAudioData(data, 16000, FEED_SAMPLES);
+        auto mono = previous.FeedMono(std::move(data));
+        checksum += mono[n % mono.size()];
+    }
+    std::chrono::duration<double, std::micro> previous_time = std::chrono::steady_clock::now() - start;
+    double previous_allocations = double(allocations - start_allocations) / BENCHMARK_FRAMES;
+
+    start_allocations = allocations;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCHMARK_FRAMES; n++) {
+        audio_service.ReadAudioData(frame, FEED_SAMPLES);
+        checksum += frame.mic[n % frame.mic.size()];
+    }
+    std::chrono::duration<double, std::micro> fused_time = std::chrono::steady_clock::now() - start;
+    double fused_allocations = double(allocations - start_allocations) / BENCHMARK_FRAMES;
+
+    // Informational: the host resampler is a linear stand-in, on the device it is the larger share of a frame
+    printf("Stereo 24 kHz read of %d samples: temporary vectors %.2f us/frame %.1f allocations/frame, "
+        "fused %.2f us/frame %.1f allocations/frame (checksum %lld)\n",
+        FEED_SAMPLES, previous_time.count() / BENCHMARK_FRAMES, previous_allocations,
+        fused_time.count() / BENCHMARK_FRAMES, fused_allocations, (long long)checksum);
+    EXPECT_GE(previous_allocations, 5.0);
+    EXPECT_EQ(fused_allocations, 0.0);
+}
@@ -0,0 +1,108 @@
+#include "audio_jitter_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#define FRAME_US 60000
+
+static std::unique_ptr<AudioStreamPacket> MakePacket(uint32_t sequence) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->sequence = sequence;
+    packet->frame_duration = 60;
+    packet->payload.assign(20, (uint8_t)sequence);
+    return packet;
+}
+
+class AudioJitterBufferTest : public ::testing::Test {
+protected:
+    AudioJitterBuffer buffer_{60};
+    std::unique_ptr<AudioStreamPacket> packet_;
+    const AudioStreamPacket* fec_ = nullptr;
+
+    JitterFrameType Get(int64_t now_us) { return buffer_.Get(now_us, packet_, fec_); }
+
+    // Start playing at depth 1 with packet 1 at t = 0
+    void StartPlaying() {
+        buffer_.Put(MakePacket(1), 0);
+        ASSERT_EQ(Get(0), kJitterFramePacket);
+        ASSERT_EQ(packet_->sequence, 1u);
+    }
+};
+
+TEST_F(AudioJitterBufferTest, HoldsForSwappedPacketAtDepthOne) {
+    StartPlaying();
+    ASSERT_EQ(buffer_.statistics().target_depth, 1u);
+
+    // 3 overtakes 2, which comes 10 ms later
+    buffer_.Put(MakePacket(3), FRAME_US);
+    EXPECT_EQ(Get(FRAME_US), kJitterFrameNone);
+    EXPECT_GT(buffer_.WaitTimeMs(FRAME_US), 0);
+    buffer_.Put(MakePacket(2), FRAME_US + 10000);
+
+    ASSERT_EQ(Get(FRAME_US + 10000), kJitterFramePacket);
+    EXPECT_EQ(packet_->sequence, 2u);
+    ASSERT_EQ(Get(FRAME_US + 10000), kJitterFramePacket);
+    EXPECT_EQ(packet_->sequence, 3u);
+
+    EXPECT_EQ(buffer_.statistics().lost_count, 0u);
+    EXPECT_EQ(buffer_.statistics().reordered_count, 1u);
+    EXPECT_EQ(buffer_.statistics().late_count, 0u);
+}
+
+TEST_F(AudioJitterBufferTest, HoldIsCountedFromTheNewerPacketAndBounded) {
+    StartPlaying();
+
+    int64_t arrival = FRAME_US;
+    buffer_.Put(MakePacket(3), arrival);
+    // Still within one frame of 3's arrival
+    EXPECT_EQ(Get(arrival + FRAME_US - 1000), kJitterFrameNone);
+    EXPECT_LE(buffer_.WaitTimeMs(arrival + FRAME_US - 1000), 1);
+
+    // Hold expired: 2 is lost and recovered from 3's FEC
+    ASSERT_EQ(Get(arrival + FRAME_US), kJitterFrameFec);
+    EXPECT_EQ(fec_->sequence, 3u);
+    EXPECT_EQ(buffer_.statistics().lost_count, 1u);
+    ASSERT_EQ(Get(arrival + FRAME_US), kJitterFramePacket);
+    EXPECT_EQ(packet_->sequence, 3u);
+
+    // 2 turning up now is late
+    buffer_.Put(MakePacket(2), arrival + FRAME_US + 5000);
+    EXPECT_EQ(buffer_.statistics().late_count, 1u);
+}
+
+TEST_F(AudioJitterBufferTest, HoldsEvenWithManyNewerPacketsBuffered) {
+    StartPlaying();
+
+    for (uint32_t sequence = 3; sequence < 8; sequence++) {
+        buffer_.Put(MakePacket(sequence), FRAME_US);
+    }
+    EXPECT_EQ(Get(FRAME_US + 1000), kJitterFrameNone);
+    buffer_.Put(MakePacket(2), FRAME_US + 2000);
+    for (uint32_t sequence = 2; sequence < 8; sequence++) {
+        ASSERT_EQ(Get(FRAME_US + 2000), kJitterFramePacket);
+        EXPECT_EQ(packet_->sequence, sequence);
+    }
+    EXPECT_EQ(buffer_.statistics().lost_count, 0u);
+}
+
+TEST_F(AudioJitterBufferTest, HoldNeverExceedsTheCap) {
+    StartPlaying();
+
+    // Heavy jitter raises the target depth past what the cap allows
+    int64_t now = 0;
+    for (uint32_t sequence = 2; sequence < 40; sequence++) {
+        now += (sequence % 2) ? 4 * FRAME_US : 0;
+        buffer_.Put(MakePacket(sequence), now);
+        while (Get(now + 8 * FRAME_US) != kJitterFrameNone) {
+        }
+    }
+    ASSERT_GT(buffer_.statistics().target_depth * 60, (uint32_t)JITTER_BUFFER_MAX_HOLD_MS);
+
+    // 40 is missing, enough newer packets arrive to reach the target depth
+    for (uint32_t sequence = 41; sequence < 41 + buffer_.statistics().target_depth; sequence++) {
+        buffer_.Put(MakePacket(sequence), now + FRAME_US);
+    }
+    EXPECT_EQ(Get(now + FRAME_US + JITTER_BUFFER_MAX_HOLD_MS * 1000 - 1000), kJitterFrameNone);
+    EXPECT_EQ(Get(now + FRAME_US + JITTER_BUFFER_MAX_HOLD_MS * 1000), kJitterFrameFec);
+}
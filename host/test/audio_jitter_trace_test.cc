@@ -0,0 +1,168 @@
+#include "audio_jitter_buffer.h"
+#include "opus_frame_decoder.h"
+#include "opus_frame_encoder.h"
+#include "host_test_util.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#define SAMPLE_RATE       16000
+#define FRAME_MS          60
+#define FRAME_SAMPLES     (SAMPLE_RATE * FRAME_MS / 1000)
+#define TRACE_FRAMES      50
+#define PLAYBACK_FRAMES   2
+
+// One received UDP packet: its sequence and when it arrived, relative to when it was sent
+struct TraceEntry {
+    uint32_t sequence;
+    int delay_ms;
+};
+
+/*
+ * 11 and 26 overtaken by the next packet, 18 lost, a burst loss of 33 and 34, and 40 arriving
+ * far too late to be played. With jitter, the other packets are up to 15 ms late, which raises
+ * the target depth; without, the buffer stays at depth 1.
+ */
+static std::vector<TraceEntry> LossyTrace(bool jitter) {
+    static const int kJitterMs[] = {0, 12, 3, 15, 7, 0, 9, 14, 2, 6};
+    std::vector<TraceEntry> trace;
+    for (uint32_t sequence = 1; sequence <= TRACE_FRAMES; sequence++) {
+        if (sequence == 18 || sequence == 33 || sequence == 34) {
+            continue;
+        }
+        int delay_ms = jitter ? kJitterMs[sequence % 10] : 0;
+        if (sequence == 11 || sequence == 26) {
+            delay_ms = FRAME_MS + 20;   // Arrives 20 ms after the next one
+        } else if (sequence == 40) {
+            delay_ms = 500;
+        }
+        trace.push_back({sequence, delay_ms});
+    }
+    return trace;
+}
+
+class AudioJitterTraceTest : public ::testing::Test {
+protected:
+    std::vector<std::vector<uint8_t>> opus_frames_;
+
+    void SetUp() override {
+        // Sequence n carries frame n - 1 of the tone, encoded with in-band FEC like the server sends it
+        OpusFrameEncoder encoder(SAMPLE_RATE, 1, FRAME_MS);
+        encoder.SetBitrate(32000);
+        encoder.SetInbandFec(true, 20);
+        auto tone = SineWave(SAMPLE_RATE, FRAME_MS * TRACE_FRAMES, 300);
+        opus_frames_.resize(TRACE_FRAMES);
+        for (int i = 0; i < TRACE_FRAMES; i++) {
+            ASSERT_TRUE(encoder.Encode(tone.data() + i * FRAME_SAMPLES, FRAME_SAMPLES, opus_frames_[i]));
+        }
+    }
+
+    std::unique_ptr<AudioStreamPacket> MakePacket(uint32_t sequence) {
+        auto packet = std::make_unique<AudioStreamPacket>();
+        packet->sample_rate = SAMPLE_RATE;
+        packet->frame_duration = FRAME_MS;
+        packet->sequence = sequence;
+        packet->timestamp = (sequence - 1) * FRAME_MS;
+        packet->payload = opus_frames_[sequence - 1];
+        return packet;
+    }
+
+    void ReplayLossyTrace(bool jitter);
+};
+
+/*
+ * Replays the trace in 1 ms steps the way the opus codec task drives the buffer: decode whenever
+ * the playback queue has room and the buffer hands out a frame, while the speaker takes one frame
+ * every FRAME_MS once playback started.
+ */
+void AudioJitterTraceTest::ReplayLossyTrace(bool jitter) {
+    auto trace = LossyTrace(jitter);
+    AudioJitterBuffer buffer(FRAME_MS);
+    OpusFrameDecoder decoder(SAMPLE_RATE, 1, FRAME_MS);
+
+    std::deque<std::vector<int16_t>> playback;
+    std::vector<int16_t> output;
+    std::vector<JitterFrameType> frame_types;
+    int64_t next_play_ms = -1;
+    bool decode_failed = false;
+
+    for (int64_t now_ms = 0; now_ms < (TRACE_FRAMES + 20) * FRAME_MS; now_ms++) {
+        int64_t now_us = now_ms * 1000;
+        for (auto& entry : trace) {
+            if ((int64_t)(entry.sequence - 1) * FRAME_MS + entry.delay_ms == now_ms) {
+                buffer.Put(MakePacket(entry.sequence), now_us);
+            }
+        }
+
+        while (playback.size() < PLAYBACK_FRAMES) {
+            std::unique_ptr<AudioStreamPacket> packet;
+            const AudioStreamPacket* fec_packet = nullptr;
+            auto type = buffer.Get(now_us, packet, fec_packet);
+            if (type == kJitterFrameNone) {
+                break;
+            }
+            std::vector<int16_t> pcm;
+            bool success;
+            if (type == kJitterFramePacket) {
+                success = decoder.Decode(packet->opus_data(), packet->opus_size(), pcm);
+            } else if (type == kJitterFrameFec) {
+                success = decoder.DecodeFec(fec_packet->opus_data(), fec_packet->opus_size(), pcm);
+            } else {
+                success = decoder.Conceal(pcm);
+            }
+            decode_failed = decode_failed || !success || pcm.size() != FRAME_SAMPLES;
+            frame_types.push_back(type);
+            playback.push_back(std::move(pcm));
+        }
+
+        if (next_play_ms < 0 && !playback.empty()) {
+            next_play_ms = now_ms;
+        }
+        if (next_play_ms >= 0 && now_ms == next_play_ms) {
+            if (!playback.empty()) {
+                output.insert(output.end(), playback.front().begin(), playback.front().end());
+                playback.pop_front();
+            }
+            next_play_ms += FRAME_MS;
+        }
+    }
+
+    auto& statistics = buffer.statistics();
+    EXPECT_FALSE(decode_failed);
+    // Every sequence is played exactly once, either decoded, recovered from FEC or concealed
+    ASSERT_EQ(frame_types.size(), (size_t)TRACE_FRAMES);
+    EXPECT_EQ(output.size(), (size_t)TRACE_FRAMES * FRAME_SAMPLES);
+
+    // The overtaken packets were waited for, the lost ones were not skipped
+    EXPECT_EQ(statistics.reordered_count, 2u);
+    EXPECT_EQ(statistics.lost_count, 4u);
+    EXPECT_EQ(statistics.late_count, 1u);
+    EXPECT_EQ(frame_types[10], kJitterFramePacket);
+    EXPECT_EQ(frame_types[25], kJitterFramePacket);
+    EXPECT_EQ(frame_types[17], kJitterFrameFec);
+    EXPECT_EQ(frame_types[32], kJitterFrameLost);
+    EXPECT_EQ(frame_types[33], kJitterFrameFec);
+    EXPECT_EQ(frame_types[39], kJitterFrameFec);
+    EXPECT_EQ(statistics.fec_count, 3u);
+    if (!jitter) {
+        // The overtaken packets must not be given up on just because a newer one is buffered
+        EXPECT_EQ(statistics.target_depth, 1u);
+    }
+
+    // The overtaken packets are played as sent, not concealed
+    for (int index : {10, 25}) {
+        std::vector<int16_t> frame(output.begin() + index * FRAME_SAMPLES, output.begin() + (index + 1) * FRAME_SAMPLES);
+        EXPECT_GT(Rms(frame), 1000) << "frame " << index;
+    }
+}
+
+TEST_F(AudioJitterTraceTest, ReorderedAndLostOnCleanLink) {
+    ReplayLossyTrace(false);
+}
+
+TEST_F(AudioJitterTraceTest, ReorderedAndLostOnJitteryLink) {
+    ReplayLossyTrace(true);
+}
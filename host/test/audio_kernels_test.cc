@@ -0,0 +1,137 @@
+#include "codecs/audio_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#define FRAME_SAMPLES    1440    // 60 ms at 24 kHz, one OutputData() buffer
+#define BENCHMARK_FRAMES 20000
+
+// The per-sample code NoAudioCodec and NoAudioCodecSimplexPdm used before the kernels
+
+static void PreviousWrite(const int16_t* data, int samples, int output_volume, std::vector<int32_t>& out) {
+    std::vector<int32_t> buffer(samples);
+    int32_t volume_factor = pow(double(output_volume) / 100.0, 2) * 65536;
+    for (int i = 0; i < samples; i++) {
+        int64_t temp = int64_t(data[i]) * volume_factor;
+        if (temp > INT32_MAX) {
+            buffer[i] = INT32_MAX;
+        } else if (temp < INT32_MIN) {
+            buffer[i] = INT32_MIN;
+        } else {
+            buffer[i] = static_cast<int32_t>(temp);
+        }
+    }
+    out.swap(buffer);
+}
+
+static void PreviousRead(const int32_t* src, int16_t* dest, int samples) {
+    std::vector<int32_t> bit32_buffer(src, src + samples);
+    for (int i = 0; i < samples; i++) {
+        int32_t value = bit32_buffer[i] >> 12;
+        dest[i] = (value > INT16_MAX) ? INT16_MAX : (value < -INT16_MAX) ? -INT16_MAX : (int16_t)value;
+    }
+}
+
+static void PreviousGain(int16_t* dest, int samples, float input_gain) {
+    int gain_factor = (int)input_gain;
+    for (int i = 0; i < samples; i++) {
+        int32_t amplified = dest[i] * gain_factor;
+        dest[i] = (amplified > INT16_MAX) ? INT16_MAX : (amplified < -INT16_MAX) ? -INT16_MAX : (int16_t)amplified;
+    }
+}
+
+static std::vector<int16_t> TestSignal() {
+    std::vector<int16_t> pcm(FRAME_SAMPLES);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] = (int16_t)(32767 * sin(2 * M_PI * 440 * i / 24000));
+    }
+    pcm[0] = INT16_MIN;
+    return pcm;
+}
+
+template <typename Body>
+static double MicrosecondsPerFrame(Body body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCHMARK_FRAMES; n++) {
+        body(n);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / BENCHMARK_FRAMES;
+}
+
+TEST(AudioKernelsTest, MatchPreviousCodecLoops) {
+    auto pcm = TestSignal();
+    for (int volume = 0; volume <= 100; volume++) {
+        // The Q15 factor truncates at half the resolution of the old 16.16 one
+        int32_t previous_factor = pow(double(volume) / 100.0, 2) * 65536;
+        EXPECT_NEAR(VolumeToQ15(volume) * 2, previous_factor, 1) << "volume " << volume;
+    }
+
+    std::vector<int32_t> previous(FRAME_SAMPLES), packed(FRAME_SAMPLES);
+    PreviousWrite(pcm.data(), FRAME_SAMPLES, 100, previous);
+    PackPcm16ToI2s32(pcm.data(), packed.data(), FRAME_SAMPLES, VolumeToQ15(100));
+    EXPECT_EQ(packed, previous);
+
+    std::vector<int32_t> slots(FRAME_SAMPLES);
+    for (size_t i = 0; i < slots.size(); i++) {
+        slots[i] = int32_t(pcm[i]) << 14;   // Louder than int16 after the shift, so both have to clamp
+    }
+    std::vector<int16_t> previous_pcm(FRAME_SAMPLES), unpacked(FRAME_SAMPLES);
+    PreviousRead(slots.data(), previous_pcm.data(), FRAME_SAMPLES);
+    UnpackI2s32ToPcm16(slots.data(), unpacked.data(), FRAME_SAMPLES, 12);
+    EXPECT_EQ(unpacked, previous_pcm);
+
+    auto previous_gain = pcm, gain = pcm;
+    PreviousGain(previous_gain.data(), FRAME_SAMPLES, 6.0f);
+    ApplyGainSaturate(gain.data(), FRAME_SAMPLES, 6);
+    EXPECT_EQ(gain, previous_gain);
+}
+
+TEST(AudioKernelsBenchmark, KernelsVersusPreviousLoops) {
+    auto pcm = TestSignal();
+    std::vector<int32_t> slots(FRAME_SAMPLES);
+    std::vector<int16_t> out(FRAME_SAMPLES);
+    int64_t checksum = 0;
+
+    double previous_write = MicrosecondsPerFrame([&](int n) {
+        PreviousWrite(pcm.data(), FRAME_SAMPLES, 70, slots);
+        checksum += slots[n % FRAME_SAMPLES];
+    });
+    int32_t volume_q15 = VolumeToQ15(70);
+    double write = MicrosecondsPerFrame([&](int n) {
+        PackPcm16ToI2s32(pcm.data(), slots.data(), FRAME_SAMPLES, volume_q15);
+        checksum += slots[n % FRAME_SAMPLES];
+    });
+
+    double previous_read = MicrosecondsPerFrame([&](int n) {
+        PreviousRead(slots.data(), out.data(), FRAME_SAMPLES);
+        checksum += out[n % FRAME_SAMPLES];
+    });
+    double read = MicrosecondsPerFrame([&](int n) {
+        UnpackI2s32ToPcm16(slots.data(), out.data(), FRAME_SAMPLES, 12);
+        checksum += out[n % FRAME_SAMPLES];
+    });
+
+    double previous_gain = MicrosecondsPerFrame([&](int n) {
+        out = pcm;
+        PreviousGain(out.data(), FRAME_SAMPLES, 4.0f);
+        checksum += out[n % FRAME_SAMPLES];
+    });
+    double gain = MicrosecondsPerFrame([&](int n) {
+        out = pcm;
+        ApplyGainSaturate(out.data(), FRAME_SAMPLES, 4);
+        checksum += out[n % FRAME_SAMPLES];
+    });
+
+    // Informational: the host vectorizes where the rv32imc C3 can not, compare the ratios, not the times
+    printf("Per %d-sample frame, previous / kernel: write %.2f / %.2f us, read %.2f / %.2f us, "
+        "gain %.2f / %.2f us (checksum %lld)\n", FRAME_SAMPLES, previous_write, write, previous_read, read,
+        previous_gain, gain, (long long)checksum);
+    EXPECT_GT(write, 0);
+    EXPECT_GT(read, 0);
+    EXPECT_GT(gain, 0);
+}
@@ -0,0 +1,99 @@
+#include "audio_jitter_buffer.h"
+#include "audio_object_pool.h"
+#include "audio_ring_queue.h"
+#include "opus_frame_encoder.h"
+#include "host_test_util.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+// Every drop path must hand the packet back, so a pooled packet is never freed behind the pool's back
+
+static std::unique_ptr<AudioStreamPacket> MakePacket(uint32_t sequence) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->sequence = sequence;
+    packet->frame_duration = 60;
+    packet->payload.assign(20, 0);
+    return packet;
+}
+
+TEST(AudioObjectPoolTest, JitterBufferHandsBackEveryDroppedPacket) {
+    AudioJitterBuffer buffer(60);
+    int dropped = 0;
+    buffer.OnDrop([&](std::unique_ptr<AudioStreamPacket>&& packet) {
+        EXPECT_NE(packet, nullptr);
+        dropped++;
+    });
+
+    int64_t now = 1000000;
+    buffer.Put(MakePacket(1), now);
+    std::unique_ptr<AudioStreamPacket> packet;
+    const AudioStreamPacket* fec = nullptr;
+    ASSERT_EQ(buffer.Get(now, packet, fec), kJitterFramePacket);
+
+    buffer.Put(MakePacket(1), now);   // Late, already played
+    EXPECT_EQ(dropped, 1);
+    buffer.Put(MakePacket(3), now);
+    buffer.Put(MakePacket(3), now);   // Duplicate
+    EXPECT_EQ(dropped, 2);
+    buffer.Put(MakePacket(3 + JITTER_BUFFER_CAPACITY), now);  // Skips past 3
+    EXPECT_EQ(dropped, 3);
+    buffer.Put(MakePacket(4 + JITTER_BUFFER_CAPACITY), now);
+    buffer.Reset();                   // Flush
+    EXPECT_EQ(dropped, 5);
+    EXPECT_EQ(buffer.Size(), 0u);
+}
+
+TEST(AudioObjectPoolTest, RingQueueHandsBackClearedAndDroppedItems) {
+    AudioObjectPool<AudioStreamPacket> pool(8);
+    AudioRingQueue<std::unique_ptr<AudioStreamPacket>, 8> queue(1 << 0, 1 << 1);
+    queue.OnDrop([&](std::unique_ptr<AudioStreamPacket>&& packet) {
+        pool.Release(std::move(packet));
+    });
+
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.Push(pool.Acquire()));
+    }
+    EXPECT_EQ(pool.misses(), 4u);
+    ASSERT_TRUE(queue.DropOldest());
+    queue.Clear();
+
+    // The consumer's next Pop() drops them, then all four come from the pool again
+    std::unique_ptr<AudioStreamPacket> packet;
+    EXPECT_FALSE(queue.Pop(packet));
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.Push(pool.Acquire()));
+    }
+    EXPECT_EQ(pool.misses(), 4u);
+    EXPECT_EQ(pool.hits(), 4u);
+}
+
+// A pooled packet block must hold every frame the encoder can produce for the negotiated uplink
+TEST(AudioObjectPoolTest, PacketBlockFitsFramesAtTheirBitrate) {
+    const int sample_rate = 16000;
+    auto pcm = SineWave(sample_rate, 2000, 220);
+    auto overtone = SineWave(sample_rate, 2000, 1330, 2000);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] += overtone[i];
+    }
+    for (int duration_ms : {20, 40, 60}) {
+        for (int bitrate : {0, 8000, 16000, 32000}) {
+            OpusFrameEncoder encoder(sample_rate, 1, duration_ms);
+            encoder.SetBitrate(bitrate);
+            size_t block = 4 + OpusFrameEncoder::MaxPacketSize(sample_rate, 1, duration_ms, bitrate);
+            EXPECT_EQ(encoder.max_packet_size() + 4, block);
+            EXPECT_LT(block, 1000u) << duration_ms << " ms, " << bitrate << " bps";
+
+            // A buffer reserved for the block is never grown by the encoder
+            std::vector<uint8_t> opus;
+            opus.reserve(block);
+            for (size_t offset = 0; offset + encoder.frame_size() <= pcm.size(); offset += encoder.frame_size()) {
+                ASSERT_TRUE(encoder.Encode(pcm.data() + offset, encoder.frame_size(), opus, 4));
+                ASSERT_LE(opus.size(), block);
+            }
+            EXPECT_EQ(opus.capacity(), block) << duration_ms << " ms, " << bitrate << " bps";
+        }
+    }
+}
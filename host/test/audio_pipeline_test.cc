@@ -0,0 +1,151 @@
+#include "audio_service.h"
+#include "loopback_protocol.h"
+#include "codecs/wav_file_audio_codec.h"
+#include "host_test_util.h"
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#define SEND_QUEUE_EVENT (1 << 0)
+#define TTS_STOP_EVENT   (1 << 1)
+
+// Stop() only signals the audio tasks, they must have returned before the service is destroyed
+static void StopAudioService(AudioService& audio_service, UBaseType_t tasks_before_start) {
+    audio_service.Stop();
+    int64_t deadline = esp_timer_get_time() + 5000000;
+    while (uxTaskGetNumberOfTasks() > tasks_before_start && esp_timer_get_time() < deadline) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    ASSERT_LE(uxTaskGetNumberOfTasks(), tasks_before_start);
+}
+
+// input.wav -> AudioService encode -> loopback -> AudioService decode -> output.wav, like the xiaozhi_host tool
+static void RunTurn(const std::string& input_path, const std::string& output_path, int speed, DebugStatistics& stats, uint32_t& sent) {
+    WavFileAudioCodec codec(input_path, output_path, 24000, speed);
+    EventGroupHandle_t events = xEventGroupCreate();
+    AudioService audio_service;
+    audio_service.Initialize(&codec);
+    AudioServiceCallbacks callbacks;
+    callbacks.on_send_queue_available = [events]() {
+        xEventGroupSetBits(events, SEND_QUEUE_EVENT);
+    };
+    audio_service.SetCallbacks(callbacks);
+    UBaseType_t tasks_before_start = uxTaskGetNumberOfTasks();
+    audio_service.Start();
+
+    {
+        LoopbackProtocol protocol(speed);
+        protocol.SetPacketAllocator([&audio_service]() {
+            return audio_service.AcquirePacket();
+        });
+        protocol.OnIncomingAudio([&audio_service](std::unique_ptr<AudioStreamPacket> packet) {
+            audio_service.PushPacketToDecodeQueue(std::move(packet), true);
+        });
+        protocol.OnIncomingMessage([events](ControlMessage& message) {
+            auto state = message.GetString("state");
+            if (strcmp(message.type(), "tts") == 0 && state != nullptr && strcmp(state, "stop") == 0) {
+                xEventGroupSetBits(events, TTS_STOP_EVENT);
+            }
+        });
+        protocol.Start();
+        ASSERT_TRUE(protocol.OpenAudioChannel());
+
+        auto send_audio = [&]() {
+            while (auto packet = audio_service.PopPacketFromSendQueue()) {
+                if (protocol.SendAudio(*packet)) {
+                    audio_service.RecordPacketSent(*packet);
+                    sent++;
+                }
+                audio_service.RecyclePacket(std::move(packet));
+            }
+        };
+
+        protocol.SendStartListening(kListeningModeManualStop);
+        audio_service.EnableVoiceProcessing(true);
+        while (!codec.input_finished()) {
+            xEventGroupWaitBits(events, SEND_QUEUE_EVENT, pdTRUE, pdFALSE, pdMS_TO_TICKS(20));
+            send_audio();
+        }
+        vTaskDelay(pdMS_TO_TICKS(OPUS_FRAME_DURATION_MS * 2));
+        audio_service.EnableVoiceProcessing(false);
+        send_audio();
+        protocol.SendStopListening();
+
+        ASSERT_TRUE(xEventGroupWaitBits(events, TTS_STOP_EVENT, pdTRUE, pdFALSE, pdMS_TO_TICKS(10000)) & TTS_STOP_EVENT);
+        // The queues are empty while the codec task still decodes the last frame it took out
+        int64_t deadline = esp_timer_get_time() + 5000000;
+        while ((!audio_service.IsIdle() || audio_service.GetDebugStatistics().decode_count < sent) &&
+            esp_timer_get_time() < deadline) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        EXPECT_TRUE(audio_service.IsIdle());
+        stats = audio_service.GetDebugStatistics();
+        protocol.CloseAudioChannel();
+    }
+    StopAudioService(audio_service, tasks_before_start);
+    vEventGroupDelete(events);
+}
+
+TEST(AudioPipelineTest, WavThroughLoopbackComesBackAsWav) {
+    const int kDurationMs = 1200;
+    ASSERT_TRUE(WriteWav("pipeline_input.wav", 16000, SineWave(16000, kDurationMs, 440)));
+
+    DebugStatistics stats;
+    uint32_t sent = 0;
+    RunTurn("pipeline_input.wav", "pipeline_output.wav", 4, stats, sent);
+
+    int sample_rate = 0;
+    auto output = ReadWav("pipeline_output.wav", sample_rate);
+    EXPECT_EQ(sample_rate, 24000);
+    // Every uplink frame of the turn is played back, trailing silence included
+    EXPECT_GE(output.size(), (size_t)24000 * kDurationMs / 1000);
+    EXPECT_GT(Rms(output), 1500);
+    // A frame encoded after the turn ended is not sent, everything sent must come back
+    EXPECT_GT(sent, 0u);
+    EXPECT_EQ(stats.decode_count, sent);
+    EXPECT_EQ(stats.jitter.lost_count, 0u);
+}
+
+TEST(AudioPipelineTest, UplinkStallIsReportedAtStartAndAtTheEndTurnThreshold) {
+    const int kDurationMs = 8000;
+    ASSERT_TRUE(WriteWav("stall_input.wav", 16000, SineWave(16000, kDurationMs, 440)));
+
+    WavFileAudioCodec codec("stall_input.wav", "stall_output.wav", 24000, 8);
+    AudioService audio_service;
+    audio_service.Initialize(&codec);
+    std::mutex mutex;
+    std::vector<int> reports;
+    AudioServiceCallbacks callbacks;
+    callbacks.on_uplink_stalled = [&](int stalled_ms) {
+        std::lock_guard<std::mutex> lock(mutex);
+        reports.push_back(stalled_ms);
+    };
+    audio_service.SetCallbacks(callbacks);
+    UBaseType_t tasks_before_start = uxTaskGetNumberOfTasks();
+    audio_service.Start();
+
+    // Nothing takes packets off the send queue, so it fills and every later frame is dropped
+    audio_service.EnableVoiceProcessing(true);
+    while (!codec.input_finished()) {
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+    audio_service.EnableVoiceProcessing(false);
+    StopAudioService(audio_service, tasks_before_start);
+
+    // A starved encoder can overflow the encode queue for a frame before the send queue fills. That
+    // is a stall of its own and is reported at its start, but nothing is reported while one lasts
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_GE(reports.size(), 2u);
+    for (size_t i = 0; i + 1 < reports.size(); i++) {
+        EXPECT_LE(reports[i], OPUS_FRAME_DURATION_MS) << "report " << i;
+    }
+    EXPECT_GE(reports.back(), UPLINK_STALL_END_TURN_MS);
+    EXPECT_LT(reports.back(), UPLINK_STALL_END_TURN_MS + OPUS_FRAME_DURATION_MS);
+}
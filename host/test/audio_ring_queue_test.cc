@@ -0,0 +1,218 @@
+#include "audio_ring_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#define DATA_BIT  (1 << 0)
+#define SPACE_BIT (1 << 1)
+
+// Producer and consumer are plain threads, the shim gives every thread a notification slot
+
+TEST(AudioRingQueueTest, StressKeepsOrderAndLosesNothing) {
+    const int kItems = 200000;
+    AudioRingQueue<int, 8> queue(DATA_BIT, SPACE_BIT, 6);
+    std::atomic<bool> consumer_ready = false;
+    int received = 0;
+    bool in_order = true;
+
+    std::thread consumer([&]() {
+        queue.SetConsumer(xTaskGetCurrentTaskHandle());
+        consumer_ready = true;
+        int expected = 0;
+        while (expected < kItems) {
+            int value;
+            if (!queue.Pop(value)) {
+                WaitAudioQueueBits(queue.data_bit(), pdMS_TO_TICKS(100));
+                continue;
+            }
+            in_order = in_order && value == expected;
+            expected++;
+            received++;
+        }
+    });
+    while (!consumer_ready) {
+        std::this_thread::yield();
+    }
+
+    std::thread producer([&]() {
+        for (int i = 0; i < kItems; i++) {
+            int value = i;
+            while (!queue.Push(std::move(value))) {
+                queue.WaitForSpace(pdMS_TO_TICKS(100));
+            }
+        }
+    });
+    producer.join();
+    consumer.join();
+
+    EXPECT_EQ(received, kItems);
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(queue.Empty());
+}
+
+// Counts live instances, so items dropped by Clear() / DropOldest() must be destroyed exactly once
+struct CountedItem {
+    static std::atomic<int> live;
+    int value;
+    explicit CountedItem(int value) : value(value) { live++; }
+    ~CountedItem() { live--; }
+};
+std::atomic<int> CountedItem::live = 0;
+
+TEST(AudioRingQueueTest, ClearAndDropOldestFromOtherTasksUnderLoad) {
+    const int kItems = 100000;
+    {
+        AudioRingQueue<std::unique_ptr<CountedItem>, 8> queue(DATA_BIT, SPACE_BIT);
+        std::atomic<bool> consumer_ready = false;
+        std::atomic<bool> producing = true;
+        int last = -1;
+        bool increasing = true;
+
+        std::thread consumer([&]() {
+            queue.SetConsumer(xTaskGetCurrentTaskHandle());
+            consumer_ready = true;
+            while (true) {
+                std::unique_ptr<CountedItem> item;
+                if (!queue.Pop(item)) {
+                    WaitAudioQueueBits(queue.data_bit(), pdMS_TO_TICKS(100));
+                    continue;
+                }
+                if (item->value == kItems) {
+                    break;
+                }
+                increasing = increasing && item->value > last;
+                last = item->value;
+            }
+        });
+        while (!consumer_ready) {
+            std::this_thread::yield();
+        }
+
+        std::thread clearer([&]() {
+            while (producing) {
+                queue.Clear();
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        });
+
+        std::thread producer([&]() {
+            for (int i = 0; i <= kItems; i++) {
+                if (i == kItems) {
+                    // The end marker must not be cleared
+                    producing = false;
+                    clearer.join();
+                }
+                auto item = std::make_unique<CountedItem>(i);
+                while (!queue.Push(std::move(item))) {
+                    if (i % 3 == 0 && i != kItems && queue.DropOldest()) {
+                        continue;
+                    }
+                    queue.WaitForSpace(pdMS_TO_TICKS(100));
+                }
+            }
+        });
+        producer.join();
+        consumer.join();
+
+        EXPECT_TRUE(increasing);
+    }
+    EXPECT_EQ(CountedItem::live.load(), 0);
+}
+
+// The mutex / condition variable queue AudioService used before the ring queues
+template <typename T>
+class LockedQueue {
+public:
+    explicit LockedQueue(size_t limit) : limit_(limit) {}
+
+    void Push(T&& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_cv_.wait(lock, [this]() { return queue_.size() < limit_; });
+        queue_.push_back(std::move(item));
+        data_cv_.notify_one();
+    }
+
+    T Pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        data_cv_.wait(lock, [this]() { return !queue_.empty(); });
+        T item = std::move(queue_.front());
+        queue_.pop_front();
+        space_cv_.notify_one();
+        return item;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable data_cv_;
+    std::condition_variable space_cv_;
+    std::deque<T> queue_;
+    size_t limit_;
+};
+
+template <typename Transfer>
+static double ItemsPerSecond(int items, Transfer transfer) {
+    auto start = std::chrono::steady_clock::now();
+    transfer();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return items / elapsed.count();
+}
+
+TEST(AudioRingQueueBenchmark, RingQueueVersusMutexQueue) {
+    const int kItems = 200000;
+    const size_t kLimit = 6;
+
+    double ring_rate = ItemsPerSecond(kItems, [&]() {
+        AudioRingQueue<std::unique_ptr<int>, 8> queue(DATA_BIT, SPACE_BIT, kLimit);
+        std::atomic<bool> consumer_ready = false;
+        std::thread consumer([&]() {
+            queue.SetConsumer(xTaskGetCurrentTaskHandle());
+            consumer_ready = true;
+            for (int received = 0; received < kItems;) {
+                std::unique_ptr<int> item;
+                if (queue.Pop(item)) {
+                    received++;
+                } else {
+                    WaitAudioQueueBits(queue.data_bit());
+                }
+            }
+        });
+        while (!consumer_ready) {
+            std::this_thread::yield();
+        }
+        for (int i = 0; i < kItems; i++) {
+            auto item = std::make_unique<int>(i);
+            while (!queue.Push(std::move(item))) {
+                queue.WaitForSpace();
+            }
+        }
+        consumer.join();
+    });
+
+    double locked_rate = ItemsPerSecond(kItems, [&]() {
+        LockedQueue<std::unique_ptr<int>> queue(kLimit);
+        std::thread consumer([&]() {
+            for (int received = 0; received < kItems; received++) {
+                queue.Pop();
+            }
+        });
+        for (int i = 0; i < kItems; i++) {
+            queue.Push(std::make_unique<int>(i));
+        }
+        consumer.join();
+    });
+
+    // Informational: on the device the ring queue also avoids the priority inversion of a shared lock,
+    // which a desktop scheduler does not show
+    printf("SPSC ring queue: %.0f items/s, mutex/cv deque: %.0f items/s (x%.2f)\n",
+        ring_rate, locked_rate, ring_rate / locked_rate);
+    EXPECT_GT(ring_rate, 0);
+    EXPECT_GT(locked_rate, 0);
+}
@@ -0,0 +1,285 @@
+#include "control_message.h"
+
+#include <cJSON.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define BENCHMARK_ROUNDS 2000
+
+/*
+ * Heap allocations of the calling thread. malloc itself is counted, so that cJSON, which does not
+ * go through operator new, shows up next to the C++ allocations.
+ */
+static thread_local size_t allocations = 0;
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+    allocations++;
+    return __libc_realloc(p, size);
+}
+
+/*
+ * Downlink JSON messages of a session file written by scripts/session_server.py record: "XZS1",
+ * then |direction 1B|kind 1B|time_ms 4B|length 4B|data| little endian records. XIAOZHI_SESSION
+ * points at a recording of a real server, data/server_turns.xzs is three turns in the same format.
+ */
+static std::vector<std::string> ReadServerMessages() {
+    const char* path = getenv("XIAOZHI_SESSION");
+    std::ifstream file(path != nullptr ? path : TEST_DATA_DIR "/server_turns.xzs", std::ios::binary);
+    std::vector<std::string> messages;
+    char magic[4];
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, "XZS1", 4) != 0) {
+        return messages;
+    }
+    uint8_t header[10];
+    while (file.read((char*)header, sizeof(header))) {
+        uint32_t length = header[6] | header[7] << 8 | header[8] << 16 | uint32_t(header[9]) << 24;
+        std::string data(length, '\0');
+        if (!file.read(data.data(), length)) {
+            break;
+        }
+        // Downlink JSON only, the device never parses what it sent itself
+        if (header[0] == 1 && header[1] == 0) {
+            messages.push_back(std::move(data));
+        }
+    }
+    return messages;
+}
+
+// Fields every handler reads, summed so that neither path can skip the work
+struct Extracted {
+    size_t messages = 0;
+    size_t text_bytes = 0;
+    size_t mcp_payloads = 0;
+};
+
+// Application before the scanner: a cJSON tree per frame and a strcmp chain on "type"
+static void PreviousDispatch(const std::string& frame, Extracted& out) {
+    cJSON* root = cJSON_ParseWithLength(frame.data(), frame.size());
+    if (root == nullptr) {
+        return;
+    }
+    auto type = cJSON_GetObjectItem(root, "type");
+    if (cJSON_IsString(type)) {
+        out.messages++;
+        if (strcmp(type->valuestring, "tts") == 0) {
+            auto state = cJSON_GetObjectItem(root, "state");
+            if (cJSON_IsString(state) && strcmp(state->valuestring, "sentence_start") == 0) {
+                auto text = cJSON_GetObjectItem(root, "text");
+                if (cJSON_IsString(text)) {
+                    out.text_bytes += strlen(text->valuestring);
+                }
+            }
+        } else if (strcmp(type->valuestring, "stt") == 0) {
+            auto text = cJSON_GetObjectItem(root, "text");
+            if (cJSON_IsString(text)) {
+                out.text_bytes += strlen(text->valuestring);
+            }
+        } else if (strcmp(type->valuestring, "llm") == 0) {
+            auto emotion = cJSON_GetObjectItem(root, "emotion");
+            if (cJSON_IsString(emotion)) {
+                out.text_bytes += strlen(emotion->valuestring);
+            }
+        } else if (strcmp(type->valuestring, "mcp") == 0) {
+            if (cJSON_IsObject(cJSON_GetObjectItem(root, "payload"))) {
+                out.mcp_payloads++;
+            }
+        }
+    }
+    cJSON_Delete(root);
+}
+
+static void RegisterHandlers(ControlMessageDispatcher& dispatcher, Extracted& out) {
+    dispatcher.On("tts", [&out](ControlMessage& message) {
+        auto state = message.GetString("state");
+        if (state != nullptr && strcmp(state, "sentence_start") == 0) {
+            if (auto text = message.GetString("text")) {
+                out.text_bytes += strlen(text);
+            }
+        }
+    });
+    dispatcher.On("stt", [&out](ControlMessage& message) {
+        if (auto text = message.GetString("text")) {
+            out.text_bytes += strlen(text);
+        }
+    });
+    dispatcher.On("llm", [&out](ControlMessage& message) {
+        if (auto emotion = message.GetString("emotion")) {
+            out.text_bytes += strlen(emotion);
+        }
+    });
+    // Like Application, MCP payloads still get a cJSON tree
+    dispatcher.On("mcp", [&out](ControlMessage& message) {
+        auto raw = message.GetRaw("payload");
+        cJSON* payload = cJSON_ParseWithLength(raw.data(), raw.size());
+        if (cJSON_IsObject(payload)) {
+            out.mcp_payloads++;
+        }
+        cJSON_Delete(payload);
+    });
+}
+
+static void ScannerDispatch(ControlMessage& message, const ControlMessageDispatcher& dispatcher,
+    const std::string& frame, Extracted& out) {
+    if (!message.Parse(frame.data(), frame.size()) || message.type()[0] == '\0') {
+        return;
+    }
+    out.messages++;
+    dispatcher.Dispatch(message);
+}
+
+TEST(ControlMessageTest, RecordedTrafficMatchesCJson) {
+    auto messages = ReadServerMessages();
+    ASSERT_FALSE(messages.empty());
+
+    ControlMessage message;
+    for (auto& frame : messages) {
+        cJSON* root = cJSON_ParseWithLength(frame.data(), frame.size());
+        ASSERT_NE(root, nullptr) << frame;
+        ASSERT_TRUE(message.Parse(frame.data(), frame.size())) << frame;
+        EXPECT_STREQ(message.type(), cJSON_GetObjectItem(root, "type")->valuestring);
+        for (const char* key : {"state", "text", "emotion", "session_id"}) {
+            auto item = cJSON_GetObjectItem(root, key);
+            auto value = message.GetString(key);
+            if (cJSON_IsString(item)) {
+                ASSERT_NE(value, nullptr) << key << " in " << frame;
+                EXPECT_STREQ(value, item->valuestring) << key << " in " << frame;
+            } else {
+                EXPECT_EQ(value, nullptr) << key << " in " << frame;
+            }
+        }
+        if (cJSON_IsObject(cJSON_GetObjectItem(root, "payload"))) {
+            EXPECT_TRUE(message.Has("payload", kControlValueObject)) << frame;
+        }
+        cJSON_Delete(root);
+    }
+}
+
+TEST(ControlMessageTest, UnescapesSurrogatePairs) {
+    const char frame[] = R"({"type":"llm","text":"\ud83d\ude36 \u4f60\u597d","emotion":"neutral"})";
+    ControlMessage message;
+    ASSERT_TRUE(message.Parse(frame, sizeof(frame) - 1));
+    EXPECT_STREQ(message.GetString("text"), "\xF0\x9F\x98\xB6 \xE4\xBD\xA0\xE5\xA5\xBD");
+    EXPECT_STREQ(message.GetString("emotion"), "neutral");
+}
+
+TEST(ControlMessageTest, StringsLongerThanScratchAreCopiedToTheHeap) {
+    // Two long values: the first fills most of the scratch buffer, the second can only go to the heap
+    std::string first(CONTROL_MESSAGE_SCRATCH_SIZE - 100, 'a');
+    std::string second(CONTROL_MESSAGE_SCRATCH_SIZE * 3, 'b');
+    second.replace(10, 2, "\\n");
+    std::string frame = "{\"type\":\"llm\",\"first\":\"" + first + "\",\"text\":\"" + second + "\"}";
+    cJSON* root = cJSON_ParseWithLength(frame.data(), frame.size());
+    ASSERT_NE(root, nullptr);
+
+    ControlMessage message;
+    ASSERT_TRUE(message.Parse(frame.data(), frame.size()));
+    auto first_value = message.GetString("first");
+    auto text = message.GetString("text");
+    ASSERT_NE(first_value, nullptr);
+    ASSERT_NE(text, nullptr);
+    EXPECT_STREQ(first_value, first.c_str());
+    EXPECT_STREQ(text, cJSON_GetObjectItem(root, "text")->valuestring);
+    EXPECT_STREQ(message.type(), "llm");
+    cJSON_Delete(root);
+
+    // The heap copy goes with the next message, which still uses the scratch buffer
+    const char next[] = R"({"type":"tts","state":"start"})";
+    ASSERT_TRUE(message.Parse(next, sizeof(next) - 1));
+    EXPECT_STREQ(message.GetString("state"), "start");
+}
+
+TEST(ControlMessageTest, RejectsNulAndUnpairedSurrogates) {
+    ControlMessage message;
+    for (const char* frame : {
+        R"({"type":"stt","text":"ab\u0000cd"})",
+        R"({"type":"stt","text":"\ud83d"})",
+        R"({"type":"stt","text":"\ud83d tail"})",
+        R"({"type":"stt","text":"\ud83d\u0041"})",
+        R"({"type":"stt","text":"\ude36"})",
+    }) {
+        ASSERT_TRUE(message.Parse(frame, strlen(frame))) << frame;
+        EXPECT_EQ(message.GetString("text"), nullptr) << frame;
+        EXPECT_STREQ(message.type(), "stt") << frame;
+    }
+}
+
+TEST(ControlMessageBenchmark, RecordedTrafficParseTimeAndHeap) {
+    auto messages = ReadServerMessages();
+    ASSERT_FALSE(messages.empty());
+    size_t mcp_messages = 0;
+    for (auto& frame : messages) {
+        mcp_messages += frame.find("\"type\":\"mcp\"") != std::string::npos;
+    }
+
+    Extracted previous;
+    size_t start_allocations = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+        for (auto& frame : messages) {
+            PreviousDispatch(frame, previous);
+        }
+    }
+    std::chrono::duration<double, std::micro> previous_time = std::chrono::steady_clock::now() - start;
+    size_t previous_allocations = allocations - start_allocations;
+
+    // The protocol owns one message and the application one dispatcher, both outlive every frame
+    ControlMessage message;
+    ControlMessageDispatcher dispatcher;
+    Extracted scanned;
+    RegisterHandlers(dispatcher, scanned);
+    start_allocations = allocations;
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+        for (auto& frame : messages) {
+            ScannerDispatch(message, dispatcher, frame, scanned);
+        }
+    }
+    std::chrono::duration<double, std::micro> scanner_time = std::chrono::steady_clock::now() - start;
+    size_t scanner_allocations = allocations - start_allocations;
+
+    // Only the MCP payloads still build a tree, everything else is scanned without touching the heap
+    Extracted ignored;
+    ControlMessageDispatcher no_mcp;
+    RegisterHandlers(no_mcp, ignored);
+    start_allocations = allocations;
+    for (auto& frame : messages) {
+        if (frame.find("\"type\":\"mcp\"") == std::string::npos) {
+            ScannerDispatch(message, no_mcp, frame, ignored);
+        }
+    }
+    size_t non_mcp_allocations = allocations - start_allocations;
+
+    size_t frames = messages.size() * BENCHMARK_ROUNDS;
+    printf("%zu server messages (%zu mcp): cJSON tree %.2f us/message %.1f allocations/message, "
+        "scanner %.2f us/message %.1f allocations/message (%zu outside mcp)\n",
+        messages.size(), mcp_messages, previous_time.count() / frames, double(previous_allocations) / frames,
+        scanner_time.count() / frames, double(scanner_allocations) / frames, non_mcp_allocations);
+    EXPECT_EQ(scanned.messages, previous.messages);
+    EXPECT_EQ(scanned.text_bytes, previous.text_bytes);
+    EXPECT_EQ(scanned.mcp_payloads, previous.mcp_payloads);
+    EXPECT_EQ(previous.mcp_payloads, mcp_messages * BENCHMARK_ROUNDS);
+    EXPECT_LT(scanner_allocations, previous_allocations);
+    EXPECT_EQ(non_mcp_allocations, 0u);
+}
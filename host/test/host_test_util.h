@@ -0,0 +1,75 @@
+#ifndef _HOST_TEST_UTIL_H_
+#define _HOST_TEST_UTIL_H_
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Minimal 16-bit mono WAV files for the host tests, the header layout WavFileAudioCodec writes
+
+inline bool WriteWav(const std::string& path, int sample_rate, const std::vector<int16_t>& samples) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    uint32_t data_size = samples.size() * sizeof(int16_t);
+    uint32_t riff_size = 36 + data_size;
+    uint32_t fmt_size = 16;
+    uint16_t audio_format = 1, channels = 1, block_align = 2, bits_per_sample = 16;
+    uint32_t rate = sample_rate, byte_rate = sample_rate * 2;
+    fwrite("RIFF", 1, 4, file);
+    fwrite(&riff_size, 4, 1, file);
+    fwrite("WAVEfmt ", 1, 8, file);
+    fwrite(&fmt_size, 4, 1, file);
+    fwrite(&audio_format, 2, 1, file);
+    fwrite(&channels, 2, 1, file);
+    fwrite(&rate, 4, 1, file);
+    fwrite(&byte_rate, 4, 1, file);
+    fwrite(&block_align, 2, 1, file);
+    fwrite(&bits_per_sample, 2, 1, file);
+    fwrite("data", 1, 4, file);
+    fwrite(&data_size, 4, 1, file);
+    fwrite(samples.data(), sizeof(int16_t), samples.size(), file);
+    fclose(file);
+    return true;
+}
+
+inline std::vector<int16_t> SineWave(int sample_rate, int duration_ms, double frequency, int16_t amplitude = 8000) {
+    std::vector<int16_t> samples(sample_rate * duration_ms / 1000);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = (int16_t)(amplitude * sin(2 * M_PI * frequency * i / sample_rate));
+    }
+    return samples;
+}
+
+// Samples of a WAV file, sample_rate is set from the header, empty if the file is unreadable
+inline std::vector<int16_t> ReadWav(const std::string& path, int& sample_rate) {
+    std::vector<int16_t> samples;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return samples;
+    }
+    uint8_t header[44];
+    if (fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, "RIFF", 4) == 0) {
+        uint32_t data_size;
+        memcpy(&sample_rate, header + 24, 4);
+        memcpy(&data_size, header + 40, 4);
+        samples.resize(data_size / sizeof(int16_t));
+        samples.resize(fread(samples.data(), sizeof(int16_t), samples.size(), file));
+    }
+    fclose(file);
+    return samples;
+}
+
+inline double Rms(const std::vector<int16_t>& samples) {
+    double sum = 0;
+    for (auto sample : samples) {
+        sum += (double)sample * sample;
+    }
+    return samples.empty() ? 0 : sqrt(sum / samples.size());
+}
+
+#endif // _HOST_TEST_UTIL_H_
@@ -0,0 +1,107 @@
+#include "loopback_protocol.h"
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#define TTS_STOP_EVENT (1 << 0)
+
+class LoopbackProtocolTest : public ::testing::Test {
+protected:
+    EventGroupHandle_t events_ = xEventGroupCreate();
+    std::mutex mutex_;
+    std::vector<int64_t> arrivals_;
+    std::vector<uint32_t> sequences_;
+
+    void TearDown() override { vEventGroupDelete(events_); }
+
+    void Attach(LoopbackProtocol& protocol) {
+        protocol.OnIncomingAudio([this](std::unique_ptr<AudioStreamPacket> packet) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            arrivals_.push_back(esp_timer_get_time());
+            sequences_.push_back(packet->sequence);
+        });
+        protocol.OnIncomingMessage([this](ControlMessage& message) {
+            auto state = message.GetString("state");
+            if (strcmp(message.type(), "tts") == 0 && state != nullptr && strcmp(state, "stop") == 0) {
+                xEventGroupSetBits(events_, TTS_STOP_EVENT);
+            }
+        });
+        ASSERT_TRUE(protocol.Start());
+        ASSERT_TRUE(protocol.OpenAudioChannel());
+    }
+
+    static AudioStreamPacket MakePacket(int frame_duration) {
+        AudioStreamPacket packet;
+        packet.sample_rate = 16000;
+        packet.frame_duration = frame_duration;
+        packet.payload.assign(40, 0x5a);
+        return packet;
+    }
+
+    bool WaitTtsStop(int timeout_ms) {
+        return xEventGroupWaitBits(events_, TTS_STOP_EVENT, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeout_ms)) & TTS_STOP_EVENT;
+    }
+};
+
+TEST_F(LoopbackProtocolTest, ReplaysRecordedTurnInOrder) {
+    LoopbackProtocol protocol(8);
+    Attach(protocol);
+
+    protocol.SendStartListening(kListeningModeManualStop);
+    for (int i = 0; i < 20; i++) {
+        auto packet = MakePacket(60);
+        ASSERT_TRUE(protocol.SendAudio(packet));
+    }
+    protocol.SendStopListening();
+    ASSERT_TRUE(WaitTtsStop(2000));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ASSERT_EQ(sequences_.size(), 20u);
+    for (size_t i = 0; i < sequences_.size(); i++) {
+        EXPECT_EQ(sequences_[i], i + 1);
+    }
+}
+
+TEST_F(LoopbackProtocolTest, AutoModeStopsRecordingOnItsOwn) {
+    LoopbackProtocol protocol(16);
+    Attach(protocol);
+
+    protocol.SendStartListening(kListeningModeAutoStop);
+    for (int i = 0; i < LOOPBACK_AUTO_STOP_MS / 60 + 10; i++) {
+        auto packet = MakePacket(60);
+        protocol.SendAudio(packet);
+    }
+    ASSERT_TRUE(WaitTtsStop(2000));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_EQ(sequences_.size(), (size_t)(LOOPBACK_AUTO_STOP_MS + 59) / 60);
+}
+
+// 60 ms frames at x16 are 3.75 ms apart, whole-tick pacing would replay them 3 ms apart (20% fast)
+TEST_F(LoopbackProtocolTest, PacingKeepsSpeedAtFractionalFrameIntervals) {
+    const int kSpeed = 16;
+    const int kPackets = 128;
+    LoopbackProtocol protocol(kSpeed);
+    Attach(protocol);
+
+    protocol.SendStartListening(kListeningModeManualStop);
+    for (int i = 0; i < kPackets; i++) {
+        auto packet = MakePacket(60);
+        ASSERT_TRUE(protocol.SendAudio(packet));
+    }
+    int64_t start = esp_timer_get_time();
+    protocol.SendStopListening();
+    ASSERT_TRUE(WaitTtsStop(5000));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ASSERT_EQ(arrivals_.size(), (size_t)kPackets);
+    double expected_us = kPackets * 60 * 1000.0 / kSpeed;
+    double elapsed_us = arrivals_.back() - start;
+    EXPECT_NEAR(elapsed_us, expected_us, expected_us * 0.08);
+}
@@ -0,0 +1,548 @@
+#include "mcp_server.h"
+#include "application.h"
+
+#include <cJSON.h>
+#include <esp_app_desc.h>
+#include <freertos/task.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define BENCHMARK_HANDSHAKES    2000
+#define PREVIOUS_MAX_PAYLOAD    5000
+
+/*
+ * Heap allocations of the calling thread. malloc itself is counted, so that cJSON, which does not
+ * go through operator new, shows up next to the C++ allocations.
+ */
+static thread_local size_t allocations = 0;
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+    allocations++;
+    return __libc_realloc(p, size);
+}
+
+static ReturnValue Ignore(const PropertyList&) {
+    return true;
+}
+
+/*
+ * Roughly what a board with a screen, a camera and a few IoT things registers: the common tools
+ * as they were before typed registration, then a dozen board tools. Two tools/list pages.
+ */
+static const std::vector<McpTool*>& HandshakeTools() {
+    static std::vector<McpTool*> tools;
+    if (!tools.empty()) {
+        return tools;
+    }
+    tools.push_back(new McpTool("self.get_device_status",
+        "Provides the real-time information of the device, including the current status of the audio speaker, screen, network, etc.\n"
+        "Use this tool for: \n"
+        "1. Answering questions about current condition (e.g. what is the current volume of the audio speaker?)\n"
+        "2. As the first step to control the device (e.g. turn up / down the volume of the audio speaker, etc.)",
+        PropertyList(), Ignore));
+    tools.push_back(new McpTool("self.audio_speaker.set_volume",
+        "Set the volume of the audio speaker. If the current volume is unknown, you must call `self.get_device_status` tool first and then call this tool.",
+        PropertyList({Property("volume", kPropertyTypeInteger, 0, 100)}), Ignore));
+    tools.push_back(new McpTool("self.screen.set_brightness", "Set the brightness of the screen.",
+        PropertyList({Property("brightness", kPropertyTypeInteger, 0, 100)}), Ignore));
+    tools.push_back(new McpTool("self.screen.set_theme", "Set the theme of the screen. The theme can be `light` or `dark`.",
+        PropertyList({Property("theme", kPropertyTypeString)}), Ignore));
+    tools.push_back(new McpTool("self.camera.take_photo",
+        "Take a photo and explain it. Use this tool after the user asks you to see something.\n"
+        "Args:\n  `question`: The question that you want to ask about the photo.\nReturn:\n  A JSON object that provides the photo information.",
+        PropertyList({Property("question", kPropertyTypeString)}), Ignore, 8192));
+    tools.push_back(new McpTool("self.robot.send_command",
+        "Control Bittle robot via UART. Examples: kwkF(walk), kbk(back), kvtL/R(turn), ksit(sit), khi(hi), kup(stand), d(rest), kang(angry), khg(hug), kbf(backflip), m8 -30(left hand up)",
+        PropertyList({Property("text", kPropertyTypeString)}), Ignore));
+    for (auto thing : {"lamp", "fan", "curtain", "heater"}) {
+        std::string prefix = std::string("self.") + thing;
+        tools.push_back(new McpTool(prefix + ".turn_on",
+            std::string("Turn on the ") + thing + " in the room the device is in. Call `self.get_device_status` first "
+            "if the user does not say which one, and confirm before turning on more than one.",
+            PropertyList({Property("id", kPropertyTypeInteger, 0, 0, 15), Property("quiet", kPropertyTypeBoolean, false)}), Ignore));
+        tools.push_back(new McpTool(prefix + ".turn_off",
+            std::string("Turn off the ") + thing + ". Turning off something that is already off is not an error.",
+            PropertyList({Property("id", kPropertyTypeInteger, 0, 0, 15)}), Ignore));
+        tools.push_back(new McpTool(prefix + ".set_level",
+            std::string("Set the level of the ") + thing + " from 0 to 100, for a lamp the brightness, for a fan the "
+            "speed, for a curtain how far it is open and for a heater the power. Use relative changes from the "
+            "current level when the user says more or less.",
+            PropertyList({Property("id", kPropertyTypeInteger, 0, 0, 15), Property("level", kPropertyTypeInteger, 0, 100),
+                Property("transition", kPropertyTypeString, std::string("smooth"))}), Ignore));
+    }
+    for (auto tool : tools) {
+        McpServer::GetInstance().AddTool(tool);
+    }
+    return tools;
+}
+
+// McpTool::to_json() before the descriptors were cached: each level printed its subtree to a
+// string and the level above parsed it back
+static std::string PreviousPropertiesJson(const PropertyList& properties) {
+    cJSON* json = cJSON_CreateObject();
+    for (auto& property : properties) {
+        cJSON* property_json = property.to_cjson();
+        char* property_str = cJSON_PrintUnformatted(property_json);
+        cJSON_Delete(property_json);
+        cJSON_AddItemToObject(json, property.name().c_str(), cJSON_Parse(property_str));
+        cJSON_free(property_str);
+    }
+    char* json_str = cJSON_PrintUnformatted(json);
+    std::string result(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(json);
+    return result;
+}
+
+static std::string PreviousToolJson(const McpTool* tool) {
+    std::vector<std::string> required = tool->properties().GetRequired();
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "name", tool->name().c_str());
+    cJSON_AddStringToObject(json, "description", tool->description().c_str());
+    cJSON* input_schema = cJSON_CreateObject();
+    cJSON_AddStringToObject(input_schema, "type", "object");
+    cJSON_AddItemToObject(input_schema, "properties", cJSON_Parse(PreviousPropertiesJson(tool->properties()).c_str()));
+    if (!required.empty()) {
+        cJSON* required_array = cJSON_CreateArray();
+        for (const auto& property : required) {
+            cJSON_AddItemToArray(required_array, cJSON_CreateString(property.c_str()));
+        }
+        cJSON_AddItemToObject(input_schema, "required", required_array);
+    }
+    cJSON_AddItemToObject(json, "inputSchema", input_schema);
+    char* json_str = cJSON_PrintUnformatted(json);
+    std::string result(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(json);
+    return result;
+}
+
+// McpServer::GetToolsList() before the pages were cached: every page serialized again from the cursor on
+static std::string PreviousToolsList(const std::vector<McpTool*>& tools, const std::string& cursor) {
+    std::string json;
+    json.reserve(PREVIOUS_MAX_PAYLOAD);
+    json = "{\"tools\":[";
+    bool found_cursor = cursor.empty();
+    std::string next_cursor;
+    for (auto tool : tools) {
+        if (!found_cursor) {
+            if (tool->name() != cursor) {
+                continue;
+            }
+            found_cursor = true;
+        }
+        std::string tool_json = PreviousToolJson(tool) + ",";
+        if (json.length() + tool_json.length() + 30 > PREVIOUS_MAX_PAYLOAD) {
+            next_cursor = tool->name();
+            break;
+        }
+        json += tool_json;
+    }
+    if (json.back() == ',') {
+        json.pop_back();
+    }
+    if (next_cursor.empty()) {
+        json += "]}";
+    } else {
+        json += "],\"nextCursor\":\"" + next_cursor + "\"}";
+    }
+    return json;
+}
+
+// The old server for the two methods of the handshake, replying through the same path as McpServer
+static void PreviousParseMessage(const std::vector<McpTool*>& tools, const std::string& message) {
+    cJSON* json = cJSON_Parse(message.c_str());
+    auto method = cJSON_GetObjectItem(json, "method");
+    auto params = cJSON_GetObjectItem(json, "params");
+    int id = cJSON_GetObjectItem(json, "id")->valueint;
+    std::string result;
+    if (strcmp(method->valuestring, "initialize") == 0) {
+        result = "{\"protocolVersion\":\"2024-11-05\",\"capabilities\":{\"tools\":{}},\"serverInfo\":{\"name\":\"" BOARD_NAME "\",\"version\":\"";
+        result += esp_app_get_description()->version;
+        result += "\"}}";
+    } else {
+        auto cursor = cJSON_GetObjectItem(params, "cursor");
+        result = PreviousToolsList(tools, cJSON_IsString(cursor) ? cursor->valuestring : "");
+    }
+    cJSON_Delete(json);
+    Application::GetInstance().SendMcpMessage("{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id) + ",\"result\":" + result + "}");
+}
+
+static std::string ToolsListRequest(int id, const std::string& cursor) {
+    std::string request = "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(id) + ",\"method\":\"tools/list\",\"params\":{";
+    if (!cursor.empty()) {
+        request += "\"cursor\":\"" + cursor + "\"";
+    }
+    return request + "}}";
+}
+
+class McpServerTest : public ::testing::Test {
+protected:
+    std::vector<std::string> replies_;
+
+    void SetUp() override {
+        replies_.reserve(16);
+        Application::GetInstance().OnMcpMessage([this](const std::string& payload) {
+            replies_.push_back(payload);
+        });
+    }
+
+    void TearDown() override {
+        Application::GetInstance().OnMcpMessage(nullptr);
+    }
+
+    // What a client sends on every new session: initialize, then tools/list until there is no
+    // nextCursor. The cursors come from the previous server, so McpServer has built nothing yet.
+    std::vector<std::string> HandshakeRequests(const std::vector<McpTool*>& tools) {
+        std::vector<std::string> requests = {
+            "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"initialize\",\"params\":{\"capabilities\":{}}}",
+        };
+        std::string cursor;
+        do {
+            requests.push_back(ToolsListRequest(requests.size() + 1, cursor));
+            replies_.clear();
+            PreviousParseMessage(tools, requests.back());
+            EXPECT_EQ(replies_.size(), 1u);
+            cJSON* reply = cJSON_Parse(replies_.back().c_str());
+            auto next_cursor = cJSON_GetObjectItem(cJSON_GetObjectItem(reply, "result"), "nextCursor");
+            cursor = cJSON_IsString(next_cursor) ? next_cursor->valuestring : "";
+            cJSON_Delete(reply);
+        } while (!cursor.empty() && requests.size() < 16);
+        replies_.clear();
+        return requests;
+    }
+};
+
+TEST_F(McpServerTest, CachedPagesMatchThePreviousServer) {
+    auto& tools = HandshakeTools();
+    auto requests = HandshakeRequests(tools);
+    ASSERT_GT(requests.size(), 2u) << "the tools should not fit on one page";
+
+    for (auto& request : requests) {
+        McpServer::GetInstance().ParseMessage(request);
+    }
+    auto cached = std::move(replies_);
+    replies_.clear();
+    for (auto& request : requests) {
+        PreviousParseMessage(tools, request);
+    }
+    EXPECT_EQ(cached, replies_);
+
+    replies_.clear();
+    McpServer::GetInstance().ParseMessage(ToolsListRequest(99, "self.no_such_tool"));
+    ASSERT_EQ(replies_.size(), 1u);
+    EXPECT_NE(replies_[0].find("\"error\""), std::string::npos) << replies_[0];
+}
+
+/*
+ * Time and heap allocations of the MCP handshake of a new session, initialize and every tools/list page. The
+ * previous server rebuilt each page from the tools on every request, printing and re-parsing every
+ * schema. Now the first tools/list builds the pages once and every later handshake replies with them.
+ */
+TEST_F(McpServerTest, HandshakeTimeAndHeap) {
+    // Adding a tool drops pages an earlier test may have built, the first handshake below builds them
+    auto tools = HandshakeTools();
+    tools.push_back(new McpTool("self.get_sequence_status", "Current step of the robot sequence, step counts from 0.",
+        PropertyList(), Ignore));
+    McpServer::GetInstance().AddTool(tools.back());
+    auto requests = HandshakeRequests(tools);
+
+    size_t start_allocations = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCHMARK_HANDSHAKES; n++) {
+        for (auto& request : requests) {
+            PreviousParseMessage(tools, request);
+        }
+        replies_.clear();
+    }
+    std::chrono::duration<double, std::micro> previous_time = std::chrono::steady_clock::now() - start;
+    size_t previous_allocations = allocations - start_allocations;
+
+    start_allocations = allocations;
+    start = std::chrono::steady_clock::now();
+    for (auto& request : requests) {
+        McpServer::GetInstance().ParseMessage(request);
+    }
+    std::chrono::duration<double, std::micro> first_time = std::chrono::steady_clock::now() - start;
+    size_t first_allocations = allocations - start_allocations;
+    // The cache holds exactly the results of the tools/list replies
+    size_t cached_bytes = 0;
+    for (size_t i = 1; i < replies_.size(); i++) {
+        auto result = replies_[i].find("\"result\":");
+        ASSERT_NE(result, std::string::npos) << replies_[i];
+        cached_bytes += replies_[i].size() - result - strlen("\"result\":") - 1;
+    }
+    replies_.clear();
+
+    start_allocations = allocations;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCHMARK_HANDSHAKES; n++) {
+        for (auto& request : requests) {
+            McpServer::GetInstance().ParseMessage(request);
+        }
+        replies_.clear();
+    }
+    std::chrono::duration<double, std::micro> cached_time = std::chrono::steady_clock::now() - start;
+    size_t cached_allocations = allocations - start_allocations;
+
+    printf("%zu tools, %zu tools/list pages: previous %.1f us/handshake %.1f allocations/handshake, "
+        "cached first %.1f us %zu allocations, then %.1f us/handshake %.1f allocations/handshake, %zu page bytes held\n",
+        tools.size(), requests.size() - 1, previous_time.count() / BENCHMARK_HANDSHAKES,
+        double(previous_allocations) / BENCHMARK_HANDSHAKES, first_time.count(), first_allocations,
+        cached_time.count() / BENCHMARK_HANDSHAKES, double(cached_allocations) / BENCHMARK_HANDSHAKES, cached_bytes);
+    EXPECT_GT(first_allocations, cached_allocations / BENCHMARK_HANDSHAKES);
+    EXPECT_LT(cached_allocations, previous_allocations);
+}
+
+class McpToolWorkerTest : public ::testing::Test {
+protected:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::string> replies_;
+    int next_id_ = 1;
+
+    void SetUp() override {
+        Application::GetInstance().OnMcpMessage([this](const std::string& payload) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            replies_.push_back(payload);
+            cv_.notify_all();
+        });
+    }
+
+    void TearDown() override {
+        host_task_create_fail_next(0);
+        Application::GetInstance().OnMcpMessage(nullptr);
+    }
+
+    // Reply to a tools/call, which comes from a worker unless the call was refused
+    std::string Call(const std::string& name, int stack_size = 0) {
+        std::string request = "{\"jsonrpc\":\"2.0\",\"id\":" + std::to_string(next_id_++) +
+            ",\"method\":\"tools/call\",\"params\":{\"name\":\"" + name + "\"";
+        if (stack_size > 0) {
+            request += ",\"stackSize\":" + std::to_string(stack_size);
+        }
+        McpServer::GetInstance().ParseMessage(request + "}}");
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cv_.wait_for(lock, std::chrono::seconds(5), [this]() { return !replies_.empty(); })) {
+            return "no reply";
+        }
+        auto reply = std::move(replies_.front());
+        replies_.erase(replies_.begin());
+        return reply;
+    }
+};
+
+// The tool answers with the stack depth of the worker it runs on
+static int WorkerStackSize() {
+    return uxTaskGetStackHighWaterMark(nullptr);
+}
+
+TEST_F(McpToolWorkerTest, WorkersThatFailToStartAreRetried) {
+    McpServer::GetInstance().AddTypedTool("self.test.stack", "Stack of the worker.",
+        []() -> ReturnValue { return WorkerStackSize(); });
+
+    host_task_create_fail_next(MCP_TOOL_WORKER_COUNT);
+    auto reply = Call("self.test.stack");
+    EXPECT_NE(reply.find("Failed to start tool worker"), std::string::npos) << reply;
+
+    // The queue went away with the workers, the next call starts the lane again
+    reply = Call("self.test.stack");
+    EXPECT_NE(reply.find("\"text\":\"" + std::to_string(MCP_TOOL_WORKER_STACK_SIZE) + "\""), std::string::npos) << reply;
+}
+
+TEST_F(McpToolWorkerTest, HeavyCallsRunWhateverStackTheyAskFor) {
+    McpServer::GetInstance().AddTypedTool("self.test.heavy", "Stack of the heavy worker.",
+        []() -> ReturnValue { return WorkerStackSize(); }, 8192);
+    std::string max_stack = "\"text\":\"" + std::to_string(MCP_TOOL_MAX_STACK_SIZE) + "\"";
+
+    host_task_create_fail_next(1);
+    auto reply = Call("self.test.heavy", 7000);
+    EXPECT_NE(reply.find("Failed to start tool worker"), std::string::npos) << reply;
+
+    // The lane has the largest stack a call can get, whichever call happens to start it
+    reply = Call("self.test.heavy", 7000);
+    EXPECT_NE(reply.find(max_stack), std::string::npos) << reply;
+    reply = Call("self.test.heavy", MCP_TOOL_MAX_STACK_SIZE);
+    EXPECT_NE(reply.find(max_stack), std::string::npos) << reply;
+    // More than that is capped rather than refused
+    reply = Call("self.test.heavy", 1 << 30);
+    EXPECT_NE(reply.find(max_stack), std::string::npos) << reply;
+    reply = Call("self.test.heavy", 4096);
+    EXPECT_NE(reply.find(max_stack), std::string::npos) << reply;
+}
+
+// Error message of a reply, which must be valid JSON
+static std::string ErrorMessage(const std::string& reply) {
+    cJSON* root = cJSON_Parse(reply.c_str());
+    if (root == nullptr) {
+        return "invalid JSON";
+    }
+    auto message = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "error"), "message");
+    std::string text = cJSON_IsString(message) ? message->valuestring : "no error";
+    cJSON_Delete(root);
+    return text;
+}
+
+TEST_F(McpToolWorkerTest, ErrorRepliesEscapeNamesAndExceptions) {
+    McpServer::GetInstance().AddTypedTool("self.test.throw", "Throws a message JSON has to escape.",
+        []() -> ReturnValue { throw std::runtime_error("bad \"value\"\n\\path"); });
+
+    EXPECT_EQ(ErrorMessage(Call("self.test.throw")), "bad \"value\"\n\\path");
+    // The name arrives escaped in the request and goes back into the error
+    EXPECT_EQ(ErrorMessage(Call("self.test.\\\"missing\\\"")), "Unknown tool: self.test.\"missing\"");
+}
+
+TEST_F(McpToolWorkerTest, JobsThatOutliveTheTimeoutGetAnError) {
+    std::mutex release_mutex;
+    std::condition_variable release_cv;
+    bool released = false;
+    McpServer::GetInstance().AddTypedTool("self.test.hang", "Blocks until the test releases it.",
+        [&]() -> ReturnValue {
+            std::unique_lock<std::mutex> lock(release_mutex);
+            release_cv.wait(lock, [&]() { return released; });
+            return true;
+        });
+    McpServer::GetInstance().SetToolJobTimeout(100);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(ErrorMessage(Call("self.test.hang")), "Tool call timed out");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(MCP_TOOL_TIMEOUT_CHECK_MS * 3));
+
+    // The late result is dropped, the worker is free again afterwards
+    {
+        std::lock_guard<std::mutex> lock(release_mutex);
+        released = true;
+    }
+    release_cv.notify_all();
+    McpServer::GetInstance().SetToolJobTimeout(MCP_TOOL_JOB_TIMEOUT_MS);
+    auto reply = Call("self.test.hang");
+    EXPECT_NE(reply.find("\"result\""), std::string::npos) << reply;
+    EXPECT_NE(reply.find("\"id\":" + std::to_string(next_id_ - 1)), std::string::npos) << reply;
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_TRUE(replies_.empty());
+}
+
+TEST_F(McpToolWorkerTest, RepliesAreSentWithoutHoldingTheReplyLock) {
+    // A transport that reacts to a reply by handing the server the next message, as a loopback would
+    bool nested = false;
+    Application::GetInstance().OnMcpMessage([this, &nested](const std::string& payload) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            replies_.push_back(payload);
+            cv_.notify_all();
+        }
+        if (!nested) {
+            nested = true;
+            McpServer::GetInstance().ParseMessage("{\"jsonrpc\":\"2.0\",\"id\":1001,\"method\":\"initialize\"}");
+        }
+    });
+    McpServer::GetInstance().ParseMessage("{\"jsonrpc\":\"2.0\",\"id\":1000,\"method\":\"initialize\"}");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    ASSERT_TRUE(cv_.wait_for(lock, std::chrono::seconds(5), [this]() { return replies_.size() == 2; }));
+    EXPECT_NE(replies_[0].find("\"id\":1000"), std::string::npos) << replies_[0];
+    EXPECT_NE(replies_[1].find("\"id\":1001"), std::string::npos) << replies_[1];
+}
+
+#define BENCHMARK_CALLS 200000
+
+// self.audio_speaker.set_volume with two more arguments, one of each type
+static const char* kCallArguments = "{\"volume\":42,\"theme\":\"dark\",\"quiet\":true}";
+
+static McpTool* PropertyListSetVolume(int& sum) {
+    return new McpTool("self.audio_speaker.set_volume", "Set the volume of the audio speaker.",
+        PropertyList({Property("volume", kPropertyTypeInteger, 0, 100), Property("theme", kPropertyTypeString),
+            Property("quiet", kPropertyTypeBoolean)}),
+        [&sum](const PropertyList& properties) -> ReturnValue {
+            sum += properties["volume"].value<int>() + properties["theme"].value<std::string>().size() +
+                properties["quiet"].value<bool>();
+            return true;
+        });
+}
+
+static McpTool* TypedSetVolume(int& sum) {
+    auto callback = [&sum](int volume, const std::string& theme, bool quiet) -> ReturnValue {
+        sum += volume + theme.size() + quiet;
+        return true;
+    };
+    using Args = McpCallableTraits<decltype(callback)>::Args;
+    McpArg args[] = {McpArg("volume", 0, 100), McpArg("theme"), McpArg("quiet")};
+    return new TypedMcpTool<decltype(callback), Args>("self.audio_speaker.set_volume", "Set the volume of the audio speaker.",
+        args, callback, MCP_TOOL_WORKER_STACK_SIZE);
+}
+
+TEST(McpToolTest, TypedSchemaMatchesPropertyList) {
+    int sum = 0;
+    std::unique_ptr<McpTool> property_list(PropertyListSetVolume(sum));
+    std::unique_ptr<McpTool> typed(TypedSetVolume(sum));
+    EXPECT_EQ(typed->to_json(), property_list->to_json());
+
+    cJSON* arguments = cJSON_Parse("{\"volume\":101,\"theme\":\"dark\",\"quiet\":true}");
+    std::string property_list_error;
+    std::string typed_error;
+    EXPECT_EQ(property_list->Bind(arguments, property_list_error), nullptr);
+    EXPECT_EQ(typed->Bind(arguments, typed_error), nullptr);
+    EXPECT_EQ(typed_error, property_list_error);
+    cJSON_Delete(arguments);
+}
+
+/*
+ * What a tools/call costs before the callback does any work: Bind() checks the parsed arguments
+ * against the schema and the worker runs the bound call. The PropertyList path copies the tool's
+ * properties and finds each value by name, the typed path parses straight into a tuple.
+ */
+TEST(McpToolBenchmark, TypedAndPropertyListCallOverhead) {
+    cJSON* arguments = cJSON_Parse(kCallArguments);
+    int property_list_sum = 0;
+    int typed_sum = 0;
+    std::unique_ptr<McpTool> property_list(PropertyListSetVolume(property_list_sum));
+    std::unique_ptr<McpTool> typed(TypedSetVolume(typed_sum));
+
+    auto measure = [arguments](const McpTool& tool, size_t& call_allocations) {
+        std::string error;
+        size_t start_allocations = allocations;
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < BENCHMARK_CALLS; n++) {
+            auto invoke = tool.Bind(arguments, error);
+            invoke();
+        }
+        std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+        call_allocations = allocations - start_allocations;
+        return time.count() / BENCHMARK_CALLS;
+    };
+    size_t property_list_allocations;
+    size_t typed_allocations;
+    double property_list_ns = measure(*property_list, property_list_allocations);
+    double typed_ns = measure(*typed, typed_allocations);
+
+    printf("Bind and invoke per call: PropertyList %.0f ns %.1f allocations, typed %.0f ns %.1f allocations\n",
+        property_list_ns, double(property_list_allocations) / BENCHMARK_CALLS,
+        typed_ns, double(typed_allocations) / BENCHMARK_CALLS);
+    EXPECT_EQ(typed_sum, property_list_sum);
+    EXPECT_EQ(typed_sum, (42 + 4 + 1) * BENCHMARK_CALLS);
+    EXPECT_LT(typed_allocations, property_list_allocations);
+    cJSON_Delete(arguments);
+}
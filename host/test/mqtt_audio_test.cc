@@ -0,0 +1,258 @@
+#include "mqtt_protocol.h"
+#include "audio_datagram_cipher.h"
+#include "audio_service.h"
+#include "host_board.h"
+#include "settings.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define OPUS_PACKET_SIZE  120     // 60 ms at 16 kbps
+#define BENCHMARK_PACKETS 100000
+
+// Heap allocations made by the calling thread, other tasks of the shim do not count
+static thread_local size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+static const char* kKey = "00112233445566778899AABBCCDDEEFF";
+static const char* kNonce = "01000000A1B2C3D40000000000000000";
+
+static std::string DecodeHex(const char* hex) {
+    std::string bytes;
+    for (size_t i = 0; hex[i] != '\0' && hex[i + 1] != '\0'; i += 2) {
+        bytes.push_back((char)strtol(std::string(hex + i, 2).c_str(), nullptr, 16));
+    }
+    return bytes;
+}
+
+class MqttAudioTest : public ::testing::Test {
+protected:
+    AudioService audio_service_;
+    HostMqtt* mqtt_ = nullptr;
+    HostUdp* udp_ = nullptr;
+    AudioDatagramCipher server_cipher_;
+    size_t sent_count_ = 0;
+    const uint8_t* sent_data_ = nullptr;
+    size_t sent_size_ = 0;
+
+    void SetUp() override {
+        Settings settings("mqtt", true);
+        settings.SetString("endpoint", "broker:8883");
+        settings.SetString("publish_topic", "device-server");
+        ASSERT_TRUE(server_cipher_.SetKey(DecodeHex(kKey), DecodeHex(kNonce)));
+    }
+
+    void TearDown() override {
+        HostBoard::GetInstance().OnMqttCreated(nullptr);
+        HostBoard::GetInstance().OnUdpCreated(nullptr);
+        Settings settings("mqtt", true);
+        settings.EraseAll();
+    }
+
+    void Open(MqttProtocol& protocol) {
+        HostBoard::GetInstance().OnMqttCreated([this](HostMqtt* mqtt) {
+            mqtt_ = mqtt;
+            mqtt->OnConnect([](const std::string&, int) { return true; });
+            mqtt->OnPublish([this, mqtt](const std::string& topic, const std::string& payload) {
+                if (payload.find("\"hello\"") != std::string::npos) {
+                    mqtt->Deliver(topic, ServerHello());
+                }
+                return true;
+            });
+        });
+        HostBoard::GetInstance().OnUdpCreated([this](HostUdp* udp) {
+            udp_ = udp;
+            udp->OnSend([this](const void* data, size_t len) {
+                sent_count_++;
+                sent_data_ = (const uint8_t*)data;
+                sent_size_ = len;
+                return (int)len;
+            });
+        });
+        protocol.SetPacketAllocator([this]() { return audio_service_.AcquirePacket(); });
+        ASSERT_TRUE(protocol.Start());
+        ASSERT_TRUE(protocol.OpenAudioChannel());
+        ASSERT_NE(udp_, nullptr);
+    }
+
+    static std::string ServerHello() {
+        return std::string("{\"type\":\"hello\",\"transport\":\"udp\",\"session_id\":\"s\",\"audio_params\":"
+            "{\"format\":\"opus\",\"sample_rate\":16000,\"frame_duration\":60},\"udp\":{\"server\":\"udp\","
+            "\"port\":8884,\"key\":\"") + kKey + "\",\"nonce\":\"" + kNonce + "\"}}";
+    }
+
+    std::string ServerDatagram(uint32_t sequence, const std::vector<uint8_t>& opus) {
+        std::string datagram(AUDIO_DATAGRAM_HEADER_SIZE + opus.size(), '\0');
+        memcpy(datagram.data() + AUDIO_DATAGRAM_HEADER_SIZE, opus.data(), opus.size());
+        server_cipher_.Seal(AUDIO_DATAGRAM_TYPE_OPUS, 0, sequence * 60, sequence, (uint8_t*)datagram.data(), datagram.size());
+        return datagram;
+    }
+};
+
+static std::vector<uint8_t> OpusPayload() {
+    std::vector<uint8_t> opus(OPUS_PACKET_SIZE);
+    for (size_t i = 0; i < opus.size(); i++) {
+        opus[i] = uint8_t(i * 7);
+    }
+    return opus;
+}
+
+TEST_F(MqttAudioTest, FrameIsSealedInsideThePacket) {
+    MqttProtocol protocol;
+    auto opus = OpusPayload();
+    Open(protocol);
+
+    auto packet = audio_service_.AcquirePacket();
+    packet->timestamp = 1234;
+    packet->payload.insert(packet->payload.end(), opus.begin(), opus.end());
+    ASSERT_TRUE(protocol.SendAudio(*packet));
+
+    // The datagram handed to the Udp is the packet buffer itself, header in the headroom
+    EXPECT_EQ(sent_data_, packet->opus_data() - AUDIO_DATAGRAM_HEADER_SIZE);
+    ASSERT_EQ(sent_size_, AUDIO_DATAGRAM_HEADER_SIZE + opus.size());
+    EXPECT_EQ(AudioDatagramCipher::timestamp(sent_data_), 1234u);
+    std::vector<uint8_t> plain(opus.size());
+    ASSERT_TRUE(server_cipher_.Open(sent_data_, sent_size_, plain.data()));
+    EXPECT_EQ(plain, opus);
+
+    audio_service_.RecyclePacket(std::move(packet));
+    protocol.CloseAudioChannel();
+}
+
+TEST_F(MqttAudioTest, DatagramThatFailsToOpenGoesBackToThePool) {
+    MqttProtocol protocol;
+    auto opus = OpusPayload();
+    size_t received = 0;
+    size_t recycled = 0;
+    protocol.OnIncomingAudio([&](std::unique_ptr<AudioStreamPacket> packet) {
+        received++;
+        audio_service_.RecyclePacket(std::move(packet));
+    });
+    protocol.SetPacketRecycler([&](std::unique_ptr<AudioStreamPacket> packet) {
+        recycled++;
+        audio_service_.RecyclePacket(std::move(packet));
+    });
+    Open(protocol);
+
+    // A hello with a bad key leaves the cipher without a key, so datagrams fail to open
+    auto bad_hello = ServerHello();
+    bad_hello.replace(bad_hello.find(kKey), strlen(kKey), "0011");
+    mqtt_->Deliver("server-device", bad_hello);
+    udp_->Deliver(ServerDatagram(1, opus));
+    EXPECT_EQ(received, 0u);
+    EXPECT_EQ(recycled, 1u);
+
+    mqtt_->Deliver("server-device", ServerHello());
+    udp_->Deliver(ServerDatagram(1, opus));
+    EXPECT_EQ(received, 1u);
+    EXPECT_EQ(recycled, 1u);
+    protocol.CloseAudioChannel();
+}
+
+TEST_F(MqttAudioTest, RekeyWhileReceivingNeverDropsOrGarbles) {
+    MqttProtocol protocol;
+    auto opus = OpusPayload();
+    std::atomic<size_t> received = 0;
+    std::atomic<size_t> garbled = 0;
+    protocol.OnIncomingAudio([&](std::unique_ptr<AudioStreamPacket> packet) {
+        if (packet->opus_size() != opus.size() || memcmp(packet->opus_data(), opus.data(), opus.size()) != 0) {
+            garbled++;
+        }
+        received++;
+        audio_service_.RecyclePacket(std::move(packet));
+    });
+    Open(protocol);
+
+    // Every hello carries the same key, so a datagram can only fail to open while SetKey is half done
+    std::atomic<bool> done = false;
+    std::thread rekey([this, &done]() {
+        auto hello = ServerHello();
+        while (!done) {
+            mqtt_->Deliver("server-device", hello);
+        }
+    });
+    const size_t packets = 20000;
+    for (size_t i = 1; i <= packets; i++) {
+        udp_->Deliver(ServerDatagram(i, opus));
+    }
+    done = true;
+    rekey.join();
+
+    EXPECT_EQ(received.load(), packets);
+    EXPECT_EQ(garbled.load(), 0u);
+    protocol.CloseAudioChannel();
+}
+
+/*
+ * Packets per second through the MQTT+UDP audio path and heap allocations per packet, sending
+ * (encrypt in place inside the packet) and receiving (decrypt into a pooled packet).
+ */
+TEST_F(MqttAudioTest, PacketsPerSecondAndAllocations) {
+    MqttProtocol protocol;
+    auto opus = OpusPayload();
+    size_t received = 0;
+    protocol.OnIncomingAudio([&](std::unique_ptr<AudioStreamPacket> packet) {
+        received++;
+        audio_service_.RecyclePacket(std::move(packet));
+    });
+    Open(protocol);
+
+    auto packet = audio_service_.AcquirePacket();
+    packet->payload.insert(packet->payload.end(), opus.begin(), opus.end());
+    std::vector<std::string> datagrams;
+    for (uint32_t i = 1; i <= 64; i++) {
+        datagrams.push_back(ServerDatagram(i, opus));
+    }
+    // Warm up, so the send buffer and the pool have their steady-state size
+    ASSERT_TRUE(protocol.SendAudio(*packet));
+    udp_->Deliver(datagrams[0]);
+
+    size_t start_allocations = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCHMARK_PACKETS; n++) {
+        protocol.SendAudio(*packet);
+    }
+    std::chrono::duration<double> send_time = std::chrono::steady_clock::now() - start;
+    double send_allocations = double(allocations - start_allocations) / BENCHMARK_PACKETS;
+
+    start_allocations = allocations;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCHMARK_PACKETS; n++) {
+        udp_->Deliver(datagrams[n % datagrams.size()]);
+    }
+    std::chrono::duration<double> receive_time = std::chrono::steady_clock::now() - start;
+    double receive_allocations = double(allocations - start_allocations) / BENCHMARK_PACKETS;
+
+    printf("%d-byte Opus packets: send %.0f packets/s %.2f allocations/packet, receive %.0f packets/s %.2f allocations/packet\n",
+        OPUS_PACKET_SIZE, BENCHMARK_PACKETS / send_time.count(), send_allocations,
+        BENCHMARK_PACKETS / receive_time.count(), receive_allocations);
+    EXPECT_EQ(sent_count_, (size_t)BENCHMARK_PACKETS + 1);
+    EXPECT_EQ(received, (size_t)BENCHMARK_PACKETS + 1);
+    EXPECT_EQ(send_allocations, 0.0);
+    EXPECT_EQ(receive_allocations, 0.0);
+    protocol.CloseAudioChannel();
+}
@@ -0,0 +1,41 @@
+#include "ogg_packet_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(OggPacketReaderTest, IndexedPacketsStayInsideTheSound) {
+    std::vector<uint8_t> data(100, 0xfc);
+    const OggPacketRef packets[] = {{10, 20}, {30, 70}, {90, 20}, {4000000000u, 500000000u}};
+    OggSoundIndex index = {reinterpret_cast<const char*>(data.data()), 16000, 60, packets, std::size(packets)};
+
+    OggPacketReader reader;
+    ASSERT_TRUE(reader.Open(data.data(), data.size(), &index));
+    const uint8_t* packet;
+    size_t size;
+    ASSERT_TRUE(reader.Next(packet, size));
+    EXPECT_EQ(packet, data.data() + 10);
+    EXPECT_EQ(size, 20u);
+    ASSERT_TRUE(reader.Next(packet, size));
+    EXPECT_EQ(size, 70u);
+    // Ends 10 bytes past the sound, the reader stops instead of handing it to the decoder
+    EXPECT_FALSE(reader.Next(packet, size));
+    EXPECT_FALSE(reader.active());
+
+    // Offset and size that only wrap around when added in 32 bits
+    const OggPacketRef wrapping[] = {{4000000000u, 500000000u}};
+    OggSoundIndex wrapping_index = {reinterpret_cast<const char*>(data.data()), 16000, 60, wrapping, 1};
+    ASSERT_TRUE(reader.Open(data.data(), data.size(), &wrapping_index));
+    EXPECT_FALSE(reader.Next(packet, size));
+}
+
+TEST(OggPacketReaderTest, EmptyIndexHasNoPackets) {
+    std::vector<uint8_t> data(64, 0);
+    OggSoundIndex index = {reinterpret_cast<const char*>(data.data()), 16000, 60, nullptr, 0};
+
+    OggPacketReader reader;
+    ASSERT_TRUE(reader.Open(data.data(), data.size(), &index));
+    const uint8_t* packet;
+    size_t size;
+    EXPECT_FALSE(reader.Next(packet, size));
+}
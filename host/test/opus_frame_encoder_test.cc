@@ -0,0 +1,72 @@
+#include "opus_frame_decoder.h"
+#include "opus_frame_encoder.h"
+#include "host_test_util.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#define SAMPLE_RATE       16000
+#define BENCHMARK_SECONDS 20
+
+TEST(OpusFrameEncoderTest, EveryNegotiableDurationRoundTrips) {
+    for (int duration_ms : {20, 40, 60}) {
+        OpusFrameEncoder encoder(SAMPLE_RATE, 1, duration_ms);
+        OpusFrameDecoder decoder(SAMPLE_RATE, 1, duration_ms);
+        ASSERT_EQ(encoder.frame_size(), (size_t)SAMPLE_RATE * duration_ms / 1000);
+
+        auto pcm = SineWave(SAMPLE_RATE, duration_ms, 440);
+        std::vector<uint8_t> opus;
+        std::vector<int16_t> decoded;
+        ASSERT_TRUE(encoder.Encode(pcm.data(), pcm.size(), opus, 4));
+        ASSERT_GT(opus.size(), 4u);
+        ASSERT_TRUE(decoder.Decode(opus.data() + 4, opus.size() - 4, decoded));
+        EXPECT_EQ(decoded.size(), pcm.size()) << duration_ms << " ms";
+    }
+}
+
+/*
+ * Encode and decode cost of the same speech-like signal at each uplink frame duration. Shorter frames
+ * cost more per second of audio: libopus has a fixed per-frame overhead and the packets carry more
+ * headers, which is what the 60 ms fallback for poor links trades against latency.
+ */
+TEST(OpusFrameEncoderBenchmark, CpuCostPerFrameDuration) {
+    auto pcm = SineWave(SAMPLE_RATE, BENCHMARK_SECONDS * 1000, 220);
+    auto overtone = SineWave(SAMPLE_RATE, BENCHMARK_SECONDS * 1000, 1330, 2000);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] += overtone[i];
+    }
+
+    for (int duration_ms : {20, 40, 60}) {
+        OpusFrameEncoder encoder(SAMPLE_RATE, 1, duration_ms);
+        OpusFrameDecoder decoder(SAMPLE_RATE, 1, duration_ms);
+        encoder.SetComplexity(0);
+        size_t frame_size = encoder.frame_size();
+        size_t frames = pcm.size() / frame_size;
+        std::vector<std::vector<uint8_t>> packets(frames);
+        size_t bytes = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < frames; i++) {
+            ASSERT_TRUE(encoder.Encode(pcm.data() + i * frame_size, frame_size, packets[i]));
+        }
+        std::chrono::duration<double, std::micro> encode_time = std::chrono::steady_clock::now() - start;
+
+        std::vector<int16_t> decoded;
+        start = std::chrono::steady_clock::now();
+        for (auto& packet : packets) {
+            ASSERT_TRUE(decoder.Decode(packet.data(), packet.size(), decoded));
+            bytes += packet.size();
+        }
+        std::chrono::duration<double, std::micro> decode_time = std::chrono::steady_clock::now() - start;
+
+        // CPU share is busy time per second of audio, what PrintWorkerStats() shows on the device
+        printf("%2d ms frames: encode %.1f us/frame (%.3f%% CPU), decode %.1f us/frame (%.3f%% CPU), %.0f bytes/s\n",
+            duration_ms, encode_time.count() / frames, encode_time.count() / (BENCHMARK_SECONDS * 1e6) * 100,
+            decode_time.count() / frames, decode_time.count() / (BENCHMARK_SECONDS * 1e6) * 100,
+            double(bytes) / BENCHMARK_SECONDS);
+        EXPECT_EQ(frames, (size_t)BENCHMARK_SECONDS * 1000 / duration_ms);
+    }
+}
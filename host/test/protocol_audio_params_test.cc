@@ -0,0 +1,65 @@
+#include "websocket_protocol.h"
+#include "host_board.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+// Opens a websocket channel against a server that answers the device hello with reply_audio_params
+static void OpenWithServerHello(WebsocketProtocol& protocol, const std::string& reply_audio_params, std::string& device_hello) {
+    HostBoard::GetInstance().OnWebSocketCreated([&](HostWebSocket* websocket) {
+        websocket->OnConnect([](const std::string&) { return true; });
+        websocket->OnSend([&device_hello, reply_audio_params, websocket](const void* data, size_t len, bool binary) {
+            std::string text((const char*)data, len);
+            if (!binary && text.find("\"hello\"") != std::string::npos) {
+                device_hello = text;
+                std::string reply = "{\"type\":\"hello\",\"transport\":\"websocket\",\"session_id\":\"s\","
+                    "\"audio_params\":" + reply_audio_params + "}";
+                websocket->Deliver(reply.data(), reply.size(), false);
+            }
+            return true;
+        });
+    });
+    protocol.SetAudioParams(20, 24000);
+    ASSERT_TRUE(protocol.Start());
+    ASSERT_TRUE(protocol.OpenAudioChannel());
+    HostBoard::GetInstance().OnWebSocketCreated(nullptr);
+}
+
+TEST(ProtocolAudioParamsTest, DownlinkFrameDurationDoesNotChangeTheUplink) {
+    WebsocketProtocol protocol;
+    std::string device_hello;
+    // A server that does not negotiate answers with its own TTS parameters only
+    OpenWithServerHello(protocol, "{\"format\":\"opus\",\"sample_rate\":24000,\"channels\":1,\"frame_duration\":20}", device_hello);
+
+    EXPECT_NE(device_hello.find("\"frame_duration\":20"), std::string::npos) << device_hello;
+    EXPECT_EQ(protocol.server_frame_duration(), 20);
+    EXPECT_EQ(protocol.uplink_frame_duration(), 60);
+    EXPECT_EQ(protocol.uplink_bitrate(), 0);
+    protocol.CloseAudioChannel();
+}
+
+TEST(ProtocolAudioParamsTest, UplinkFollowsItsOwnFields) {
+    WebsocketProtocol protocol;
+    std::string device_hello;
+    OpenWithServerHello(protocol, "{\"format\":\"opus\",\"sample_rate\":24000,\"frame_duration\":60,"
+        "\"uplink_frame_duration\":40,\"uplink_bitrate\":16000}", device_hello);
+
+    EXPECT_EQ(protocol.server_frame_duration(), 60);
+    EXPECT_EQ(protocol.uplink_frame_duration(), 40);
+    EXPECT_EQ(protocol.uplink_bitrate(), 16000);
+    protocol.CloseAudioChannel();
+}
+
+TEST(ProtocolAudioParamsTest, UnsupportedUplinkFrameDurationKeeps60) {
+    for (const char* duration : {"0", "-20", "30", "100", "120"}) {
+        WebsocketProtocol protocol;
+        std::string device_hello;
+        OpenWithServerHello(protocol, std::string("{\"format\":\"opus\",\"sample_rate\":24000,\"frame_duration\":60,"
+            "\"uplink_frame_duration\":") + duration + "}", device_hello);
+
+        EXPECT_EQ(protocol.uplink_frame_duration(), 60) << duration;
+        protocol.CloseAudioChannel();
+    }
+}
@@ -0,0 +1,50 @@
+#include "robot_sequencer.h"
+#include "second_uart.h"
+
+#include <freertos/task.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Waits for the sequence to play out, false if it still runs after timeout_ms
+static bool WaitUntilIdle(int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (RobotSequencer::GetInstance().IsRunning()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+TEST(RobotSequencerTest, TaskCreationFailureLeavesItIdle) {
+    auto& sequencer = RobotSequencer::GetInstance();
+    SecondUart::GetInstance().TakeSent();
+
+    host_task_create_fail_next(1);
+    EXPECT_FALSE(sequencer.Start({{"kwkF", 10}, {"ksit", 10}}));
+    host_task_create_fail_next(0);
+    EXPECT_FALSE(sequencer.IsRunning());
+    EXPECT_EQ(sequencer.GetStatusJson(), "{\"running\":false}");
+    // Nothing to cancel, and no task to notify
+    sequencer.Cancel("test");
+
+    // The next Start() creates the task
+    ASSERT_TRUE(sequencer.Start({{"kwkF", 10}, {"ksit", 10}, {"d", 10}}));
+    ASSERT_TRUE(WaitUntilIdle(2000));
+    EXPECT_EQ(SecondUart::GetInstance().TakeSent(), (std::vector<std::string>{"kwkF", "ksit", "d"}));
+}
+
+TEST(RobotSequencerTest, StartReplacesTheRunningSequence) {
+    auto& sequencer = RobotSequencer::GetInstance();
+    ASSERT_TRUE(sequencer.Start({{"kwkF", 10000}}));
+    // Let the task send the first step, then replace it long before the step is over
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(sequencer.Start({{"ksit", 10}}));
+    ASSERT_TRUE(WaitUntilIdle(2000));
+    EXPECT_EQ(SecondUart::GetInstance().TakeSent(), (std::vector<std::string>{"kwkF", "ksit"}));
+}
@@ -0,0 +1,230 @@
+#include "websocket_protocol.h"
+#include "audio_service.h"
+#include "host_board.h"
+#include "settings.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define OPUS_PACKET_SIZE  120     // 60 ms at 16 kbps
+#define BENCHMARK_FRAMES  100000
+
+class WebsocketAudioTest : public ::testing::Test {
+protected:
+    AudioService audio_service_;
+    HostWebSocket* websocket_ = nullptr;
+    // Where the protocol handed its last binary frame to the websocket
+    const uint8_t* sent_data_ = nullptr;
+    size_t sent_size_ = 0;
+    size_t sent_count_ = 0;
+
+    void TearDown() override {
+        HostBoard::GetInstance().OnWebSocketCreated(nullptr);
+        Settings settings("websocket", true);
+        settings.SetInt("version", 0);
+    }
+
+    void Open(WebsocketProtocol& protocol, int version) {
+        {
+            Settings settings("websocket", true);
+            settings.SetInt("version", version);
+        }
+        HostBoard::GetInstance().OnWebSocketCreated([this](HostWebSocket* websocket) {
+            websocket_ = websocket;
+            websocket->OnConnect([](const std::string&) { return true; });
+            websocket->OnSend([this, websocket](const void* data, size_t len, bool binary) {
+                if (binary) {
+                    sent_data_ = (const uint8_t*)data;
+                    sent_size_ = len;
+                    sent_count_++;
+                    return true;
+                }
+                std::string text((const char*)data, len);
+                if (text.find("\"hello\"") != std::string::npos) {
+                    std::string reply = "{\"type\":\"hello\",\"transport\":\"websocket\",\"session_id\":\"s\","
+                        "\"audio_params\":{\"format\":\"opus\",\"sample_rate\":16000,\"frame_duration\":60}}";
+                    websocket->Deliver(reply.data(), reply.size(), false);
+                }
+                return true;
+            });
+        });
+        ASSERT_TRUE(protocol.Start());
+        ASSERT_TRUE(protocol.OpenAudioChannel());
+    }
+
+    std::unique_ptr<AudioStreamPacket> EncodedPacket() {
+        auto packet = audio_service_.AcquirePacket();
+        for (int i = 0; i < OPUS_PACKET_SIZE; i++) {
+            packet->payload.push_back(uint8_t(i));
+        }
+        packet->timestamp = 1234;
+        return packet;
+    }
+};
+
+TEST_F(WebsocketAudioTest, SendsEveryVersionInPlace) {
+    for (int version : {1, 2, 3}) {
+        WebsocketProtocol protocol;
+        Open(protocol, version);
+        auto packet = EncodedPacket();
+        ASSERT_EQ(packet->headroom, AUDIO_PACKET_HEADROOM);
+        ASSERT_TRUE(protocol.SendAudio(*packet));
+
+        size_t header_size = version == 2 ? sizeof(BinaryProtocol2) : version == 3 ? sizeof(BinaryProtocol3) : 0;
+        // The frame starts inside the packet headroom, nothing was copied or moved
+        EXPECT_EQ(sent_data_, packet->opus_data() - header_size) << "version " << version;
+        ASSERT_EQ(sent_size_, header_size + OPUS_PACKET_SIZE);
+        EXPECT_EQ(memcmp(sent_data_ + header_size, packet->opus_data(), OPUS_PACKET_SIZE), 0);
+        if (version == 2) {
+            auto bp2 = (const BinaryProtocol2*)sent_data_;
+            EXPECT_EQ(ntohs(bp2->version), 2);
+            EXPECT_EQ(ntohl(bp2->timestamp), 1234u);
+            EXPECT_EQ(ntohl(bp2->payload_size), (uint32_t)OPUS_PACKET_SIZE);
+        } else if (version == 3) {
+            EXPECT_EQ(ntohs(((const BinaryProtocol3*)sent_data_)->payload_size), OPUS_PACKET_SIZE);
+        }
+        protocol.CloseAudioChannel();
+    }
+}
+
+TEST_F(WebsocketAudioTest, PacketWithoutHeadroomIsRefused) {
+    WebsocketProtocol protocol;
+    Open(protocol, 3);
+    AudioStreamPacket packet;
+    packet.payload.assign(OPUS_PACKET_SIZE, 0x5a);
+    EXPECT_FALSE(protocol.SendAudio(packet));
+    EXPECT_EQ(sent_count_, 0u);
+    EXPECT_EQ(packet.payload.size(), (size_t)OPUS_PACKET_SIZE);
+    protocol.CloseAudioChannel();
+}
+
+TEST_F(WebsocketAudioTest, ReceivedFramesKeepTheHeadroom) {
+    WebsocketProtocol protocol;
+    protocol.SetPacketAllocator([this]() { return audio_service_.AcquirePacket(); });
+    std::unique_ptr<AudioStreamPacket> received;
+    protocol.OnIncomingAudio([&received](std::unique_ptr<AudioStreamPacket> packet) {
+        received = std::move(packet);
+    });
+    Open(protocol, 3);
+
+    std::vector<uint8_t> frame(sizeof(BinaryProtocol3) + OPUS_PACKET_SIZE);
+    auto bp3 = (BinaryProtocol3*)frame.data();
+    bp3->payload_size = htons(OPUS_PACKET_SIZE);
+    for (int i = 0; i < OPUS_PACKET_SIZE; i++) {
+        bp3->payload[i] = uint8_t(i);
+    }
+    websocket_->Deliver((const char*)frame.data(), frame.size(), true);
+
+    ASSERT_NE(received, nullptr);
+    EXPECT_EQ(received->headroom, AUDIO_PACKET_HEADROOM);
+    ASSERT_EQ(received->opus_size(), (size_t)OPUS_PACKET_SIZE);
+    EXPECT_EQ(memcmp(received->opus_data(), bp3->payload, OPUS_PACKET_SIZE), 0);
+
+    // A received packet can go straight back out, e.g. when the loopback echoes it
+    ASSERT_TRUE(protocol.SendAudio(*received));
+    EXPECT_EQ(sent_data_, received->opus_data() - sizeof(BinaryProtocol3));
+    protocol.CloseAudioChannel();
+}
+
+TEST_F(WebsocketAudioTest, FramesWithBadPayloadSizeAreDropped) {
+    for (int version : {2, 3}) {
+        WebsocketProtocol protocol;
+        size_t received = 0;
+        protocol.OnIncomingAudio([&received](std::unique_ptr<AudioStreamPacket> packet) {
+            received++;
+        });
+        Open(protocol, version);
+
+        size_t header_size = version == 2 ? sizeof(BinaryProtocol2) : sizeof(BinaryProtocol3);
+        std::vector<uint8_t> frame(header_size + OPUS_PACKET_SIZE);
+        auto set_payload_size = [&](size_t size) {
+            if (version == 2) {
+                ((BinaryProtocol2*)frame.data())->payload_size = htonl(size);
+            } else {
+                ((BinaryProtocol3*)frame.data())->payload_size = htons(size);
+            }
+        };
+
+        // Shorter than the header
+        websocket_->Deliver((const char*)frame.data(), header_size - 1, true);
+        // Payload size past the end of the frame
+        set_payload_size(OPUS_PACKET_SIZE + 1);
+        websocket_->Deliver((const char*)frame.data(), frame.size(), true);
+        set_payload_size(version == 2 ? 0xffffffff : 0xffff);
+        websocket_->Deliver((const char*)frame.data(), frame.size(), true);
+        EXPECT_EQ(received, 0u) << "version " << version;
+
+        set_payload_size(OPUS_PACKET_SIZE);
+        websocket_->Deliver((const char*)frame.data(), frame.size(), true);
+        EXPECT_EQ(received, 1u) << "version " << version;
+        protocol.CloseAudioChannel();
+    }
+}
+
+/*
+ * Bytes the protocol copies per second of 60 ms uplink audio. Before the headroom, SendAudio built a
+ * new string with the header and copied the Opus data behind it, and packets without headroom (the
+ * wake word) had it inserted in front, moving the whole payload. Now both send from the packet.
+ */
+TEST_F(WebsocketAudioTest, BytesCopiedPerSecondOfAudio) {
+    WebsocketProtocol protocol;
+    Open(protocol, 3);
+    auto packet = EncodedPacket();
+    std::vector<uint8_t> opus(packet->opus_data(), packet->opus_data() + OPUS_PACKET_SIZE);
+    uint64_t checksum = 0;
+
+    // Previous path: a serialized copy per frame
+    size_t previous_copied = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCHMARK_FRAMES; n++) {
+        std::string serialized;
+        serialized.resize(sizeof(BinaryProtocol3) + opus.size());
+        auto bp3 = (BinaryProtocol3*)serialized.data();
+        bp3->type = 0;
+        bp3->reserved = 0;
+        bp3->payload_size = htons(opus.size());
+        memcpy(bp3->payload, opus.data(), opus.size());
+        previous_copied += serialized.size();
+        checksum += (uint8_t)serialized[n % serialized.size()];
+    }
+    std::chrono::duration<double, std::micro> previous_time = std::chrono::steady_clock::now() - start;
+
+    // Previous wake word path: a packet without headroom got it inserted in front of the payload
+    size_t previous_insert_copied = 0;
+    for (int n = 0; n < BENCHMARK_FRAMES / 100; n++) {
+        std::vector<uint8_t> payload(opus);
+        payload.insert(payload.begin(), AUDIO_PACKET_HEADROOM, 0);
+        previous_insert_copied += payload.size();
+        checksum += payload[n % payload.size()];
+    }
+
+    // In place: anything handed to the websocket from outside the packet would have been copied
+    size_t copied = 0;
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < BENCHMARK_FRAMES; n++) {
+        ASSERT_TRUE(protocol.SendAudio(*packet));
+        if (sent_data_ < packet->payload.data() || sent_data_ + sent_size_ > packet->payload.data() + packet->payload.size()) {
+            copied += sent_size_;
+        }
+        checksum += sent_data_[n % sent_size_];
+    }
+    std::chrono::duration<double, std::micro> time = std::chrono::steady_clock::now() - start;
+
+    double frames_per_second = 1000.0 / 60;
+    printf("Per second of 60 ms audio: previous send copied %.0f bytes (%.3f us/frame), wake word insert %.0f bytes, "
+        "in place %.0f bytes (%.3f us/frame) (checksum %llu)\n",
+        double(previous_copied) / BENCHMARK_FRAMES * frames_per_second, previous_time.count() / BENCHMARK_FRAMES,
+        double(previous_insert_copied) / (BENCHMARK_FRAMES / 100) * frames_per_second,
+        double(copied) / BENCHMARK_FRAMES * frames_per_second, time.count() / BENCHMARK_FRAMES,
+        (unsigned long long)checksum);
+    EXPECT_EQ(previous_copied, (size_t)BENCHMARK_FRAMES * (sizeof(BinaryProtocol3) + OPUS_PACKET_SIZE));
+    EXPECT_EQ(copied, 0u);
+    protocol.CloseAudioChannel();
+}
@@ -5,6 +5,7 @@
 #include "audio_codec.h"
 #include "mqtt_protocol.h"
 #include "websocket_protocol.h"
+#include "loopback_protocol.h"
 #include "assets/lang_config.h"
 #include "language_runtime.h"
 #include "language_sounds_zh_cn.h"
@@ -12,7 +13,10 @@
 #include "assets.h"
 #include "settings.h"
 #include "second_uart.h"
+#include "robot_sequencer.h"
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <string>
 #include <esp_log.h>
@@ -293,11 +297,8 @@ void Application::ToggleChatState() {
 
     if (device_state_ == kDeviceStateIdle) {
         Schedule([this]() {
-            if (!protocol_->IsAudioChannelOpened()) {
-                SetDeviceState(kDeviceStateConnecting);
-                if (!protocol_->OpenAudioChannel()) {
-                    return;
-                }
+            if (!OpenAudioChannelForTurn()) {
+                return;
             }
 
             SetListeningMode(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
@@ -330,11 +331,8 @@ void Application::StartListening() {
     
     if (device_state_ == kDeviceStateIdle) {
         Schedule([this]() {
-            if (!protocol_->IsAudioChannelOpened()) {
-                SetDeviceState(kDeviceStateConnecting);
-                if (!protocol_->OpenAudioChannel()) {
-                    return;
-                }
+            if (!OpenAudioChannelForTurn()) {
+                return;
             }
 
             SetListeningMode(kListeningModeManualStop);
@@ -417,6 +415,11 @@ void Application::Start() {
     callbacks.on_vad_change = [this](bool speaking) {
         xEventGroupSetBits(event_group_, MAIN_EVENT_VAD_CHANGE);
     };
+    callbacks.on_uplink_stalled = [this](int stalled_ms) {
+        if (stalled_ms >= UPLINK_STALL_END_TURN_MS) {
+            xEventGroupSetBits(event_group_, MAIN_EVENT_UPLINK_STALLED);
+        }
+    };
     audio_service_.SetCallbacks(callbacks);
 
     // Start the main event loop task with priority 3
@@ -448,6 +451,10 @@ void Application::Start() {
     auto& mcp_server = McpServer::GetInstance();
     mcp_server.AddCommonTools();
 
+#if CONFIG_USE_LOOPBACK_PROTOCOL
+    ESP_LOGW(TAG, "Loopback protocol enabled, replies are the recorded uplink audio");
+    protocol_ = std::make_unique<LoopbackProtocol>(CONFIG_LOOPBACK_REPLAY_SPEED);
+#else
     if (ota.HasMqttConfig()) {
         protocol_ = std::make_unique<MqttProtocol>();
     } else if (ota.HasWebsocketConfig()) {
@@ -456,19 +463,38 @@ void Application::Start() {
         ESP_LOGW(TAG, "No protocol specified in the OTA config, using MQTT");
         protocol_ = std::make_unique<MqttProtocol>();
     }
+#endif
 
     protocol_->OnNetworkError([this](const std::string& message) {
+        if (preconnecting_) {
+            // A background connect that failed is retried later, nobody is waiting for it
+            ESP_LOGW(TAG, "Audio channel pre-connect failed: %s", message.c_str());
+            return;
+        }
         last_error_message_ = message;
         xEventGroupSetBits(event_group_, MAIN_EVENT_ERROR);
     });
-    protocol_->OnIncomingAudio([this](AudioStreamPacket&& packet) {
+#if CONFIG_AUDIO_CHANNEL_KEEP_WARM
+    protocol_->SetSessionResume(true);
+#endif
+    protocol_->SetPacketAllocator([this]() {
+        return audio_service_.AcquirePacket();
+    });
+    protocol_->SetPacketRecycler([this](std::unique_ptr<AudioStreamPacket> packet) {
+        audio_service_.RecyclePacket(std::move(packet));
+    });
+    protocol_->OnIncomingAudio([this](std::unique_ptr<AudioStreamPacket> packet) {
         if (device_state_ == kDeviceStateSpeaking) {
-            auto packet_ptr = std::make_unique<AudioStreamPacket>(std::move(packet));
-            audio_service_.PushPacketToDecodeQueue(std::move(packet_ptr));
+            audio_service_.PushPacketToDecodeQueue(std::move(packet));
+        } else {
+            audio_service_.RecyclePacket(std::move(packet));
         }
     });
     protocol_->OnAudioChannelOpened([this, codec, &board]() {
         board.SetPowerSaveMode(false);
+        // The uplink follows the frame duration and bitrate the server accepted in its hello
+        int bitrate = protocol_->uplink_bitrate() > 0 ? protocol_->uplink_bitrate() : CONFIG_OPUS_UPLINK_BITRATE;
+        audio_service_.SetEncodeParams(protocol_->uplink_frame_duration(), bitrate);
         if (protocol_->server_sample_rate() != codec->output_sample_rate()) {
             ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
                 protocol_->server_sample_rate(), codec->output_sample_rate());
@@ -482,116 +508,13 @@ void Application::Start() {
             SetDeviceState(kDeviceStateIdle);
         });
     });
-    protocol_->OnIncomingJson([this, display](const cJSON* root) {
-        // Parse JSON data
-        auto type = cJSON_GetObjectItem(root, "type");
-        if (strcmp(type->valuestring, "tts") == 0) {
-            auto state = cJSON_GetObjectItem(root, "state");
-            if (strcmp(state->valuestring, "start") == 0) {
-                Schedule([this]() {
-                    aborted_ = false;
-                    if (device_state_ == kDeviceStateIdle || device_state_ == kDeviceStateListening) {
-                        SetDeviceState(kDeviceStateSpeaking);
-                    }
-                });
-            } else if (strcmp(state->valuestring, "stop") == 0) {
-                Schedule([this]() {
-                    if (device_state_ == kDeviceStateSpeaking) {
-                        if (listening_mode_ == kListeningModeManualStop) {
-                            SetDeviceState(kDeviceStateIdle);
-                        } else {
-                            SetDeviceState(kDeviceStateListening);
-                        }
-                    }
-                });
-            } else if (strcmp(state->valuestring, "sentence_start") == 0) {
-                auto text = cJSON_GetObjectItem(root, "text");
-                if (cJSON_IsString(text)) {
-                    // 提取机器人指令
-                    std::string originalText = text->valuestring;
-                    std::string cleanedText;
-                    std::string commands = ExtractRobotCommands(originalText, cleanedText);
-                    
-                    // 在串口上打印原始与清理后的回复内容，独立于日志等级
-                    printf("<< %s\n", originalText.c_str());
-                    ESP_LOGI(TAG, "<< Original: %s", originalText.c_str());
-                    if (!commands.empty()) {
-                        ESP_LOGI(TAG, "<< Commands: %s", commands.c_str());
-                        // 发送机器人指令到第二串口
-                        Schedule([this, commands]() {
-                            SendRobotCommand(commands);
-                        });
-                    }
-                    ESP_LOGI(TAG, "<< Cleaned: %s", cleanedText.c_str());
-                    
-                    // 显示清理后的文本（如果有）
-                    if (!cleanedText.empty()) {
-                        Schedule([this, display, message = cleanedText]() {
-                            display->SetChatMessage("assistant", message.c_str());
-                        });
-                    }
-                }
-            }
-        } else if (strcmp(type->valuestring, "stt") == 0) {
-            auto text = cJSON_GetObjectItem(root, "text");
-            if (cJSON_IsString(text)) {
-                // 在串口上打印用户说的话，独立于日志等级，方便调试
-                printf(">> %s\n", text->valuestring);
-                ESP_LOGI(TAG, ">> %s", text->valuestring);
-                Schedule([this, display, message = std::string(text->valuestring)]() {
-                    display->SetChatMessage("user", message.c_str());
-                });
-            }
-        } else if (strcmp(type->valuestring, "llm") == 0) {
-            auto emotion = cJSON_GetObjectItem(root, "emotion");
-            if (cJSON_IsString(emotion)) {
-                Schedule([this, display, emotion_str = std::string(emotion->valuestring)]() {
-                    display->SetEmotion(emotion_str.c_str());
-                });
-            }
-        } else if (strcmp(type->valuestring, "mcp") == 0) {
-            auto payload = cJSON_GetObjectItem(root, "payload");
-            if (cJSON_IsObject(payload)) {
-                McpServer::GetInstance().ParseMessage(payload);
-            }
-        } else if (strcmp(type->valuestring, "system") == 0) {
-            auto command = cJSON_GetObjectItem(root, "command");
-            if (cJSON_IsString(command)) {
-                ESP_LOGI(TAG, "System command: %s", command->valuestring);
-                if (strcmp(command->valuestring, "reboot") == 0) {
-                    // Do a reboot if user requests a OTA update
-                    Schedule([this]() {
-                        Reboot();
-                    });
-                } else {
-                    ESP_LOGW(TAG, "Unknown system command: %s", command->valuestring);
-                }
-            }
-        } else if (strcmp(type->valuestring, "alert") == 0) {
-            auto status = cJSON_GetObjectItem(root, "status");
-            auto message = cJSON_GetObjectItem(root, "message");
-            auto emotion = cJSON_GetObjectItem(root, "emotion");
-            if (cJSON_IsString(status) && cJSON_IsString(message) && cJSON_IsString(emotion)) {
-                Alert(status->valuestring, message->valuestring, emotion->valuestring, Lang::Sounds::OGG_VIBRATION);
-            } else {
-                ESP_LOGW(TAG, "Alert command requires status, message and emotion");
-            }
-#if CONFIG_RECEIVE_CUSTOM_MESSAGE
-        } else if (strcmp(type->valuestring, "custom") == 0) {
-            auto payload = cJSON_GetObjectItem(root, "payload");
-            ESP_LOGI(TAG, "Received custom message: %s", cJSON_PrintUnformatted(root));
-            if (cJSON_IsObject(payload)) {
-                Schedule([this, display, payload_str = std::string(cJSON_PrintUnformatted(payload))]() {
-                    display->SetChatMessage("system", payload_str.c_str());
-                });
-            } else {
-                ESP_LOGW(TAG, "Invalid custom message format: missing payload");
-            }
-#endif
-        } else {
-            ESP_LOGW(TAG, "Unknown message type: %s", type->valuestring);
+    RegisterControlHandlers();
+    protocol_->OnIncomingMessage([this](ControlMessage& message) {
+        if (!control_handlers_.Dispatch(message)) {
+            ESP_LOGW(TAG, "Unknown message type: %s", message.type());
         }
     });
+    protocol_->SetAudioParams(CONFIG_OPUS_UPLINK_FRAME_DURATION, CONFIG_OPUS_UPLINK_BITRATE);
     bool protocol_started = protocol_->Start();
 
     SystemInfo::PrintHeapStats();
@@ -616,6 +539,140 @@ void Application::Start() {
     }
 }
 
+// Handlers for the server control messages, called on the protocol's receive task
+void Application::RegisterControlHandlers() {
+    auto display = Board::GetInstance().GetDisplay();
+
+    control_handlers_.On("tts", [this, display](ControlMessage& message) {
+        auto state = message.GetString("state");
+        if (state == nullptr) {
+            return;
+        }
+        if (strcmp(state, "start") == 0) {
+            Schedule([this]() {
+                aborted_ = false;
+                if (device_state_ == kDeviceStateIdle || device_state_ == kDeviceStateListening) {
+                    SetDeviceState(kDeviceStateSpeaking);
+                }
+            });
+        } else if (strcmp(state, "stop") == 0) {
+            Schedule([this]() {
+                if (device_state_ == kDeviceStateSpeaking) {
+                    if (listening_mode_ == kListeningModeManualStop) {
+                        SetDeviceState(kDeviceStateIdle);
+                    } else {
+                        SetDeviceState(kDeviceStateListening);
+                    }
+                }
+            });
+        } else if (strcmp(state, "sentence_start") == 0) {
+            auto text = message.GetString("text");
+            if (text != nullptr) {
+                // 提取机器人指令
+                std::string originalText = text;
+                std::string cleanedText;
+                std::string commands = ExtractRobotCommands(originalText, cleanedText);
+                
+                // 在串口上打印原始与清理后的回复内容，独立于日志等级
+                printf("<< %s\n", originalText.c_str());
+                ESP_LOGI(TAG, "<< Original: %s", originalText.c_str());
+                if (!commands.empty()) {
+                    ESP_LOGI(TAG, "<< Commands: %s", commands.c_str());
+                    // 发送机器人指令到第二串口
+                    Schedule([this, commands]() {
+                        SendRobotCommand(commands);
+                    });
+                }
+                ESP_LOGI(TAG, "<< Cleaned: %s", cleanedText.c_str());
+                
+                // 显示清理后的文本（如果有）
+                if (!cleanedText.empty()) {
+                    Schedule([this, display, message = std::move(cleanedText)]() {
+                        display->SetChatMessage("assistant", message.c_str());
+                    });
+                }
+            }
+        }
+    });
+
+    control_handlers_.On("stt", [this, display](ControlMessage& message) {
+        auto text = message.GetString("text");
+        if (text != nullptr) {
+            // 在串口上打印用户说的话，独立于日志等级，方便调试
+            printf(">> %s\n", text);
+            ESP_LOGI(TAG, ">> %s", text);
+            Schedule([this, display, message = std::string(text)]() {
+                display->SetChatMessage("user", message.c_str());
+            });
+        }
+    });
+
+    control_handlers_.On("llm", [this, display](ControlMessage& message) {
+        auto emotion = message.GetString("emotion");
+        if (emotion != nullptr) {
+            Schedule([this, display, emotion_str = std::string(emotion)]() {
+                display->SetEmotion(emotion_str.c_str());
+            });
+        }
+    });
+
+    // MCP is the only message that needs a full tree
+    control_handlers_.On("mcp", [](ControlMessage& message) {
+        // A JSON-RPC request or a batch array of them
+        if (!message.Has("payload", kControlValueObject) && !message.Has("payload", kControlValueArray)) {
+            return;
+        }
+        bool sequential = false;
+        message.GetBool("sequential", sequential);
+        auto raw = message.GetRaw("payload");
+        cJSON* payload = cJSON_ParseWithLength(raw.data(), raw.size());
+        if (payload != nullptr) {
+            McpServer::GetInstance().ParseMessage(payload, sequential);
+            cJSON_Delete(payload);
+        }
+    });
+
+    control_handlers_.On("system", [this](ControlMessage& message) {
+        auto command = message.GetString("command");
+        if (command != nullptr) {
+            ESP_LOGI(TAG, "System command: %s", command);
+            if (strcmp(command, "reboot") == 0) {
+                // Do a reboot if user requests a OTA update
+                Schedule([this]() {
+                    Reboot();
+                });
+            } else {
+                ESP_LOGW(TAG, "Unknown system command: %s", command);
+            }
+        }
+    });
+
+    control_handlers_.On("alert", [this](ControlMessage& message) {
+        auto status = message.GetString("status");
+        auto text = message.GetString("message");
+        auto emotion = message.GetString("emotion");
+        if (status != nullptr && text != nullptr && emotion != nullptr) {
+            Alert(status, text, emotion, Lang::Sounds::OGG_VIBRATION);
+        } else {
+            ESP_LOGW(TAG, "Alert command requires status, message and emotion");
+        }
+    });
+
+#if CONFIG_RECEIVE_CUSTOM_MESSAGE
+    control_handlers_.On("custom", [this, display](ControlMessage& message) {
+        auto text = message.text();
+        ESP_LOGI(TAG, "Received custom message: %.*s", (int)text.size(), text.data());
+        if (message.Has("payload", kControlValueObject)) {
+            Schedule([this, display, payload_str = std::string(message.GetRaw("payload"))]() {
+                display->SetChatMessage("system", payload_str.c_str());
+            });
+        } else {
+            ESP_LOGW(TAG, "Invalid custom message format: missing payload");
+        }
+    });
+#endif
+}
+
 // Add a async task to MainLoop
 void Application::Schedule(std::function<void()> callback) {
     {
@@ -625,6 +682,49 @@ void Application::Schedule(std::function<void()> callback) {
     xEventGroupSetBits(event_group_, MAIN_EVENT_SCHEDULE);
 }
 
+// Drain the send queue. Frames that piled up while the uplink was slow go out together, up to the
+// batch size the server accepted, so the batch grows with the queue depth and never waits for frames
+void Application::SendQueuedAudio() {
+    std::array<std::unique_ptr<AudioStreamPacket>, AUDIO_BATCH_MAX_FRAMES> packets;
+    std::array<AudioStreamPacket*, AUDIO_BATCH_MAX_FRAMES> batch;
+    while (true) {
+        size_t limit = protocol_ ? protocol_->max_audio_batch() : 1;
+        size_t count = 0;
+        while (count < limit && (packets[count] = audio_service_.PopPacketFromSendQueue())) {
+            batch[count] = packets[count].get();
+            count++;
+        }
+        if (count == 0) {
+            return;
+        }
+
+        bool failed = protocol_ && !protocol_->SendAudioBatch(std::span(batch.data(), count));
+        for (size_t i = 0; i < count; i++) {
+            if (!failed) {
+                audio_service_.RecordPacketSent(*packets[i]);
+            }
+            audio_service_.RecyclePacket(std::move(packets[i]));
+        }
+        if (failed) {
+            audio_service_.RecordSendFailure();
+            return;
+        }
+    }
+}
+
+// The server has not taken any audio for a while, what the user says now would be lost
+void Application::OnUplinkStalled() {
+    if (device_state_ != kDeviceStateListening) {
+        return;
+    }
+    auto& stats = audio_service_.GetDebugStatistics();
+    ESP_LOGW(TAG, "Uplink stalled for %d ms (%lu oldest, %lu newest, %lu paused frames dropped), ending the turn",
+        UPLINK_STALL_END_TURN_MS, stats.uplink_drop_oldest_count, stats.uplink_drop_newest_count,
+        stats.uplink_paused_drop_count);
+    protocol_->SendStopListening();
+    SetDeviceState(kDeviceStateIdle);
+}
+
 // The Main Event Loop controls the chat state and websocket connection
 // If other tasks need to access the websocket or chat state,
 // they should use Schedule to call this function
@@ -634,6 +734,7 @@ void Application::MainEventLoop() {
             MAIN_EVENT_SEND_AUDIO |
             MAIN_EVENT_WAKE_WORD_DETECTED |
             MAIN_EVENT_VAD_CHANGE |
+            MAIN_EVENT_UPLINK_STALLED |
             MAIN_EVENT_CLOCK_TICK |
             MAIN_EVENT_ERROR, pdTRUE, pdFALSE, portMAX_DELAY);
 
@@ -643,11 +744,7 @@ void Application::MainEventLoop() {
         }
 
         if (bits & MAIN_EVENT_SEND_AUDIO) {
-            while (auto packet = audio_service_.PopPacketFromSendQueue()) {
-                if (protocol_ && packet && !protocol_->SendAudio(*packet)) {
-                    break;
-                }
-            }
+            SendQueuedAudio();
         }
 
         if (bits & MAIN_EVENT_WAKE_WORD_DETECTED) {
@@ -658,6 +755,10 @@ void Application::MainEventLoop() {
             // LED control removed - board doesn't support GetLed()
         }
 
+        if (bits & MAIN_EVENT_UPLINK_STALLED) {
+            OnUplinkStalled();
+        }
+
         if (bits & MAIN_EVENT_SCHEDULE) {
             std::unique_lock<std::mutex> lock(mutex_);
             auto tasks = std::move(main_tasks_);
@@ -677,25 +778,87 @@ void Application::MainEventLoop() {
                 // SystemInfo::PrintTaskCpuUsage(pdMS_TO_TICKS(1000));
                 // SystemInfo::PrintTaskList();
                 SystemInfo::PrintHeapStats();
+                audio_service_.PrintWorkerStats();
+                audio_service_.GetLatencyMonitor().Log();
             }
+#if CONFIG_AUDIO_CHANNEL_KEEP_WARM
+            KeepAudioChannelWarm();
+#endif
+        }
+    }
+}
+
+// Open the audio channel ahead of the next wake word while idle, so the turn starts streaming at
+// once instead of waiting for the TLS handshake and the hello round trip. The connect runs on its
+// own task so the main loop keeps handling events, a wake word meanwhile waits for it in
+// OpenAudioChannelForTurn() and then finds the channel open.
+void Application::KeepAudioChannelWarm() {
+    if (preconnecting_) {
+        return;
+    }
+    if (!protocol_ || device_state_ != kDeviceStateIdle || protocol_->IsAudioChannelOpened()) {
+        warm_wait_seconds_ = 0;
+        return;
+    }
+    if (++warm_wait_seconds_ < warm_retry_seconds_) {
+        return;
+    }
+    warm_wait_seconds_ = 0;
+
+    preconnecting_ = true;
+    if (xTaskCreate([](void* arg) {
+        ((Application*)arg)->PreconnectAudioChannel();
+        vTaskDelete(NULL);
+    }, "preconnect", 2048 * 4, this, 2, nullptr) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create the pre-connect task");
+        preconnecting_ = false;
+    }
+}
+
+void Application::PreconnectAudioChannel() {
+    int64_t start_time = esp_timer_get_time();
+    bool opened = false;
+    {
+        std::lock_guard<std::mutex> lock(audio_channel_mutex_);
+        // A turn that started first has opened the channel itself
+        if (device_state_ == kDeviceStateIdle && !protocol_->IsAudioChannelOpened()) {
+            opened = protocol_->OpenAudioChannel();
+        }
+    }
+    preconnecting_ = false;
+
+    Schedule([this, opened, start_time]() {
+        if (opened) {
+            ESP_LOGI(TAG, "Audio channel pre-connected in %lld ms, session %s", (esp_timer_get_time() - start_time) / 1000,
+                protocol_->session_id().c_str());
+            warm_retry_seconds_ = AUDIO_CHANNEL_WARM_RETRY_MIN_SECONDS;
+        } else {
+            warm_retry_seconds_ = std::min(warm_retry_seconds_ * 2, AUDIO_CHANNEL_WARM_RETRY_MAX_SECONDS);
         }
+    });
+}
+
+bool Application::OpenAudioChannelForTurn() {
+    if (!protocol_->IsAudioChannelOpened()) {
+        SetDeviceState(kDeviceStateConnecting);
     }
+    // A pre-connect in flight finishes first, the turn then goes on over its channel
+    std::lock_guard<std::mutex> lock(audio_channel_mutex_);
+    return protocol_->IsAudioChannelOpened() || protocol_->OpenAudioChannel();
 }
 
 void Application::OnWakeWordDetected() {
     if (!protocol_) {
         return;
     }
+    RobotSequencer::GetInstance().Cancel("wake word");
 
     if (device_state_ == kDeviceStateIdle) {
         audio_service_.EncodeWakeWord();
 
-        if (!protocol_->IsAudioChannelOpened()) {
-            SetDeviceState(kDeviceStateConnecting);
-            if (!protocol_->OpenAudioChannel()) {
-                audio_service_.EnableWakeWordDetection(true);
-                return;
-            }
+        if (!OpenAudioChannelForTurn()) {
+            audio_service_.EnableWakeWordDetection(true);
+            return;
         }
 
         auto wake_word = audio_service_.GetLastWakeWord();
@@ -705,7 +868,9 @@ void Application::OnWakeWordDetected() {
 #if CONFIG_SEND_WAKE_WORD_DATA
         // Encode and send the wake word data to the server
         while (auto packet = audio_service_.PopWakeWordPacket()) {
-            protocol_->SendAudio(std::move(packet));
+            if (protocol_->SendAudio(*packet)) {
+                audio_service_.RecordPacketSent(*packet);
+            }
         }
         // Set the chat state to wake word detected
         protocol_->SendWakeWordDetected(wake_word);
@@ -725,6 +890,7 @@ void Application::OnWakeWordDetected() {
 void Application::AbortSpeaking(AbortReason reason) {
     ESP_LOGI(TAG, "Abort speaking");
     aborted_ = true;
+    RobotSequencer::GetInstance().Cancel("abort");
     if (protocol_) {
         protocol_->SendAbortSpeaking(reason);
     }
@@ -743,6 +909,11 @@ void Application::SetDeviceState(DeviceState state) {
     clock_ticks_ = 0;
     auto previous_state = device_state_;
     device_state_ = state;
+#if CONFIG_AUDIO_CHANNEL_KEEP_WARM
+    if (protocol_) {
+        protocol_->SetIdle(state == kDeviceStateIdle);
+    }
+#endif
     ESP_LOGI(TAG, "STATE: %s", STATE_STRINGS[device_state_]);
 
     // Send the state change event
@@ -866,19 +1037,18 @@ void Application::WakeWordInvoke(const std::string& wake_word) {
     if (device_state_ == kDeviceStateIdle) {
         audio_service_.EncodeWakeWord();
 
-        if (!protocol_->IsAudioChannelOpened()) {
-            SetDeviceState(kDeviceStateConnecting);
-            if (!protocol_->OpenAudioChannel()) {
-                audio_service_.EnableWakeWordDetection(true);
-                return;
-            }
+        if (!OpenAudioChannelForTurn()) {
+            audio_service_.EnableWakeWordDetection(true);
+            return;
         }
 
         ESP_LOGI(TAG, "Wake word detected: %s", wake_word.c_str());
 #if CONFIG_USE_AFE_WAKE_WORD || CONFIG_USE_CUSTOM_WAKE_WORD
         // Encode and send the wake word data to the server
         while (auto packet = audio_service_.PopWakeWordPacket()) {
-            protocol_->SendAudio(std::move(packet));
+            if (protocol_->SendAudio(*packet)) {
+                audio_service_.RecordPacketSent(*packet);
+            }
         }
         // Set the chat state to wake word detected
         protocol_->SendWakeWordDetected(wake_word);
@@ -1014,11 +1184,8 @@ void Application::SendRobotCommand(const std::string& command) {
         std::string singleCmd = cmd.substr(0, pos);
         cmd.erase(0, pos + 1);
         
-        // 发送单个指令（去重与日志由 SecondUart 负责）
+        // 发送单个指令（去重、指令间隔与日志由 SecondUart 的发送任务负责，这里不会阻塞）
         SecondUart::GetInstance().SendString(singleCmd);
-        
-        // 添加小延时，避免指令发送过快
-        vTaskDelay(pdMS_TO_TICKS(10));
         pos = 0;
     }
     
@@ -6,6 +6,7 @@
 #include <freertos/task.h>
 #include <esp_timer.h>
 
+#include <atomic>
 #include <string>
 #include <mutex>
 #include <deque>
@@ -24,6 +25,7 @@
 #define MAIN_EVENT_ERROR (1 << 4)
 #define MAIN_EVENT_CHECK_NEW_VERSION_DONE (1 << 5)
 #define MAIN_EVENT_CLOCK_TICK (1 << 6)
+#define MAIN_EVENT_UPLINK_STALLED (1 << 7)
 
 enum AecMode {
     kAecOff,
@@ -33,6 +35,10 @@ enum AecMode {
 
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
 
+// Background reconnect of a warm audio channel, the wait doubles after every failed attempt
+#define AUDIO_CHANNEL_WARM_RETRY_MIN_SECONDS 2
+#define AUDIO_CHANNEL_WARM_RETRY_MAX_SECONDS 64
+
 class Application {
 public:
     static Application& GetInstance() {
@@ -79,6 +85,7 @@ private:
     std::mutex mutex_;
     std::deque<std::function<void()>> main_tasks_;
     std::unique_ptr<Protocol> protocol_;
+    ControlMessageDispatcher control_handlers_;
     EventGroupHandle_t event_group_ = nullptr;
     esp_timer_handle_t clock_timer_handle_ = nullptr;
     volatile DeviceState device_state_ = kDeviceStateUnknown;
@@ -90,10 +97,22 @@ private:
     bool has_server_time_ = false;
     bool aborted_ = false;
     int clock_ticks_ = 0;
+    std::atomic<bool> preconnecting_ = false;
+    // Held while the audio channel is opened, so a turn waits for a pre-connect instead of racing it
+    std::mutex audio_channel_mutex_;
+    int warm_wait_seconds_ = 0;
+    int warm_retry_seconds_ = AUDIO_CHANNEL_WARM_RETRY_MIN_SECONDS;
     TaskHandle_t check_new_version_task_handle_ = nullptr;
     TaskHandle_t main_event_loop_task_handle_ = nullptr;
 
     void OnWakeWordDetected();
+    void SendQueuedAudio();
+    void OnUplinkStalled();
+    void RegisterControlHandlers();
+    void KeepAudioChannelWarm();
+    void PreconnectAudioChannel();
+    // Opens the audio channel for a turn unless it is already open, false if that failed
+    bool OpenAudioChannelForTurn();
     void CheckNewVersion(Ota& ota);
     void CheckAssetsVersion();
     void ShowActivationCode(const std::string& code, const std::string& message);
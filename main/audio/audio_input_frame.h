@@ -0,0 +1,39 @@
+#ifndef AUDIO_INPUT_FRAME_H
+#define AUDIO_INPUT_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*
+ * One block of microphone input at 16 kHz, already split into channels by AudioService.
+ *
+ * The spans point into buffers owned by AudioService and are only valid until the next read,
+ * consumers that keep the samples must copy them.
+ */
+struct AudioInputFrame {
+    // First microphone channel
+    std::span<const int16_t> mic;
+    // Second input channel, the playback reference (or a second microphone), empty on mono codecs
+    std::span<const int16_t> reference;
+
+    inline int channels() const { return reference.empty() ? 1 : 2; }
+
+    // Restore the codec channel order for consumers that take interleaved input, such as AFE.
+    // out keeps its capacity between frames.
+    void Interleave(std::vector<int16_t>& out) const {
+        if (reference.empty()) {
+            out.assign(mic.begin(), mic.end());
+            return;
+        }
+        out.resize(mic.size() * 2);
+        int16_t* dest = out.data();
+        for (size_t i = 0; i < mic.size(); ++i) {
+            *dest++ = mic[i];
+            *dest++ = reference[i];
+        }
+    }
+};
+
+#endif // AUDIO_INPUT_FRAME_H
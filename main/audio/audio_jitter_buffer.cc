@@ -0,0 +1,195 @@
+#include "audio_jitter_buffer.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "AudioJitterBuffer"
+
+static_assert((JITTER_BUFFER_CAPACITY & (JITTER_BUFFER_CAPACITY - 1)) == 0, "JITTER_BUFFER_CAPACITY must be a power of two");
+static_assert(JITTER_BUFFER_MAX_PACKETS < JITTER_BUFFER_CAPACITY, "JITTER_BUFFER_MAX_PACKETS must leave reorder room");
+
+AudioJitterBuffer::AudioJitterBuffer(int frame_duration_ms) : frame_duration_ms_(frame_duration_ms) {
+}
+
+void AudioJitterBuffer::Put(std::unique_ptr<AudioStreamPacket>&& packet, int64_t now_us) {
+    if (packet->frame_duration > 0) {
+        frame_duration_ms_ = packet->frame_duration;
+    }
+    if (packet->sequence == 0) {
+        packet->sequence = has_sequence_ ? highest_sequence_ + 1 : 1;
+    }
+
+    uint32_t sequence = packet->sequence;
+    int32_t offset = int32_t(sequence - expected_sequence_);
+    if (!has_sequence_ || offset < -JITTER_BUFFER_RESYNC_WINDOW || offset >= JITTER_BUFFER_RESYNC_WINDOW) {
+        if (has_sequence_) {
+            ESP_LOGW(TAG, "Sequence jumped from %lu to %lu, restarting", expected_sequence_, sequence);
+        }
+        Flush();
+        has_sequence_ = true;
+        expected_sequence_ = sequence;
+        highest_sequence_ = sequence - 1;
+        last_arrival_us_ = 0;
+        offset = 0;
+    }
+
+    if (offset < 0) {
+        // Already played or concealed
+        statistics_.late_count++;
+        Drop(packet);
+        return;
+    }
+    if (offset >= JITTER_BUFFER_CAPACITY) {
+        // Too far ahead of the playout position, give up on the oldest frames
+        Skip(offset - JITTER_BUFFER_CAPACITY + 1);
+    }
+
+    auto& slot = slots_[Index(sequence)];
+    if (slot) {
+        statistics_.duplicate_count++;
+        Drop(packet);
+        return;
+    }
+    if (int32_t(sequence - highest_sequence_) <= 0) {
+        statistics_.reordered_count++;
+    } else {
+        UpdateJitter(sequence, now_us);
+        highest_sequence_ = sequence;
+    }
+
+    slot = std::move(packet);
+    arrival_us_[Index(sequence)] = now_us;
+    count_++;
+    statistics_.received_count++;
+}
+
+JitterFrameType AudioJitterBuffer::Get(int64_t now_us, std::unique_ptr<AudioStreamPacket>& packet, const AudioStreamPacket*& fec_packet) {
+    packet.reset();
+    fec_packet = nullptr;
+
+    if (count_ == 0) {
+        if (playing_) {
+            // Either the stream ended or the network fell behind, buffer up again before playing
+            playing_ = false;
+            statistics_.rebuffer_count++;
+        }
+        return kJitterFrameNone;
+    }
+
+    auto& slot = slots_[Index(expected_sequence_)];
+    if (!playing_) {
+        if (ShouldWait(now_us)) {
+            return kJitterFrameNone;
+        }
+        playing_ = true;
+    }
+    if (!slot && OldestWaitUs(now_us) < HoldUs()) {
+        // Newer packets are here, give the missing one the hold time to arrive out of order
+        return kJitterFrameNone;
+    }
+
+    if (slot) {
+        packet = std::move(slot);
+        count_--;
+        expected_sequence_++;
+        return kJitterFramePacket;
+    }
+
+    statistics_.lost_count++;
+    expected_sequence_++;
+    auto& next = slots_[Index(expected_sequence_)];
+    if (next) {
+        statistics_.fec_count++;
+        fec_packet = next.get();
+        return kJitterFrameFec;
+    }
+    return kJitterFrameLost;
+}
+
+int AudioJitterBuffer::WaitTimeMs(int64_t now_us) const {
+    if (count_ == 0) {
+        return -1;
+    }
+    // Buffering up to the target depth, or holding for a missing packet
+    int64_t wait_us = !playing_ && count_ < (size_t)target_depth_ ? int64_t(target_depth_) * frame_duration_ms_ * 1000 : HoldUs();
+    int64_t remaining_us = wait_us - OldestWaitUs(now_us);
+    return std::max<int64_t>(1, (remaining_us + 999) / 1000);
+}
+
+void AudioJitterBuffer::Reset() {
+    Flush();
+    has_sequence_ = false;
+    last_arrival_us_ = 0;
+}
+
+bool AudioJitterBuffer::ShouldWait(int64_t now_us) const {
+    if (count_ >= (size_t)target_depth_) {
+        return false;
+    }
+    return OldestWaitUs(now_us) < int64_t(target_depth_) * frame_duration_ms_ * 1000;
+}
+
+int64_t AudioJitterBuffer::HoldUs() const {
+    return std::min<int64_t>(int64_t(target_depth_) * frame_duration_ms_, JITTER_BUFFER_MAX_HOLD_MS) * 1000;
+}
+
+int64_t AudioJitterBuffer::OldestWaitUs(int64_t now_us) const {
+    int64_t oldest_us = now_us;
+    for (size_t i = 0; i < JITTER_BUFFER_CAPACITY; i++) {
+        if (slots_[i] && arrival_us_[i] < oldest_us) {
+            oldest_us = arrival_us_[i];
+        }
+    }
+    return now_us - oldest_us;
+}
+
+void AudioJitterBuffer::UpdateJitter(uint32_t sequence, int64_t now_us) {
+    if (last_arrival_us_ != 0) {
+        // Only late arrivals starve the decoder, bursts faster than real time do not count
+        int64_t expected_gap_us = int64_t(sequence - last_arrival_sequence_) * frame_duration_ms_ * 1000;
+        int64_t delay_ms = std::max<int64_t>(0, (now_us - last_arrival_us_ - expected_gap_us) / 1000);
+        jitter_q4_ += (int32_t(std::min<int64_t>(delay_ms, 2000)) * 16 - jitter_q4_) / 16;
+
+        int jitter_ms = jitter_q4_ / 16;
+        int depth = 1 + (2 * jitter_ms + frame_duration_ms_ - 1) / frame_duration_ms_;
+        depth = std::clamp(depth, JITTER_BUFFER_MIN_DEPTH, JITTER_BUFFER_MAX_DEPTH);
+        if (depth != target_depth_) {
+            ESP_LOGD(TAG, "Jitter %d ms, target depth %d -> %d", jitter_ms, target_depth_, depth);
+            target_depth_ = depth;
+        }
+        statistics_.jitter_ms = jitter_ms;
+        statistics_.target_depth = target_depth_;
+    }
+    last_arrival_us_ = now_us;
+    last_arrival_sequence_ = sequence;
+}
+
+void AudioJitterBuffer::Skip(uint32_t frames) {
+    for (uint32_t i = 0; i < frames; i++) {
+        auto& slot = slots_[Index(expected_sequence_)];
+        if (slot) {
+            Drop(slot);
+            count_--;
+        } else {
+            statistics_.lost_count++;
+        }
+        expected_sequence_++;
+    }
+}
+
+void AudioJitterBuffer::Flush() {
+    for (auto& slot : slots_) {
+        if (slot) {
+            Drop(slot);
+        }
+    }
+    count_ = 0;
+    playing_ = false;
+}
+
+void AudioJitterBuffer::Drop(std::unique_ptr<AudioStreamPacket>& packet) {
+    if (on_drop_) {
+        on_drop_(std::move(packet));
+    }
+    packet.reset();
+}
@@ -0,0 +1,98 @@
+#ifndef AUDIO_JITTER_BUFFER_H
+#define AUDIO_JITTER_BUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "protocol.h"
+
+#define JITTER_BUFFER_CAPACITY      16  // Sequence window, must be a power of two
+#define JITTER_BUFFER_MAX_PACKETS   12  // Stop accepting packets above this, the rest is reorder room
+#define JITTER_BUFFER_MIN_DEPTH     1
+#define JITTER_BUFFER_MAX_DEPTH     8
+#define JITTER_BUFFER_RESYNC_WINDOW 64  // A larger sequence jump starts a new stream
+#define JITTER_BUFFER_MAX_HOLD_MS   120 // Longest wait for a missing packet once newer ones arrived
+
+enum JitterFrameType {
+    kJitterFrameNone,   // Nothing to play yet
+    kJitterFramePacket, // The next packet arrived in time
+    kJitterFrameFec,    // The next packet is lost, recover it from the FEC data of the one after
+    kJitterFrameLost,   // The next packet is lost, conceal it
+};
+
+struct JitterBufferStatistics {
+    uint32_t received_count = 0;
+    uint32_t late_count = 0;
+    uint32_t duplicate_count = 0;
+    uint32_t reordered_count = 0;
+    uint32_t lost_count = 0;
+    uint32_t fec_count = 0;
+    uint32_t rebuffer_count = 0;
+    uint32_t jitter_ms = 0;
+    uint32_t target_depth = JITTER_BUFFER_MIN_DEPTH;
+};
+
+/*
+ * Reorders incoming Opus packets by sequence number in front of the decoder.
+ *
+ * The target depth follows the inter-arrival jitter (RFC 3550 style estimate, late arrivals only),
+ * so a clean link plays the first frame at once and a congested one buffers a few frames. When the
+ * next packet is missing but newer ones are buffered, it may just be reordered: it is waited for up
+ * to the hold time (target depth frames, at most JITTER_BUFFER_MAX_HOLD_MS) from the arrival of the
+ * oldest buffered packet, however many are buffered, and only then reported as lost so the decoder
+ * can run FEC or PLC instead of skipping the frame. Packets without a sequence number (websocket,
+ * local sounds) are numbered in arrival order.
+ *
+ * Not thread safe, owned by the opus codec task.
+ */
+class AudioJitterBuffer {
+public:
+    explicit AudioJitterBuffer(int frame_duration_ms);
+
+    AudioJitterBuffer(const AudioJitterBuffer&) = delete;
+    AudioJitterBuffer& operator=(const AudioJitterBuffer&) = delete;
+
+    bool Full() const { return count_ >= JITTER_BUFFER_MAX_PACKETS; }
+    size_t Size() const { return count_; }
+
+    void Put(std::unique_ptr<AudioStreamPacket>&& packet, int64_t now_us);
+    // fec_packet stays owned by the buffer and is only valid until the next call
+    JitterFrameType Get(int64_t now_us, std::unique_ptr<AudioStreamPacket>& packet, const AudioStreamPacket*& fec_packet);
+    // Milliseconds until Get() can make progress without new packets, -1 if the buffer is empty
+    int WaitTimeMs(int64_t now_us) const;
+    void Reset();
+    // Receives every packet the buffer drops (late, duplicate, skipped or flushed) so it can be recycled
+    void OnDrop(std::function<void(std::unique_ptr<AudioStreamPacket>&&)> callback) { on_drop_ = callback; }
+
+    const JitterBufferStatistics& statistics() const { return statistics_; }
+
+private:
+    std::array<std::unique_ptr<AudioStreamPacket>, JITTER_BUFFER_CAPACITY> slots_;
+    std::array<int64_t, JITTER_BUFFER_CAPACITY> arrival_us_{};
+    size_t count_ = 0;
+    bool has_sequence_ = false;
+    bool playing_ = false;
+    uint32_t expected_sequence_ = 0;
+    uint32_t highest_sequence_ = 0;
+    uint32_t last_arrival_sequence_ = 0;
+    int64_t last_arrival_us_ = 0;
+    int frame_duration_ms_;
+    int32_t jitter_q4_ = 0;  // Jitter estimate in 1/16 ms
+    int target_depth_ = JITTER_BUFFER_MIN_DEPTH;
+    JitterBufferStatistics statistics_;
+    std::function<void(std::unique_ptr<AudioStreamPacket>&&)> on_drop_;
+
+    static size_t Index(uint32_t sequence) { return sequence & (JITTER_BUFFER_CAPACITY - 1); }
+    bool ShouldWait(int64_t now_us) const;
+    int64_t HoldUs() const;
+    int64_t OldestWaitUs(int64_t now_us) const;
+    void UpdateJitter(uint32_t sequence, int64_t now_us);
+    void Skip(uint32_t frames);
+    void Flush();
+    void Drop(std::unique_ptr<AudioStreamPacket>& packet);
+};
+
+#endif // AUDIO_JITTER_BUFFER_H
@@ -0,0 +1,159 @@
+#include "audio_latency.h"
+
+#include <esp_log.h>
+#include <cJSON.h>
+
+#define TAG "AudioLatency"
+
+static const uint32_t kBucketBoundsMs[] = LATENCY_BUCKET_BOUNDS_MS;
+static_assert(sizeof(kBucketBoundsMs) / sizeof(kBucketBoundsMs[0]) == LATENCY_BUCKET_COUNT - 1, "LATENCY_BUCKET_COUNT must be one more than the bucket bounds");
+
+static const char* const kStageNames[kLatencyStageCount] = {
+    "capture_to_processed",
+    "processed_to_encoded",
+    "encoded_to_sent",
+    "capture_to_sent",
+    "receive_to_decoded",
+    "decoded_to_played",
+    "receive_to_played",
+    "wake_to_first_playback",
+    "wake_to_first_uplink",
+};
+
+static const char* const kPacketEventNames[kPacketEventCount] = {
+    "received",
+    "reordered",
+    "late",
+    "lost",
+    "recovered",
+};
+
+void LatencyHistogram::Add(int64_t latency_us) {
+    if (latency_us < 0) {
+        return;
+    }
+    uint32_t latency_ms = latency_us / 1000;
+    size_t bucket = 0;
+    while (bucket < LATENCY_BUCKET_COUNT - 1 && latency_ms >= kBucketBoundsMs[bucket]) {
+        bucket++;
+    }
+    buckets_[bucket]++;
+    count_++;
+    uint32_t us = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    if (us > max_us_) {
+        max_us_ = us;
+    }
+}
+
+uint32_t LatencyHistogram::Percentile(int percent) const {
+    uint32_t count = count_;
+    if (count == 0) {
+        return 0;
+    }
+    uint32_t target = (count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT - 1; i++) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            return kBucketBoundsMs[i];
+        }
+    }
+    return max_ms();
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : buckets_) {
+        bucket = 0;
+    }
+    count_ = 0;
+    max_us_ = 0;
+}
+
+void AudioLatencyMonitor::Record(AudioLatencyStage stage, int64_t start_us, int64_t end_us) {
+    if (start_us > 0) {
+        histograms_[stage].Add(end_us - start_us);
+    }
+}
+
+void AudioLatencyMonitor::CountPackets(AudioPacketEvent event, uint32_t count) {
+    if (count > 0) {
+        packet_counts_[event] += count;
+    }
+}
+
+void AudioLatencyMonitor::MarkWakeWord(int64_t now_us) {
+    wake_time_us_ = now_us;
+    uplink_wake_time_us_ = now_us;
+}
+
+void AudioLatencyMonitor::OnFramePlayed(int64_t receive_time_us, int64_t now_us) {
+    int64_t wake_time_us = wake_time_us_;
+    // Frames received before the wake word belong to the previous turn
+    if (wake_time_us == 0 || receive_time_us < wake_time_us) {
+        return;
+    }
+    if (wake_time_us_.compare_exchange_strong(wake_time_us, 0)) {
+        histograms_[kLatencyWakeToFirstPlayback].Add(now_us - wake_time_us);
+        ESP_LOGI(TAG, "Wake word to first TTS sample: %lld ms", (now_us - wake_time_us) / 1000);
+    }
+}
+
+void AudioLatencyMonitor::OnPacketSent(int64_t now_us) {
+    int64_t wake_time_us = uplink_wake_time_us_.exchange(0);
+    if (wake_time_us != 0) {
+        histograms_[kLatencyWakeToFirstUplink].Add(now_us - wake_time_us);
+        ESP_LOGI(TAG, "Wake word to first uplink packet: %lld ms", (now_us - wake_time_us) / 1000);
+    }
+}
+
+std::string AudioLatencyMonitor::GetJson() const {
+    cJSON* root = cJSON_CreateObject();
+    for (int i = 0; i < kLatencyStageCount; i++) {
+        auto& histogram = histograms_[i];
+        cJSON* stage = cJSON_CreateObject();
+        cJSON_AddNumberToObject(stage, "n", histogram.count());
+        cJSON_AddNumberToObject(stage, "p50", histogram.Percentile(50));
+        cJSON_AddNumberToObject(stage, "p95", histogram.Percentile(95));
+        cJSON_AddNumberToObject(stage, "p99", histogram.Percentile(99));
+        cJSON_AddNumberToObject(stage, "max", histogram.max_ms());
+        cJSON_AddItemToObject(root, kStageNames[i], stage);
+    }
+    cJSON* packets = cJSON_CreateObject();
+    for (int i = 0; i < kPacketEventCount; i++) {
+        cJSON_AddNumberToObject(packets, kPacketEventNames[i], packet_counts_[i]);
+    }
+    cJSON_AddItemToObject(root, "downlink_packets", packets);
+    char* json_str = cJSON_PrintUnformatted(root);
+    std::string json(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(root);
+    return json;
+}
+
+void AudioLatencyMonitor::Log() const {
+    auto& up = histograms_[kLatencyCaptureToSent];
+    auto& down = histograms_[kLatencyReceiveToPlayed];
+    auto& wake = histograms_[kLatencyWakeToFirstPlayback];
+    auto& wake_up = histograms_[kLatencyWakeToFirstUplink];
+    if (up.count() == 0 && down.count() == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "ms p50/p95/p99 up %lu/%lu/%lu (n=%lu) down %lu/%lu/%lu (n=%lu) wake->tts %lu/%lu/%lu (n=%lu)"
+        " wake->up %lu/%lu (n=%lu) reordered/late/lost %lu/%lu/%lu",
+        up.Percentile(50), up.Percentile(95), up.Percentile(99), up.count(),
+        down.Percentile(50), down.Percentile(95), down.Percentile(99), down.count(),
+        wake.Percentile(50), wake.Percentile(95), wake.Percentile(99), wake.count(),
+        wake_up.Percentile(50), wake_up.Percentile(95), wake_up.count(),
+        packet_count(kPacketReordered), packet_count(kPacketLate), packet_count(kPacketLost));
+}
+
+void AudioLatencyMonitor::Reset() {
+    for (auto& histogram : histograms_) {
+        histogram.Reset();
+    }
+    for (auto& count : packet_counts_) {
+        count = 0;
+    }
+    wake_time_us_ = 0;
+    uplink_wake_time_us_ = 0;
+}
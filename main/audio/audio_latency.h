@@ -0,0 +1,90 @@
+#ifndef AUDIO_LATENCY_H
+#define AUDIO_LATENCY_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Upper bounds of the histogram buckets in milliseconds, the last bucket is open ended
+#define LATENCY_BUCKET_BOUNDS_MS { 1, 2, 3, 5, 8, 10, 15, 20, 30, 40, 60, 80, 100, 150, 200, 300, 400, 600, 800, 1000, 1500, 2000, 3000, 5000 }
+#define LATENCY_BUCKET_COUNT 25
+
+enum AudioLatencyStage {
+    // Uplink
+    kLatencyCaptureToProcessed,  // Mic read -> processor output
+    kLatencyProcessedToEncoded,  // Processor output -> Opus packet ready, includes the encode queue
+    kLatencyEncodedToSent,       // Opus packet ready -> SendAudio() returned, includes the send queue
+    kLatencyCaptureToSent,
+    // Downlink
+    kLatencyReceiveToDecoded,    // Network receive -> PCM ready, includes the jitter buffer
+    kLatencyDecodedToPlayed,     // PCM ready -> I2S write returned, includes the playback queue
+    kLatencyReceiveToPlayed,
+    // Wake word detected -> first TTS frame written to I2S
+    kLatencyWakeToFirstPlayback,
+    // Wake word detected -> first uplink packet sent, includes opening the audio channel
+    kLatencyWakeToFirstUplink,
+    kLatencyStageCount,
+};
+
+// Downlink packet fates seen by the jitter buffer, reported next to the latencies they explain
+enum AudioPacketEvent {
+    kPacketReceived,
+    kPacketReordered,   // Arrived after a later sequence number, put back in order
+    kPacketLate,        // Arrived after its slot was played or concealed, dropped
+    kPacketLost,        // Never arrived in time, replaced by FEC or PLC
+    kPacketRecovered,   // Lost packets rebuilt from the FEC data of the next one
+    kPacketEventCount,
+};
+
+/*
+ * Fixed-bucket latency histogram, percentiles are reported as the upper bound of their bucket.
+ *
+ * Add() is lock free, every stage has a single writer task. Readers may see a sample counted
+ * before max_us is updated, which is fine for statistics.
+ */
+class LatencyHistogram {
+public:
+    void Add(int64_t latency_us);
+    // Upper bound in ms of the bucket holding the given percentile, 0 if empty
+    uint32_t Percentile(int percent) const;
+    uint32_t count() const { return count_; }
+    uint32_t max_ms() const { return max_us_ / 1000; }
+    void Reset();
+
+private:
+    std::array<std::atomic<uint32_t>, LATENCY_BUCKET_COUNT> buckets_{};
+    std::atomic<uint32_t> count_ = 0;
+    std::atomic<uint32_t> max_us_ = 0;
+};
+
+/*
+ * End-to-end audio latency, fed by the AudioService tasks with esp_timer timestamps carried
+ * on each AudioTask / AudioStreamPacket.
+ */
+class AudioLatencyMonitor {
+public:
+    void Record(AudioLatencyStage stage, int64_t start_us, int64_t end_us);
+    // Start a turn: the next network frame received after this and played counts as the first TTS sample
+    void MarkWakeWord(int64_t now_us);
+    void OnFramePlayed(int64_t receive_time_us, int64_t now_us);
+    void OnPacketSent(int64_t now_us);
+
+    void CountPackets(AudioPacketEvent event, uint32_t count);
+
+    const LatencyHistogram& histogram(AudioLatencyStage stage) const { return histograms_[stage]; }
+    uint32_t packet_count(AudioPacketEvent event) const { return packet_counts_[event]; }
+    // {"stage": {"n", "p50", "p95", "p99", "max"}, ..., "downlink_packets": {"received", ...}} in ms
+    std::string GetJson() const;
+    // One compact line with p50/p95/p99 of the totals
+    void Log() const;
+    void Reset();
+
+private:
+    std::array<LatencyHistogram, kLatencyStageCount> histograms_;
+    std::array<std::atomic<uint32_t>, kPacketEventCount> packet_counts_{};
+    std::atomic<int64_t> wake_time_us_ = 0;
+    std::atomic<int64_t> uplink_wake_time_us_ = 0;
+};
+
+#endif // AUDIO_LATENCY_H
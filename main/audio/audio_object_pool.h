@@ -0,0 +1,82 @@
+#ifndef AUDIO_OBJECT_POOL_H
+#define AUDIO_OBJECT_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * Fixed-size free list of audio frame objects (AudioTask / AudioStreamPacket).
+ *
+ * Objects are preallocated with their payload vectors reserved for one frame, and are
+ * handed back with Release() once a frame has been consumed. Recycled vectors keep their
+ * capacity, so in steady state a frame costs no heap allocation at all. When the pool is
+ * empty Acquire() falls back to the heap and counts a miss; Release() deletes objects
+ * that do not fit back into the pool.
+ */
+template <typename T>
+class AudioObjectPool {
+public:
+    explicit AudioObjectPool(size_t capacity) : capacity_(capacity) {
+        free_.reserve(capacity);
+    }
+
+    AudioObjectPool(const AudioObjectPool&) = delete;
+    AudioObjectPool& operator=(const AudioObjectPool&) = delete;
+
+    // Allocate up to count objects up front, init reserves the payload storage
+    void Preallocate(size_t count, const std::function<void(T&)>& init) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        init_ = init;
+        while (free_.size() < count && free_.size() < capacity_) {
+            auto object = std::make_unique<T>();
+            init_(*object);
+            free_.push_back(std::move(object));
+        }
+    }
+
+    std::unique_ptr<T> Acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                auto object = std::move(free_.back());
+                free_.pop_back();
+                hits_++;
+                return object;
+            }
+        }
+        misses_++;
+        auto object = std::make_unique<T>();
+        if (init_) {
+            init_(*object);
+        }
+        return object;
+    }
+
+    void Release(std::unique_ptr<T>&& object) {
+        if (!object) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.size() < capacity_) {
+            free_.push_back(std::move(object));
+        }
+    }
+
+    inline uint32_t hits() const { return hits_.load(); }
+    inline uint32_t misses() const { return misses_.load(); }
+
+private:
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<T>> free_;
+    std::function<void(T&)> init_;
+    std::atomic<uint32_t> hits_ = 0;
+    std::atomic<uint32_t> misses_ = 0;
+};
+
+#endif // AUDIO_OBJECT_POOL_H
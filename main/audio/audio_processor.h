@@ -4,20 +4,25 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <span>
 
 #include <model_path.h>
 #include "audio_codec.h"
+#include "audio_input_frame.h"
 
 class AudioProcessor {
 public:
     virtual ~AudioProcessor() = default;
     
     virtual void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) = 0;
-    virtual void Feed(std::vector<int16_t>&& data) = 0;
+    // Re-chunk the output to a new frame duration, samples already buffered carry over
+    virtual void SetFrameDuration(int frame_duration_ms) = 0;
+    virtual void Feed(const AudioInputFrame& frame) = 0;
     virtual void Start() = 0;
     virtual void Stop() = 0;
     virtual bool IsRunning() = 0;
-    virtual void OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) = 0;
+    // data is only valid during the callback
+    virtual void OnOutput(std::function<void(std::span<const int16_t> data)> callback) = 0;
     virtual void OnVadStateChange(std::function<void(bool speaking)> callback) = 0;
     virtual size_t GetFeedSize() = 0;
     virtual void EnableDeviceAec(bool enable) = 0;
@@ -0,0 +1,211 @@
+#ifndef AUDIO_RING_QUEUE_H
+#define AUDIO_RING_QUEUE_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+/*
+ * Fixed-capacity single-producer / single-consumer ring queue for the audio pipeline.
+ *
+ * Push() must only be called from one producer task at a time and Pop() only from the
+ * consumer task, so the head / tail indices need no lock. A failed Push() leaves the item
+ * untouched, so callers can WaitForSpace() and retry. Instead of a shared condition
+ * variable, each queue wakes exactly the task that waits on it with a task notification bit:
+ * - data_bit is set on the consumer task when the queue becomes non-empty
+ * - space_bit is set on the space waiter when the queue drops below its limit
+ *
+ * Clear() may be called from any task. It only records the current producer position; the
+ * consumer drops everything before that position on its next Pop(), so consumers must call
+ * Pop() whenever they are woken with data_bit. Dropped items go to the OnDrop() handler, so
+ * pooled objects can be recycled instead of freed.
+ */
+template <typename T, size_t Capacity>
+class AudioRingQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    AudioRingQueue(uint32_t data_bit, uint32_t space_bit, size_t limit = Capacity)
+        : data_bit_(data_bit), space_bit_(space_bit), limit_(limit < Capacity ? limit : Capacity) {}
+
+    AudioRingQueue(const AudioRingQueue&) = delete;
+    AudioRingQueue& operator=(const AudioRingQueue&) = delete;
+
+    inline uint32_t data_bit() const { return data_bit_; }
+    inline uint32_t space_bit() const { return space_bit_; }
+    inline size_t limit() const { return limit_; }
+
+    // The task that is notified with data_bit when an item is pushed
+    void SetConsumer(TaskHandle_t task) { consumer_.store(task); }
+    // The task that is notified with space_bit when an item is popped
+    void SetSpaceWaiter(TaskHandle_t task) { space_waiter_.store(task); }
+    // Receives items dropped by Clear() / DropOldest(), on the consumer task. Set before the queue is used.
+    void OnDrop(std::function<void(T&&)> handler) { on_drop_ = handler; }
+
+    size_t Size() const {
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        uint32_t head = Begin();
+        return tail - head;
+    }
+    bool Empty() const { return Size() == 0; }
+    bool Full() const {
+        // Cleared items keep their slots until the consumer drops them
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        return tail - Begin() >= limit_ || tail - head_.load(std::memory_order_acquire) >= Capacity;
+    }
+
+    // Non-blocking push, returns false if the queue is full
+    bool Push(T&& item) {
+        if (Full()) {
+            return false;
+        }
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        slots_[tail & (Capacity - 1)] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        // Only the empty -> non-empty transition can unblock the consumer. The head is read after
+        // publishing the item, paired with the fence after the head store in Pop(): a head read before
+        // could miss a Pop() that emptied the queue meanwhile, and the consumer would sleep with an item queued.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (Begin() == tail) {
+            Notify(consumer_.load(), data_bit_);
+        }
+        return true;
+    }
+
+    // Block the calling task until the queue is below its limit, the wait times out or Abort() is called
+    bool WaitForSpace(TickType_t ticks_to_wait = portMAX_DELAY) {
+        TaskHandle_t previous_waiter = space_waiter_.exchange(xTaskGetCurrentTaskHandle());
+        // Registered before checking, so a Pop() that makes room after the check notifies us
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (Full() && !aborted_.load()) {
+            if (xTaskNotifyWait(0, space_bit_, nullptr, ticks_to_wait) != pdTRUE) {
+                break;
+            }
+        }
+        space_waiter_.store(previous_waiter);
+        return !Full() && !aborted_.load();
+    }
+
+    // Non-blocking pop, returns false if the queue is empty
+    bool Pop(T& item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        head = DropCleared(head);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        item = std::move(slots_[head & (Capacity - 1)]);
+        head_.store(head + 1, std::memory_order_release);
+        // Like Push(), decide after publishing the head. The producer may have filled the queue and
+        // started waiting since the tail above was read.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (tail_.load(std::memory_order_acquire) - head >= limit_) {
+            Notify(space_waiter_.load(), space_bit_);
+        }
+        return true;
+    }
+
+    // Drop all queued items. Safe to call from any task.
+    void Clear() {
+        flush_to_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Notify(space_waiter_.load(), space_bit_);
+        Notify(consumer_.load(), data_bit_);
+    }
+
+    /*
+     * Drop the oldest item so the producer can push again. Safe to call from the producer while the
+     * consumer runs: like Clear() it only moves the logical head, the item keeps its slot until the
+     * consumer's next Pop(). Returns false if the queue is empty or every physical slot is taken.
+     */
+    bool DropOldest() {
+        uint32_t head = Begin();
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (head == tail || tail - head_.load(std::memory_order_acquire) >= Capacity) {
+            return false;
+        }
+        // A concurrent Clear() may have moved it further, never move it back
+        uint32_t flush_to = flush_to_.load(std::memory_order_acquire);
+        while (int32_t(head + 1 - flush_to) > 0 &&
+            !flush_to_.compare_exchange_weak(flush_to, head + 1, std::memory_order_acq_rel)) {
+        }
+        return true;
+    }
+
+    // Wake the consumer without pushing, e.g. when another source becomes readable
+    void WakeConsumer() {
+        Notify(consumer_.load(), data_bit_);
+    }
+
+    // Release any task blocked in WaitForSpace() and wake the consumer, used when stopping
+    void Abort() {
+        aborted_.store(true);
+        Notify(space_waiter_.load(), space_bit_);
+        Notify(consumer_.load(), data_bit_);
+    }
+
+    void Reset() {
+        aborted_.store(false);
+    }
+
+private:
+    const uint32_t data_bit_;
+    const uint32_t space_bit_;
+    const size_t limit_;
+    std::array<T, Capacity> slots_{};
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    std::atomic<uint32_t> flush_to_{0};
+    std::atomic<bool> aborted_{false};
+    std::atomic<TaskHandle_t> consumer_{nullptr};
+    std::atomic<TaskHandle_t> space_waiter_{nullptr};
+    std::function<void(T&&)> on_drop_;
+
+    // The logical head, taking a pending Clear() into account
+    uint32_t Begin() const {
+        uint32_t head = head_.load(std::memory_order_acquire);
+        uint32_t flush_to = flush_to_.load(std::memory_order_acquire);
+        return int32_t(flush_to - head) > 0 ? flush_to : head;
+    }
+
+    // Called by the consumer only: destroy items that were cleared by another task
+    uint32_t DropCleared(uint32_t head) {
+        uint32_t flush_to = flush_to_.load(std::memory_order_acquire);
+        if (int32_t(flush_to - head) <= 0) {
+            return head;
+        }
+        while (head != flush_to) {
+            auto& slot = slots_[head & (Capacity - 1)];
+            if (on_drop_) {
+                on_drop_(std::move(slot));
+            }
+            slot = T();
+            head++;
+        }
+        head_.store(head, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Notify(space_waiter_.load(), space_bit_);
+        return head;
+    }
+
+    static void Notify(TaskHandle_t task, uint32_t bit) {
+        if (task != nullptr) {
+            xTaskNotify(task, bit, eSetBits);
+        }
+    }
+};
+
+// Wait on the calling task's notification value for any of the given queue bits
+inline uint32_t WaitAudioQueueBits(uint32_t bits, TickType_t ticks_to_wait = portMAX_DELAY) {
+    uint32_t value = 0;
+    xTaskNotifyWait(0, bits, &value, ticks_to_wait);
+    return value & bits;
+}
+
+#endif // AUDIO_RING_QUEUE_H
@@ -1,6 +1,8 @@
 #include "audio_service.h"
+#include "assets/lang_config.h"
 #include <esp_log.h>
 #include <cstring>
+#include <algorithm>
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
@@ -11,7 +13,7 @@
 #if CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32P4
 #include "wake_words/afe_wake_word.h"
 #include "wake_words/custom_wake_word.h"
-#else
+#elif !CONFIG_IDF_TARGET_LINUX
 #include "wake_words/esp_wake_word.h"
 #endif
 
@@ -20,6 +22,20 @@
 
 AudioService::AudioService() {
     event_group_ = xEventGroupCreate();
+
+    /* Frames dropped by Clear(), DropOldest() or the jitter buffer go back to their pools */
+    auto recycle_packet = [this](std::unique_ptr<AudioStreamPacket>&& packet) {
+        packet_pool_.Release(std::move(packet));
+    };
+    auto recycle_task = [this](std::unique_ptr<AudioTask>&& task) {
+        task_pool_.Release(std::move(task));
+    };
+    audio_decode_queue_.OnDrop(recycle_packet);
+    audio_send_queue_.OnDrop(recycle_packet);
+    audio_testing_queue_.OnDrop(recycle_packet);
+    jitter_buffer_.OnDrop(recycle_packet);
+    audio_encode_queue_.OnDrop(recycle_task);
+    audio_playback_queue_.OnDrop(recycle_task);
 }
 
 AudioService::~AudioService() {
@@ -34,23 +50,32 @@ void AudioService::Initialize(AudioCodec* codec) {
     codec_->Start();
 
     /* Setup the audio codec */
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_->SetComplexity(0);
+    opus_decoder_ = std::make_unique<OpusFrameDecoder>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
+    ConfigureEncoder(encode_frame_duration_);
 
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
         reference_resampler_.Configure(codec->input_sample_rate(), 16000);
     }
 
+    /* Preallocate frame buffers, a task carries either 16 kHz encoder input or decoded output */
+    size_t pcm_samples = std::max(16000, codec->output_sample_rate()) * OPUS_FRAME_DURATION_MS / 1000;
+    task_pool_.Preallocate(AUDIO_TASK_PREALLOCATED, [pcm_samples](AudioTask& task) {
+        task.pcm.reserve(pcm_samples);
+    });
+    packet_pool_.Preallocate(AUDIO_PACKET_PREALLOCATED, [this](AudioStreamPacket& packet) {
+        packet.payload.reserve(packet_block_size_);
+    });
+    decode_buffer_.reserve(pcm_samples);
+
 #if CONFIG_USE_AUDIO_PROCESSOR
     audio_processor_ = std::make_unique<AfeAudioProcessor>();
 #else
     audio_processor_ = std::make_unique<NoAudioProcessor>();
 #endif
 
-    audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
-        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
+    audio_processor_->OnOutput([this](std::span<const int16_t> data) {
+        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, data);
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
@@ -75,6 +100,9 @@ void AudioService::Initialize(AudioCodec* codec) {
 
 void AudioService::Start() {
     service_stopped_ = false;
+    audio_encode_queue_.Reset();
+    audio_decode_queue_.Reset();
+    audio_playback_queue_.Reset();
     xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
     esp_timer_start_periodic(audio_power_timer_, 1000000);
@@ -109,12 +137,19 @@ void AudioService::Start() {
     }, "audio_output", 2048, this, 4, &audio_output_task_handle_);
 #endif
 
-    /* Start the opus codec task */
+    /* Start the opus encode task, SILK encoding needs a deep stack */
+    xTaskCreate([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusEncodeTask();
+        vTaskDelete(NULL);
+    }, "opus_encode", OPUS_ENCODE_TASK_STACK_SIZE, this, OPUS_ENCODE_TASK_PRIORITY, &opus_encode_task_handle_);
+
+    /* Start the opus decode task, it raises its own priority when playback is about to run dry */
     xTaskCreate([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
-        audio_service->OpusCodecTask();
+        audio_service->OpusDecodeTask();
         vTaskDelete(NULL);
-    }, "opus_codec", 2048 * 13, this, 2, &opus_codec_task_handle_);  // 26KB（新版本原始值，Opus SILK编码必需）
+    }, "opus_decode", OPUS_DECODE_TASK_STACK_SIZE, this, OPUS_DECODE_TASK_PRIORITY, &opus_decode_task_handle_);
 }
 
 void AudioService::Stop() {
@@ -124,70 +159,79 @@ void AudioService::Stop() {
         AS_EVENT_WAKE_WORD_RUNNING |
         AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    audio_encode_queue_.Clear();
+    audio_decode_queue_.Clear();
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
+    audio_encode_queue_.Abort();
+    audio_decode_queue_.Abort();
+    audio_playback_queue_.Abort();
 }
 
-bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
+bool AudioService::ReadAudioData(AudioInputFrame& frame, int samples) {
     if (!codec_->input_enabled()) {
         esp_timer_stop(audio_power_timer_);
         esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
         codec_->EnableInput(true);
     }
 
-    if (codec_->input_sample_rate() != sample_rate) {
-        data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
-        if (!codec_->InputData(data)) {
-            return false;
-        }
-        if (codec_->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
-            }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
-            }
+    /* Read I2S into the persistent input buffer, all buffers below keep their capacity between frames */
+    int channels = codec_->input_channels();
+    bool resample = codec_->input_sample_rate() != 16000;
+    int input_samples = resample ? samples * codec_->input_sample_rate() / 16000 : samples;
+    input_buffer_.resize(input_samples * channels);
+    if (!codec_->InputData(input_buffer_)) {
+        return false;
+    }
+
+    if (channels == 1) {
+        if (resample) {
+            mic_buffer_.resize(input_resampler_.GetOutputSamples(input_samples));
+            input_resampler_.Process(input_buffer_.data(), input_samples, mic_buffer_.data());
+            frame.mic = mic_buffer_;
         } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
+            frame.mic = input_buffer_;
         }
+        frame.reference = {};
     } else {
-        data.resize(samples * codec_->input_channels());
-        if (!codec_->InputData(data)) {
-            return false;
+        /* Deinterleave in one pass, straight into the output at 16 kHz, otherwise into the resampler input */
+        auto& mic = resample ? mic_raw_ : mic_buffer_;
+        auto& reference = resample ? reference_raw_ : reference_buffer_;
+        mic.resize(input_samples);
+        reference.resize(input_samples);
+        const int16_t* src = input_buffer_.data();
+        for (int i = 0; i < input_samples; ++i, src += channels) {
+            mic[i] = src[0];
+            reference[i] = src[1];
         }
+        if (resample) {
+            mic_buffer_.resize(input_resampler_.GetOutputSamples(input_samples));
+            reference_buffer_.resize(reference_resampler_.GetOutputSamples(input_samples));
+            input_resampler_.Process(mic_raw_.data(), input_samples, mic_buffer_.data());
+            reference_resampler_.Process(reference_raw_.data(), input_samples, reference_buffer_.data());
+        }
+        frame.mic = mic_buffer_;
+        frame.reference = reference_buffer_;
     }
 
     /* Update the last input time */
     last_input_time_ = std::chrono::steady_clock::now();
+    last_capture_time_us_ = esp_timer_get_time();
     debug_statistics_.input_count++;
 
 #if CONFIG_USE_AUDIO_DEBUGGER
-    // 音频调试：发送原始音频数据
+    // 音频调试：发送麦克风通道数据
     if (audio_debugger_ == nullptr) {
         audio_debugger_ = std::make_unique<AudioDebugger>();
     }
-    audio_debugger_->Feed(data);
+    audio_debugger_->Feed(frame.mic);
 #endif
 
     return true;
 }
 
 void AudioService::AudioInputTask() {
+    AudioInputFrame frame;
     while (true) {
         EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
             AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING,
@@ -204,34 +248,24 @@ void AudioService::AudioInputTask() {
 
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
+            if (audio_testing_queue_.Full()) {
                 ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
                 EnableAudioTesting(false);
                 continue;
             }
-            std::vector<int16_t> data;
-            int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
-            if (ReadAudioData(data, 16000, samples)) {
-                // If input channels is 2, we need to fetch the left channel data
-                if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
-                    }
-                    data = std::move(mono_data);
-                }
-                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
+            int samples = encode_frame_duration_ * 16000 / 1000;
+            if (ReadAudioData(frame, samples)) {
+                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, frame.mic);
                 continue;
             }
         }
 
         /* Feed the wake word */
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
             int samples = wake_word_->GetFeedSize();
             if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    wake_word_->Feed(data);
+                if (ReadAudioData(frame, samples)) {
+                    wake_word_->Feed(frame);
                     continue;
                 }
             }
@@ -239,11 +273,10 @@ void AudioService::AudioInputTask() {
 
         /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
             int samples = audio_processor_->GetFeedSize();
             if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    audio_processor_->Feed(std::move(data));
+                if (ReadAudioData(frame, samples)) {
+                    audio_processor_->Feed(frame);
                     continue;
                 }
             }
@@ -257,17 +290,18 @@ void AudioService::AudioInputTask() {
 }
 
 void AudioService::AudioOutputTask() {
+    audio_playback_queue_.SetConsumer(xTaskGetCurrentTaskHandle());
+
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
         if (service_stopped_) {
             break;
         }
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
+        std::unique_ptr<AudioTask> task;
+        if (!audio_playback_queue_.Pop(task)) {
+            WaitAudioQueueBits(AS_QUEUE_PLAYBACK_DATA);
+            continue;
+        }
 
         if (!codec_->output_enabled()) {
             esp_timer_stop(audio_power_timer_);
@@ -275,6 +309,12 @@ void AudioService::AudioOutputTask() {
             codec_->EnableOutput(true);
         }
         codec_->OutputData(task->pcm);
+        int64_t now = esp_timer_get_time();
+        latency_.Record(kLatencyDecodedToPlayed, task->stage_time_us, now);
+        if (task->origin_time_us > 0) {
+            latency_.Record(kLatencyReceiveToPlayed, task->origin_time_us, now);
+            latency_.OnFramePlayed(task->origin_time_us, now);
+        }
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
@@ -283,102 +323,267 @@ void AudioService::AudioOutputTask() {
 #if CONFIG_USE_SERVER_AEC
         /* Record the timestamp for server AEC */
         if (task->timestamp > 0) {
-            lock.lock();
+            std::lock_guard<std::mutex> lock(timestamp_mutex_);
             timestamp_queue_.push_back(task->timestamp);
         }
 #endif
+        task_pool_.Release(std::move(task));
     }
 
     ESP_LOGW(TAG, "Audio output task stopped");
 }
 
-void AudioService::OpusCodecTask() {
+void AudioService::OpusEncodeTask() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    audio_encode_queue_.SetConsumer(self);
+    audio_send_queue_.SetSpaceWaiter(self);
+
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
         if (service_stopped_) {
             break;
         }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
+        std::unique_ptr<AudioTask> task;
+        UplinkBackpressurePolicy policy = backpressure_policy_;
+        bool paused = policy == kUplinkPauseEncoding && audio_send_queue_.Full();
+        if (paused || !audio_encode_queue_.Pop(task)) {
+            WaitAudioQueueBits(AS_QUEUE_ENCODE_DATA | AS_QUEUE_SEND_SPACE);
+            continue;
+        }
 
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
+        /* The send queue is full and the policy says to drop, never wait for the network here */
+        bool dropped_oldest = false;
+        if (task->type == kAudioTaskTypeEncodeToSendQueue && audio_send_queue_.Full()) {
+            if (policy == kUplinkDropOldest && audio_send_queue_.DropOldest()) {
+                dropped_oldest = true;
+                debug_statistics_.uplink_drop_oldest_count++;
+                OnUplinkFrameDropped(encode_frame_duration_);
+            } else if (policy != kUplinkPauseEncoding) {
+                // Also when every slot still holds a packet the sender has not collected
+                debug_statistics_.uplink_drop_newest_count++;
+                OnUplinkFrameDropped(task->pcm.size() * 1000 / 16000);
+                task_pool_.Release(std::move(task));
+                continue;
+            }
+        }
 
-            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
-                // Resample if the sample rate is different
-                if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    std::vector<int16_t> resampled;
-                    resampled.reserve(target_size);  // 预留容量，减少内存碎片
-                    resampled.resize(target_size);   // 分配内存
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
-                }
+        int64_t start_time = esp_timer_get_time();
+        /* The processor chunk size decides the frame duration, so frames queued before a change still encode */
+        int frame_duration = task->pcm.size() * 1000 / 16000;
+        if (frame_duration != opus_encoder_->duration_ms() && OPUS_FRAME_DURATION_VALID(frame_duration)) {
+            ConfigureEncoder(frame_duration);
+        }
+        if (applied_bitrate_ != encode_bitrate_) {
+            applied_bitrate_ = encode_bitrate_;
+            uplink_rate_.SetBaseBitrate(applied_bitrate_);
+            ApplyUplinkOperatingPoint();
+        }
 
-                lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
-                audio_queue_cv_.notify_all();
-            } else {
-                ESP_LOGE(TAG, "Failed to decode audio");
-                lock.lock();
+        auto packet = AcquirePacket();
+        packet->frame_duration = opus_encoder_->duration_ms();
+        packet->sample_rate = 16000;
+        packet->timestamp = task->timestamp;
+        packet->origin_time_us = task->origin_time_us;
+        int64_t processed_time_us = task->stage_time_us;
+
+        // 编码到池化的 payload 中，Opus 数据写在预留的传输层包头空间之后，发送时无需再拷贝
+        bool encode_success = opus_encoder_->Encode(task->pcm.data(), task->pcm.size(), packet->payload, packet->headroom);
+        AudioTaskType type = task->type;
+        task_pool_.Release(std::move(task));
+        packet->encoded_time_us = esp_timer_get_time();
+        int encode_us = packet->encoded_time_us - start_time;
+        int frame_us = packet->frame_duration * 1000;
+        latency_.Record(kLatencyProcessedToEncoded, processed_time_us, packet->encoded_time_us);
+
+        if (!encode_success) {
+            ESP_LOGE(TAG, "Failed to encode audio");
+            packet_pool_.Release(std::move(packet));
+        } else if (type == kAudioTaskTypeEncodeToSendQueue) {
+            if (!audio_send_queue_.Push(std::move(packet))) {
+                // Space was checked or made above, but never lose a pooled packet
+                packet_pool_.Release(std::move(packet));
+            } else if (!dropped_oldest) {
+                uplink_stalled_ms_ = 0;
             }
-            debug_statistics_.decode_count++;
-        }
-        
-        /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-            
-            // 使用回调函数获取编码后的数据
-            bool encode_success = false;
-            opus_encoder_->Encode(std::move(task->pcm), [&](std::vector<uint8_t>&& opus) {
-                packet->payload = std::move(opus);
-                encode_success = true;
-            });
-            
-            if (!encode_success) {
-                ESP_LOGE(TAG, "Failed to encode audio");
-                continue;
+            if (callbacks_.on_send_queue_available) {
+                callbacks_.on_send_queue_available();
             }
+            debug_statistics_.encode_count++;
+#if CONFIG_OPUS_UPLINK_ADAPTIVE
+            if (uplink_rate_.OnFrame(audio_send_queue_.Size(), MAX_SEND_PACKETS_IN_QUEUE, send_failure_count_,
+                encode_us, frame_us)) {
+                ApplyUplinkOperatingPoint();
+            }
+#endif
+        } else if (type == kAudioTaskTypeEncodeToTestingQueue) {
+            audio_testing_queue_.Push(std::move(packet));
+            debug_statistics_.encode_count++;
+        }
+        UpdateWorkerStatistics(debug_statistics_.encode_worker, start_time);
+    }
 
-            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                {
-                    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                    audio_send_queue_.push_back(std::move(packet));
-                }
-                if (callbacks_.on_send_queue_available) {
-                    callbacks_.on_send_queue_available();
+    opus_encode_task_handle_ = nullptr;
+    ESP_LOGW(TAG, "Opus encode task stopped");
+}
+
+void AudioService::OpusDecodeTask() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    audio_decode_queue_.SetConsumer(self);
+    audio_testing_queue_.SetConsumer(self);
+    audio_sound_queue_.SetConsumer(self);
+    audio_playback_queue_.SetSpaceWaiter(self);
+
+    const uint32_t wait_bits = AS_QUEUE_DECODE_DATA | AS_QUEUE_TESTING_DATA | AS_QUEUE_SOUND_DATA | AS_QUEUE_PLAYBACK_SPACE;
+    UBaseType_t priority = uxTaskPriorityGet(NULL);
+
+    while (true) {
+        if (service_stopped_) {
+            break;
+        }
+
+        if (decoder_reset_requested_.exchange(false)) {
+            opus_decoder_->ResetState();
+            jitter_buffer_.Reset();
+            sound_reader_.Close();
+        }
+
+        /* Sound cues play straight from flash, ahead of network audio */
+        if (!audio_playback_queue_.Full() && PlayNextSoundPacket()) {
+            UpdateWorkerStatistics(debug_statistics_.decode_worker, esp_timer_get_time());
+            continue;
+        }
+
+        /* Move arrived packets into the jitter buffer, it orders them and decides when to play */
+        int64_t now = esp_timer_get_time();
+        std::unique_ptr<AudioStreamPacket> packet;
+        while (!jitter_buffer_.Full() && audio_decode_queue_.Pop(packet)) {
+            jitter_buffer_.Put(std::move(packet), now);
+        }
+
+        /* Decode the next frame, or replay the recorded audio once testing is done */
+        auto frame = kJitterFrameNone;
+        const AudioStreamPacket* fec_packet = nullptr;
+        if (!audio_playback_queue_.Full()) {
+            frame = jitter_buffer_.Get(now, packet, fec_packet);
+            ReportJitterStatistics();
+            if (frame == kJitterFrameNone && !(xEventGroupGetBits(event_group_) & AS_EVENT_AUDIO_TESTING_RUNNING)) {
+                if (audio_testing_queue_.Pop(packet)) {
+                    frame = kJitterFramePacket;
                 }
-            } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                audio_testing_queue_.push_back(std::move(packet));
             }
-            debug_statistics_.encode_count++;
-            lock.lock();
         }
+
+        if (frame == kJitterFrameNone) {
+            /* Wake up in time to play a buffered frame even if no more packets arrive */
+            int wait_ms = audio_playback_queue_.Full() ? -1 : jitter_buffer_.WaitTimeMs(esp_timer_get_time());
+            WaitAudioQueueBits(wait_bits, wait_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms) + 1);
+            continue;
+        }
+
+        /* The speaker is about to run dry, so the next frame has a deadline: run ahead of encoding */
+        UBaseType_t target_priority = audio_playback_queue_.Size() < OPUS_DECODE_URGENT_DEPTH ?
+            OPUS_DECODE_URGENT_PRIORITY : OPUS_DECODE_TASK_PRIORITY;
+        if (target_priority != priority) {
+            vTaskPrioritySet(NULL, target_priority);
+            priority = target_priority;
+        }
+
+        if (packet) {
+            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
+        }
+        if (frame == kJitterFramePacket) {
+            DecodeFrame(frame, packet->opus_data(), packet->opus_size(), packet->timestamp, packet->origin_time_us);
+        } else if (frame == kJitterFrameFec) {
+            DecodeFrame(frame, fec_packet->opus_data(), fec_packet->opus_size(), 0, 0);
+        } else {
+            DecodeFrame(frame, nullptr, 0, 0, 0);
+        }
+        packet_pool_.Release(std::move(packet));
+        UpdateWorkerStatistics(debug_statistics_.decode_worker, now);
+    }
+
+    opus_decode_task_handle_ = nullptr;
+    ESP_LOGW(TAG, "Opus decode task stopped");
+}
+
+void AudioService::ReportJitterStatistics() {
+    auto& statistics = jitter_buffer_.statistics();
+    latency_.CountPackets(kPacketReceived, statistics.received_count - reported_jitter_.received_count);
+    latency_.CountPackets(kPacketReordered, statistics.reordered_count - reported_jitter_.reordered_count);
+    latency_.CountPackets(kPacketLate, statistics.late_count - reported_jitter_.late_count);
+    latency_.CountPackets(kPacketLost, statistics.lost_count - reported_jitter_.lost_count);
+    latency_.CountPackets(kPacketRecovered, statistics.fec_count - reported_jitter_.fec_count);
+    reported_jitter_ = statistics;
+}
+
+bool AudioService::PlayNextSoundPacket() {
+    while (true) {
+        if (!sound_reader_.active()) {
+            SoundCue cue;
+            if (!audio_sound_queue_.Pop(cue)) {
+                sound_playing_ = false;
+                return false;
+            }
+            sound_playing_ = true;
+            if (!sound_reader_.Open(cue.data, cue.size, cue.index)) {
+                continue;
+            }
+            SetDecodeSampleRate(sound_reader_.sample_rate(), sound_reader_.frame_duration());
+        }
+
+        const uint8_t* packet;
+        size_t size;
+        if (sound_reader_.Next(packet, size)) {
+            DecodeFrame(kJitterFramePacket, packet, size, 0, 0);
+            return true;
+        }
+        sound_reader_.Close();
+    }
+}
+
+void AudioService::UpdateWorkerStatistics(AudioWorkerStatistics& statistics, int64_t start_time) {
+    uint32_t busy_us = esp_timer_get_time() - start_time;
+    statistics.busy_us += busy_us;
+    if (busy_us > statistics.max_busy_us) {
+        statistics.max_busy_us = busy_us;
+    }
+}
+
+void AudioService::DecodeFrame(JitterFrameType frame, const uint8_t* data, size_t size, uint32_t timestamp, int64_t origin_time_us) {
+    auto task = task_pool_.Acquire();
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+    task->timestamp = timestamp;
+    task->origin_time_us = origin_time_us;
+
+    // Resample if the sample rate is different, straight into the pooled task buffer
+    bool resample = opus_decoder_->sample_rate() != codec_->output_sample_rate();
+    auto& decoded = resample ? decode_buffer_ : task->pcm;
+    bool success = false;
+    switch (frame) {
+    case kJitterFramePacket:
+        success = opus_decoder_->Decode(data, size, decoded);
+        break;
+    case kJitterFrameFec:
+        success = opus_decoder_->DecodeFec(data, size, decoded);
+        break;
+    default:
+        success = opus_decoder_->Conceal(decoded);
+        break;
     }
 
-    ESP_LOGW(TAG, "Opus codec task stopped");
+    if (!success) {
+        ESP_LOGE(TAG, "Failed to decode audio");
+        task_pool_.Release(std::move(task));
+        return;
+    }
+    if (resample) {
+        task->pcm.resize(output_resampler_.GetOutputSamples(decoded.size()));
+        output_resampler_.Process(decoded.data(), decoded.size(), task->pcm.data());
+    }
+    task->stage_time_us = esp_timer_get_time();
+    latency_.Record(kLatencyReceiveToDecoded, origin_time_us, task->stage_time_us);
+    audio_playback_queue_.Push(std::move(task));
+    debug_statistics_.decode_count++;
 }
 
 void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
@@ -387,63 +592,119 @@ void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
     }
 
     opus_decoder_.reset();
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
+    opus_decoder_ = std::make_unique<OpusFrameDecoder>(sample_rate, 1, frame_duration);
 
-    auto codec = Board::GetInstance().GetAudioCodec();
-    if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
-        ESP_LOGI(TAG, "Resampling audio from %d to %d", opus_decoder_->sample_rate(), codec->output_sample_rate());
-        output_resampler_.Configure(opus_decoder_->sample_rate(), codec->output_sample_rate());
+    if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
+        ESP_LOGI(TAG, "Resampling audio from %d to %d", opus_decoder_->sample_rate(), codec_->output_sample_rate());
+        output_resampler_.Configure(opus_decoder_->sample_rate(), codec_->output_sample_rate());
     }
 }
 
-void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
-    auto task = std::make_unique<AudioTask>();
+void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::span<const int16_t> pcm) {
+    auto task = task_pool_.Acquire();
     task->type = type;
-    task->pcm = std::move(pcm);
-    
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+    task->timestamp = 0;
+    task->pcm.assign(pcm.begin(), pcm.end());
+    task->origin_time_us = 0;
+    task->stage_time_us = esp_timer_get_time();
 
     /* If the task is to send queue, we need to set the timestamp */
-    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
-        } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
+    if (type == kAudioTaskTypeEncodeToSendQueue) {
+        task->origin_time_us = last_capture_time_us_;
+        latency_.Record(kLatencyCaptureToProcessed, task->origin_time_us, task->stage_time_us);
+
+        std::lock_guard<std::mutex> lock(timestamp_mutex_);
+        if (!timestamp_queue_.empty()) {
+            if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
+                task->timestamp = timestamp_queue_.front();
+            } else {
+                ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
+            }
+            timestamp_queue_.pop_front();
         }
-        timestamp_queue_.pop_front();
     }
 
-    audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
-    audio_encode_queue_.push_back(std::move(task));
-    audio_queue_cv_.notify_all();
+    /* Push the task to the encode queue, uplink frames never wait: the mic has to keep draining */
+    while (!audio_encode_queue_.Push(std::move(task))) {
+        if (type == kAudioTaskTypeEncodeToSendQueue) {
+            debug_statistics_.uplink_paused_drop_count++;
+            OnUplinkFrameDropped(pcm.size() * 1000 / 16000);
+            task_pool_.Release(std::move(task));
+            return;
+        }
+        if (!audio_encode_queue_.WaitForSpace()) {
+            task_pool_.Release(std::move(task));
+            return;
+        }
+    }
+}
+
+void AudioService::OnUplinkFrameDropped(int frame_duration_ms) {
+    int previous_ms = uplink_stalled_ms_.fetch_add(frame_duration_ms);
+    int stalled_ms = previous_ms + frame_duration_ms;
+    // Only the start of a stall and the drop that crosses the end-turn threshold are reported
+    bool started = previous_ms == 0;
+    bool crossed = previous_ms < UPLINK_STALL_END_TURN_MS && stalled_ms >= UPLINK_STALL_END_TURN_MS;
+    if (started) {
+        ESP_LOGW(TAG, "Uplink stalled, dropping audio");
+    }
+    if ((started || crossed) && callbacks_.on_uplink_stalled) {
+        callbacks_.on_uplink_stalled(stalled_ms);
+    }
 }
 
 bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
-        if (wait) {
-            audio_queue_cv_.wait(lock, [this]() { return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE; });
-        } else {
+    packet->origin_time_us = esp_timer_get_time();
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+            if (audio_decode_queue_.Push(std::move(packet))) {
+                return true;
+            }
+            if (!wait) {
+                debug_statistics_.decode_queue_drop_count++;
+                packet_pool_.Release(std::move(packet));
+                return false;
+            }
+        }
+        if (!audio_decode_queue_.WaitForSpace()) {
+            packet_pool_.Release(std::move(packet));
             return false;
         }
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
-    return true;
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
-        return nullptr;
-    }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
+    std::unique_ptr<AudioStreamPacket> packet;
+    audio_send_queue_.Pop(packet);
+    return packet;
+}
+
+std::unique_ptr<AudioStreamPacket> AudioService::AcquirePacket() {
+    auto packet = packet_pool_.Acquire();
+    packet->sample_rate = 0;
+    packet->frame_duration = 0;
+    packet->timestamp = 0;
+    packet->sequence = 0;
+    packet->origin_time_us = 0;
+    packet->encoded_time_us = 0;
+    // Every packet keeps room for a transport header in front of the Opus data, senders never move the payload
+    packet->headroom = AUDIO_PACKET_HEADROOM;
+    packet->payload.assign(AUDIO_PACKET_HEADROOM, 0);
     return packet;
 }
 
+void AudioService::RecyclePacket(std::unique_ptr<AudioStreamPacket>&& packet) {
+    packet_pool_.Release(std::move(packet));
+}
+
+void AudioService::RecordPacketSent(const AudioStreamPacket& packet) {
+    int64_t now = esp_timer_get_time();
+    latency_.Record(kLatencyEncodedToSent, packet.encoded_time_us, now);
+    latency_.Record(kLatencyCaptureToSent, packet.origin_time_us, now);
+    latency_.OnPacketSent(now);
+}
+
 void AudioService::EncodeWakeWord() {
     if (wake_word_) {
         wake_word_->EncodeWakeWordData();
@@ -457,6 +718,8 @@ const std::string& AudioService::GetLastWakeWord() const {
 std::unique_ptr<AudioStreamPacket> AudioService::PopWakeWordPacket() {
     auto packet = std::make_unique<AudioStreamPacket>();
     if (wake_word_->GetWakeWordOpus(packet->payload)) {
+        // The wake word encoder leaves the same headroom as the uplink encoder
+        packet->headroom = AUDIO_PACKET_HEADROOM;
         return packet;
     }
     return nullptr;
@@ -488,7 +751,7 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
         if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+            audio_processor_->Initialize(codec_, encode_frame_duration_, models_list_);
             audio_processor_initialized_ = true;
         }
 
@@ -509,23 +772,61 @@ void AudioService::EnableAudioTesting(bool enable) {
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* The opus codec task replays audio_testing_queue_ once testing is stopped */
+        audio_testing_queue_.WakeConsumer();
     }
 }
 
 void AudioService::EnableDeviceAec(bool enable) {
     ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
     if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+        audio_processor_->Initialize(codec_, encode_frame_duration_, models_list_);
         audio_processor_initialized_ = true;
     }
 
     audio_processor_->EnableDeviceAec(enable);
 }
 
+void AudioService::SetEncodeParams(int frame_duration_ms, int bitrate) {
+    if (!OPUS_FRAME_DURATION_VALID(frame_duration_ms)) {
+        ESP_LOGW(TAG, "Unsupported frame duration %d ms, keeping %d ms", frame_duration_ms, encode_frame_duration_.load());
+        frame_duration_ms = encode_frame_duration_;
+    }
+    if (frame_duration_ms != encode_frame_duration_ || bitrate != encode_bitrate_) {
+        ESP_LOGI(TAG, "Uplink Opus: %d ms frames, bitrate %d", frame_duration_ms, bitrate);
+    }
+    encode_bitrate_ = bitrate;
+    encode_frame_duration_ = frame_duration_ms;
+    packet_block_size_ = AUDIO_PACKET_HEADROOM + OpusFrameEncoder::MaxPacketSize(16000, 1, frame_duration_ms, bitrate);
+    /* The encoder follows the new chunk size on its own, see OpusEncodeTask */
+    if (audio_processor_initialized_) {
+        audio_processor_->SetFrameDuration(frame_duration_ms);
+    }
+}
+
+void AudioService::ConfigureEncoder(int frame_duration_ms) {
+    opus_encoder_ = std::make_unique<OpusFrameEncoder>(16000, 1, frame_duration_ms);
+    if (applied_bitrate_ != encode_bitrate_) {
+        applied_bitrate_ = encode_bitrate_;
+        uplink_rate_.SetBaseBitrate(applied_bitrate_);
+    }
+    ApplyUplinkOperatingPoint();
+}
+
+void AudioService::ApplyUplinkOperatingPoint() {
+    auto& point = uplink_rate_.point();
+    opus_encoder_->SetBitrate(point.bitrate);
+    opus_encoder_->SetComplexity(point.complexity);
+    opus_encoder_->SetInbandFec(point.fec, point.loss_percent);
+    std::lock_guard<std::mutex> lock(uplink_point_mutex_);
+    uplink_point_ = point;
+}
+
+UplinkOperatingPoint AudioService::GetUplinkOperatingPoint() {
+    std::lock_guard<std::mutex> lock(uplink_point_mutex_);
+    return uplink_point_;
+}
+
 void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
     callbacks_ = callbacks;
 }
@@ -537,111 +838,41 @@ void AudioService::PlaySound(const std::string_view& ogg) {
         codec_->EnableOutput(true);
     }
 
-    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
-    size_t size = ogg.size();
-    size_t offset = 0;
-
-    auto find_page = [&](size_t start)->size_t {
-        for (size_t i = start; i + 4 <= size; ++i) {
-            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
-        }
-        return static_cast<size_t>(-1);
-    };
-
-    bool seen_head = false;
-    bool seen_tags = false;
-    int sample_rate = 16000; // 默认值
-
-    while (true) {
-        size_t pos = find_page(offset);
-        if (pos == static_cast<size_t>(-1)) break;
-        offset = pos;
-        if (offset + 27 > size) break;
-
-        const uint8_t* page = buf + offset;
-        uint8_t page_segments = page[26];
-        size_t seg_table_off = offset + 27;
-        if (seg_table_off + page_segments > size) break;
-
-        size_t body_size = 0;
-        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
-
-        size_t body_off = seg_table_off + page_segments;
-        if (body_off + body_size > size) break;
-
-        // Parse packets using lacing
-        size_t cur = body_off;
-        size_t seg_idx = 0;
-        while (seg_idx < page_segments) {
-            size_t pkt_len = 0;
-            size_t pkt_start = cur;
-            bool continued = false;
-            do {
-                uint8_t l = page[27 + seg_idx++];
-                pkt_len += l;
-                cur += l;
-                continued = (l == 255);
-            } while (continued && seg_idx < page_segments);
-
-            if (pkt_len == 0) continue;
-            const uint8_t* pkt_ptr = buf + pkt_start;
-
-            if (!seen_head) {
-                // 解析OpusHead包
-                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
-                    seen_head = true;
-                    
-                    // OpusHead结构：[0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
-                    // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
-                    if (pkt_len >= 12) {
-                        uint8_t version = pkt_ptr[8];
-                        uint8_t channel_count = pkt_ptr[9];
-                        
-                        if (pkt_len >= 16) {
-                            // 读取输入采样率 (little-endian)
-                            sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) | 
-                                        (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
-                            ESP_LOGI(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d", 
-                                   version, channel_count, sample_rate);
-                        }
-                    }
-                }
-                continue;
-            }
-            if (!seen_tags) {
-                // Expect OpusTags in second packet
-                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
-                    seen_tags = true;
-                }
-                continue;
-            }
-
-            // Audio packet (Opus)
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->sample_rate = sample_rate;
-            packet->frame_duration = 60;
-            packet->payload.resize(pkt_len);
-            std::memcpy(packet->payload.data(), pkt_ptr, pkt_len);
-            PushPacketToDecodeQueue(std::move(packet), true);
+    /* Built-in sounds come with a packet table, others are walked page by page while playing */
+    SoundCue cue;
+    cue.data = reinterpret_cast<const uint8_t*>(ogg.data());
+    cue.size = ogg.size();
+    cue.index = nullptr;
+    for (auto& index : Lang::Sounds::SOUND_INDEX) {
+        if (index.data == ogg.data()) {
+            cue.index = &index;
+            break;
         }
+    }
 
-        offset = body_off + body_size;
+    /* The opus decode task plays the sound, so the caller never blocks */
+    std::lock_guard<std::mutex> lock(sound_producer_mutex_);
+    if (!audio_sound_queue_.Push(std::move(cue))) {
+        ESP_LOGW(TAG, "Sound queue is full, dropping sound");
     }
 }
 
 bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    return audio_encode_queue_.Empty() && audio_decode_queue_.Empty() && jitter_buffer_.Size() == 0 &&
+        audio_sound_queue_.Empty() && !sound_playing_ && audio_playback_queue_.Empty() && audio_testing_queue_.Empty();
 }
 
 void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    opus_decoder_->ResetState();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    /* The decoder state is owned by the opus codec task, so it resets it before the next packet */
+    decoder_reset_requested_ = true;
+    {
+        std::lock_guard<std::mutex> lock(timestamp_mutex_);
+        timestamp_queue_.clear();
+    }
+    audio_decode_queue_.Clear();
+    audio_sound_queue_.Clear();
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
 }
 
 void AudioService::CheckAndUpdateAudioPowerState() {
@@ -670,6 +901,9 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
     } else {
         wake_word_ = nullptr;
     }
+#elif CONFIG_IDF_TARGET_LINUX
+    /* No wake word engine on the host build */
+    wake_word_ = nullptr;
 #else
     if (esp_srmodel_filter(models_list_, ESP_WN_PREFIX, NULL) != nullptr) {
         wake_word_ = std::make_unique<EspWakeWord>();
@@ -680,6 +914,7 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
 
     if (wake_word_) {
         wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
+            latency_.MarkWakeWord(esp_timer_get_time());
             if (callbacks_.on_wake_word_detected) {
                 callbacks_.on_wake_word_detected(wake_word);
             }
@@ -687,6 +922,50 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
     }
 }
 
+const DebugStatistics& AudioService::GetDebugStatistics() {
+    debug_statistics_.task_pool_hits = task_pool_.hits();
+    debug_statistics_.task_pool_misses = task_pool_.misses();
+    debug_statistics_.packet_pool_hits = packet_pool_.hits();
+    debug_statistics_.packet_pool_misses = packet_pool_.misses();
+    debug_statistics_.jitter = jitter_buffer_.statistics();
+    TaskHandle_t encode_task = opus_encode_task_handle_;
+    if (encode_task != nullptr) {
+        debug_statistics_.encode_worker.min_free_stack = uxTaskGetStackHighWaterMark(encode_task);
+    }
+    TaskHandle_t decode_task = opus_decode_task_handle_;
+    if (decode_task != nullptr) {
+        debug_statistics_.decode_worker.min_free_stack = uxTaskGetStackHighWaterMark(decode_task);
+    }
+    return debug_statistics_;
+}
+
+void AudioService::PrintWorkerStats() {
+    auto& stats = GetDebugStatistics();
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed_us = now - worker_stats_time_;
+    uint64_t encode_busy_us = stats.encode_worker.busy_us - last_encode_busy_us_;
+    uint64_t decode_busy_us = stats.decode_worker.busy_us - last_decode_busy_us_;
+    uint32_t encoded_frames = stats.encode_count - last_encode_count_;
+    worker_stats_time_ = now;
+    last_encode_busy_us_ = stats.encode_worker.busy_us;
+    last_decode_busy_us_ = stats.decode_worker.busy_us;
+    last_encode_count_ = stats.encode_count;
+    if (elapsed_us <= 0 || (encode_busy_us == 0 && decode_busy_us == 0)) {
+        return;
+    }
+
+    // The per-frame encode cost is what changes with the negotiated frame duration
+    ESP_LOGI(TAG, "Opus encode: %.1f%% busy, %d ms frames %lu us/frame, max %lu us, stack free %lu; decode: %.1f%% busy, max %lu us, stack free %lu",
+        encode_busy_us * 100.0f / elapsed_us, encode_frame_duration_.load(),
+        encoded_frames > 0 ? (uint32_t)(encode_busy_us / encoded_frames) : 0,
+        stats.encode_worker.max_busy_us, stats.encode_worker.min_free_stack,
+        decode_busy_us * 100.0f / elapsed_us, stats.decode_worker.max_busy_us, stats.decode_worker.min_free_stack);
+    if (stats.uplink_drop_oldest_count + stats.uplink_drop_newest_count + stats.uplink_paused_drop_count > 0) {
+        ESP_LOGI(TAG, "Uplink dropped frames: %lu oldest, %lu newest, %lu while paused",
+            stats.uplink_drop_oldest_count, stats.uplink_drop_newest_count, stats.uplink_paused_drop_count);
+    }
+}
+
 bool AudioService::IsAfeWakeWord() {
 #if CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32P4
     return wake_word_ != nullptr && dynamic_cast<AfeWakeWord*>(wake_word_.get()) != nullptr;
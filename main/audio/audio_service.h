@@ -1,11 +1,13 @@
 #ifndef AUDIO_SERVICE_H
 #define AUDIO_SERVICE_H
 
+#include <algorithm>
 #include <memory>
+#include <atomic>
 #include <deque>
-#include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <span>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -13,12 +15,18 @@
 #include <esp_timer.h>
 #include <model_path.h>
 
-#include <opus_encoder.h>
-#include <opus_decoder.h>
 #include <opus_resampler.h>
 
 #include "audio_codec.h"
 #include "audio_processor.h"
+#include "audio_ring_queue.h"
+#include "audio_object_pool.h"
+#include "audio_jitter_buffer.h"
+#include "audio_latency.h"
+#include "uplink_rate_controller.h"
+#include "opus_frame_decoder.h"
+#include "opus_frame_encoder.h"
+#include "ogg_packet_reader.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
 #include "protocol.h"
@@ -27,21 +35,59 @@
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Decode Queue} -> [Jitter Buffer] -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
  *
- * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * We use one task for MIC / Speaker / Processors, and one task each for Opus Encoder and Opus Decoder,
+ * so a long TTS decode never delays the uplink and vice versa.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
  * 
+ * Every queue is a single-producer / single-consumer AudioRingQueue, so the MIC, speaker and Opus tasks
+ * never share a lock. Each queue wakes only the task waiting on it via the AS_QUEUE_* notification bits.
+ *
+ * AudioTask and AudioStreamPacket objects are recycled through AudioObjectPool, so streaming a frame
+ * reuses preallocated PCM / Opus buffers instead of hitting the heap.
  */
 
 #define OPUS_FRAME_DURATION_MS 60
+#define OPUS_ENCODE_COMPLEXITY 0
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
 #define MAX_DECODE_PACKETS_IN_QUEUE 20  // 减小到20（从40），节省内存
 #define MAX_SEND_PACKETS_IN_QUEUE 20    // 减小到20（从40），节省内存
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
 #define MAX_TIMESTAMPS_IN_QUEUE 3
+// End the listening turn once the uplink has dropped this much audio in a row
+#define UPLINK_STALL_END_TURN_MS 3000
+#define MAX_TESTING_PACKETS_IN_QUEUE (AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS)
+
+// Ring capacities must be powers of two, with room for items cleared but not yet dropped
+#define ENCODE_QUEUE_CAPACITY   4
+#define PLAYBACK_QUEUE_CAPACITY 4
+#define DECODE_QUEUE_CAPACITY   32
+#define SEND_QUEUE_CAPACITY     32
+#define TESTING_QUEUE_CAPACITY  256
+#define SOUND_QUEUE_CAPACITY    16
+
+// Pooled frame objects, sized so that full queues still recycle every frame: what the queues (and
+// the jitter buffer) hold, plus one frame in flight in each worker that touches them. Only the
+// preallocated ones are reserved at boot, the rest is kept once a burst has allocated it.
+// Packets pile up in one direction at a time, a full decode queue behind a full jitter buffer while
+// speaking or a full send queue while the link stalls, so the pool covers the larger of the two.
+#define AUDIO_TASK_POOL_SIZE        (MAX_ENCODE_TASKS_IN_QUEUE + MAX_PLAYBACK_TASKS_IN_QUEUE + 4)
+#define AUDIO_TASK_PREALLOCATED     4
+#define AUDIO_DOWNLINK_PACKETS_HELD (MAX_DECODE_PACKETS_IN_QUEUE + JITTER_BUFFER_MAX_PACKETS)
+#define AUDIO_UPLINK_PACKETS_HELD   MAX_SEND_PACKETS_IN_QUEUE
+#define AUDIO_PACKET_POOL_SIZE      (std::max(AUDIO_DOWNLINK_PACKETS_HELD, AUDIO_UPLINK_PACKETS_HELD) + 3)
+#define AUDIO_PACKET_PREALLOCATED   4
+
+// Opus workers, the decoder is raised to the urgent priority while playback holds fewer frames than the urgent depth
+#define OPUS_ENCODE_TASK_STACK_SIZE (2048 * 12)
+#define OPUS_ENCODE_TASK_PRIORITY   2
+#define OPUS_DECODE_TASK_STACK_SIZE (2048 * 6)
+#define OPUS_DECODE_TASK_PRIORITY   2
+#define OPUS_DECODE_URGENT_PRIORITY 5
+#define OPUS_DECODE_URGENT_DEPTH    1
 
 #define AUDIO_POWER_TIMEOUT_MS 15000
 #define AUDIO_POWER_CHECK_INTERVAL_MS 1000
@@ -52,8 +98,40 @@
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY         (1 << 3)
 
+// Task notification bits used by the audio queues
+#define AS_QUEUE_ENCODE_DATA        (1 << 0)
+#define AS_QUEUE_ENCODE_SPACE       (1 << 1)
+#define AS_QUEUE_SEND_DATA          (1 << 2)
+#define AS_QUEUE_SEND_SPACE         (1 << 3)
+#define AS_QUEUE_DECODE_DATA        (1 << 4)
+#define AS_QUEUE_DECODE_SPACE       (1 << 5)
+#define AS_QUEUE_PLAYBACK_DATA      (1 << 6)
+#define AS_QUEUE_PLAYBACK_SPACE     (1 << 7)
+#define AS_QUEUE_TESTING_DATA       (1 << 8)
+#define AS_QUEUE_TESTING_SPACE      (1 << 9)
+#define AS_QUEUE_SOUND_DATA         (1 << 10)
+#define AS_QUEUE_SOUND_SPACE        (1 << 11)
+
+// What the encode task does with new frames while the send queue is full
+enum UplinkBackpressurePolicy {
+    kUplinkDropOldest,      // Drop the oldest queued packet, the server gets the most recent audio
+    kUplinkDropNewest,      // Drop new frames before encoding, queued audio is kept
+    kUplinkPauseEncoding,   // Stop encoding, the mic keeps draining and frames that find the encode queue full are dropped
+};
+
+#if CONFIG_UPLINK_BACKPRESSURE_DROP_NEWEST
+#define UPLINK_BACKPRESSURE_POLICY kUplinkDropNewest
+#elif CONFIG_UPLINK_BACKPRESSURE_PAUSE
+#define UPLINK_BACKPRESSURE_POLICY kUplinkPauseEncoding
+#else
+#define UPLINK_BACKPRESSURE_POLICY kUplinkDropOldest
+#endif
+
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
+    // Called from the audio tasks twice per stall: on the first dropped uplink frame, and once the uplink
+    // has dropped UPLINK_STALL_END_TURN_MS of audio in a row. stalled_ms is the audio dropped so far
+    std::function<void(int stalled_ms)> on_uplink_stalled;
     std::function<void(const std::string&)> on_wake_word_detected;
     std::function<void(bool)> on_vad_change;
     std::function<void(void)> on_audio_testing_queue_full;
@@ -70,6 +148,22 @@ struct AudioTask {
     AudioTaskType type;
     std::vector<int16_t> pcm;
     uint32_t timestamp;
+    // esp_timer times for latency statistics, 0 if unknown
+    int64_t origin_time_us = 0;  // Mic read (encode) or network receive (decode)
+    int64_t stage_time_us = 0;   // Processor output (encode) or decode done (decode)
+};
+
+// A sound waiting to be played from flash, index is nullptr for sounds without a packet table
+struct SoundCue {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    const OggSoundIndex* index = nullptr;
+};
+
+struct AudioWorkerStatistics {
+    uint64_t busy_us = 0;
+    uint32_t max_busy_us = 0;
+    uint32_t min_free_stack = 0;
 };
 
 struct DebugStatistics {
@@ -77,6 +171,17 @@ struct DebugStatistics {
     uint32_t decode_count = 0;
     uint32_t encode_count = 0;
     uint32_t playback_count = 0;
+    uint32_t task_pool_hits = 0;
+    uint32_t task_pool_misses = 0;
+    uint32_t packet_pool_hits = 0;
+    uint32_t packet_pool_misses = 0;
+    uint32_t decode_queue_drop_count = 0;
+    uint32_t uplink_drop_oldest_count = 0;   // Encoded packets dropped from the send queue
+    uint32_t uplink_drop_newest_count = 0;   // Frames dropped by the encode task before encoding
+    uint32_t uplink_paused_drop_count = 0;   // Mic frames dropped because the encode queue was full
+    JitterBufferStatistics jitter;
+    AudioWorkerStatistics encode_worker;
+    AudioWorkerStatistics decode_worker;
 };
 
 class AudioService {
@@ -105,10 +210,30 @@ public:
 
     bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
     std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
+    // A pooled packet with default metadata, for transports to receive into
+    std::unique_ptr<AudioStreamPacket> AcquirePacket();
+    // Hand a packet returned by PopPacketFromSendQueue() back to the pool once it is sent
+    void RecyclePacket(std::unique_ptr<AudioStreamPacket>&& packet);
+    // Call right after SendAudio() succeeded for an uplink packet (send queue or wake word data)
+    void RecordPacketSent(const AudioStreamPacket& packet);
+    // Call when SendAudio() failed, the uplink steps down to a lower bitrate
+    void RecordSendFailure() { send_failure_count_++; }
     void PlaySound(const std::string_view& sound);
-    bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
+    // Read samples (per channel, at 16 kHz) from the codec, frame points into buffers owned by the service
+    bool ReadAudioData(AudioInputFrame& frame, int samples);
     void ResetDecoder();
     void SetModelsList(srmodel_list_t* models_list);
+    const DebugStatistics& GetDebugStatistics();
+    // Log the Opus worker load since the previous call
+    void PrintWorkerStats();
+    const AudioLatencyMonitor& GetLatencyMonitor() const { return latency_; }
+    // Uplink Opus parameters, bitrate 0 lets the encoder choose. Takes effect from the next processor frame.
+    void SetEncodeParams(int frame_duration_ms, int bitrate);
+    int encode_frame_duration() const { return encode_frame_duration_; }
+    int encode_bitrate() const { return encode_bitrate_; }
+    // Bitrate, complexity and FEC the uplink encoder runs with right now
+    UplinkOperatingPoint GetUplinkOperatingPoint();
+    void SetUplinkBackpressurePolicy(UplinkBackpressurePolicy policy) { backpressure_policy_ = policy; }
 
 private:
     AudioCodec* codec_ = nullptr;
@@ -116,12 +241,15 @@ private:
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<WakeWord> wake_word_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
-    std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
-    std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
+    std::unique_ptr<OpusFrameEncoder> opus_encoder_;
+    std::unique_ptr<OpusFrameDecoder> opus_decoder_;
     OpusResampler input_resampler_;
     OpusResampler reference_resampler_;
     OpusResampler output_resampler_;
     DebugStatistics debug_statistics_;
+    AudioLatencyMonitor latency_;
+    // esp_timer time of the latest mic read, the newest sample of a processor output was captured then
+    std::atomic<int64_t> last_capture_time_us_ = 0;
     srmodel_list_t* models_list_ = nullptr;
 
     EventGroupHandle_t event_group_;
@@ -129,15 +257,40 @@ private:
     // Audio encode / decode
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
-    TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
+    TaskHandle_t opus_encode_task_handle_ = nullptr;
+    TaskHandle_t opus_decode_task_handle_ = nullptr;
+    AudioObjectPool<AudioTask> task_pool_{AUDIO_TASK_POOL_SIZE};
+    AudioObjectPool<AudioStreamPacket> packet_pool_{AUDIO_PACKET_POOL_SIZE};
+    // Input stage buffers, owned by the audio input task
+    std::vector<int16_t> input_buffer_;
+    std::vector<int16_t> mic_raw_;
+    std::vector<int16_t> reference_raw_;
+    std::vector<int16_t> mic_buffer_;
+    std::vector<int16_t> reference_buffer_;
+    // Decoder output before resampling, owned by the opus codec task
+    std::vector<int16_t> decode_buffer_;
+    AudioJitterBuffer jitter_buffer_{OPUS_FRAME_DURATION_MS};
+    JitterBufferStatistics reported_jitter_;  // Counters already passed on to latency_
+    AudioRingQueue<std::unique_ptr<AudioStreamPacket>, DECODE_QUEUE_CAPACITY> audio_decode_queue_{
+        AS_QUEUE_DECODE_DATA, AS_QUEUE_DECODE_SPACE, MAX_DECODE_PACKETS_IN_QUEUE};
+    AudioRingQueue<std::unique_ptr<AudioStreamPacket>, SEND_QUEUE_CAPACITY> audio_send_queue_{
+        AS_QUEUE_SEND_DATA, AS_QUEUE_SEND_SPACE, MAX_SEND_PACKETS_IN_QUEUE};
+    AudioRingQueue<std::unique_ptr<AudioStreamPacket>, TESTING_QUEUE_CAPACITY> audio_testing_queue_{
+        AS_QUEUE_TESTING_DATA, AS_QUEUE_TESTING_SPACE, MAX_TESTING_PACKETS_IN_QUEUE};
+    AudioRingQueue<std::unique_ptr<AudioTask>, ENCODE_QUEUE_CAPACITY> audio_encode_queue_{
+        AS_QUEUE_ENCODE_DATA, AS_QUEUE_ENCODE_SPACE, MAX_ENCODE_TASKS_IN_QUEUE};
+    AudioRingQueue<std::unique_ptr<AudioTask>, PLAYBACK_QUEUE_CAPACITY> audio_playback_queue_{
+        AS_QUEUE_PLAYBACK_DATA, AS_QUEUE_PLAYBACK_SPACE, MAX_PLAYBACK_TASKS_IN_QUEUE};
+    AudioRingQueue<SoundCue, SOUND_QUEUE_CAPACITY> audio_sound_queue_{
+        AS_QUEUE_SOUND_DATA, AS_QUEUE_SOUND_SPACE};
+    // The decode queue may be fed by several tasks, so may the sound queue
+    std::mutex decode_producer_mutex_;
+    std::mutex sound_producer_mutex_;
+    // Sound being played, owned by the opus decode task
+    OggPacketReader sound_reader_;
+    std::atomic<bool> sound_playing_ = false;
     // For server AEC
+    std::mutex timestamp_mutex_;
     std::deque<uint32_t> timestamp_queue_;
 
     bool wake_word_initialized_ = false;
@@ -145,15 +298,40 @@ private:
     bool voice_detected_ = false;
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
+    std::atomic<bool> decoder_reset_requested_ = false;
+    std::atomic<int> encode_frame_duration_ = OPUS_FRAME_DURATION_MS;
+    std::atomic<int> encode_bitrate_ = 0;
+    // Payload reserved for a pooled packet: headroom and the largest uplink frame at the negotiated
+    // duration and bitrate. Downlink frames grow a packet only as far as they need
+    std::atomic<size_t> packet_block_size_ = AUDIO_PACKET_HEADROOM + OpusFrameEncoder::MaxPacketSize(16000, 1, OPUS_FRAME_DURATION_MS, 0);
+    int applied_bitrate_ = 0;  // Owned by the opus encode task
+    UplinkRateController uplink_rate_{OPUS_ENCODE_COMPLEXITY, UPLINK_RATE_MAX_COMPLEXITY};  // Owned by the opus encode task
+    std::atomic<uint32_t> send_failure_count_ = 0;
+    std::atomic<UplinkBackpressurePolicy> backpressure_policy_ = UPLINK_BACKPRESSURE_POLICY;
+    std::atomic<int> uplink_stalled_ms_ = 0;  // Audio dropped since a frame last made it into the send queue
+    std::mutex uplink_point_mutex_;
+    UplinkOperatingPoint uplink_point_;
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
     std::chrono::steady_clock::time_point last_input_time_;
     std::chrono::steady_clock::time_point last_output_time_;
+    int64_t worker_stats_time_ = 0;
+    uint64_t last_encode_busy_us_ = 0;
+    uint64_t last_decode_busy_us_ = 0;
+    uint32_t last_encode_count_ = 0;
 
     void AudioInputTask();
     void AudioOutputTask();
-    void OpusCodecTask();
-    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
+    void OpusEncodeTask();
+    void OpusDecodeTask();
+    void UpdateWorkerStatistics(AudioWorkerStatistics& statistics, int64_t start_time);
+    void ConfigureEncoder(int frame_duration_ms);
+    void ApplyUplinkOperatingPoint();
+    void PushTaskToEncodeQueue(AudioTaskType type, std::span<const int16_t> pcm);
+    void OnUplinkFrameDropped(int frame_duration_ms);
+    void DecodeFrame(JitterFrameType frame, const uint8_t* data, size_t size, uint32_t timestamp, int64_t origin_time_us);
+    bool PlayNextSoundPacket();
+    void ReportJitterStatistics();
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
     void CheckAndUpdateAudioPowerState();
 };
@@ -0,0 +1,48 @@
+#ifndef _AUDIO_KERNELS_H
+#define _AUDIO_KERNELS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Sample format and gain kernels for the I2S codecs.
+ *
+ * Plain fixed-point loops without branches in the body, so they stay cheap on cores without
+ * SIMD (the C3 is rv32imc) and let the compiler unroll them. All of them work on caller-owned
+ * buffers and never allocate.
+ */
+
+// Clamp to the symmetric int16 range used by the codecs
+inline int16_t SaturateInt16(int32_t value) {
+    return static_cast<int16_t>(std::clamp<int32_t>(value, -INT16_MAX, INT16_MAX));
+}
+
+// Q15 factor for a 0-100 volume, square law: (volume / 100)^2
+inline int32_t VolumeToQ15(int volume) {
+    volume = std::clamp(volume, 0, 100);
+    return volume * volume * 32768 / 10000;
+}
+
+// int16 PCM to the upper bits of 32-bit I2S slots with a Q15 gain of at most 1.0, which can not overflow
+inline void PackPcm16ToI2s32(const int16_t* src, int32_t* dest, size_t samples, int32_t gain_q15) {
+    for (size_t i = 0; i < samples; i++) {
+        dest[i] = int32_t(src[i]) * gain_q15 * 2;
+    }
+}
+
+// 32-bit I2S slots to int16 PCM, keeping the bits above shift
+inline void UnpackI2s32ToPcm16(const int32_t* src, int16_t* dest, size_t samples, int shift) {
+    for (size_t i = 0; i < samples; i++) {
+        dest[i] = SaturateInt16(src[i] >> shift);
+    }
+}
+
+// In-place integer gain with saturation
+inline void ApplyGainSaturate(int16_t* data, size_t samples, int32_t gain) {
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = SaturateInt16(int32_t(data[i]) * gain);
+    }
+}
+
+#endif // _AUDIO_KERNELS_H
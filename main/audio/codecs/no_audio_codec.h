@@ -6,10 +6,17 @@
 #include <driver/gpio.h>
 #include <driver/i2s_pdm.h>
 #include <mutex>
+#include <vector>
 
 class NoAudioCodec : public AudioCodec {
 protected:
     std::mutex data_if_mutex_;
+    // Persistent 32-bit I2S staging buffers, Write() holds data_if_mutex_ and Read() runs on the input task
+    std::vector<int32_t> write_buffer_;
+    std::vector<int32_t> read_buffer_;
+    // Q15 output gain, recomputed only when output_volume_ changes
+    int cached_volume_ = -1;
+    int32_t volume_q15_ = 0;
 
     virtual int Write(const int16_t* data, int samples) override;
     virtual int Read(int16_t* dest, int samples) override;
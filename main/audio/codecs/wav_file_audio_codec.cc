@@ -0,0 +1,181 @@
+#include "wav_file_audio_codec.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "WavFileAudioCodec"
+
+// Falling further behind than this (idle speaker, slow SD card) restarts the pacing clock
+#define WAV_FILE_MAX_LAG_US 200000
+
+struct WavChunkHeader {
+    char id[4];
+    uint32_t size;
+} __attribute__((packed));
+
+struct WavFormat {
+    uint16_t audio_format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+} __attribute__((packed));
+
+WavFileAudioCodec::WavFileAudioCodec(const std::string& input_path, const std::string& output_path, int output_sample_rate, int speed)
+    : speed_(speed < 1 ? 1 : speed) {
+    duplex_ = true;
+    input_reference_ = false;
+    input_channels_ = 1;
+    input_sample_rate_ = 16000;
+    output_sample_rate_ = output_sample_rate;
+
+    if (!input_path.empty() && !OpenInput(input_path)) {
+        ESP_LOGW(TAG, "Microphone input will be silent");
+    }
+    if (!output_path.empty()) {
+        OpenOutput(output_path);
+    }
+    ESP_LOGI(TAG, "WAV file codec: %s -> %s, speed x%d", input_path.c_str(), output_path.c_str(), speed_);
+}
+
+WavFileAudioCodec::~WavFileAudioCodec() {
+    if (input_file_ != nullptr) {
+        fclose(input_file_);
+    }
+    FinishOutput();
+}
+
+bool WavFileAudioCodec::OpenInput(const std::string& path) {
+    input_file_ = fopen(path.c_str(), "rb");
+    if (input_file_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to open %s", path.c_str());
+        return false;
+    }
+
+    char riff[12];
+    if (fread(riff, 1, sizeof(riff), input_file_) != sizeof(riff) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        ESP_LOGE(TAG, "%s is not a WAV file", path.c_str());
+        fclose(input_file_);
+        input_file_ = nullptr;
+        return false;
+    }
+
+    // Walk the chunks up to the PCM data
+    WavChunkHeader chunk;
+    bool has_format = false;
+    while (fread(&chunk, 1, sizeof(chunk), input_file_) == sizeof(chunk)) {
+        if (memcmp(chunk.id, "fmt ", 4) == 0 && chunk.size >= sizeof(WavFormat)) {
+            WavFormat format;
+            if (fread(&format, 1, sizeof(format), input_file_) != sizeof(format)) {
+                break;
+            }
+            fseek(input_file_, chunk.size - sizeof(format), SEEK_CUR);
+            if (format.audio_format != 1 || format.channels != 1 || format.bits_per_sample != 16) {
+                ESP_LOGE(TAG, "%s must be 16-bit mono PCM", path.c_str());
+                break;
+            }
+            input_sample_rate_ = format.sample_rate;
+            has_format = true;
+        } else if (memcmp(chunk.id, "data", 4) == 0 && has_format) {
+            input_remaining_ = chunk.size;
+            ESP_LOGI(TAG, "Input %s: %d Hz, %u ms", path.c_str(), input_sample_rate_,
+                (unsigned)(chunk.size / 2 * 1000 / input_sample_rate_));
+            return true;
+        } else {
+            fseek(input_file_, chunk.size + (chunk.size & 1), SEEK_CUR);
+        }
+    }
+
+    ESP_LOGE(TAG, "No PCM data found in %s", path.c_str());
+    fclose(input_file_);
+    input_file_ = nullptr;
+    return false;
+}
+
+bool WavFileAudioCodec::OpenOutput(const std::string& path) {
+    output_file_ = fopen(path.c_str(), "wb");
+    if (output_file_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create %s", path.c_str());
+        return false;
+    }
+
+    // Sizes are patched in FinishOutput()
+    WavFormat format = {
+        .audio_format = 1,
+        .channels = 1,
+        .sample_rate = (uint32_t)output_sample_rate_,
+        .byte_rate = (uint32_t)output_sample_rate_ * 2,
+        .block_align = 2,
+        .bits_per_sample = 16,
+    };
+    WavChunkHeader riff = {{'R', 'I', 'F', 'F'}, 0};
+    WavChunkHeader fmt = {{'f', 'm', 't', ' '}, sizeof(format)};
+    WavChunkHeader data = {{'d', 'a', 't', 'a'}, 0};
+    fwrite(&riff, 1, sizeof(riff), output_file_);
+    fwrite("WAVE", 1, 4, output_file_);
+    fwrite(&fmt, 1, sizeof(fmt), output_file_);
+    fwrite(&format, 1, sizeof(format), output_file_);
+    fwrite(&data, 1, sizeof(data), output_file_);
+    return true;
+}
+
+void WavFileAudioCodec::FinishOutput() {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    if (output_file_ == nullptr) {
+        return;
+    }
+
+    uint32_t riff_size = 4 + sizeof(WavChunkHeader) + sizeof(WavFormat) + sizeof(WavChunkHeader) + output_bytes_;
+    fseek(output_file_, 4, SEEK_SET);
+    fwrite(&riff_size, 1, sizeof(riff_size), output_file_);
+    fseek(output_file_, 12 + sizeof(WavChunkHeader) + sizeof(WavFormat) + 4, SEEK_SET);
+    fwrite(&output_bytes_, 1, sizeof(output_bytes_), output_file_);
+    fclose(output_file_);
+    output_file_ = nullptr;
+    ESP_LOGI(TAG, "Wrote %lu bytes of output", output_bytes_);
+}
+
+void WavFileAudioCodec::Pace(int64_t& start_time, int64_t samples, int sample_rate) {
+    int64_t now = esp_timer_get_time();
+    int64_t due = start_time + samples * 1000000 / ((int64_t)sample_rate * speed_);
+    if (start_time == 0 || now - due > WAV_FILE_MAX_LAG_US) {
+        start_time = now - samples * 1000000 / ((int64_t)sample_rate * speed_);
+        return;
+    }
+    if (due > now) {
+        vTaskDelay(pdMS_TO_TICKS((due - now) / 1000) + 1);
+    }
+}
+
+int WavFileAudioCodec::Read(int16_t* dest, int samples) {
+    int read = 0;
+    if (input_file_ != nullptr && input_remaining_ > 0) {
+        size_t bytes = std::min<size_t>(samples * sizeof(int16_t), input_remaining_);
+        read = fread(dest, sizeof(int16_t), bytes / sizeof(int16_t), input_file_);
+        input_remaining_ = read > 0 ? input_remaining_ - read * sizeof(int16_t) : 0;
+        if (input_remaining_ == 0) {
+            ESP_LOGI(TAG, "Input file finished");
+        }
+    }
+    memset(dest + read, 0, (samples - read) * sizeof(int16_t));
+
+    input_samples_ += samples;
+    Pace(input_start_time_, input_samples_, input_sample_rate_);
+    return samples;
+}
+
+int WavFileAudioCodec::Write(const int16_t* data, int samples) {
+    {
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        if (output_file_ != nullptr) {
+            output_bytes_ += fwrite(data, sizeof(int16_t), samples, output_file_) * sizeof(int16_t);
+        }
+    }
+
+    output_samples_ += samples;
+    Pace(output_start_time_, output_samples_, output_sample_rate_);
+    return samples;
+}
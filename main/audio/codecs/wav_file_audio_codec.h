@@ -0,0 +1,45 @@
+#ifndef _WAV_FILE_AUDIO_CODEC_H
+#define _WAV_FILE_AUDIO_CODEC_H
+
+#include "audio_codec.h"
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+/*
+ * Codec backed by WAV files instead of I2S, for reproducible pipeline measurements.
+ *
+ * The microphone reads a 16-bit mono WAV file (silence once it runs out) and the speaker writes
+ * another one, with the data size patched in when the codec is destroyed. Both sides block like a
+ * DMA channel would, at speed times real time. Paths usually live on the SD card or SPIFFS mount.
+ */
+class WavFileAudioCodec : public AudioCodec {
+private:
+    FILE* input_file_ = nullptr;
+    FILE* output_file_ = nullptr;
+    std::mutex output_mutex_;
+    size_t input_remaining_ = 0;     // Bytes of PCM left in the input file
+    uint32_t output_bytes_ = 0;
+    int speed_;
+    int64_t input_start_time_ = 0;
+    int64_t input_samples_ = 0;
+    int64_t output_start_time_ = 0;
+    int64_t output_samples_ = 0;
+
+    bool OpenInput(const std::string& path);
+    bool OpenOutput(const std::string& path);
+    void FinishOutput();
+    void Pace(int64_t& start_time, int64_t samples, int sample_rate);
+
+    virtual int Read(int16_t* dest, int samples) override;
+    virtual int Write(const int16_t* data, int samples) override;
+
+public:
+    WavFileAudioCodec(const std::string& input_path, const std::string& output_path, int output_sample_rate, int speed = 1);
+    virtual ~WavFileAudioCodec();
+
+    inline bool input_finished() const { return input_remaining_ == 0; }
+};
+
+#endif // _WAV_FILE_AUDIO_CODEC_H
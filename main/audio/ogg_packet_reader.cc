@@ -0,0 +1,123 @@
+#include "ogg_packet_reader.h"
+
+#include <esp_log.h>
+#include <cstring>
+
+#define TAG "OggPacketReader"
+
+bool OggPacketReader::Open(const uint8_t* data, size_t size, const OggSoundIndex* index) {
+    data_ = data;
+    size_ = size;
+    index_ = index;
+    next_packet_ = 0;
+    page_offset_ = 0;
+    page_loaded_ = false;
+
+    if (index_ != nullptr) {
+        sample_rate_ = index_->sample_rate;
+        frame_duration_ = index_->frame_duration;
+        return true;
+    }
+
+    // Unindexed: the first two packets are OpusHead and OpusTags
+    sample_rate_ = 16000;
+    frame_duration_ = 60;
+    const uint8_t* packet;
+    size_t packet_size;
+    if (!NextInPages(packet, packet_size) || packet_size < 16 || std::memcmp(packet, "OpusHead", 8) != 0) {
+        ESP_LOGE(TAG, "OpusHead not found");
+        Close();
+        return false;
+    }
+    // [8] version, [9] channel_count, [10-11] pre_skip, [12-15] input_sample_rate (little-endian)
+    sample_rate_ = packet[12] | (packet[13] << 8) | (packet[14] << 16) | (packet[15] << 24);
+    if (!NextInPages(packet, packet_size) || packet_size < 8 || std::memcmp(packet, "OpusTags", 8) != 0) {
+        ESP_LOGW(TAG, "OpusTags not found");
+    }
+    return true;
+}
+
+void OggPacketReader::Close() {
+    data_ = nullptr;
+    size_ = 0;
+    index_ = nullptr;
+}
+
+bool OggPacketReader::Next(const uint8_t*& packet, size_t& size) {
+    if (data_ == nullptr) {
+        return false;
+    }
+    if (index_ != nullptr) {
+        if (next_packet_ >= index_->packet_count) {
+            return false;
+        }
+        auto& ref = index_->packets[next_packet_++];
+        // A table generated from another version of the file must not point past its end
+        if (ref.offset > size_ || ref.size > size_ - ref.offset) {
+            ESP_LOGE(TAG, "Packet %u is outside the sound (%u bytes)", (unsigned)(next_packet_ - 1), (unsigned)size_);
+            Close();
+            return false;
+        }
+        packet = data_ + ref.offset;
+        size = ref.size;
+        return true;
+    }
+    return NextInPages(packet, size);
+}
+
+bool OggPacketReader::LoadPage() {
+    // Pages are contiguous, only search for the capture pattern if the next one is not where expected
+    while (page_offset_ + 27 <= size_ && std::memcmp(data_ + page_offset_, "OggS", 4) != 0) {
+        page_offset_++;
+    }
+    if (page_offset_ + 27 > size_) {
+        return false;
+    }
+
+    const uint8_t* page = data_ + page_offset_;
+    page_segments_ = page[26];
+    cursor_ = page_offset_ + 27 + page_segments_;
+    if (cursor_ > size_) {
+        return false;
+    }
+    page_end_ = cursor_;
+    for (size_t i = 0; i < page_segments_; ++i) {
+        page_end_ += page[27 + i];
+    }
+    if (page_end_ > size_) {
+        return false;
+    }
+    segment_ = 0;
+    page_loaded_ = true;
+    return true;
+}
+
+bool OggPacketReader::NextInPages(const uint8_t*& packet, size_t& size) {
+    while (true) {
+        if (!page_loaded_ && !LoadPage()) {
+            return false;
+        }
+
+        // Parse packets using lacing
+        const uint8_t* lacing = data_ + page_offset_ + 27;
+        while (segment_ < page_segments_) {
+            size_t start = cursor_;
+            size_t length = 0;
+            uint8_t value;
+            do {
+                value = lacing[segment_++];
+                length += value;
+            } while (value == 255 && segment_ < page_segments_);
+            cursor_ += length;
+
+            if (length > 0) {
+                packet = data_ + start;
+                size = length;
+                return true;
+            }
+        }
+
+        page_offset_ = page_end_;
+        page_loaded_ = false;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef OGG_PACKET_READER_H
+#define OGG_PACKET_READER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ogg_sound_index.h"
+
+/*
+ * Walks the Opus packets of an Ogg file in place, without copying them.
+ *
+ * With a build-time OggSoundIndex it just follows the packet table. Without one it walks the
+ * Ogg pages one at a time while playing, so even unindexed sounds never need a full scan up front.
+ */
+class OggPacketReader {
+public:
+    // Returns false if no OpusHead is found in an unindexed file
+    bool Open(const uint8_t* data, size_t size, const OggSoundIndex* index);
+    void Close();
+    // Points packet into the Ogg data, returns false at the end of the file
+    bool Next(const uint8_t*& packet, size_t& size);
+
+    inline bool active() const { return data_ != nullptr; }
+    inline int sample_rate() const { return sample_rate_; }
+    inline int frame_duration() const { return frame_duration_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    const OggSoundIndex* index_ = nullptr;
+    size_t next_packet_ = 0;
+    int sample_rate_ = 16000;
+    int frame_duration_ = 60;
+
+    // Page walking state for unindexed files
+    size_t page_offset_ = 0;
+    size_t page_end_ = 0;
+    size_t cursor_ = 0;
+    uint8_t page_segments_ = 0;
+    uint8_t segment_ = 0;
+    bool page_loaded_ = false;
+
+    bool LoadPage();
+    bool NextInPages(const uint8_t*& packet, size_t& size);
+};
+
+#endif // OGG_PACKET_READER_H
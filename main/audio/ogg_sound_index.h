@@ -0,0 +1,22 @@
+#ifndef OGG_SOUND_INDEX_H
+#define OGG_SOUND_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+// One Opus packet inside an embedded Ogg file
+struct OggPacketRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+// Packet table of an embedded sound, generated by scripts/gen_lang.py
+struct OggSoundIndex {
+    const char* data;
+    int sample_rate;
+    int frame_duration;
+    const OggPacketRef* packets;
+    size_t packet_count;
+};
+
+#endif // OGG_SOUND_INDEX_H
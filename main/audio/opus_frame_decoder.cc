@@ -0,0 +1,60 @@
+#include "opus_frame_decoder.h"
+
+#include <esp_log.h>
+#include <opus.h>
+
+#define TAG "OpusFrameDecoder"
+
+OpusFrameDecoder::OpusFrameDecoder(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), channels_(channels), duration_ms_(duration_ms) {
+    int error;
+    decoder_ = opus_decoder_create(sample_rate, channels, &error);
+    if (decoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio decoder, error code: %d", error);
+        return;
+    }
+    frame_size_ = sample_rate / 1000 * channels * duration_ms;
+}
+
+OpusFrameDecoder::~OpusFrameDecoder() {
+    if (decoder_ != nullptr) {
+        opus_decoder_destroy(decoder_);
+    }
+}
+
+bool OpusFrameDecoder::Decode(const uint8_t* opus, size_t size, std::vector<int16_t>& pcm) {
+    return DecodeInternal(opus, size, pcm, 0);
+}
+
+bool OpusFrameDecoder::DecodeFec(const uint8_t* next_opus, size_t size, std::vector<int16_t>& pcm) {
+    return DecodeInternal(next_opus, size, pcm, 1);
+}
+
+bool OpusFrameDecoder::Conceal(std::vector<int16_t>& pcm) {
+    // A null packet makes libopus extrapolate one frame from its current state
+    return DecodeInternal(nullptr, 0, pcm, 0);
+}
+
+void OpusFrameDecoder::ResetState() {
+    if (decoder_ != nullptr) {
+        opus_decoder_ctl(decoder_, OPUS_RESET_STATE);
+    }
+}
+
+bool OpusFrameDecoder::DecodeInternal(const uint8_t* opus, size_t size, std::vector<int16_t>& pcm, int decode_fec) {
+    if (decoder_ == nullptr) {
+        ESP_LOGE(TAG, "Audio decoder is not configured");
+        return false;
+    }
+
+    pcm.resize(frame_size_);
+    // For FEC and PLC the frame size must be exactly the duration of the missing frame
+    int ret = opus_decode(decoder_, opus, size, pcm.data(), frame_size_ / channels_, decode_fec);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to decode audio, error code: %d", ret);
+        pcm.clear();
+        return false;
+    }
+    pcm.resize(ret * channels_);
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef OPUS_FRAME_DECODER_H
+#define OPUS_FRAME_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct OpusDecoder;
+
+/*
+ * Thin libopus decoder for the playback path.
+ *
+ * Unlike OpusDecoderWrapper it can also synthesize a missing frame, either from the
+ * in-band FEC data of the following packet or with packet loss concealment, which the
+ * jitter buffer asks for when a packet never arrives. Only used from the opus codec task.
+ */
+class OpusFrameDecoder {
+public:
+    OpusFrameDecoder(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusFrameDecoder();
+
+    OpusFrameDecoder(const OpusFrameDecoder&) = delete;
+    OpusFrameDecoder& operator=(const OpusFrameDecoder&) = delete;
+
+    bool Decode(const uint8_t* opus, size_t size, std::vector<int16_t>& pcm);
+    // Recover the frame before this packet from its in-band FEC data
+    bool DecodeFec(const uint8_t* next_opus, size_t size, std::vector<int16_t>& pcm);
+    // Packet loss concealment for one frame
+    bool Conceal(std::vector<int16_t>& pcm);
+    void ResetState();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+
+private:
+    OpusDecoder* decoder_ = nullptr;
+    int sample_rate_;
+    int channels_;
+    int duration_ms_;
+    int frame_size_ = 0;
+
+    bool DecodeInternal(const uint8_t* opus, size_t size, std::vector<int16_t>& pcm, int decode_fec);
+};
+
+#endif // OPUS_FRAME_DECODER_H
@@ -0,0 +1,92 @@
+#include "opus_frame_encoder.h"
+
+#include <esp_log.h>
+#include <opus.h>
+
+#include <algorithm>
+
+#define TAG "OpusFrameEncoder"
+
+// Upper bound for one Opus frame at any bitrate we negotiate
+#define MAX_OPUS_PACKET_SIZE 1000
+
+size_t OpusFrameEncoder::MaxPacketSize(int sample_rate, int channels, int duration_ms, int bitrate) {
+    if (bitrate <= 0) {
+        // What libopus picks for OPUS_AUTO
+        bitrate = 60 * 1000 / duration_ms + sample_rate * channels;
+    }
+    size_t average = (size_t)bitrate * duration_ms / 8000;
+    return std::min<size_t>(average * 2, MAX_OPUS_PACKET_SIZE);
+}
+
+OpusFrameEncoder::OpusFrameEncoder(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), channels_(channels), duration_ms_(duration_ms) {
+    int error;
+    encoder_ = opus_encoder_create(sample_rate, channels, OPUS_APPLICATION_VOIP, &error);
+    if (encoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", error);
+        return;
+    }
+    opus_encoder_ctl(encoder_, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+    frame_size_ = sample_rate / 1000 * channels * duration_ms;
+    max_packet_size_ = MaxPacketSize(sample_rate, channels, duration_ms, 0);
+}
+
+OpusFrameEncoder::~OpusFrameEncoder() {
+    if (encoder_ != nullptr) {
+        opus_encoder_destroy(encoder_);
+    }
+}
+
+bool OpusFrameEncoder::Encode(const int16_t* pcm, size_t samples, std::vector<uint8_t>& opus, size_t headroom) {
+    if (encoder_ == nullptr) {
+        ESP_LOGE(TAG, "Audio encoder is not configured");
+        return false;
+    }
+    if (samples != frame_size_) {
+        ESP_LOGE(TAG, "Frame has %u samples, expected %u", samples, frame_size_);
+        return false;
+    }
+
+    opus.resize(headroom + max_packet_size_);
+    int ret = opus_encode(encoder_, pcm, frame_size_ / channels_, opus.data() + headroom, max_packet_size_);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to encode audio, error code: %d", ret);
+        opus.clear();
+        return false;
+    }
+    opus.resize(headroom + ret);
+    return true;
+}
+
+void OpusFrameEncoder::SetBitrate(int bitrate) {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate > 0 ? bitrate : OPUS_AUTO));
+    }
+    max_packet_size_ = MaxPacketSize(sample_rate_, channels_, duration_ms_, bitrate);
+}
+
+void OpusFrameEncoder::SetComplexity(int complexity) {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity));
+    }
+}
+
+void OpusFrameEncoder::SetInbandFec(bool enable, int packet_loss_percent) {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_INBAND_FEC(enable ? 1 : 0));
+        opus_encoder_ctl(encoder_, OPUS_SET_PACKET_LOSS_PERC(enable ? packet_loss_percent : 0));
+    }
+}
+
+void OpusFrameEncoder::SetDtx(bool enable) {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_DTX(enable ? 1 : 0));
+    }
+}
+
+void OpusFrameEncoder::ResetState() {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_RESET_STATE);
+    }
+}
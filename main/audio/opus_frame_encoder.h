@@ -0,0 +1,53 @@
+#ifndef OPUS_FRAME_ENCODER_H
+#define OPUS_FRAME_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct OpusEncoder;
+
+/*
+ * Thin libopus encoder for the uplink.
+ *
+ * Unlike OpusEncoderWrapper it encodes one caller-owned frame at a time into a caller-owned
+ * buffer, and exposes the bitrate, complexity and FEC knobs so they can follow the negotiated
+ * audio parameters at runtime. Only used from the opus encode task.
+ */
+class OpusFrameEncoder {
+public:
+    OpusFrameEncoder(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusFrameEncoder();
+
+    OpusFrameEncoder(const OpusFrameEncoder&) = delete;
+    OpusFrameEncoder& operator=(const OpusFrameEncoder&) = delete;
+
+    // Largest packet one frame can take at this bitrate (0 = the libopus automatic rate), about twice the
+    // average so VBR peaks still fit. Encode() caps frames at it, so packet buffers can be sized to match
+    static size_t MaxPacketSize(int sample_rate, int channels, int duration_ms, int bitrate);
+
+    // samples must be exactly one frame, the packet is written after headroom bytes left for a transport header
+    bool Encode(const int16_t* pcm, size_t samples, std::vector<uint8_t>& opus, size_t headroom = 0);
+    // 0 lets libopus pick the bitrate
+    void SetBitrate(int bitrate);
+    void SetComplexity(int complexity);
+    // In-band FEC only kicks in when the expected loss is above zero
+    void SetInbandFec(bool enable, int packet_loss_percent);
+    void SetDtx(bool enable);
+    void ResetState();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+    inline size_t frame_size() const { return frame_size_; }
+    inline size_t max_packet_size() const { return max_packet_size_; }
+
+private:
+    OpusEncoder* encoder_ = nullptr;
+    int sample_rate_;
+    int channels_;
+    int duration_ms_;
+    size_t frame_size_ = 0;
+    size_t max_packet_size_ = 0;
+};
+
+#endif // OPUS_FRAME_ENCODER_H
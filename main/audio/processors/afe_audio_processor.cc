@@ -10,6 +10,11 @@ AfeAudioProcessor::AfeAudioProcessor()
     event_group_ = xEventGroupCreate();
 }
 
+void AfeAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    // Picked up by the processor task on its next fetch
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
 void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
     codec_ = codec;
     frame_samples_ = frame_duration_ms * 16000 / 1000;
@@ -88,11 +93,16 @@ size_t AfeAudioProcessor::GetFeedSize() {
     return afe_iface_->get_feed_chunksize(afe_data_);
 }
 
-void AfeAudioProcessor::Feed(std::vector<int16_t>&& data) {
+void AfeAudioProcessor::Feed(const AudioInputFrame& frame) {
     if (afe_data_ == nullptr) {
         return;
     }
-    afe_iface_->feed(afe_data_, data.data());
+    if (frame.channels() == 1) {
+        afe_iface_->feed(afe_data_, frame.mic.data());
+        return;
+    }
+    frame.Interleave(feed_buffer_);
+    afe_iface_->feed(afe_data_, feed_buffer_.data());
 }
 
 void AfeAudioProcessor::Start() {
@@ -110,7 +120,7 @@ bool AfeAudioProcessor::IsRunning() {
     return xEventGroupGetBits(event_group_) & PROCESSOR_RUNNING;
 }
 
-void AfeAudioProcessor::OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) {
+void AfeAudioProcessor::OnOutput(std::function<void(std::span<const int16_t> data)> callback) {
     output_callback_ = callback;
 }
 
@@ -155,19 +165,14 @@ void AfeAudioProcessor::AudioProcessorTask() {
             // Add data to buffer
             output_buffer_.insert(output_buffer_.end(), res->data, res->data + samples);
             
-            // Output complete frames when buffer has enough data
-            while (output_buffer_.size() >= frame_samples_) {
-                if (output_buffer_.size() == frame_samples_) {
-                    // If buffer size equals frame size, move the entire buffer
-                    output_callback_(std::move(output_buffer_));
-                    output_buffer_.clear();
-                    output_buffer_.reserve(frame_samples_);
-                } else {
-                    // If buffer size exceeds frame size, copy one frame and remove it
-                    output_callback_(std::vector<int16_t>(output_buffer_.begin(), output_buffer_.begin() + frame_samples_));
-                    output_buffer_.erase(output_buffer_.begin(), output_buffer_.begin() + frame_samples_);
-                }
+            // Output complete frames when buffer has enough data, the buffer keeps its capacity
+            size_t frame_samples = frame_samples_;
+            size_t offset = 0;
+            while (output_buffer_.size() - offset >= frame_samples) {
+                output_callback_(std::span<const int16_t>(output_buffer_.data() + offset, frame_samples));
+                offset += frame_samples;
             }
+            output_buffer_.erase(output_buffer_.begin(), output_buffer_.begin() + offset);
         }
     }
 }
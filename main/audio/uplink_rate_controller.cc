@@ -0,0 +1,103 @@
+#include "uplink_rate_controller.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "UplinkRate"
+
+struct UplinkLevel {
+    int bitrate;        // Upper bound, 0 keeps the negotiated bitrate
+    int loss_percent;   // 0 turns FEC off
+    const char* name;
+};
+
+static const UplinkLevel kUplinkLevels[] = {
+    {0, 0, "full"},
+    {16000, 10, "reduced"},
+    {12000, 20, "low"},
+    {8000, 30, "minimum"},
+};
+static const int kUplinkLevelCount = sizeof(kUplinkLevels) / sizeof(kUplinkLevels[0]);
+
+UplinkRateController::UplinkRateController(int min_complexity, int max_complexity)
+    : min_complexity_(min_complexity), max_complexity_(std::max(min_complexity, max_complexity)) {
+    point_.complexity = min_complexity_;
+    SetLevel(0);
+}
+
+void UplinkRateController::SetBaseBitrate(int bitrate) {
+    base_bitrate_ = bitrate;
+    clean_windows_ = 0;
+    point_.complexity = min_complexity_;
+    SetLevel(0);
+}
+
+void UplinkRateController::SetLevel(int level) {
+    auto& entry = kUplinkLevels[level];
+    point_.level = level;
+    point_.name = entry.name;
+    if (entry.bitrate == 0) {
+        point_.bitrate = base_bitrate_;
+    } else {
+        point_.bitrate = base_bitrate_ > 0 ? std::min(base_bitrate_, entry.bitrate) : entry.bitrate;
+    }
+    point_.fec = entry.loss_percent > 0;
+    point_.loss_percent = entry.loss_percent;
+}
+
+bool UplinkRateController::OnFrame(size_t send_queue_depth, size_t send_queue_capacity, uint32_t send_failures,
+    int encode_us, int frame_us) {
+    window_max_depth_ = std::max(window_max_depth_, send_queue_depth);
+    window_encode_us_ += encode_us;
+    window_frame_us_ += frame_us;
+    if (++window_frames_ < UPLINK_RATE_WINDOW_FRAMES) {
+        return false;
+    }
+
+    uint32_t failures = send_failures - last_send_failures_;
+    last_send_failures_ = send_failures;
+    // Half a queue of backlog means the link drains slower than the encoder fills it
+    bool congested = failures > 0 || window_max_depth_ * 2 >= send_queue_capacity;
+    bool clean = failures == 0 && window_max_depth_ <= 2;
+    int encode_percent = window_frame_us_ > 0 ? window_encode_us_ * 100 / window_frame_us_ : 0;
+    size_t max_depth = window_max_depth_;
+    window_frames_ = 0;
+    window_max_depth_ = 0;
+    window_encode_us_ = 0;
+    window_frame_us_ = 0;
+
+    auto previous = point_;
+    if (congested) {
+        clean_windows_ = 0;
+        if (point_.level + 1 < kUplinkLevelCount) {
+            SetLevel(point_.level + 1);
+        }
+    } else if (clean) {
+        if (++clean_windows_ >= UPLINK_RATE_RECOVER_WINDOWS && point_.level > 0) {
+            clean_windows_ = 0;
+            SetLevel(point_.level - 1);
+        }
+    } else {
+        clean_windows_ = 0;
+    }
+
+    if (encode_percent > 50 && point_.complexity > min_complexity_) {
+        point_.complexity--;
+    } else if (point_.level > 0 && encode_percent < 25 && point_.complexity < max_complexity_) {
+        point_.complexity++;
+    } else if (point_.level == 0 && point_.complexity > min_complexity_) {
+        point_.complexity--;
+    }
+
+    if (point_.level == previous.level && point_.complexity == previous.complexity) {
+        return false;
+    }
+    if (point_.level == previous.level) {
+        ESP_LOGD(TAG, "Complexity %d -> %d (encode %d%%)", previous.complexity, point_.complexity, encode_percent);
+        return true;
+    }
+    ESP_LOGI(TAG, "%s -> %s: bitrate %d, complexity %d, fec %d%% (queue max %u/%u, %lu send failures, encode %d%%)",
+        previous.name, point_.name, point_.bitrate, point_.complexity, point_.fec ? point_.loss_percent : 0,
+        (unsigned)max_depth, (unsigned)send_queue_capacity, failures, encode_percent);
+    return true;
+}
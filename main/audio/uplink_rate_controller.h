@@ -0,0 +1,58 @@
+#ifndef UPLINK_RATE_CONTROLLER_H
+#define UPLINK_RATE_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define UPLINK_RATE_WINDOW_FRAMES    16  // Frames per decision, about 1 s of 60 ms frames
+#define UPLINK_RATE_RECOVER_WINDOWS  4   // Clean windows in a row before stepping back up
+#define UPLINK_RATE_MAX_COMPLEXITY   5   // Highest complexity tried when the bitrate is reduced
+
+struct UplinkOperatingPoint {
+    int level = 0;          // 0 is the negotiated quality, higher levels protect a congested link
+    int bitrate = 0;        // 0 lets libopus pick
+    int complexity = 0;
+    bool fec = false;
+    int loss_percent = 0;   // Expected loss the FEC is tuned for
+    const char* name = "full";
+};
+
+/*
+ * Picks the uplink Opus operating point from what the encode task can observe.
+ *
+ * Every UPLINK_RATE_WINDOW_FRAMES frames it looks at the deepest send queue and the send failures
+ * of the window. A congested window steps one level down at once (lower bitrate, in-band FEC with
+ * a higher expected loss), stepping back up needs UPLINK_RATE_RECOVER_WINDOWS clean windows, so a
+ * marginal link does not flap. Complexity follows the spare encode time: lower bitrates get more
+ * complexity while the encoder stays under a quarter of real time, and it drops again above half.
+ *
+ * Not thread safe, owned by the opus encode task.
+ */
+class UplinkRateController {
+public:
+    UplinkRateController(int min_complexity, int max_complexity);
+
+    // Negotiated bitrate, 0 for the encoder default. Resets to the full quality level.
+    void SetBaseBitrate(int bitrate);
+    // Once per frame sent to the network. send_failures is a running total. True if the point changed.
+    bool OnFrame(size_t send_queue_depth, size_t send_queue_capacity, uint32_t send_failures, int encode_us, int frame_us);
+
+    const UplinkOperatingPoint& point() const { return point_; }
+
+private:
+    int min_complexity_;
+    int max_complexity_;
+    int base_bitrate_ = 0;
+    UplinkOperatingPoint point_;
+
+    uint32_t window_frames_ = 0;
+    size_t window_max_depth_ = 0;
+    uint64_t window_encode_us_ = 0;
+    uint64_t window_frame_us_ = 0;
+    uint32_t last_send_failures_ = 0;
+    int clean_windows_ = 0;
+
+    void SetLevel(int level);
+};
+
+#endif // UPLINK_RATE_CONTROLLER_H
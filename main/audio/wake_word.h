@@ -7,13 +7,14 @@
 
 #include <model_path.h>
 #include "audio_codec.h"
+#include "audio_input_frame.h"
 
 class WakeWord {
 public:
     virtual ~WakeWord() = default;
     
     virtual bool Initialize(AudioCodec* codec, srmodel_list_t* models_list) = 0;
-    virtual void Feed(const std::vector<int16_t>& data) = 0;
+    virtual void Feed(const AudioInputFrame& frame) = 0;
     virtual void OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback) = 0;
     virtual void Start() = 0;
     virtual void Stop() = 0;
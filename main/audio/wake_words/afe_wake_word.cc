@@ -1,7 +1,9 @@
 #include "afe_wake_word.h"
 #include "audio_service.h"
+#include "opus_frame_encoder.h"
 
 #include <esp_log.h>
+#include <algorithm>
 #include <sstream>
 
 #define DETECTION_RUNNING_EVENT 1
@@ -105,11 +107,16 @@ void AfeWakeWord::Stop() {
     }
 }
 
-void AfeWakeWord::Feed(const std::vector<int16_t>& data) {
+void AfeWakeWord::Feed(const AudioInputFrame& frame) {
     if (afe_data_ == nullptr) {
         return;
     }
-    afe_iface_->feed(afe_data_, data.data());
+    if (frame.channels() == 1) {
+        afe_iface_->feed(afe_data_, frame.mic.data());
+        return;
+    }
+    frame.Interleave(feed_buffer_);
+    afe_iface_->feed(afe_data_, feed_buffer_.data());
 }
 
 size_t AfeWakeWord::GetFeedSize() {
@@ -172,17 +179,30 @@ void AfeWakeWord::EncodeWakeWordData() {
         auto this_ = (AfeWakeWord*)arg;
         {
             auto start_time = esp_timer_get_time();
-            auto encoder = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
+            auto encoder = std::make_unique<OpusFrameEncoder>(16000, 1, OPUS_FRAME_DURATION_MS);
             encoder->SetComplexity(0); // 0 is the fastest
 
+            // Frames are encoded behind the same headroom as the uplink, so SendAudio writes its header in place
+            std::vector<int16_t> frame;
+            frame.reserve(encoder->frame_size());
             int packets = 0;
             for (auto& pcm: this_->wake_word_pcm_) {
-                encoder->Encode(std::move(pcm), [this_](std::vector<uint8_t>&& opus) {
-                    std::lock_guard<std::mutex> lock(this_->wake_word_mutex_);
-                    this_->wake_word_opus_.emplace_back(std::move(opus));
-                    this_->wake_word_cv_.notify_all();
-                });
-                packets++;
+                for (size_t offset = 0; offset < pcm.size();) {
+                    size_t count = std::min(pcm.size() - offset, encoder->frame_size() - frame.size());
+                    frame.insert(frame.end(), pcm.begin() + offset, pcm.begin() + offset + count);
+                    offset += count;
+                    if (frame.size() < encoder->frame_size()) {
+                        continue;
+                    }
+                    std::vector<uint8_t> opus;
+                    if (encoder->Encode(frame.data(), frame.size(), opus, AUDIO_PACKET_HEADROOM)) {
+                        std::lock_guard<std::mutex> lock(this_->wake_word_mutex_);
+                        this_->wake_word_opus_.emplace_back(std::move(opus));
+                        this_->wake_word_cv_.notify_all();
+                        packets++;
+                    }
+                    frame.clear();
+                }
             }
             this_->wake_word_pcm_.clear();
 
@@ -1,9 +1,11 @@
 #include "custom_wake_word.h"
 #include "audio_service.h"
+#include "opus_frame_encoder.h"
 #include "system_info.h"
 #include "assets.h"
 
 #include <esp_log.h>
+#include <algorithm>
 #include <esp_mn_iface.h>
 #include <esp_mn_models.h>
 #include <esp_mn_speech_commands.h>
@@ -142,25 +144,14 @@ void CustomWakeWord::Stop() {
     running_ = false;
 }
 
-void CustomWakeWord::Feed(const std::vector<int16_t>& data) {
+void CustomWakeWord::Feed(const AudioInputFrame& frame) {
     if (multinet_model_data_ == nullptr || !running_) {
         return;
     }
 
-    esp_mn_state_t mn_state;
-    // If input channels is 2, we need to fetch the left channel data
-    if (codec_->input_channels() == 2) {
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
-        }
-
-        StoreWakeWordData(mono_data);
-        mn_state = multinet_->detect(multinet_model_data_, const_cast<int16_t*>(mono_data.data()));
-    } else {
-        StoreWakeWordData(data);
-        mn_state = multinet_->detect(multinet_model_data_, const_cast<int16_t*>(data.data()));
-    }
+    // MultiNet takes the first microphone channel only
+    StoreWakeWordData(frame.mic);
+    esp_mn_state_t mn_state = multinet_->detect(multinet_model_data_, const_cast<int16_t*>(frame.mic.data()));
     
     if (mn_state == ESP_MN_STATE_DETECTING) {
         return;
@@ -193,9 +184,9 @@ size_t CustomWakeWord::GetFeedSize() {
     return multinet_->get_samp_chunksize(multinet_model_data_);
 }
 
-void CustomWakeWord::StoreWakeWordData(const std::vector<int16_t>& data) {
+void CustomWakeWord::StoreWakeWordData(std::span<const int16_t> data) {
     // store audio data to wake_word_pcm_
-    wake_word_pcm_.push_back(data);
+    wake_word_pcm_.emplace_back(data.begin(), data.end());
     // keep about 2 seconds of data, detect duration is 30ms (sample_rate == 16000, chunksize == 512)
     while (wake_word_pcm_.size() > 2000 / 30) {
         wake_word_pcm_.pop_front();
@@ -218,17 +209,30 @@ void CustomWakeWord::EncodeWakeWordData() {
         auto this_ = (CustomWakeWord*)arg;
         {
             auto start_time = esp_timer_get_time();
-            auto encoder = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
+            auto encoder = std::make_unique<OpusFrameEncoder>(16000, 1, OPUS_FRAME_DURATION_MS);
             encoder->SetComplexity(0); // 0 is the fastest
 
+            // Frames are encoded behind the same headroom as the uplink, so SendAudio writes its header in place
+            std::vector<int16_t> frame;
+            frame.reserve(encoder->frame_size());
             int packets = 0;
             for (auto& pcm: this_->wake_word_pcm_) {
-                encoder->Encode(std::move(pcm), [this_](std::vector<uint8_t>&& opus) {
-                    std::lock_guard<std::mutex> lock(this_->wake_word_mutex_);
-                    this_->wake_word_opus_.emplace_back(std::move(opus));
-                    this_->wake_word_cv_.notify_all();
-                });
-                packets++;
+                for (size_t offset = 0; offset < pcm.size();) {
+                    size_t count = std::min(pcm.size() - offset, encoder->frame_size() - frame.size());
+                    frame.insert(frame.end(), pcm.begin() + offset, pcm.begin() + offset + count);
+                    offset += count;
+                    if (frame.size() < encoder->frame_size()) {
+                        continue;
+                    }
+                    std::vector<uint8_t> opus;
+                    if (encoder->Encode(frame.data(), frame.size(), opus, AUDIO_PACKET_HEADROOM)) {
+                        std::lock_guard<std::mutex> lock(this_->wake_word_mutex_);
+                        this_->wake_word_opus_.emplace_back(std::move(opus));
+                        this_->wake_word_cv_.notify_all();
+                        packets++;
+                    }
+                    frame.clear();
+                }
             }
             this_->wake_word_pcm_.clear();
 
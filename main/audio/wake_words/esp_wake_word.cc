@@ -66,7 +66,7 @@ void EspWakeWord::Stop() {
     running_ = false;
 }
 
-void EspWakeWord::Feed(const std::vector<int16_t>& data) {
+void EspWakeWord::Feed(const AudioInputFrame& frame) {
     if (wakenet_data_ == nullptr || !running_) {
         return;
     }
@@ -78,7 +78,8 @@ void EspWakeWord::Feed(const std::vector<int16_t>& data) {
         return;
     }
 
-    int res = wakenet_iface_->detect(wakenet_data_, (int16_t *)data.data());
+    // WakeNet takes the first microphone channel only
+    int res = wakenet_iface_->detect(wakenet_data_, (int16_t *)frame.mic.data());
     if (res > 0) {
         // 单帧检测到唤醒词即触发，具体灵敏度由 DET_MODE_90 控制
         last_detected_wake_word_ = wakenet_iface_->get_word_name(wakenet_data_, res);
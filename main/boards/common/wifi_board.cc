@@ -274,6 +274,12 @@ std::string WifiBoard::GetDeviceStatusJson() {
      *     "audio_speaker": {
      *         "volume": 70
      *     },
+     *     "audio_uplink": {
+     *         "level": "full",
+     *         "bitrate": 0,
+     *         "complexity": 0,
+     *         "fec": false
+     *     },
      *     "screen": {
      *         "brightness": 100,
      *         "theme": "light"
@@ -301,6 +307,15 @@ std::string WifiBoard::GetDeviceStatusJson() {
     }
     cJSON_AddItemToObject(root, "audio_speaker", audio_speaker);
 
+    // Uplink Opus operating point, bitrate 0 means chosen by the encoder
+    auto point = Application::GetInstance().GetAudioService().GetUplinkOperatingPoint();
+    auto audio_uplink = cJSON_CreateObject();
+    cJSON_AddStringToObject(audio_uplink, "level", point.name);
+    cJSON_AddNumberToObject(audio_uplink, "bitrate", point.bitrate);
+    cJSON_AddNumberToObject(audio_uplink, "complexity", point.complexity);
+    cJSON_AddBoolToObject(audio_uplink, "fec", point.fec);
+    cJSON_AddItemToObject(root, "audio_uplink", audio_uplink);
+
     // Screen brightness
     auto backlight = board.GetBacklight();
     auto screen = cJSON_CreateObject();
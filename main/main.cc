@@ -39,8 +39,8 @@ extern "C" void app_main(void)
         "\n"
         "# 动作执行规则（必须严格遵守）\n"
         "## 强制要求：\n"
-        "1. **每次回复都必须至少调用一次 self.robot.send_command 工具执行动作**，这是最重要的规则\n"
-        "2. **多个动作时，每次调用之间必须等待至少2秒**\n"
+        "1. **每次回复都必须至少执行一个动作**：单个动作调用 self.robot.send_command，多个动作调用 self.robot.run_sequence，这是最重要的规则\n"
+        "2. **多个动作时，用一次 self.robot.run_sequence 调用按顺序给出全部动作及每个动作的持续时间（一般2000毫秒），不要连续多次调用 send_command**\n"
         "3. **工具参数只能是指令代码**，如\"ksit\"、\"kwkF 3\"，绝对不能包含中文描述如\"坐下(ksit)\"\n"
         "\n"
         "## 动作选择策略：\n"
@@ -54,7 +54,7 @@ extern "C" void app_main(void)
         "\n"
         "## 特殊场景：\n"
         "- **再见/待机**：当对话结束、用户说再见、让你待机或休息时，必须先调用 self.robot.send_command 发送'd'指令让机器人休息，然后再说再见\n"
-        "- **多个任务**：用户布置多个任务时，每个任务调用一次工具，间隔2秒，简化回复\n"
+        "- **多个任务**：用户布置多个任务时，用 self.robot.run_sequence 一次调用完成全部动作，简化回复\n"
         "\n"
         "# 可用动作列表（详见 self.robot.send_command 工具说明）\n"
         "包括：基本动作（坐、站、打招呼等）、情感动作（点头、摇头、拥抱等）、技能动作（跳跃、翻滚等）、步态（前进、后退、转向等）\n";
@@ -8,16 +8,71 @@
 #include <esp_app_desc.h>
 #include <algorithm>
 #include <cstring>
-#include <esp_pthread.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
 
 #include "application.h"
 #include "display.h"
 #include "board.h"
 #include "second_uart.h"
+#include "robot_sequencer.h"
 
 #define TAG "MCP"
 
-#define DEFAULT_TOOLCALL_STACK_SIZE 6144
+#define MAX_TOOLS_LIST_PAGE_SIZE 5000  // 减小到5KB，为外层包装留空间
+
+// Steps of self.robot.run_sequence: [{"command": "kwkF", "duration_ms": 2000}, ...]
+template <>
+struct McpArgTraits<std::vector<RobotStep>> {
+    static constexpr const char* kType = "array";
+    static constexpr bool kRequired = true;
+
+    static void AddSchema(cJSON* json) {
+        cJSON* items = cJSON_CreateObject();
+        cJSON_AddStringToObject(items, "type", "object");
+        cJSON* properties = cJSON_CreateObject();
+        cJSON* command = cJSON_CreateObject();
+        cJSON_AddStringToObject(command, "type", "string");
+        cJSON_AddItemToObject(properties, "command", command);
+        cJSON* duration = cJSON_CreateObject();
+        cJSON_AddStringToObject(duration, "type", "integer");
+        cJSON_AddNumberToObject(duration, "minimum", 0);
+        cJSON_AddNumberToObject(duration, "maximum", ROBOT_STEP_MAX_DURATION_MS);
+        cJSON_AddItemToObject(properties, "duration_ms", duration);
+        cJSON_AddItemToObject(items, "properties", properties);
+        cJSON* required = cJSON_CreateArray();
+        cJSON_AddItemToArray(required, cJSON_CreateString("command"));
+        cJSON_AddItemToArray(required, cJSON_CreateString("duration_ms"));
+        cJSON_AddItemToObject(items, "required", required);
+        cJSON_AddItemToObject(json, "items", items);
+        cJSON_AddNumberToObject(json, "minItems", 1);
+        cJSON_AddNumberToObject(json, "maxItems", ROBOT_SEQUENCE_MAX_STEPS);
+    }
+
+    static bool Parse(const cJSON* value, const McpArg& arg, std::vector<RobotStep>& out, std::string& error) {
+        int size = cJSON_IsArray(value) ? cJSON_GetArraySize(value) : 0;
+        if (size == 0 || size > ROBOT_SEQUENCE_MAX_STEPS) {
+            error = std::string("Expected 1 to ") + std::to_string(ROBOT_SEQUENCE_MAX_STEPS) + " steps in " + arg.name;
+            return false;
+        }
+        out.reserve(size);
+        const cJSON* item;
+        cJSON_ArrayForEach(item, value) {
+            auto command = cJSON_GetObjectItem(item, "command");
+            auto duration = cJSON_GetObjectItem(item, "duration_ms");
+            if (!cJSON_IsString(command) || command->valuestring[0] == '\0' || !cJSON_IsNumber(duration)) {
+                error = "Step " + std::to_string(out.size()) + " needs a command and a duration_ms";
+                return false;
+            }
+            if (duration->valueint < 0 || duration->valueint > ROBOT_STEP_MAX_DURATION_MS) {
+                error = "duration_ms must be between 0 and " + std::to_string(ROBOT_STEP_MAX_DURATION_MS);
+                return false;
+            }
+            out.push_back(RobotStep{command->valuestring, duration->valueint});
+        }
+        return true;
+    }
+};
 
 McpServer::McpServer() {
 }
@@ -27,6 +82,7 @@ McpServer::~McpServer() {
         delete tool;
     }
     tools_.clear();
+    tool_index_.clear();
 }
 
 void McpServer::AddCommonTools() {
@@ -36,50 +92,42 @@ void McpServer::AddCommonTools() {
     auto original_tools = std::move(tools_);
     auto& board = Board::GetInstance();
 
-    AddTool("self.get_device_status",
+    AddTypedTool("self.get_device_status",
         "Provides the real-time information of the device, including the current status of the audio speaker, screen, network, etc.\n"
         "Use this tool for: \n"
         "1. Answering questions about current condition (e.g. what is the current volume of the audio speaker?)\n"
         "2. As the first step to control the device (e.g. turn up / down the volume of the audio speaker, etc.)",
-        PropertyList(),
-        [&board](const PropertyList& properties) -> ReturnValue {
+        [&board]() -> ReturnValue {
             return board.GetDeviceStatusJson();
         });
 
-    AddTool("self.audio_speaker.set_volume", 
+    AddTypedTool("self.audio_speaker.set_volume", 
         "Set the volume of the audio speaker. If the current volume is unknown, you must call `self.get_device_status` tool first and then call this tool.",
-        PropertyList({
-            Property("volume", kPropertyTypeInteger, 0, 100)
-        }), 
-        [&board](const PropertyList& properties) -> ReturnValue {
+        {McpArg("volume", 0, 100)},
+        [&board](int volume) -> ReturnValue {
             auto codec = board.GetAudioCodec();
-            codec->SetOutputVolume(properties["volume"].value<int>());
+            codec->SetOutputVolume(volume);
             return true;
         });
     
     auto backlight = board.GetBacklight();
     if (backlight) {
-        AddTool("self.screen.set_brightness",
+        AddTypedTool("self.screen.set_brightness",
             "Set the brightness of the screen.",
-            PropertyList({
-                Property("brightness", kPropertyTypeInteger, 0, 100)
-            }),
-            [backlight](const PropertyList& properties) -> ReturnValue {
-                uint8_t brightness = static_cast<uint8_t>(properties["brightness"].value<int>());
-                backlight->SetBrightness(brightness, true);
+            {McpArg("brightness", 0, 100)},
+            [backlight](int brightness) -> ReturnValue {
+                backlight->SetBrightness(static_cast<uint8_t>(brightness), true);
                 return true;
             });
     }
 
     auto display = board.GetDisplay();
     if (display && !display->GetTheme().empty()) {
-        AddTool("self.screen.set_theme",
+        AddTypedTool("self.screen.set_theme",
             "Set the theme of the screen. The theme can be `light` or `dark`.",
-            PropertyList({
-                Property("theme", kPropertyTypeString)
-            }),
-            [display](const PropertyList& properties) -> ReturnValue {
-                display->SetTheme(properties["theme"].value<std::string>().c_str());
+            {McpArg("theme")},
+            [display](const std::string& theme) -> ReturnValue {
+                display->SetTheme(theme.c_str());
                 return true;
             });
     }
@@ -89,14 +137,18 @@ void McpServer::AddCommonTools() {
     // Restore the original tools list to the end of the tools list
     tools_.insert(tools_.end(), original_tools.begin(), original_tools.end());
 
+    AddTypedTool("self.audio.get_latency_stats",
+        "Diagnostics: end-to-end audio latency histograms in milliseconds (p50/p95/p99/max per stage), "
+        "including wake word detected to first TTS sample played. Only use this when the user asks about latency.",
+        []() -> ReturnValue {
+            return Application::GetInstance().GetAudioService().GetLatencyMonitor().GetJson();
+        });
+
     // Robot control tool - single parameterized command interface
-    AddTool("self.robot.send_command",
+    AddTypedTool("self.robot.send_command",
         "Control Bittle robot via UART. Examples: kwkF(walk), kbk(back), kvtL/R(turn), ksit(sit), khi(hi), kup(stand), d(rest), kang(angry), khg(hug), kbf(backflip), m8 -30(left hand up)",
-        PropertyList({
-            Property("text", kPropertyTypeString)
-        }),
-        [](const PropertyList& properties) -> ReturnValue {
-            std::string text = properties["text"].value<std::string>();
+        {McpArg("text")},
+        [](const std::string& text) -> ReturnValue {
             if (text.empty()) {
                 return std::string("empty command");
             }
@@ -104,21 +156,49 @@ void McpServer::AddCommonTools() {
             ESP_LOGI(TAG, "MCP tool executed: send_command(\"%s\")", text.c_str());
             return std::string("command sent successfully");
         });
+
+    AddTypedTool("self.robot.run_sequence",
+        "Run several Bittle robot actions back to back in one call. Each step sends `command` (same codes as "
+        "self.robot.send_command) and gives it `duration_ms` before the next step, e.g. "
+        "[{\"command\":\"kwkF\",\"duration_ms\":3000},{\"command\":\"ksit\",\"duration_ms\":2000}]. "
+        "Returns at once while the device plays the steps. A new sequence replaces a running one; "
+        "the wake word or an abort cancels it.",
+        {McpArg("steps")},
+        [](const std::vector<RobotStep>& steps) -> ReturnValue {
+            int total_ms = 0;
+            for (auto& step : steps) {
+                total_ms += step.duration_ms;
+            }
+            if (!RobotSequencer::GetInstance().Start(steps)) {
+                throw std::runtime_error("Failed to start the robot sequence");
+            }
+            return "sequence started: " + std::to_string(steps.size()) + " steps, about " +
+                std::to_string(total_ms) + " ms";
+        });
+
+    AddTypedTool("self.robot.get_sequence_status",
+        "Current step of the robot sequence started by self.robot.run_sequence, step counts from 0.",
+        []() -> ReturnValue {
+            return RobotSequencer::GetInstance().GetStatusJson();
+        });
 }
 
 void McpServer::AddTool(McpTool* tool) {
     // Prevent adding duplicate tools
-    if (std::find_if(tools_.begin(), tools_.end(), [tool](const McpTool* t) { return t->name() == tool->name(); }) != tools_.end()) {
+    if (tool_index_.find(tool->name()) != tool_index_.end()) {
         ESP_LOGW(TAG, "Tool %s already added", tool->name().c_str());
+        delete tool;
         return;
     }
 
     ESP_LOGI(TAG, "Add tool: %s", tool->name().c_str());
     tools_.push_back(tool);
+    tool_index_.emplace(tool->name(), tool);
+    tools_list_dirty_ = true;
 }
 
-void McpServer::AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback) {
-    AddTool(new McpTool(name, description, properties, callback));
+void McpServer::AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback, int stack_size) {
+    AddTool(new McpTool(name, description, properties, callback, stack_size));
 }
 
 void McpServer::ParseMessage(const std::string& message) {
@@ -141,7 +221,34 @@ void McpServer::ParseCapabilities(const cJSON* capabilities) {
     }
 }
 
-void McpServer::ParseMessage(const cJSON* json) {
+void McpServer::ParseMessage(const cJSON* json, bool sequential) {
+    auto response = std::make_shared<Response>();
+    response->batch = cJSON_IsArray(json);
+    // Held until every request has been looked at, so a fast reply cannot complete the response early
+    response->pending = 1;
+    {
+        std::lock_guard<std::mutex> lock(reply_mutex_);
+        response->sequence = next_sequence_++;
+    }
+
+    if (!response->batch) {
+        HandleRequest(json, response, nullptr);
+    } else if (cJSON_GetArraySize(json) == 0) {
+        ESP_LOGE(TAG, "Empty batch");
+    } else {
+        ToolJob sequence;
+        const cJSON* item;
+        cJSON_ArrayForEach(item, json) {
+            HandleRequest(item, response, sequential ? &sequence : nullptr);
+        }
+        if (!sequence.empty()) {
+            SubmitToolJob(std::move(sequence));
+        }
+    }
+    CompleteReply(response, SIZE_MAX, std::string());
+}
+
+void McpServer::HandleRequest(const cJSON* json, const std::shared_ptr<Response>& response, ToolJob* sequence) {
     // Check JSONRPC version
     auto version = cJSON_GetObjectItem(json, "jsonrpc");
     if (version == nullptr || !cJSON_IsString(version) || strcmp(version->valuestring, "2.0") != 0) {
@@ -174,6 +281,7 @@ void McpServer::ParseMessage(const cJSON* json) {
         return;
     }
     auto id_int = id->valueint;
+    auto to = AddReply(response);
     
     if (method_str == "initialize") {
         if (cJSON_IsObject(params)) {
@@ -186,7 +294,7 @@ void McpServer::ParseMessage(const cJSON* json) {
         std::string message = "{\"protocolVersion\":\"2024-11-05\",\"capabilities\":{\"tools\":{}},\"serverInfo\":{\"name\":\"" BOARD_NAME "\",\"version\":\"";
         message += app_desc->version;
         message += "\"}}";
-        ReplyResult(id_int, message);
+        ReplyResult(to, id_int, message);
     } else if (method_str == "tools/list") {
         std::string cursor_str = "";
         if (params != nullptr) {
@@ -195,165 +303,374 @@ void McpServer::ParseMessage(const cJSON* json) {
                 cursor_str = std::string(cursor->valuestring);
             }
         }
-        GetToolsList(id_int, cursor_str);
+        GetToolsList(to, id_int, cursor_str);
     } else if (method_str == "tools/call") {
         if (!cJSON_IsObject(params)) {
             ESP_LOGE(TAG, "tools/call: Missing params");
-            ReplyError(id_int, "Missing params");
+            ReplyError(to, id_int, "Missing params");
             return;
         }
         auto tool_name = cJSON_GetObjectItem(params, "name");
         if (!cJSON_IsString(tool_name)) {
             ESP_LOGE(TAG, "tools/call: Missing name");
-            ReplyError(id_int, "Missing name");
+            ReplyError(to, id_int, "Missing name");
             return;
         }
         auto tool_arguments = cJSON_GetObjectItem(params, "arguments");
         if (tool_arguments != nullptr && !cJSON_IsObject(tool_arguments)) {
             ESP_LOGE(TAG, "tools/call: Invalid arguments");
-            ReplyError(id_int, "Invalid arguments");
+            ReplyError(to, id_int, "Invalid arguments");
             return;
         }
         auto stack_size = cJSON_GetObjectItem(params, "stackSize");
         if (stack_size != nullptr && !cJSON_IsNumber(stack_size)) {
             ESP_LOGE(TAG, "tools/call: Invalid stackSize");
-            ReplyError(id_int, "Invalid stackSize");
+            ReplyError(to, id_int, "Invalid stackSize");
             return;
         }
-        DoToolCall(id_int, std::string(tool_name->valuestring), tool_arguments, stack_size ? stack_size->valueint : DEFAULT_TOOLCALL_STACK_SIZE);
+        DoToolCall(to, id_int, std::string(tool_name->valuestring), tool_arguments,
+            stack_size ? stack_size->valueint : MCP_TOOL_WORKER_STACK_SIZE, sequence);
     } else {
         ESP_LOGE(TAG, "Method not implemented: %s", method_str.c_str());
-        ReplyError(id_int, "Method not implemented: " + method_str);
+        ReplyError(to, id_int, "Method not implemented: " + method_str);
     }
 }
 
-void McpServer::ReplyResult(int id, const std::string& result) {
+McpServer::ReplyTo McpServer::AddReply(const std::shared_ptr<Response>& response) {
+    std::lock_guard<std::mutex> lock(reply_mutex_);
+    response->replies.emplace_back();
+    response->pending++;
+    return ReplyTo{response, response->replies.size() - 1};
+}
+
+void McpServer::ReplyResult(const ReplyTo& to, int id, const std::string& result) {
     std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":";
     payload += std::to_string(id) + ",\"result\":";
     payload += result;
     payload += "}";
-    Application::GetInstance().SendMcpMessage(payload);
+    CompleteReply(to.response, to.index, std::move(payload));
 }
 
-void McpServer::ReplyError(int id, const std::string& message) {
-    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":";
-    payload += std::to_string(id);
-    payload += ",\"error\":{\"message\":\"";
-    payload += message;
-    payload += "\"}}";
-    Application::GetInstance().SendMcpMessage(payload);
+void McpServer::ReplyError(const ReplyTo& to, int id, const std::string& message) {
+    // Messages carry tool names and exception texts, cJSON escapes them
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "jsonrpc", "2.0");
+    cJSON_AddNumberToObject(root, "id", id);
+    cJSON* error = cJSON_AddObjectToObject(root, "error");
+    cJSON_AddStringToObject(error, "message", message.c_str());
+    char* json_str = cJSON_PrintUnformatted(root);
+    std::string payload(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(root);
+    CompleteReply(to.response, to.index, std::move(payload));
 }
 
-void McpServer::GetToolsList(int id, const std::string& cursor) {
-    const int max_payload_size = 5000;  // 减小到5KB，为外层包装留空间
+// index is SIZE_MAX when ParseMessage() drops its own hold on the response
+void McpServer::CompleteReply(const std::shared_ptr<Response>& response, size_t index, std::string&& payload) {
+    {
+        std::lock_guard<std::mutex> lock(reply_mutex_);
+        if (index < response->replies.size()) {
+            if (response->finished || !response->replies[index].empty()) {
+                // The job timed out and this reply was already given
+                return;
+            }
+            response->replies[index] = std::move(payload);
+        }
+        if (--response->pending > 0) {
+            return;
+        }
+        response->finished = true;
+
+        std::string message;
+        if (response->batch) {
+            // Notifications and malformed requests leave no reply, an all-notification batch sends nothing
+            for (auto& reply : response->replies) {
+                if (!reply.empty()) {
+                    message += message.empty() ? '[' : ',';
+                    message += reply;
+                }
+            }
+            if (!message.empty()) {
+                message += ']';
+            }
+        } else if (!response->replies.empty()) {
+            message = std::move(response->replies[0]);
+        }
+        ready_responses_.emplace(response->sequence, std::move(message));
+        if (sending_) {
+            // The thread that is sending picks this one up too
+            return;
+        }
+        sending_ = true;
+    }
+
+    // Send whatever no longer waits for an earlier message, outside the lock so workers and new
+    // requests are not held up by the transport. Only one thread sends, which keeps the order
+    std::vector<std::string> outgoing;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(reply_mutex_);
+            auto it = ready_responses_.find(next_send_sequence_);
+            while (it != ready_responses_.end()) {
+                if (!it->second.empty()) {
+                    outgoing.push_back(std::move(it->second));
+                }
+                ready_responses_.erase(it);
+                it = ready_responses_.find(++next_send_sequence_);
+            }
+            if (outgoing.empty()) {
+                sending_ = false;
+                return;
+            }
+        }
+        for (auto& message : outgoing) {
+            Application::GetInstance().SendMcpMessage(message);
+        }
+        outgoing.clear();
+    }
+}
+
+void McpServer::BuildToolsListPages() {
+    int64_t start_time = esp_timer_get_time();
+    size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    tools_list_pages_.clear();
+
+    std::string cursor;
     std::string json;
-    json.reserve(max_payload_size);  // 预分配内存，避免频繁重新分配
+    json.reserve(MAX_TOOLS_LIST_PAGE_SIZE);
     json = "{\"tools\":[";
-    
-    bool found_cursor = cursor.empty();
-    auto it = tools_.begin();
-    std::string next_cursor = "";
-    
-    while (it != tools_.end()) {
-        // 如果我们还没有找到起始位置，继续搜索
-        if (!found_cursor) {
-            if ((*it)->name() == cursor) {
-                found_cursor = true;
-            } else {
-                ++it;
+    for (auto tool : tools_) {
+        auto& tool_json = tool->to_json();
+        if (json.length() + tool_json.length() + 30 > MAX_TOOLS_LIST_PAGE_SIZE) {
+            if (json.back() == '[') {
+                // Not even alone on a page, leave it out instead of failing the whole list
+                ESP_LOGE(TAG, "tools/list: Tool %s exceeds the payload size limit", tool->name().c_str());
                 continue;
             }
+            // Close this page with a cursor to the tool that did not fit
+            json.pop_back();
+            json += "],\"nextCursor\":\"" + tool->name() + "\"}";
+            json.shrink_to_fit();
+            tools_list_pages_.emplace_back(std::move(cursor), std::move(json));
+            cursor = tool->name();
+            json.reserve(MAX_TOOLS_LIST_PAGE_SIZE);
+            json = "{\"tools\":[";
         }
-        
-        // 添加tool前检查大小
-        std::string tool_json = (*it)->to_json() + ",";
-        if (json.length() + tool_json.length() + 30 > max_payload_size) {
-            // 如果添加这个tool会超出大小限制，设置next_cursor并退出循环
-            next_cursor = (*it)->name();
-            break;
-        }
-        
         json += tool_json;
-        ++it;
+        json += ',';
     }
-    
     if (json.back() == ',') {
         json.pop_back();
     }
-    
-    if (json.back() == '[' && !tools_.empty()) {
-        // 如果没有添加任何tool，返回错误
-        ESP_LOGE(TAG, "tools/list: Failed to add tool %s because of payload size limit", next_cursor.c_str());
-        ReplyError(id, "Failed to add tool " + next_cursor + " because of payload size limit");
-        return;
-    }
+    json += "]}";
+    json.shrink_to_fit();
+    tools_list_pages_.emplace_back(std::move(cursor), std::move(json));
+    tools_list_dirty_ = false;
 
-    if (next_cursor.empty()) {
-        json += "]}";
-    } else {
-        json += "],\"nextCursor\":\"" + next_cursor + "\"}";
+    ESP_LOGI(TAG, "tools/list: %u tools in %u pages, built in %lld us, %d bytes of heap cached",
+        tools_.size(), tools_list_pages_.size(), esp_timer_get_time() - start_time,
+        (int)free_heap - (int)heap_caps_get_free_size(MALLOC_CAP_8BIT));
+}
+
+void McpServer::GetToolsList(const ReplyTo& to, int id, const std::string& cursor) {
+    if (tools_list_dirty_) {
+        BuildToolsListPages();
     }
-    
-    ReplyResult(id, json);
+    for (auto& page : tools_list_pages_) {
+        if (page.first == cursor) {
+            ReplyResult(to, id, page.second);
+            return;
+        }
+    }
+    ESP_LOGE(TAG, "tools/list: Invalid cursor: %s", cursor.c_str());
+    ReplyError(to, id, "Invalid cursor: " + cursor);
 }
 
-void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size) {
-    auto tool_iter = std::find_if(tools_.begin(), tools_.end(), 
-                                 [&tool_name](const McpTool* tool) { 
-                                     return tool->name() == tool_name; 
-                                 });
-    
-    if (tool_iter == tools_.end()) {
+void McpServer::DoToolCall(const ReplyTo& to, int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size,
+    ToolJob* sequence) {
+    auto tool_iter = tool_index_.find(tool_name);
+    if (tool_iter == tool_index_.end()) {
         ESP_LOGE(TAG, "tools/call: Unknown tool: %s", tool_name.c_str());
-        ReplyError(id, "Unknown tool: " + tool_name);
+        ReplyError(to, id, "Unknown tool: " + tool_name);
         return;
     }
+    McpTool* tool = tool_iter->second;
 
-    PropertyList arguments = (*tool_iter)->properties();
-    try {
-        for (auto& argument : arguments) {
-            bool found = false;
-            if (cJSON_IsObject(tool_arguments)) {
-                auto value = cJSON_GetObjectItem(tool_arguments, argument.name().c_str());
-                if (argument.type() == kPropertyTypeBoolean && cJSON_IsBool(value)) {
-                    argument.set_value<bool>(value->valueint == 1);
-                    found = true;
-                } else if (argument.type() == kPropertyTypeInteger && cJSON_IsNumber(value)) {
-                    argument.set_value<int>(value->valueint);
-                    found = true;
-                } else if (argument.type() == kPropertyTypeString && cJSON_IsString(value)) {
-                    argument.set_value<std::string>(value->valuestring);
-                    found = true;
-                }
+    std::string error;
+    auto invoke = tool->Bind(tool_arguments, error);
+    if (!invoke) {
+        ESP_LOGE(TAG, "tools/call: %s", error.c_str());
+        ReplyError(to, id, error);
+        return;
+    }
+
+    // The heavy lane always has MCP_TOOL_MAX_STACK_SIZE, so whatever a call asks for runs whenever it comes
+    int needed_stack = std::max(stack_size, tool->stack_size());
+    if (needed_stack > MCP_TOOL_MAX_STACK_SIZE) {
+        ESP_LOGW(TAG, "tools/call: %s asks for a %d byte stack, capped to %d", tool_name.c_str(), needed_stack,
+            MCP_TOOL_MAX_STACK_SIZE);
+        needed_stack = MCP_TOOL_MAX_STACK_SIZE;
+    }
+    ToolCall call{to, id, tool, std::move(invoke), needed_stack, esp_timer_get_time()};
+    if (sequence != nullptr) {
+        // Submitted as one job once the whole batch is parsed
+        sequence->push_back(std::move(call));
+        return;
+    }
+    ToolJob job;
+    job.push_back(std::move(call));
+    SubmitToolJob(std::move(job));
+}
+
+// Run on a worker so the main loop never waits for a tool
+void McpServer::SubmitToolJob(ToolJob&& job) {
+    int needed_stack = 0;
+    for (auto& call : job) {
+        needed_stack = std::max(needed_stack, call.stack_size);
+    }
+    bool heavy = needed_stack > MCP_TOOL_WORKER_STACK_SIZE;
+    auto& lane = heavy ? heavy_lane_ : shared_lane_;
+    const char* error = nullptr;
+    if (lane.queue == nullptr) {
+        bool started = heavy
+            ? StartLane(lane, "tool_heavy", 1, MCP_TOOL_MAX_STACK_SIZE, MCP_HEAVY_CALL_QUEUE_LENGTH)
+            : StartLane(lane, "tool_call", MCP_TOOL_WORKER_COUNT, MCP_TOOL_WORKER_STACK_SIZE, MCP_TOOL_CALL_QUEUE_LENGTH);
+        if (!started) {
+            error = "Failed to start tool worker";
+        }
+    }
+
+    if (error == nullptr) {
+        auto pending = new ToolJob(std::move(job));
+        // Watched before it is queued, a worker may finish it right away
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex_);
+            if (job_timer_ == nullptr) {
+                esp_timer_create_args_t timer_args = {
+                    .callback = [](void* arg) {
+                        ((McpServer*)arg)->CheckJobTimeouts();
+                    },
+                    .arg = this,
+                    .dispatch_method = ESP_TIMER_TASK,
+                    .name = "mcp_job_timeout",
+                    .skip_unhandled_events = true,
+                };
+                esp_timer_create(&timer_args, &job_timer_);
+                esp_timer_start_periodic(job_timer_, MCP_TOOL_TIMEOUT_CHECK_MS * 1000);
             }
+            watched_jobs_.push_back(WatchedJob{pending, esp_timer_get_time() + tool_job_timeout_ms_ * 1000LL});
+        }
+        if (xQueueSend(lane.queue, &pending, 0) == pdTRUE) {
+            return;
+        }
+        UnwatchJob(pending);
+        job = std::move(*pending);
+        delete pending;
+        ESP_LOGW(TAG, "tools/call: Queue full, rejecting %s", job.front().tool->name().c_str());
+        error = "Too many tool calls in progress";
+    }
+    for (auto& call : job) {
+        ReplyError(call.reply, call.id, error);
+    }
+}
 
-            if (!argument.has_default_value() && !found) {
-                ESP_LOGE(TAG, "tools/call: Missing valid argument: %s", argument.name().c_str());
-                ReplyError(id, "Missing valid argument: " + argument.name());
-                return;
+bool McpServer::StartLane(ToolLane& lane, const char* name, int workers, int stack_size, int queue_length) {
+    lane.queue = xQueueCreate(queue_length, sizeof(ToolJob*));
+    if (lane.queue == nullptr) {
+        ESP_LOGE(TAG, "Failed to create the %s queue", name);
+        return false;
+    }
+    lane.stack_size = stack_size;
+    int started = 0;
+    for (int i = 0; i < workers; i++) {
+        BaseType_t ret = xTaskCreate([](void* arg) {
+            auto lane = (ToolLane*)arg;
+            McpServer::GetInstance().ToolWorkerTask(lane->queue);
+            vTaskDelete(NULL);
+        }, name, stack_size, &lane, MCP_TOOL_WORKER_PRIORITY, nullptr);
+        if (ret == pdPASS) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        // Nothing would ever take a job off the queue, the next call tries again
+        ESP_LOGE(TAG, "Failed to create any %s worker with a %d byte stack", name, stack_size);
+        vQueueDelete(lane.queue);
+        lane.queue = nullptr;
+        lane.stack_size = 0;
+        return false;
+    }
+    if (started < workers) {
+        ESP_LOGW(TAG, "Only %d of %d %s workers started", started, workers, name);
+    }
+    ESP_LOGI(TAG, "Started %d %s workers with %d byte stacks", started, name, stack_size);
+    return true;
+}
+
+void McpServer::ToolWorkerTask(QueueHandle_t queue) {
+    while (true) {
+        ToolJob* job = nullptr;
+        if (xQueueReceive(queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        for (auto& call : *job) {
+            RunToolCall(call);
+        }
+        UnwatchJob(job);
+        delete job;
+    }
+}
+
+void McpServer::UnwatchJob(const ToolJob* job) {
+    std::lock_guard<std::mutex> lock(jobs_mutex_);
+    for (auto it = watched_jobs_.begin(); it != watched_jobs_.end(); ++it) {
+        if (it->job == job) {
+            watched_jobs_.erase(it);
+            return;
+        }
+    }
+}
+
+void McpServer::CheckJobTimeouts() {
+    std::vector<std::pair<ReplyTo, int>> expired;
+    {
+        // The worker unwatches a job before deleting it, so a watched job can be read here
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        int64_t now = esp_timer_get_time();
+        for (auto it = watched_jobs_.begin(); it != watched_jobs_.end();) {
+            if (it->deadline_us > now) {
+                ++it;
+                continue;
+            }
+            for (auto& call : *it->job) {
+                ESP_LOGW(TAG, "tools/call: %s timed out", call.tool->name().c_str());
+                expired.emplace_back(call.reply, call.id);
             }
+            it = watched_jobs_.erase(it);
         }
+    }
+    // Calls that already replied are skipped by CompleteReply()
+    for (auto& [reply, id] : expired) {
+        ReplyError(reply, id, "Tool call timed out");
+    }
+}
+
+void McpServer::RunToolCall(ToolCall& call) {
+    int64_t start_time = esp_timer_get_time();
+    try {
+        ReplyResult(call.reply, call.id, McpTool::FormatResult(call.invoke()));
     } catch (const std::exception& e) {
         ESP_LOGE(TAG, "tools/call: %s", e.what());
-        ReplyError(id, e.what());
-        return;
+        ReplyError(call.reply, call.id, e.what());
     }
+    int64_t end_time = esp_timer_get_time();
+    int64_t wait_us = start_time - call.queued_time_us;
+    int64_t run_us = end_time - start_time;
 
-    // Start a task to receive data with stack size
-    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
-    cfg.thread_name = "tool_call";
-    cfg.stack_size = stack_size;
-    cfg.prio = 1;
-    esp_pthread_set_cfg(&cfg);
-
-    // Use a thread to call the tool to avoid blocking the main thread
-    tool_call_thread_ = std::thread([this, id, tool_iter, arguments = std::move(arguments)]() {
-        try {
-            ReplyResult(id, (*tool_iter)->Call(arguments));
-        } catch (const std::exception& e) {
-            ESP_LOGE(TAG, "tools/call: %s", e.what());
-            ReplyError(id, e.what());
-        }
-    });
-    tool_call_thread_.detach();
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    call.tool->RecordCall(wait_us, run_us);
+    auto& stats = call.tool->stats();
+    ESP_LOGI(TAG, "tools/call %s: queued %lld us, ran %lld us (%lu calls, avg %lld us, max %lld us, max queued %lld us)",
+        call.tool->name().c_str(), wait_us, run_us, stats.calls, stats.total_run_us / stats.calls,
+        stats.max_run_us, stats.max_wait_us);
 }
@@ -2,16 +2,36 @@
 #define MCP_SERVER_H
 
 #include <string>
+#include <algorithm>
 #include <vector>
 #include <map>
+#include <memory>
 #include <functional>
 #include <variant>
 #include <optional>
 #include <stdexcept>
-#include <thread>
-
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <array>
+#include <tuple>
+#include <type_traits>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <esp_timer.h>
 #include <cJSON.h>
 
+#define MCP_TOOL_WORKER_COUNT       2     // Shared workers for ordinary tools
+#define MCP_TOOL_WORKER_STACK_SIZE  6144
+#define MCP_TOOL_WORKER_PRIORITY    1
+#define MCP_TOOL_CALL_QUEUE_LENGTH  8     // Jobs waiting for a worker, more are rejected
+#define MCP_HEAVY_CALL_QUEUE_LENGTH 2
+#define MCP_TOOL_MAX_STACK_SIZE     16384 // Stack of the heavy lane, the most any tool call gets
+#define MCP_TOOL_JOB_TIMEOUT_MS     30000 // A job not done by then is answered with an error
+#define MCP_TOOL_TIMEOUT_CHECK_MS   1000
+
 // 添加类型别名
 using ReturnValue = std::variant<bool, int, std::string>;
 
@@ -86,7 +106,8 @@ public:
         value_ = value;
     }
 
-    std::string to_json() const {
+    // Schema of the property, owned by the caller
+    cJSON* to_cjson() const {
         cJSON *json = cJSON_CreateObject();
         
         if (type_ == kPropertyTypeBoolean) {
@@ -111,13 +132,7 @@ public:
                 cJSON_AddStringToObject(json, "default", value<std::string>().c_str());
             }
         }
-        
-        char *json_str = cJSON_PrintUnformatted(json);
-        std::string result(json_str);
-        cJSON_free(json_str);
-        cJSON_Delete(json);
-        
-        return result;
+        return json;
     }
 };
 
@@ -143,6 +158,8 @@ public:
 
     auto begin() { return properties_.begin(); }
     auto end() { return properties_.end(); }
+    auto begin() const { return properties_.begin(); }
+    auto end() const { return properties_.end(); }
 
     std::vector<std::string> GetRequired() const {
         std::vector<std::string> required;
@@ -154,55 +171,49 @@ public:
         return required;
     }
 
-    std::string to_json() const {
+    // Schemas of all properties keyed by name, owned by the caller
+    cJSON* to_cjson() const {
         cJSON *json = cJSON_CreateObject();
-        
         for (const auto& property : properties_) {
-            cJSON *prop_json = cJSON_Parse(property.to_json().c_str());
-            cJSON_AddItemToObject(json, property.name().c_str(), prop_json);
+            cJSON_AddItemToObject(json, property.name().c_str(), property.to_cjson());
         }
-        
-        char *json_str = cJSON_PrintUnformatted(json);
-        std::string result(json_str);
-        cJSON_free(json_str);
-        cJSON_Delete(json);
-        
-        return result;
+        return json;
     }
 };
 
+struct McpToolStats {
+    uint32_t calls = 0;
+    int64_t total_run_us = 0;
+    int64_t max_run_us = 0;
+    int64_t max_wait_us = 0;  // Time spent in the call queue
+};
+
+// A tool call with its arguments parsed and checked, ready to run on a worker
+using McpInvocation = std::function<ReturnValue()>;
+
 class McpTool {
 private:
     std::string name_;
     std::string description_;
     PropertyList properties_;
     std::function<ReturnValue(const PropertyList&)> callback_;
+    std::string json_;  // tools/list descriptor, the schema never changes after construction
+    int stack_size_;    // Above MCP_TOOL_WORKER_STACK_SIZE the tool runs on the heavy lane
+    McpToolStats stats_;
 
-public:
-    McpTool(const std::string& name, 
-            const std::string& description, 
-            const PropertyList& properties, 
-            std::function<ReturnValue(const PropertyList&)> callback)
-        : name_(name), 
-        description_(description), 
-        properties_(properties), 
-        callback_(callback) {}
+protected:
+    // For tools that build their schema themselves and override Bind()
+    McpTool(const std::string& name, const std::string& description, int stack_size)
+        : name_(name), description_(description), stack_size_(stack_size) {}
 
-    inline const std::string& name() const { return name_; }
-    inline const std::string& description() const { return description_; }
-    inline const PropertyList& properties() const { return properties_; }
-
-    std::string to_json() const {
-        std::vector<std::string> required = properties_.GetRequired();
-        
+    // Build the descriptor from the "properties" schema object, which it takes ownership of
+    void SetSchema(cJSON* properties, const std::vector<std::string>& required) {
         cJSON *json = cJSON_CreateObject();
         cJSON_AddStringToObject(json, "name", name_.c_str());
         cJSON_AddStringToObject(json, "description", description_.c_str());
         
         cJSON *input_schema = cJSON_CreateObject();
         cJSON_AddStringToObject(input_schema, "type", "object");
-        
-        cJSON *properties = cJSON_Parse(properties_.to_json().c_str());
         cJSON_AddItemToObject(input_schema, "properties", properties);
         
         if (!required.empty()) {
@@ -216,15 +227,75 @@ public:
         cJSON_AddItemToObject(json, "inputSchema", input_schema);
         
         char *json_str = cJSON_PrintUnformatted(json);
-        std::string result(json_str);
+        json_ = json_str;
         cJSON_free(json_str);
         cJSON_Delete(json);
-        
-        return result;
     }
 
-    std::string Call(const PropertyList& properties) {
-        ReturnValue return_value = callback_(properties);
+public:
+    McpTool(const std::string& name, 
+            const std::string& description, 
+            const PropertyList& properties, 
+            std::function<ReturnValue(const PropertyList&)> callback,
+            int stack_size = MCP_TOOL_WORKER_STACK_SIZE)
+        : name_(name), 
+        description_(description), 
+        properties_(properties), 
+        callback_(callback),
+        stack_size_(stack_size) {
+        SetSchema(properties_.to_cjson(), properties_.GetRequired());
+    }
+    virtual ~McpTool() = default;
+
+    inline const std::string& name() const { return name_; }
+    inline const std::string& description() const { return description_; }
+    inline const PropertyList& properties() const { return properties_; }
+    inline const std::string& to_json() const { return json_; }
+    inline int stack_size() const { return stack_size_; }
+    inline const McpToolStats& stats() const { return stats_; }
+
+    void RecordCall(int64_t wait_us, int64_t run_us) {
+        stats_.calls++;
+        stats_.total_run_us += run_us;
+        stats_.max_run_us = std::max(stats_.max_run_us, run_us);
+        stats_.max_wait_us = std::max(stats_.max_wait_us, wait_us);
+    }
+
+    // Parse the tools/call arguments (may be nullptr), empty with error set if they do not fit the schema
+    virtual McpInvocation Bind(const cJSON* arguments, std::string& error) const {
+        PropertyList values = properties_;
+        try {
+            for (auto& argument : values) {
+                bool found = false;
+                if (cJSON_IsObject(arguments)) {
+                    auto value = cJSON_GetObjectItem(arguments, argument.name().c_str());
+                    if (argument.type() == kPropertyTypeBoolean && cJSON_IsBool(value)) {
+                        argument.set_value<bool>(cJSON_IsTrue(value));
+                        found = true;
+                    } else if (argument.type() == kPropertyTypeInteger && cJSON_IsNumber(value)) {
+                        argument.set_value<int>(value->valueint);
+                        found = true;
+                    } else if (argument.type() == kPropertyTypeString && cJSON_IsString(value)) {
+                        argument.set_value<std::string>(value->valuestring);
+                        found = true;
+                    }
+                }
+
+                if (!argument.has_default_value() && !found) {
+                    error = "Missing valid argument: " + argument.name();
+                    return nullptr;
+                }
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+            return nullptr;
+        }
+        return [this, values = std::move(values)]() {
+            return callback_(values);
+        };
+    }
+
+    static std::string FormatResult(const ReturnValue& return_value) {
         // 返回结果
         cJSON* result = cJSON_CreateObject();
         cJSON* content = cJSON_CreateArray();
@@ -249,6 +320,166 @@ public:
     }
 };
 
+/*
+ * Typed tool binding: the argument schema comes from the parameter types of the callback.
+ *
+ * bool, int and std::string parameters are required arguments, std::optional of one of them is an
+ * optional one that stays empty when missing. McpArg only adds what a type cannot say: the JSON
+ * name and an integer range. Arguments are parsed straight into a tuple of the parameter types,
+ * no PropertyList is copied and no variant is looked up by name. Other parameter types work once
+ * they have an McpArgTraits specialization, which may add an AddSchema(cJSON*) for its items.
+ *
+ *     server.AddTypedTool("self.audio_speaker.set_volume", "...", {McpArg("volume", 0, 100)},
+ *         [](int volume) -> ReturnValue { ... });
+ */
+struct McpArg {
+    const char* name = "";
+    std::optional<int> min_value;
+    std::optional<int> max_value;
+
+    McpArg() = default;
+    McpArg(const char* name) : name(name) {}
+    McpArg(const char* name, int min_value, int max_value) : name(name), min_value(min_value), max_value(max_value) {}
+};
+
+template <typename T>
+struct McpArgTraits;
+
+template <>
+struct McpArgTraits<bool> {
+    static constexpr const char* kType = "boolean";
+    static constexpr bool kRequired = true;
+    static bool Parse(const cJSON* value, const McpArg& arg, bool& out, std::string& error) {
+        if (!cJSON_IsBool(value)) {
+            error = std::string("Missing valid argument: ") + arg.name;
+            return false;
+        }
+        out = cJSON_IsTrue(value);
+        return true;
+    }
+};
+
+template <>
+struct McpArgTraits<int> {
+    static constexpr const char* kType = "integer";
+    static constexpr bool kRequired = true;
+    static bool Parse(const cJSON* value, const McpArg& arg, int& out, std::string& error) {
+        if (!cJSON_IsNumber(value)) {
+            error = std::string("Missing valid argument: ") + arg.name;
+            return false;
+        }
+        out = value->valueint;
+        if (arg.min_value.has_value() && out < arg.min_value.value()) {
+            error = "Value is below minimum allowed: " + std::to_string(arg.min_value.value());
+            return false;
+        }
+        if (arg.max_value.has_value() && out > arg.max_value.value()) {
+            error = "Value exceeds maximum allowed: " + std::to_string(arg.max_value.value());
+            return false;
+        }
+        return true;
+    }
+};
+
+template <>
+struct McpArgTraits<std::string> {
+    static constexpr const char* kType = "string";
+    static constexpr bool kRequired = true;
+    static bool Parse(const cJSON* value, const McpArg& arg, std::string& out, std::string& error) {
+        if (!cJSON_IsString(value)) {
+            error = std::string("Missing valid argument: ") + arg.name;
+            return false;
+        }
+        out = value->valuestring;
+        return true;
+    }
+};
+
+template <typename T>
+struct McpArgTraits<std::optional<T>> {
+    static constexpr const char* kType = McpArgTraits<T>::kType;
+    static constexpr bool kRequired = false;
+    static bool Parse(const cJSON* value, const McpArg& arg, std::optional<T>& out, std::string& error) {
+        if (value == nullptr) {
+            out.reset();
+            return true;
+        }
+        return McpArgTraits<T>::Parse(value, arg, out.emplace(), error);
+    }
+};
+
+// Parameter types of a lambda or functor
+template <typename F>
+struct McpCallableTraits : McpCallableTraits<decltype(&F::operator())> {};
+
+template <typename C, typename R, typename... A>
+struct McpCallableTraits<R (C::*)(A...) const> {
+    static_assert(std::is_convertible_v<R, ReturnValue>, "Tool callbacks return bool, int or std::string");
+    using Args = std::tuple<std::decay_t<A>...>;
+};
+
+template <typename F, typename Args>
+class TypedMcpTool;
+
+template <typename F, typename... Args>
+class TypedMcpTool<F, std::tuple<Args...>> : public McpTool {
+public:
+    TypedMcpTool(const std::string& name, const std::string& description, const McpArg* args, F callback, int stack_size)
+        : McpTool(name, description, stack_size), callback_(std::move(callback)) {
+        std::copy(args, args + sizeof...(Args), args_.begin());
+        cJSON* properties = cJSON_CreateObject();
+        std::vector<std::string> required;
+        AddProperties(properties, required, std::index_sequence_for<Args...>{});
+        SetSchema(properties, required);
+    }
+
+    McpInvocation Bind(const cJSON* arguments, std::string& error) const override {
+        std::tuple<Args...> values;
+        if (!ParseArgs(arguments, values, error, std::index_sequence_for<Args...>{})) {
+            return nullptr;
+        }
+        return [this, values = std::move(values)]() {
+            return ReturnValue(std::apply(callback_, values));
+        };
+    }
+
+private:
+    std::array<McpArg, sizeof...(Args)> args_;
+    F callback_;
+
+    template <size_t... I>
+    void AddProperties(cJSON* properties, std::vector<std::string>& required, std::index_sequence<I...>) {
+        (AddProperty<Args>(properties, required, args_[I]), ...);
+    }
+
+    template <typename T>
+    static void AddProperty(cJSON* properties, std::vector<std::string>& required, const McpArg& arg) {
+        cJSON* json = cJSON_CreateObject();
+        cJSON_AddStringToObject(json, "type", McpArgTraits<T>::kType);
+        // Array and object arguments describe their items themselves
+        if constexpr (requires { McpArgTraits<T>::AddSchema(json); }) {
+            McpArgTraits<T>::AddSchema(json);
+        }
+        if (arg.min_value.has_value()) {
+            cJSON_AddNumberToObject(json, "minimum", arg.min_value.value());
+        }
+        if (arg.max_value.has_value()) {
+            cJSON_AddNumberToObject(json, "maximum", arg.max_value.value());
+        }
+        cJSON_AddItemToObject(properties, arg.name, json);
+        if (McpArgTraits<T>::kRequired) {
+            required.push_back(arg.name);
+        }
+    }
+
+    template <size_t... I>
+    bool ParseArgs(const cJSON* arguments, std::tuple<Args...>& values, std::string& error, std::index_sequence<I...>) const {
+        // Stops at the first argument that does not fit
+        return (McpArgTraits<Args>::Parse(cJSON_IsObject(arguments) ? cJSON_GetObjectItem(arguments, args_[I].name) : nullptr,
+            args_[I], std::get<I>(values), error) && ...);
+    }
+};
+
 class McpServer {
 public:
     static McpServer& GetInstance() {
@@ -258,24 +489,111 @@ public:
 
     void AddCommonTools();
     void AddTool(McpTool* tool);
-    void AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback);
-    void ParseMessage(const cJSON* json);
+    // Tools that need more than MCP_TOOL_WORKER_STACK_SIZE (camera, upgrade) declare it with stack_size
+    void AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback, int stack_size = MCP_TOOL_WORKER_STACK_SIZE);
+
+    // Typed tool, one McpArg per parameter of the callback, see TypedMcpTool
+    template <typename F, size_t N>
+    void AddTypedTool(const std::string& name, const std::string& description, const McpArg (&args)[N], F callback,
+        int stack_size = MCP_TOOL_WORKER_STACK_SIZE) {
+        using Args = typename McpCallableTraits<F>::Args;
+        static_assert(std::tuple_size_v<Args> == N, "One McpArg per callback parameter");
+        AddTool(new TypedMcpTool<F, Args>(name, description, args, std::move(callback), stack_size));
+    }
+    // Typed tool without arguments
+    template <typename F>
+    void AddTypedTool(const std::string& name, const std::string& description, F callback,
+        int stack_size = MCP_TOOL_WORKER_STACK_SIZE) {
+        using Args = typename McpCallableTraits<F>::Args;
+        static_assert(std::tuple_size_v<Args> == 0, "Tools with parameters need one McpArg per parameter");
+        AddTool(new TypedMcpTool<F, Args>(name, description, nullptr, std::move(callback), stack_size));
+    }
+    // A single JSON-RPC request or a batch array. With sequential, the tool calls of a batch run
+    // one after another in array order on one worker instead of in parallel.
+    void ParseMessage(const cJSON* json, bool sequential = false);
     void ParseMessage(const std::string& message);
+    // Time a job (one call or a sequential batch) gets from being queued until it has to reply.
+    // A late tool keeps running but its result is dropped
+    void SetToolJobTimeout(int timeout_ms) { tool_job_timeout_ms_ = timeout_ms; }
 
 private:
     McpServer();
     ~McpServer();
 
-    void ParseCapabilities(const cJSON* capabilities);
-
-    void ReplyResult(int id, const std::string& result);
-    void ReplyError(int id, const std::string& message);
-
-    void GetToolsList(int id, const std::string& cursor);
-    void DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size);
+    // Replies to one mcp message: a batch is answered with one array once all of its requests
+    // have replied. Responses are sent in the order their messages arrived, so pipelined
+    // requests are answered in order even when their tools finish out of order.
+    struct Response {
+        uint32_t sequence;
+        bool batch;
+        std::vector<std::string> replies;
+        size_t pending;
+        bool finished = false;  // Replies that come after a timeout are dropped
+    };
+    struct ReplyTo {
+        std::shared_ptr<Response> response;
+        size_t index;
+    };
+    struct ToolCall {
+        ReplyTo reply;
+        int id;
+        McpTool* tool;
+        McpInvocation invoke;
+        int stack_size;
+        int64_t queued_time_us;
+    };
+    // Calls a worker runs back to back, one for a plain tools/call
+    using ToolJob = std::vector<ToolCall>;
 
-    std::vector<McpTool*> tools_;
-    std::thread tool_call_thread_;
+    void ParseCapabilities(const cJSON* capabilities);
+    void HandleRequest(const cJSON* json, const std::shared_ptr<Response>& response, ToolJob* sequence);
+
+    ReplyTo AddReply(const std::shared_ptr<Response>& response);
+    void ReplyResult(const ReplyTo& to, int id, const std::string& result);
+    void ReplyError(const ReplyTo& to, int id, const std::string& message);
+    void CompleteReply(const std::shared_ptr<Response>& response, size_t index, std::string&& payload);
+
+    void GetToolsList(const ReplyTo& to, int id, const std::string& cursor);
+    void BuildToolsListPages();
+    void DoToolCall(const ReplyTo& to, int id, const std::string& tool_name, const cJSON* tool_arguments, int stack_size,
+        ToolJob* sequence);
+
+    // Worker tasks sharing one bounded queue of ToolJob pointers
+    struct ToolLane {
+        QueueHandle_t queue = nullptr;
+        int stack_size = 0;
+    };
+    // Queued or running job and when it has to be done by
+    struct WatchedJob {
+        const ToolJob* job;
+        int64_t deadline_us;
+    };
+    void SubmitToolJob(ToolJob&& job);
+    bool StartLane(ToolLane& lane, const char* name, int workers, int stack_size, int queue_length);
+    void ToolWorkerTask(QueueHandle_t queue);
+    void RunToolCall(ToolCall& call);
+    void UnwatchJob(const ToolJob* job);
+    void CheckJobTimeouts();
+
+    std::vector<McpTool*> tools_;  // In tools/list order
+    // Keys point into the names owned by the tools
+    std::unordered_map<std::string_view, McpTool*> tool_index_;
+    // tools/list results keyed by their cursor, "" for the first page. Built on the first
+    // tools/list and rebuilt only after a tool is added.
+    std::vector<std::pair<std::string, std::string>> tools_list_pages_;
+    bool tools_list_dirty_ = true;
+    ToolLane shared_lane_;
+    ToolLane heavy_lane_;
+    std::mutex stats_mutex_;
+    std::mutex reply_mutex_;
+    uint32_t next_sequence_ = 0;       // Given to the next mcp message
+    uint32_t next_send_sequence_ = 0;  // Response that goes out next
+    std::map<uint32_t, std::string> ready_responses_;  // Finished ahead of an earlier one, "" if nothing to send
+    bool sending_ = false;  // A thread is sending ready responses, the others leave theirs to it
+    std::mutex jobs_mutex_;
+    std::vector<WatchedJob> watched_jobs_;
+    esp_timer_handle_t job_timer_ = nullptr;
+    int tool_job_timeout_ms_ = MCP_TOOL_JOB_TIMEOUT_MS;
 };
 
 #endif // MCP_SERVER_H
@@ -0,0 +1,87 @@
+#include "audio_datagram_cipher.h"
+
+#include <esp_log.h>
+#include <arpa/inet.h>
+#include <cstring>
+
+#define TAG "DatagramCipher"
+
+AudioDatagramCipher::AudioDatagramCipher() {
+    mbedtls_aes_init(&aes_ctx_);
+}
+
+AudioDatagramCipher::~AudioDatagramCipher() {
+    mbedtls_aes_free(&aes_ctx_);
+}
+
+bool AudioDatagramCipher::SetKey(const std::string& key, const std::string& nonce) {
+    ready_ = false;
+    if (key.size() != 16 || nonce.size() != AUDIO_DATAGRAM_HEADER_SIZE) {
+        ESP_LOGE(TAG, "Invalid key or nonce size: %u, %u", key.size(), nonce.size());
+        return false;
+    }
+    mbedtls_aes_free(&aes_ctx_);
+    mbedtls_aes_init(&aes_ctx_);
+    if (mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char*)key.data(), 128) != 0) {
+        ESP_LOGE(TAG, "Failed to set AES key");
+        return false;
+    }
+    memcpy(nonce_, nonce.data(), sizeof(nonce_));
+    ready_ = true;
+    return true;
+}
+
+bool AudioDatagramCipher::Crypt(const uint8_t* header, const uint8_t* input, size_t size, uint8_t* output) {
+    if (!ready_) {
+        return false;
+    }
+    // CTR mode advances the counter block, so work on a copy and leave the header intact
+    uint8_t counter[AUDIO_DATAGRAM_HEADER_SIZE];
+    uint8_t stream_block[16];
+    size_t nc_off = 0;
+    memcpy(counter, header, sizeof(counter));
+    return mbedtls_aes_crypt_ctr(&aes_ctx_, size, &nc_off, counter, stream_block, input, output) == 0;
+}
+
+bool AudioDatagramCipher::Seal(uint8_t type, uint8_t flags, uint32_t timestamp, uint32_t sequence, uint8_t* datagram, size_t size) {
+    size_t payload_size = size - AUDIO_DATAGRAM_HEADER_SIZE;
+    memcpy(datagram, nonce_, AUDIO_DATAGRAM_HEADER_SIZE);
+    datagram[0] = type;
+    datagram[1] = flags;
+    uint16_t payload_len = htons(payload_size);
+    timestamp = htonl(timestamp);
+    sequence = htonl(sequence);
+    memcpy(datagram + 2, &payload_len, sizeof(payload_len));
+    memcpy(datagram + 8, &timestamp, sizeof(timestamp));
+    memcpy(datagram + 12, &sequence, sizeof(sequence));
+
+    uint8_t* payload = datagram + AUDIO_DATAGRAM_HEADER_SIZE;
+    if (!Crypt(datagram, payload, payload_size, payload)) {
+        ESP_LOGE(TAG, "Failed to encrypt audio data");
+        return false;
+    }
+    return true;
+}
+
+bool AudioDatagramCipher::Open(const uint8_t* datagram, size_t size, uint8_t* out) {
+    if (size < AUDIO_DATAGRAM_HEADER_SIZE) {
+        return false;
+    }
+    if (!Crypt(datagram, datagram + AUDIO_DATAGRAM_HEADER_SIZE, size - AUDIO_DATAGRAM_HEADER_SIZE, out)) {
+        ESP_LOGE(TAG, "Failed to decrypt audio data");
+        return false;
+    }
+    return true;
+}
+
+uint32_t AudioDatagramCipher::timestamp(const uint8_t* datagram) {
+    uint32_t value;
+    memcpy(&value, datagram + 8, sizeof(value));
+    return ntohl(value);
+}
+
+uint32_t AudioDatagramCipher::sequence(const uint8_t* datagram) {
+    uint32_t value;
+    memcpy(&value, datagram + 12, sizeof(value));
+    return ntohl(value);
+}
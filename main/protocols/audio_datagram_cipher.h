@@ -0,0 +1,54 @@
+#ifndef _AUDIO_DATAGRAM_CIPHER_H_
+#define _AUDIO_DATAGRAM_CIPHER_H_
+
+#include <mbedtls/aes.h>
+
+#include <cstdint>
+#include <string>
+
+/*
+ * UDP audio datagram framing:
+ * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
+ * |payload payload_len, AES-128-CTR with the header as the initial counter block|
+ */
+#define AUDIO_DATAGRAM_HEADER_SIZE 16
+#define AUDIO_DATAGRAM_TYPE_OPUS        0x01
+#define AUDIO_DATAGRAM_TYPE_OPUS_BATCH  0x02
+
+/*
+ * Encrypts and decrypts audio datagrams in place, without heap allocations.
+ *
+ * The caller sizes a reused datagram buffer, writes the plain payload after the header and calls
+ * Seal(), which fills in the header and encrypts the payload where it lies. Receiving decrypts
+ * straight into the caller's (pooled) buffer. The whole payload goes through one
+ * mbedtls_aes_crypt_ctr() call, which the AES peripheral processes as one DMA run.
+ */
+class AudioDatagramCipher {
+public:
+    AudioDatagramCipher();
+    ~AudioDatagramCipher();
+    AudioDatagramCipher(const AudioDatagramCipher&) = delete;
+    AudioDatagramCipher& operator=(const AudioDatagramCipher&) = delete;
+
+    // key and nonce are raw bytes from the server hello, the nonce supplies the ssrc
+    bool SetKey(const std::string& key, const std::string& nonce);
+
+    // datagram holds AUDIO_DATAGRAM_HEADER_SIZE bytes of room followed by the plain payload
+    bool Seal(uint8_t type, uint8_t flags, uint32_t timestamp, uint32_t sequence, uint8_t* datagram, size_t size);
+    // Decrypt the payload of a received datagram into out, which must hold size - AUDIO_DATAGRAM_HEADER_SIZE bytes
+    bool Open(const uint8_t* datagram, size_t size, uint8_t* out);
+
+    static inline uint8_t type(const uint8_t* datagram) { return datagram[0]; }
+    static inline uint8_t flags(const uint8_t* datagram) { return datagram[1]; }
+    static uint32_t timestamp(const uint8_t* datagram);
+    static uint32_t sequence(const uint8_t* datagram);
+
+private:
+    mbedtls_aes_context aes_ctx_;
+    uint8_t nonce_[AUDIO_DATAGRAM_HEADER_SIZE] = {0};
+    bool ready_ = false;
+
+    bool Crypt(const uint8_t* header, const uint8_t* input, size_t size, uint8_t* output);
+};
+
+#endif // _AUDIO_DATAGRAM_CIPHER_H_
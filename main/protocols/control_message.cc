@@ -0,0 +1,345 @@
+#include "control_message.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#define TAG "ControlMessage"
+
+static inline const char* SkipSpace(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+// p points at the opening quote, returns the position after the closing one or nullptr
+static const char* ScanString(const char* p, const char* end, bool& escaped) {
+    escaped = false;
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            escaped = true;
+            p++;
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return nullptr;
+}
+
+// p points at '{' or '[', returns the position after the matching bracket or nullptr
+static const char* ScanContainer(const char* p, const char* end) {
+    int depth = 0;
+    bool escaped;
+    while (p < end) {
+        char c = *p;
+        if (c == '"') {
+            p = ScanString(p, end, escaped);
+            if (p == nullptr) {
+                return nullptr;
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                return p + 1;
+            }
+        }
+        p++;
+    }
+    return nullptr;
+}
+
+bool ControlMessage::Parse(const char* data, size_t size) {
+    text_ = std::string_view(data, size);
+    field_count_ = 0;
+    scratch_used_ = 0;
+    overflow_.clear();
+    type_ = "";
+
+    const char* end = data + size;
+    const char* p = SkipSpace(data, end);
+    if (p == end || *p != '{') {
+        return false;
+    }
+    p = SkipSpace(p + 1, end);
+    if (p < end && *p == '}') {
+        return true;
+    }
+
+    while (true) {
+        Field field;
+        bool escaped;
+        if (p == end || *p != '"') {
+            return false;
+        }
+        const char* key_end = ScanString(p, end, escaped);
+        if (key_end == nullptr) {
+            return false;
+        }
+        field.key = std::string_view(p + 1, key_end - p - 2);
+
+        p = SkipSpace(key_end, end);
+        if (p == end || *p != ':') {
+            return false;
+        }
+        p = SkipSpace(p + 1, end);
+        if (p == end) {
+            return false;
+        }
+
+        const char* value_end;
+        field.escaped = false;
+        switch (*p) {
+        case '"':
+            value_end = ScanString(p, end, field.escaped);
+            if (value_end == nullptr) {
+                return false;
+            }
+            field.type = kControlValueString;
+            field.value = std::string_view(p + 1, value_end - p - 2);
+            break;
+        case '{':
+        case '[':
+            value_end = ScanContainer(p, end);
+            if (value_end == nullptr) {
+                return false;
+            }
+            field.type = *p == '{' ? kControlValueObject : kControlValueArray;
+            field.value = std::string_view(p, value_end - p);
+            break;
+        default:
+            value_end = p;
+            while (value_end < end && *value_end != ',' && *value_end != '}' && *value_end != ' ' &&
+                *value_end != '\t' && *value_end != '\n' && *value_end != '\r') {
+                value_end++;
+            }
+            field.value = std::string_view(p, value_end - p);
+            if (field.value == "true" || field.value == "false") {
+                field.type = kControlValueBool;
+            } else if (field.value == "null") {
+                field.type = kControlValueNull;
+            } else {
+                field.type = kControlValueNumber;
+            }
+            break;
+        }
+
+        if (field_count_ < fields_.size()) {
+            fields_[field_count_++] = field;
+        }
+
+        p = SkipSpace(value_end, end);
+        if (p == end) {
+            return false;
+        }
+        if (*p == '}') {
+            break;
+        }
+        if (*p != ',') {
+            return false;
+        }
+        p = SkipSpace(p + 1, end);
+    }
+
+    auto type = GetString("type");
+    if (type != nullptr) {
+        type_ = type;
+    }
+    return true;
+}
+
+const ControlMessage::Field* ControlMessage::Find(std::string_view key) const {
+    for (size_t i = 0; i < field_count_; i++) {
+        if (fields_[i].key == key) {
+            return &fields_[i];
+        }
+    }
+    return nullptr;
+}
+
+static inline int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static bool ReadHex4(const char* p, const char* end, uint32_t& value) {
+    if (end - p < 4) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = HexValue(p[i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+    return true;
+}
+
+// Writes the unescaped value and its NUL to out, which needs value.size() + 1 bytes since unescaping
+// never makes a string longer. nullptr for escapes that cannot be turned into a valid C string
+static char* UnescapeTo(std::string_view value, bool escaped, char* out) {
+    if (!escaped) {
+        memcpy(out, value.data(), value.size());
+        out += value.size();
+        *out++ = '\0';
+        return out;
+    }
+    const char* p = value.data();
+    const char* end = p + value.size();
+    while (p < end) {
+        if (*p != '\\' || p + 1 == end) {
+            *out++ = *p++;
+            continue;
+        }
+        char c = p[1];
+        p += 2;
+        switch (c) {
+        case 'b': *out++ = '\b'; break;
+        case 'f': *out++ = '\f'; break;
+        case 'n': *out++ = '\n'; break;
+        case 'r': *out++ = '\r'; break;
+        case 't': *out++ = '\t'; break;
+        case 'u': {
+            uint32_t code;
+            if (!ReadHex4(p, end, code)) {
+                return nullptr;
+            }
+            p += 4;
+            // \u0000 would cut the string short, a surrogate is only valid as a high/low pair
+            if (code == 0 || (code >= 0xDC00 && code < 0xE000)) {
+                return nullptr;
+            }
+            if (code >= 0xD800 && code < 0xDC00) {
+                // A surrogate pair takes 12 bytes of input for 4 bytes of UTF-8
+                uint32_t low;
+                if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !ReadHex4(p + 2, end, low) || low < 0xDC00 || low >= 0xE000) {
+                    return nullptr;
+                }
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                p += 6;
+            }
+            if (code < 0x80) {
+                *out++ = code;
+            } else if (code < 0x800) {
+                *out++ = 0xC0 | (code >> 6);
+                *out++ = 0x80 | (code & 0x3F);
+            } else if (code < 0x10000) {
+                *out++ = 0xE0 | (code >> 12);
+                *out++ = 0x80 | ((code >> 6) & 0x3F);
+                *out++ = 0x80 | (code & 0x3F);
+            } else {
+                *out++ = 0xF0 | (code >> 18);
+                *out++ = 0x80 | ((code >> 12) & 0x3F);
+                *out++ = 0x80 | ((code >> 6) & 0x3F);
+                *out++ = 0x80 | (code & 0x3F);
+            }
+            break;
+        }
+        default:
+            // \" \\ \/
+            *out++ = c;
+            break;
+        }
+    }
+    *out++ = '\0';
+    return out;
+}
+
+const char* ControlMessage::Unescape(const Field& field) {
+    if (scratch_used_ + field.value.size() + 1 <= scratch_.size()) {
+        char* start = scratch_.data() + scratch_used_;
+        char* out = UnescapeTo(field.value, field.escaped, start);
+        if (out == nullptr) {
+            return nullptr;
+        }
+        scratch_used_ = out - scratch_.data();
+        return start;
+    }
+
+    // Long values (e.g. a whole llm reply) go to the heap, freed by the next Parse()
+    ESP_LOGD(TAG, "Field %.*s does not fit the scratch buffer, %u bytes", (int)field.key.size(), field.key.data(),
+        (unsigned)field.value.size());
+    auto buffer = std::make_unique<char[]>(field.value.size() + 1);
+    if (UnescapeTo(field.value, field.escaped, buffer.get()) == nullptr) {
+        return nullptr;
+    }
+    overflow_.push_back(std::move(buffer));
+    return overflow_.back().get();
+}
+
+const char* ControlMessage::GetString(std::string_view key) {
+    auto field = Find(key);
+    if (field == nullptr || field->type != kControlValueString) {
+        return nullptr;
+    }
+    return Unescape(*field);
+}
+
+bool ControlMessage::GetNumber(std::string_view key, double& value) const {
+    auto field = Find(key);
+    if (field == nullptr || field->type != kControlValueNumber) {
+        return false;
+    }
+    char buffer[32];
+    size_t size = std::min(field->value.size(), sizeof(buffer) - 1);
+    memcpy(buffer, field->value.data(), size);
+    buffer[size] = '\0';
+    char* number_end;
+    value = strtod(buffer, &number_end);
+    return number_end != buffer;
+}
+
+bool ControlMessage::GetBool(std::string_view key, bool& value) const {
+    auto field = Find(key);
+    if (field == nullptr || field->type != kControlValueBool) {
+        return false;
+    }
+    value = field->value == "true";
+    return true;
+}
+
+std::string_view ControlMessage::GetRaw(std::string_view key) const {
+    auto field = Find(key);
+    if (field == nullptr) {
+        return std::string_view();
+    }
+    if (field->type == kControlValueString) {
+        // Include the quotes so the text stays valid JSON
+        return std::string_view(field->value.data() - 1, field->value.size() + 2);
+    }
+    return field->value;
+}
+
+bool ControlMessage::Has(std::string_view key, ControlValueType type) const {
+    auto field = Find(key);
+    return field != nullptr && field->type == type;
+}
+
+void ControlMessageDispatcher::On(const std::string& type, Handler handler) {
+    for (auto& entry : handlers_) {
+        if (entry.first == type) {
+            entry.second = std::move(handler);
+            return;
+        }
+    }
+    handlers_.emplace_back(type, std::move(handler));
+}
+
+bool ControlMessageDispatcher::Dispatch(ControlMessage& message) const {
+    std::string_view type = message.type();
+    for (auto& entry : handlers_) {
+        if (entry.first == type) {
+            entry.second(message);
+            return true;
+        }
+    }
+    return false;
+}
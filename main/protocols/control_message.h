@@ -0,0 +1,87 @@
+#ifndef _CONTROL_MESSAGE_H_
+#define _CONTROL_MESSAGE_H_
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#define CONTROL_MESSAGE_MAX_FIELDS   16    // Top-level members kept per message, the rest are skipped
+#define CONTROL_MESSAGE_SCRATCH_SIZE 2048  // Unescaped string values of one message, longer ones go to the heap
+
+enum ControlValueType {
+    kControlValueString,
+    kControlValueNumber,
+    kControlValueBool,
+    kControlValueNull,
+    kControlValueObject,
+    kControlValueArray,
+};
+
+/*
+ * Server control message (tts, stt, llm, mcp, ...) read with a single pass over the JSON text.
+ *
+ * Parse() only records where the top-level members are, nested objects and arrays are skipped as
+ * raw text, so no tree is built and nothing is allocated. String values are unescaped on demand
+ * into a scratch buffer owned by the message, which the protocol keeps and reuses for every text
+ * frame; a string too long for it gets a heap copy. Views and pointers into a message are valid
+ * until the next Parse() and must not outlive the text it was parsed from. Consumers that need a
+ * tree (MCP payloads) parse GetRaw() with cJSON.
+ */
+class ControlMessage {
+public:
+    bool Parse(const char* data, size_t size);
+
+    // "type" of the message, "" if missing
+    const char* type() const { return type_; }
+    // Unescaped, NUL terminated string value, nullptr if missing, not a string, or it contains \u0000
+    // or an unpaired surrogate
+    const char* GetString(std::string_view key);
+    bool GetNumber(std::string_view key, double& value) const;
+    bool GetBool(std::string_view key, bool& value) const;
+    // JSON text of the value as received, e.g. a whole object with its braces, empty if missing
+    std::string_view GetRaw(std::string_view key) const;
+    bool Has(std::string_view key, ControlValueType type) const;
+    std::string_view text() const { return text_; }
+
+private:
+    struct Field {
+        std::string_view key;
+        std::string_view value;  // Without the quotes for strings
+        ControlValueType type;
+        bool escaped;
+    };
+
+    std::string_view text_;
+    std::array<Field, CONTROL_MESSAGE_MAX_FIELDS> fields_;
+    size_t field_count_ = 0;
+    std::array<char, CONTROL_MESSAGE_SCRATCH_SIZE> scratch_;
+    size_t scratch_used_ = 0;
+    std::vector<std::unique_ptr<char[]>> overflow_;  // Strings that did not fit the scratch buffer
+    const char* type_ = "";
+
+    const Field* Find(std::string_view key) const;
+    const char* Unescape(const Field& field);
+};
+
+/*
+ * Routes control messages to the handler registered for their "type".
+ */
+class ControlMessageDispatcher {
+public:
+    using Handler = std::function<void(ControlMessage& message)>;
+
+    void On(const std::string& type, Handler handler);
+    // false if nothing is registered for the type
+    bool Dispatch(ControlMessage& message) const;
+
+private:
+    // A handful of types, a linear scan beats hashing here
+    std::vector<std::pair<std::string, Handler>> handlers_;
+};
+
+#endif // _CONTROL_MESSAGE_H_
@@ -0,0 +1,190 @@
+#include "loopback_protocol.h"
+
+#include <cstring>
+#include <cJSON.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "Loopback"
+
+LoopbackProtocol::LoopbackProtocol(int speed) : speed_(speed < 1 ? 1 : speed) {
+    event_group_handle_ = xEventGroupCreate();
+    // Replies are the device's own uplink packets
+    server_sample_rate_ = 16000;
+}
+
+LoopbackProtocol::~LoopbackProtocol() {
+    xEventGroupSetBits(event_group_handle_, LOOPBACK_PROTOCOL_STOP_EVENT);
+    while (replay_task_handle_ != nullptr) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    vEventGroupDelete(event_group_handle_);
+}
+
+bool LoopbackProtocol::Start() {
+    if (replay_task_handle_ != nullptr) {
+        return true;
+    }
+    xTaskCreate([](void* arg) {
+        LoopbackProtocol* protocol = (LoopbackProtocol*)arg;
+        protocol->ReplayTask();
+        vTaskDelete(NULL);
+    }, "loopback", 2048 * 2, this, 3, &replay_task_handle_);
+    ESP_LOGI(TAG, "Loopback protocol started, replay speed x%d", speed_);
+    return true;
+}
+
+bool LoopbackProtocol::OpenAudioChannel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        recorded_.clear();
+        recording_ = false;
+    }
+    session_id_ = "loopback";
+    // Agree to whatever the device asked for
+    server_frame_duration_ = client_frame_duration_;
+    uplink_frame_duration_ = client_frame_duration_;
+    uplink_bitrate_ = client_bitrate_;
+    error_occurred_ = false;
+    channel_opened_ = true;
+    last_incoming_time_ = std::chrono::steady_clock::now();
+
+    if (on_audio_channel_opened_ != nullptr) {
+        on_audio_channel_opened_();
+    }
+    return true;
+}
+
+void LoopbackProtocol::CloseAudioChannel() {
+    if (!channel_opened_) {
+        return;
+    }
+    channel_opened_ = false;
+    xEventGroupSetBits(event_group_handle_, LOOPBACK_PROTOCOL_ABORT_EVENT);
+    if (on_audio_channel_closed_ != nullptr) {
+        on_audio_channel_closed_();
+    }
+}
+
+bool LoopbackProtocol::IsAudioChannelOpened() const {
+    return channel_opened_ && !error_occurred_;
+}
+
+bool LoopbackProtocol::SendAudio(AudioStreamPacket& packet) {
+    if (!channel_opened_) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!recording_) {
+        return true;
+    }
+    if (recorded_.size() < LOOPBACK_MAX_PACKETS) {
+        recorded_.push_back(packet);
+    }
+    recorded_ms_ += packet.frame_duration;
+    if (auto_stop_ && recorded_ms_ >= LOOPBACK_AUTO_STOP_MS) {
+        recording_ = false;
+        xEventGroupSetBits(event_group_handle_, LOOPBACK_PROTOCOL_REPLAY_EVENT);
+    }
+    return true;
+}
+
+bool LoopbackProtocol::SendText(const std::string& text) {
+    if (!channel_opened_) {
+        return false;
+    }
+
+    cJSON* root = cJSON_Parse(text.c_str());
+    if (root == nullptr) {
+        ESP_LOGE(TAG, "Failed to parse message: %s", text.c_str());
+        return false;
+    }
+
+    auto type = cJSON_GetObjectItem(root, "type");
+    auto state = cJSON_GetObjectItem(root, "state");
+    if (cJSON_IsString(type) && strcmp(type->valuestring, "listen") == 0 && cJSON_IsString(state)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (strcmp(state->valuestring, "start") == 0) {
+            auto mode = cJSON_GetObjectItem(root, "mode");
+            auto_stop_ = !cJSON_IsString(mode) || strcmp(mode->valuestring, "manual") != 0;
+            recorded_.clear();
+            recorded_ms_ = 0;
+            recording_ = true;
+        } else if (strcmp(state->valuestring, "stop") == 0 && recording_) {
+            recording_ = false;
+            xEventGroupSetBits(event_group_handle_, LOOPBACK_PROTOCOL_REPLAY_EVENT);
+        }
+    } else if (cJSON_IsString(type) && strcmp(type->valuestring, "abort") == 0) {
+        xEventGroupSetBits(event_group_handle_, LOOPBACK_PROTOCOL_ABORT_EVENT);
+    }
+
+    cJSON_Delete(root);
+    return true;
+}
+
+void LoopbackProtocol::ReplayTask() {
+    std::vector<AudioStreamPacket> packets;
+    while (true) {
+        auto bits = xEventGroupWaitBits(event_group_handle_,
+            LOOPBACK_PROTOCOL_REPLAY_EVENT | LOOPBACK_PROTOCOL_ABORT_EVENT | LOOPBACK_PROTOCOL_STOP_EVENT,
+            pdTRUE, pdFALSE, portMAX_DELAY);
+        if (bits & LOOPBACK_PROTOCOL_STOP_EVENT) {
+            break;
+        }
+        if (!(bits & LOOPBACK_PROTOCOL_REPLAY_EVENT)) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            packets.swap(recorded_);
+            recorded_.clear();
+        }
+        Replay(packets);
+    }
+    replay_task_handle_ = nullptr;
+}
+
+void LoopbackProtocol::Replay(std::vector<AudioStreamPacket>& packets) {
+    ESP_LOGI(TAG, "Replaying %u packets", packets.size());
+    DeliverJson("{\"type\":\"tts\",\"state\":\"start\"}");
+
+    // Pace the packets like a server would, the first delay also lets the device enter speaking state.
+    // The deadline accumulates in microseconds, so speeds that do not divide a frame into whole
+    // ticks still average out to speed times real time
+    int64_t deadline_us = esp_timer_get_time();
+    uint32_t sequence = 0;
+    for (auto& packet : packets) {
+        deadline_us += packet.frame_duration * 1000LL / speed_;
+        int64_t wait_ms = (deadline_us - esp_timer_get_time()) / 1000;
+        if (wait_ms > 0 && pdMS_TO_TICKS(wait_ms) > 0) {
+            vTaskDelay(pdMS_TO_TICKS(wait_ms));
+        }
+        if (xEventGroupGetBits(event_group_handle_) & (LOOPBACK_PROTOCOL_ABORT_EVENT | LOOPBACK_PROTOCOL_STOP_EVENT)) {
+            ESP_LOGI(TAG, "Replay aborted");
+            break;
+        }
+        last_incoming_time_ = std::chrono::steady_clock::now();
+        if (on_incoming_audio_ != nullptr) {
+            auto incoming = AllocatePacket();
+            *incoming = std::move(packet);
+            incoming->sequence = ++sequence;
+            on_incoming_audio_(std::move(incoming));
+        }
+    }
+    packets.clear();
+
+    xEventGroupClearBits(event_group_handle_, LOOPBACK_PROTOCOL_ABORT_EVENT);
+    DeliverJson("{\"type\":\"tts\",\"state\":\"stop\"}");
+}
+
+void LoopbackProtocol::DeliverJson(const char* json) {
+    if (!channel_opened_ || on_incoming_message_ == nullptr) {
+        return;
+    }
+    last_incoming_time_ = std::chrono::steady_clock::now();
+    if (incoming_message_.Parse(json, strlen(json))) {
+        on_incoming_message_(incoming_message_);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef _LOOPBACK_PROTOCOL_H_
+#define _LOOPBACK_PROTOCOL_H_
+
+
+#include "protocol.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+
+#include <mutex>
+#include <vector>
+
+#define LOOPBACK_PROTOCOL_REPLAY_EVENT (1 << 0)
+#define LOOPBACK_PROTOCOL_ABORT_EVENT  (1 << 1)
+#define LOOPBACK_PROTOCOL_STOP_EVENT   (1 << 2)
+
+#define LOOPBACK_MAX_PACKETS      300   // 18 s of 60 ms frames
+#define LOOPBACK_AUTO_STOP_MS     4000  // Auto / realtime listening has no server VAD, stop recording after this
+
+/*
+ * Local stand-in for the server, no network involved.
+ *
+ * Records the uplink Opus packets of one listening turn and plays them back as the TTS reply,
+ * wrapped in the usual tts start/stop messages, so the whole audio pipeline can be exercised and
+ * timed without a server. speed > 1 replays faster than real time for throughput runs.
+ */
+class LoopbackProtocol : public Protocol {
+public:
+    LoopbackProtocol(int speed = 1);
+    ~LoopbackProtocol();
+
+    bool Start() override;
+    bool SendAudio(AudioStreamPacket& packet) override;
+    bool OpenAudioChannel() override;
+    void CloseAudioChannel() override;
+    bool IsAudioChannelOpened() const override;
+
+private:
+    EventGroupHandle_t event_group_handle_;
+    TaskHandle_t replay_task_handle_ = nullptr;
+    std::mutex mutex_;
+    std::vector<AudioStreamPacket> recorded_;
+    bool channel_opened_ = false;
+    bool recording_ = false;
+    bool auto_stop_ = false;
+    int recorded_ms_ = 0;
+    int speed_;
+
+    void ReplayTask();
+    void Replay(std::vector<AudioStreamPacket>& packets);
+    void DeliverJson(const char* json);
+    bool SendText(const std::string& text) override;
+};
+
+#endif
@@ -11,6 +11,22 @@
 
 #define TAG "MQTT"
 
+static_assert(AUDIO_DATAGRAM_HEADER_SIZE <= AUDIO_PACKET_HEADROOM, "The datagram header must fit in the packet headroom");
+
+// esp-ml307's Udp only sends a std::string, so there the datagram is copied into buffer once.
+// Transports that offer a pointer/length Send get the datagram where it was sealed.
+template <typename U>
+static int SendDatagram(U* udp, const uint8_t* datagram, size_t size, std::string& buffer) {
+    if constexpr (requires { udp->Send(datagram, size); }) {
+        return udp->Send(datagram, size);
+    } else {
+        if (datagram != (const uint8_t*)buffer.data()) {
+            buffer.assign((const char*)datagram, size);
+        }
+        return udp->Send(buffer);
+    }
+}
+
 MqttProtocol::MqttProtocol() {
     event_group_handle_ = xEventGroupCreate();
 }
@@ -60,32 +76,31 @@ bool MqttProtocol::StartMqttClient(bool report_error) {
     });
 
     mqtt_->OnMessage([this](const std::string& topic, const std::string& payload) {
-        cJSON* root = cJSON_Parse(payload.c_str());
-        if (root == nullptr) {
+        auto& message = incoming_message_;
+        if (!message.Parse(payload.data(), payload.size())) {
             ESP_LOGE(TAG, "Failed to parse json message %s", payload.c_str());
             return;
         }
-        cJSON* type = cJSON_GetObjectItem(root, "type");
-        if (!cJSON_IsString(type)) {
+        if (message.type()[0] == '\0') {
             ESP_LOGE(TAG, "Message type is invalid");
-            cJSON_Delete(root);
             return;
         }
 
-        if (strcmp(type->valuestring, "hello") == 0) {
+        if (strcmp(message.type(), "hello") == 0) {
+            cJSON* root = cJSON_ParseWithLength(payload.data(), payload.size());
             ParseServerHello(root);
-        } else if (strcmp(type->valuestring, "goodbye") == 0) {
-            auto session_id = cJSON_GetObjectItem(root, "session_id");
-            ESP_LOGI(TAG, "Received goodbye message, session_id: %s", session_id ? session_id->valuestring : "null");
-            if (session_id == nullptr || session_id_ == session_id->valuestring) {
+            cJSON_Delete(root);
+        } else if (strcmp(message.type(), "goodbye") == 0) {
+            auto session_id = message.GetString("session_id");
+            ESP_LOGI(TAG, "Received goodbye message, session_id: %s", session_id ? session_id : "null");
+            if (session_id == nullptr || session_id_ == session_id) {
                 Application::GetInstance().Schedule([this]() {
                     CloseAudioChannel();
                 });
             }
-        } else if (on_incoming_json_ != nullptr) {
-            on_incoming_json_(root);
+        } else if (on_incoming_message_ != nullptr) {
+            on_incoming_message_(message);
         }
-        cJSON_Delete(root);
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
@@ -121,30 +136,50 @@ bool MqttProtocol::SendText(const std::string& text) {
     return true;
 }
 
-bool MqttProtocol::SendAudio(const AudioStreamPacket& packet) {
+bool MqttProtocol::SendAudio(AudioStreamPacket& packet) {
     std::lock_guard<std::mutex> lock(channel_mutex_);
     if (udp_ == nullptr) {
         return false;
     }
 
-    std::string nonce(aes_nonce_);
-    *(uint16_t*)&nonce[2] = htons(packet.payload.size());
-    *(uint32_t*)&nonce[8] = htonl(packet.timestamp);
-    *(uint32_t*)&nonce[12] = htonl(++local_sequence_);
+    // Seal the frame in place, the header goes into the packet headroom
+    if (packet.headroom < AUDIO_DATAGRAM_HEADER_SIZE) {
+        ESP_LOGE(TAG, "Audio packet headroom too small: %u", packet.headroom);
+        return false;
+    }
+    auto datagram = packet.opus_data() - AUDIO_DATAGRAM_HEADER_SIZE;
+    size_t size = AUDIO_DATAGRAM_HEADER_SIZE + packet.opus_size();
+    if (!cipher_.Seal(AUDIO_DATAGRAM_TYPE_OPUS, 0, packet.timestamp, ++local_sequence_, datagram, size)) {
+        return false;
+    }
+    return SendDatagram(udp_, datagram, size, send_buffer_) > 0;
+}
 
-    std::string encrypted;
-    encrypted.resize(aes_nonce_.size() + packet.payload.size());
-    memcpy(encrypted.data(), nonce.data(), nonce.size());
+bool MqttProtocol::SendAudioBatch(std::span<AudioStreamPacket* const> packets) {
+    if (!audio_batching_ || packets.size() < 2) {
+        return Protocol::SendAudioBatch(packets);
+    }
 
-    size_t nc_off = 0;
-    uint8_t stream_block[16] = {0};
-    if (mbedtls_aes_crypt_ctr(&aes_ctx_, packet.payload.size(), &nc_off, (uint8_t*)nonce.c_str(), stream_block,
-        (uint8_t*)packet.payload.data(), (uint8_t*)&encrypted[nonce.size()]) != 0) {
-        ESP_LOGE(TAG, "Failed to encrypt audio data");
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    if (udp_ == nullptr) {
         return false;
     }
 
-    return udp_->Send(encrypted) > 0;
+    /*
+     * Batched datagram, one header for all frames:
+     * |type 1u = 0x02|flags 1u = frame count|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
+     * |frame sizes 2u * count|frames|
+     * The sequence is that of the first frame, every frame still takes one sequence number.
+     */
+    send_buffer_.resize(AUDIO_DATAGRAM_HEADER_SIZE + GetAudioBatchSize(packets));
+    auto datagram = (uint8_t*)send_buffer_.data();
+    PackAudioBatch(packets, datagram + AUDIO_DATAGRAM_HEADER_SIZE);
+    if (!cipher_.Seal(AUDIO_DATAGRAM_TYPE_OPUS_BATCH, packets.size(), packets[0]->timestamp, local_sequence_ + 1,
+        datagram, send_buffer_.size())) {
+        return false;
+    }
+    local_sequence_ += packets.size();
+    return SendDatagram(udp_, datagram, send_buffer_.size(), send_buffer_) > 0;
 }
 
 void MqttProtocol::CloseAudioChannel() {
@@ -176,6 +211,7 @@ bool MqttProtocol::OpenAudioChannel() {
     }
 
     error_occurred_ = false;
+    resume_session_id_ = session_id_;
     session_id_ = "";
     xEventGroupClearBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT);
 
@@ -198,48 +234,42 @@ bool MqttProtocol::OpenAudioChannel() {
     }
     udp_ = Board::GetInstance().CreateUdp();
     udp_->OnMessage([this](const std::string& data) {
-        /*
-         * UDP Encrypted OPUS Packet Format:
-         * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
-         * |payload payload_len|
-         */
-        if (data.size() < sizeof(aes_nonce_)) {
+        auto datagram = (const uint8_t*)data.data();
+        if (data.size() < AUDIO_DATAGRAM_HEADER_SIZE) {
             ESP_LOGE(TAG, "Invalid audio packet size: %u", data.size());
             return;
         }
-        if (data[0] != 0x01) {
-            ESP_LOGE(TAG, "Invalid audio packet type: %x", data[0]);
-            return;
-        }
-        uint32_t timestamp = ntohl(*(uint32_t*)&data[8]);
-        uint32_t sequence = ntohl(*(uint32_t*)&data[12]);
-        if (sequence < remote_sequence_) {
-            ESP_LOGW(TAG, "Received audio packet with old sequence: %lu, expected: %lu", sequence, remote_sequence_);
+        if (AudioDatagramCipher::type(datagram) != AUDIO_DATAGRAM_TYPE_OPUS) {
+            ESP_LOGE(TAG, "Invalid audio packet type: %x", AudioDatagramCipher::type(datagram));
             return;
         }
-        if (sequence != remote_sequence_ + 1) {
-            ESP_LOGW(TAG, "Received audio packet with wrong sequence: %lu, expected: %lu", sequence, remote_sequence_ + 1);
-        }
-
-        size_t decrypted_size = data.size() - aes_nonce_.size();
-        size_t nc_off = 0;
-        uint8_t stream_block[16] = {0};
-        auto nonce = (uint8_t*)data.data();
-        auto encrypted = (uint8_t*)data.data() + aes_nonce_.size();
-        AudioStreamPacket packet;
-        packet.sample_rate = server_sample_rate_;
-        packet.frame_duration = server_frame_duration_;
-        packet.timestamp = timestamp;
-        packet.payload.resize(decrypted_size);
-        int ret = mbedtls_aes_crypt_ctr(&aes_ctx_, decrypted_size, &nc_off, nonce, stream_block, encrypted, (uint8_t*)packet.payload.data());
-        if (ret != 0) {
-            ESP_LOGE(TAG, "Failed to decrypt audio data, ret: %d", ret);
-            return;
+        uint32_t timestamp = AudioDatagramCipher::timestamp(datagram);
+        uint32_t sequence = AudioDatagramCipher::sequence(datagram);
+
+        // Decrypt straight into a recycled packet, its buffer keeps the capacity of earlier frames
+        auto packet = AllocatePacket();
+        packet->sample_rate = server_sample_rate_;
+        packet->frame_duration = server_frame_duration_;
+        packet->timestamp = timestamp;
+        packet->sequence = sequence;
+        packet->payload.resize(packet->headroom + data.size() - AUDIO_DATAGRAM_HEADER_SIZE);
+        {
+            std::lock_guard<std::mutex> lock(cipher_mutex_);
+            // Out of order packets are passed on, the jitter buffer puts them back in order
+            if (sequence != remote_sequence_ + 1) {
+                ESP_LOGD(TAG, "Received audio packet with sequence: %lu, expected: %lu", sequence, remote_sequence_ + 1);
+            }
+            if (!cipher_.Open(datagram, data.size(), packet->opus_data())) {
+                RecyclePacket(std::move(packet));
+                return;
+            }
+            if (int32_t(sequence - remote_sequence_) > 0) {
+                remote_sequence_ = sequence;
+            }
         }
         if (on_incoming_audio_ != nullptr) {
             on_incoming_audio_(std::move(packet));
         }
-        remote_sequence_ = sequence;
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
@@ -256,6 +286,7 @@ std::string MqttProtocol::GetHelloMessage() {
     cJSON* root = cJSON_CreateObject();
     cJSON_AddStringToObject(root, "type", "hello");
     cJSON_AddNumberToObject(root, "version", 3);
+    AddResumeSession(root);
     cJSON_AddStringToObject(root, "transport", "udp");
     cJSON* features = cJSON_CreateObject();
 #if CONFIG_USE_SERVER_AEC
@@ -264,13 +295,9 @@ std::string MqttProtocol::GetHelloMessage() {
 #if CONFIG_IOT_PROTOCOL_MCP
     cJSON_AddBoolToObject(features, "mcp", true);
 #endif
+    AddBatchFeature(features);
     cJSON_AddItemToObject(root, "features", features);
-    cJSON* audio_params = cJSON_CreateObject();
-    cJSON_AddStringToObject(audio_params, "format", "opus");
-    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
-    cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
-    cJSON_AddItemToObject(root, "audio_params", audio_params);
+    cJSON_AddItemToObject(root, "audio_params", CreateAudioParams());
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
     cJSON_free(json_str);
@@ -291,18 +318,9 @@ void MqttProtocol::ParseServerHello(const cJSON* root) {
         ESP_LOGI(TAG, "Session ID: %s", session_id_.c_str());
     }
 
-    // Get sample rate from hello message
-    auto audio_params = cJSON_GetObjectItem(root, "audio_params");
-    if (cJSON_IsObject(audio_params)) {
-        auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
-        if (cJSON_IsNumber(sample_rate)) {
-            server_sample_rate_ = sample_rate->valueint;
-        }
-        auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
-        if (cJSON_IsNumber(frame_duration)) {
-            server_frame_duration_ = frame_duration->valueint;
-        }
-    }
+    // Get sample rate, frame duration and bitrate from hello message
+    ParseAudioParams(cJSON_GetObjectItem(root, "audio_params"));
+    ParseServerFeatures(cJSON_GetObjectItem(root, "features"));
 
     auto udp = cJSON_GetObjectItem(root, "udp");
     if (!cJSON_IsObject(udp)) {
@@ -316,11 +334,14 @@ void MqttProtocol::ParseServerHello(const cJSON* root) {
 
     // auto encryption = cJSON_GetObjectItem(udp, "encryption")->valuestring;
     // ESP_LOGI(TAG, "UDP server: %s, port: %d, encryption: %s", udp_server_.c_str(), udp_port_, encryption);
-    aes_nonce_ = DecodeHexString(nonce);
-    mbedtls_aes_init(&aes_ctx_);
-    mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char*)DecodeHexString(key).c_str(), 128);
-    local_sequence_ = 0;
-    remote_sequence_ = 0;
+    {
+        // A hello can arrive while the UDP task decrypts and the audio task encrypts with the old key
+        std::lock_guard<std::mutex> channel_lock(channel_mutex_);
+        std::lock_guard<std::mutex> cipher_lock(cipher_mutex_);
+        cipher_.SetKey(DecodeHexString(key), DecodeHexString(nonce));
+        local_sequence_ = 0;
+        remote_sequence_ = 0;
+    }
     xEventGroupSetBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT);
 }
 
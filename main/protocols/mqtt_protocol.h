@@ -3,10 +3,10 @@
 
 
 #include "protocol.h"
+#include "audio_datagram_cipher.h"
 #include <mqtt.h>
 #include <udp.h>
 #include <cJSON.h>
-#include <mbedtls/aes.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 
@@ -26,7 +26,8 @@ public:
     ~MqttProtocol();
 
     bool Start() override;
-    bool SendAudio(const AudioStreamPacket& packet) override;
+    bool SendAudio(AudioStreamPacket& packet) override;
+    bool SendAudioBatch(std::span<AudioStreamPacket* const> packets) override;
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
@@ -39,12 +40,15 @@ private:
     std::mutex channel_mutex_;
     Mqtt* mqtt_ = nullptr;
     Udp* udp_ = nullptr;
-    mbedtls_aes_context aes_ctx_;
-    std::string aes_nonce_;
+    AudioDatagramCipher cipher_;
+    // Guards cipher_ and remote_sequence_ on the UDP receive path. It is not channel_mutex_, which is held
+    // while udp_ is deleted, so the receive task never waits on its own teardown
+    std::mutex cipher_mutex_;
     std::string udp_server_;
     int udp_port_;
     uint32_t local_sequence_;
     uint32_t remote_sequence_;
+    std::string send_buffer_;  // Batched datagrams are packed here, reused so sending does not allocate
 
     bool StartMqttClient(bool report_error=false);
     void ParseServerHello(const cJSON* root);
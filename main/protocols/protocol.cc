@@ -1,20 +1,46 @@
 #include "protocol.h"
 #include "settings.h"
 
+#include <cstring>
 #include <esp_log.h>
+#include <arpa/inet.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
 #define TAG "Protocol"
 
-void Protocol::OnIncomingJson(std::function<void(const cJSON* root)> callback) {
-    on_incoming_json_ = callback;
+void Protocol::OnIncomingMessage(std::function<void(ControlMessage& message)> callback) {
+    on_incoming_message_ = callback;
 }
 
-void Protocol::OnIncomingAudio(std::function<void(AudioStreamPacket&& packet)> callback) {
+void Protocol::OnIncomingAudio(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> callback) {
     on_incoming_audio_ = callback;
 }
 
+void Protocol::SetPacketAllocator(std::function<std::unique_ptr<AudioStreamPacket>()> allocator) {
+    packet_allocator_ = allocator;
+}
+
+void Protocol::SetPacketRecycler(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> recycler) {
+    packet_recycler_ = recycler;
+}
+
+std::unique_ptr<AudioStreamPacket> Protocol::AllocatePacket() {
+    if (packet_allocator_ != nullptr) {
+        return packet_allocator_();
+    }
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->headroom = AUDIO_PACKET_HEADROOM;
+    packet->payload.assign(AUDIO_PACKET_HEADROOM, 0);
+    return packet;
+}
+
+void Protocol::RecyclePacket(std::unique_ptr<AudioStreamPacket> packet) {
+    if (packet_recycler_ != nullptr) {
+        packet_recycler_(std::move(packet));
+    }
+}
+
 void Protocol::OnAudioChannelOpened(std::function<void()> callback) {
     on_audio_channel_opened_ = callback;
 }
@@ -27,6 +53,109 @@ void Protocol::OnNetworkError(std::function<void(const std::string& message)> ca
     on_network_error_ = callback;
 }
 
+void Protocol::SetAudioParams(int frame_duration, int bitrate) {
+    client_frame_duration_ = frame_duration;
+    client_bitrate_ = bitrate;
+}
+
+void Protocol::SetSessionResume(bool enable) {
+    session_resume_ = enable;
+}
+
+void Protocol::AddResumeSession(cJSON* hello) const {
+    // Servers that do not support resumption ignore it and answer with a new session_id
+    if (session_resume_ && !resume_session_id_.empty()) {
+        cJSON_AddStringToObject(hello, "session_id", resume_session_id_.c_str());
+    }
+}
+
+cJSON* Protocol::CreateAudioParams() const {
+    cJSON* audio_params = cJSON_CreateObject();
+    cJSON_AddStringToObject(audio_params, "format", "opus");
+    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
+    cJSON_AddNumberToObject(audio_params, "channels", 1);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", client_frame_duration_);
+    if (client_bitrate_ > 0) {
+        cJSON_AddNumberToObject(audio_params, "bitrate", client_bitrate_);
+    }
+    return audio_params;
+}
+
+void Protocol::ParseAudioParams(const cJSON* audio_params) {
+    // frame_duration describes the server's own (downlink) frames. The uplink is only changed when the
+    // server answers uplink_frame_duration, older servers get the 60 ms frames they always got.
+    uplink_frame_duration_ = 60;
+    uplink_bitrate_ = 0;
+    if (!cJSON_IsObject(audio_params)) {
+        return;
+    }
+    auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
+    if (cJSON_IsNumber(sample_rate)) {
+        server_sample_rate_ = sample_rate->valueint;
+    }
+    auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
+    if (cJSON_IsNumber(frame_duration)) {
+        server_frame_duration_ = frame_duration->valueint;
+    }
+    auto uplink_frame_duration = cJSON_GetObjectItem(audio_params, "uplink_frame_duration");
+    if (cJSON_IsNumber(uplink_frame_duration)) {
+        if (OPUS_FRAME_DURATION_VALID(uplink_frame_duration->valueint)) {
+            uplink_frame_duration_ = uplink_frame_duration->valueint;
+        } else {
+            ESP_LOGW(TAG, "Server asked for %d ms uplink frames, keeping %d ms", uplink_frame_duration->valueint, uplink_frame_duration_);
+        }
+    }
+    auto uplink_bitrate = cJSON_GetObjectItem(audio_params, "uplink_bitrate");
+    if (cJSON_IsNumber(uplink_bitrate)) {
+        uplink_bitrate_ = uplink_bitrate->valueint;
+    }
+}
+
+void Protocol::AddBatchFeature(cJSON* features) const {
+    cJSON_AddBoolToObject(features, "audio_batch", true);
+}
+
+void Protocol::ParseServerFeatures(const cJSON* features) {
+    // Batching stays off unless the server answers with features.audio_batch, older servers only know single frames
+    audio_batching_ = false;
+    if (!cJSON_IsObject(features)) {
+        return;
+    }
+    auto audio_batch = cJSON_GetObjectItem(features, "audio_batch");
+    audio_batching_ = cJSON_IsTrue(audio_batch);
+    if (audio_batching_) {
+        ESP_LOGI(TAG, "Server accepts batched audio, up to %d frames per message", AUDIO_BATCH_MAX_FRAMES);
+    }
+}
+
+bool Protocol::SendAudioBatch(std::span<AudioStreamPacket* const> packets) {
+    for (auto packet : packets) {
+        if (!SendAudio(*packet)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Protocol::GetAudioBatchSize(std::span<AudioStreamPacket* const> packets) {
+    size_t size = packets.size() * sizeof(uint16_t);
+    for (auto packet : packets) {
+        size += packet->opus_size();
+    }
+    return size;
+}
+
+size_t Protocol::PackAudioBatch(std::span<AudioStreamPacket* const> packets, uint8_t* dest) {
+    uint8_t* frame = dest + packets.size() * sizeof(uint16_t);
+    for (size_t i = 0; i < packets.size(); i++) {
+        uint16_t size = htons(packets[i]->opus_size());
+        memcpy(dest + i * sizeof(uint16_t), &size, sizeof(size));
+        memcpy(frame, packets[i]->opus_data(), packets[i]->opus_size());
+        frame += packets[i]->opus_size();
+    }
+    return frame - dest;
+}
+
 void Protocol::SetError(const std::string& message) {
     error_occurred_ = true;
     if (on_network_error_ != nullptr) {
@@ -153,7 +282,18 @@ void Protocol::SendMcpMessage(const std::string& payload) {
     SendText(message);
 }
 
+void Protocol::SetIdle(bool idle) {
+    if (!idle && idle_) {
+        // The turn starts the timeout over, the quiet time before it does not count
+        last_incoming_time_ = std::chrono::steady_clock::now();
+    }
+    idle_ = idle;
+}
+
 bool Protocol::IsTimeout() const {
+    if (idle_) {
+        return false;
+    }
     const int kTimeoutSeconds = 120;
     auto now = std::chrono::steady_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - last_incoming_time_);
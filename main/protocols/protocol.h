@@ -1,17 +1,38 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include "control_message.h"
+
 #include <cJSON.h>
+#include <atomic>
 #include <string>
 #include <functional>
 #include <chrono>
 #include <vector>
+#include <memory>
+#include <span>
+
+// Room kept in front of encoded Opus data, so a transport can write its header (BinaryProtocol2/3, UDP datagram) in place
+#define AUDIO_PACKET_HEADROOM 16
+// Uplink frame durations the device can negotiate, shorter frames cut latency but cost more CPU and bandwidth
+#define OPUS_FRAME_DURATION_VALID(ms) ((ms) == 20 || (ms) == 40 || (ms) == 60)
+// Most Opus frames packed into one batched audio message, once the server opted in with features.audio_batch
+#define AUDIO_BATCH_MAX_FRAMES 4
 
 struct AudioStreamPacket {
     int sample_rate = 0;
     int frame_duration = 0;
     uint32_t timestamp = 0;
-    std::vector<uint8_t> payload;
+    uint32_t sequence = 0;  // 0 if the transport has no sequence numbers
+    std::vector<uint8_t> payload;  // Opus data starts at headroom
+    uint16_t headroom = 0;
+    // Local esp_timer times for latency statistics, 0 if unknown
+    int64_t origin_time_us = 0;   // Mic read (uplink) or network receive (downlink)
+    int64_t encoded_time_us = 0;  // Uplink only
+
+    inline uint8_t* opus_data() { return payload.data() + headroom; }
+    inline const uint8_t* opus_data() const { return payload.data() + headroom; }
+    inline size_t opus_size() const { return payload.size() - headroom; }
 };
 
 struct BinaryProtocol2 {
@@ -30,6 +51,17 @@ struct BinaryProtocol3 {
     uint8_t payload[];
 } __attribute__((packed));
 
+// Batched uplink audio (protocol v4), sent instead of single frames when the send queue backs up
+struct BinaryProtocol4 {
+    uint8_t type;           // Message type (0: OPUS)
+    uint8_t frame_count;    // Number of Opus frames, 1..AUDIO_BATCH_MAX_FRAMES
+    uint16_t payload_size;  // Bytes after this header: length table + frames
+    uint32_t timestamp;     // Timestamp of the first frame in milliseconds
+    uint8_t payload[];      // uint16_t frame sizes (big endian) followed by the frames back to back
+} __attribute__((packed));
+
+static_assert(sizeof(BinaryProtocol4) + sizeof(uint16_t) <= AUDIO_PACKET_HEADROOM, "A one-frame batch header must fit in the packet headroom");
+
 enum AbortReason {
     kAbortReasonNone,
     kAbortReasonWakeWordDetected
@@ -51,12 +83,36 @@ public:
     inline int server_frame_duration() const {
         return server_frame_duration_;
     }
+    // Uplink frame duration and bitrate the server accepted, 60 ms and 0 if it did not answer
+    inline int uplink_frame_duration() const {
+        return uplink_frame_duration_;
+    }
+    inline int uplink_bitrate() const {
+        return uplink_bitrate_;
+    }
+    // Frames the transport may pack into one message, 1 until the server accepts batching
+    inline size_t max_audio_batch() const {
+        return audio_batching_ ? AUDIO_BATCH_MAX_FRAMES : 1;
+    }
     inline const std::string& session_id() const {
         return session_id_;
     }
 
-    void OnIncomingAudio(std::function<void(AudioStreamPacket&& packet)> callback);
-    void OnIncomingJson(std::function<void(const cJSON* root)> callback);
+    // Uplink audio parameters the device asks for in the hello message, bitrate 0 means encoder default
+    void SetAudioParams(int frame_duration, int bitrate);
+    // Ask the server in the next hello to continue the previous session instead of starting a new one
+    void SetSessionResume(bool enable);
+    // A warm channel waits between turns with nothing to receive, so it does not time out while idle.
+    // Dropped connections still close it through the transport
+    void SetIdle(bool idle);
+
+    void OnIncomingAudio(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> callback);
+    // Incoming packets are taken from here when set, so their buffers can be recycled
+    void SetPacketAllocator(std::function<std::unique_ptr<AudioStreamPacket>()> allocator);
+    // Allocated packets a transport drops instead of passing on are handed back here
+    void SetPacketRecycler(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> recycler);
+    // Control messages other than hello, the message is only valid during the callback
+    void OnIncomingMessage(std::function<void(ControlMessage& message)> callback);
     void OnAudioChannelOpened(std::function<void()> callback);
     void OnAudioChannelClosed(std::function<void()> callback);
     void OnNetworkError(std::function<void(const std::string& message)> callback);
@@ -65,7 +121,10 @@ public:
     virtual bool OpenAudioChannel() = 0;
     virtual void CloseAudioChannel() = 0;
     virtual bool IsAudioChannelOpened() const = 0;
-    virtual bool SendAudio(const AudioStreamPacket& packet) = 0;
+    // May write a transport header into the packet headroom and encrypt the payload in place
+    virtual bool SendAudio(AudioStreamPacket& packet) = 0;
+    // Send consecutive frames, transports that support batching pack them into one message
+    virtual bool SendAudioBatch(std::span<AudioStreamPacket* const> packets);
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
@@ -76,20 +135,41 @@ public:
     virtual void SendMcpMessage(const std::string& message);
 
 protected:
-    std::function<void(const cJSON* root)> on_incoming_json_;
-    std::function<void(AudioStreamPacket&& packet)> on_incoming_audio_;
+    std::function<void(ControlMessage& message)> on_incoming_message_;
+    std::function<void(std::unique_ptr<AudioStreamPacket> packet)> on_incoming_audio_;
+    std::function<std::unique_ptr<AudioStreamPacket>()> packet_allocator_;
+    std::function<void(std::unique_ptr<AudioStreamPacket> packet)> packet_recycler_;
     std::function<void()> on_audio_channel_opened_;
     std::function<void()> on_audio_channel_closed_;
     std::function<void(const std::string& message)> on_network_error_;
 
     int server_sample_rate_ = 24000;
     int server_frame_duration_ = 60;
+    int uplink_frame_duration_ = 60;
+    int uplink_bitrate_ = 0;
+    int client_frame_duration_ = 60;
+    int client_bitrate_ = 0;
+    bool audio_batching_ = false;
+    bool session_resume_ = false;
+    std::string resume_session_id_;  // Session of the last channel, taken when a new one is opened
     bool error_occurred_ = false;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
+    std::atomic<bool> idle_ = false;
+    ControlMessage incoming_message_;  // Reused for every text frame, transports receive on one task
 
     virtual bool SendText(const std::string& text) = 0;
     virtual void SetError(const std::string& message);
+    cJSON* CreateAudioParams() const;
+    std::unique_ptr<AudioStreamPacket> AllocatePacket();
+    void RecyclePacket(std::unique_ptr<AudioStreamPacket> packet);
+    void ParseAudioParams(const cJSON* audio_params);
+    void AddBatchFeature(cJSON* features) const;
+    void AddResumeSession(cJSON* hello) const;
+    void ParseServerFeatures(const cJSON* features);
+    // Write the frame size table and the frames of a batch to dest, returns the bytes written
+    static size_t PackAudioBatch(std::span<AudioStreamPacket* const> packets, uint8_t* dest);
+    static size_t GetAudioBatchSize(std::span<AudioStreamPacket* const> packets);
     virtual bool IsTimeout() const;
 };
 
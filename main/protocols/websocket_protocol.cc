@@ -28,36 +28,74 @@ bool WebsocketProtocol::Start() {
     return true;
 }
 
-bool WebsocketProtocol::SendAudio(const AudioStreamPacket& packet) {
+bool WebsocketProtocol::SendAudio(AudioStreamPacket& packet) {
     if (websocket_ == nullptr) {
         return false;
     }
 
-    if (version_ == 2) {
-        std::string serialized;
-        serialized.resize(sizeof(BinaryProtocol2) + packet.payload.size());
-        auto bp2 = (BinaryProtocol2*)serialized.data();
+    // Binary frames carry no type the server could tell apart, so once batching is on every frame is a batch
+    size_t header_size = 0;
+    if (audio_batching_) {
+        header_size = sizeof(BinaryProtocol4) + sizeof(uint16_t);
+    } else if (version_ == 2) {
+        header_size = sizeof(BinaryProtocol2);
+    } else if (version_ == 3) {
+        header_size = sizeof(BinaryProtocol3);
+    }
+    if (packet.headroom < header_size) {
+        // Every packet allocator reserves AUDIO_PACKET_HEADROOM, making room here would move the whole frame
+        ESP_LOGE(TAG, "Audio packet has %u bytes of headroom, the header needs %u", (unsigned)packet.headroom, (unsigned)header_size);
+        return false;
+    }
+
+    // Write the header right in front of the Opus data and send the frame in place
+    size_t opus_size = packet.opus_size();
+    uint8_t* frame = packet.opus_data() - header_size;
+    if (audio_batching_) {
+        auto bp4 = (BinaryProtocol4*)frame;
+        bp4->type = 0;
+        bp4->frame_count = 1;
+        bp4->payload_size = htons(sizeof(uint16_t) + opus_size);
+        bp4->timestamp = htonl(packet.timestamp);
+        uint16_t size = htons(opus_size);
+        memcpy(bp4->payload, &size, sizeof(size));
+    } else if (version_ == 2) {
+        auto bp2 = (BinaryProtocol2*)frame;
         bp2->version = htons(version_);
         bp2->type = 0;
         bp2->reserved = 0;
         bp2->timestamp = htonl(packet.timestamp);
-        bp2->payload_size = htonl(packet.payload.size());
-        memcpy(bp2->payload, packet.payload.data(), packet.payload.size());
-
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        bp2->payload_size = htonl(opus_size);
     } else if (version_ == 3) {
-        std::string serialized;
-        serialized.resize(sizeof(BinaryProtocol3) + packet.payload.size());
-        auto bp3 = (BinaryProtocol3*)serialized.data();
+        auto bp3 = (BinaryProtocol3*)frame;
         bp3->type = 0;
         bp3->reserved = 0;
-        bp3->payload_size = htons(packet.payload.size());
-        memcpy(bp3->payload, packet.payload.data(), packet.payload.size());
+        bp3->payload_size = htons(opus_size);
+    }
+    return websocket_->Send(frame, header_size + opus_size, true);
+}
 
-        return websocket_->Send(serialized.data(), serialized.size(), true);
-    } else {
-        return websocket_->Send(packet.payload.data(), packet.payload.size(), true);
+bool WebsocketProtocol::SendAudioBatch(std::span<AudioStreamPacket* const> packets) {
+    if (!audio_batching_) {
+        return Protocol::SendAudioBatch(packets);
+    }
+    if (packets.size() == 1) {
+        // A lone frame fits its batch header into the packet headroom
+        return SendAudio(*packets[0]);
+    }
+    if (websocket_ == nullptr) {
+        return false;
     }
+
+    size_t payload_size = GetAudioBatchSize(packets);
+    batch_buffer_.resize(sizeof(BinaryProtocol4) + payload_size);
+    auto bp4 = (BinaryProtocol4*)batch_buffer_.data();
+    bp4->type = 0;
+    bp4->frame_count = packets.size();
+    bp4->payload_size = htons(payload_size);
+    bp4->timestamp = htonl(packets[0]->timestamp);
+    PackAudioBatch(packets, bp4->payload);
+    return websocket_->Send(batch_buffer_.data(), batch_buffer_.size(), true);
 }
 
 bool WebsocketProtocol::SendText(const std::string& text) {
@@ -99,6 +137,7 @@ bool WebsocketProtocol::OpenAudioChannel() {
     }
 
     error_occurred_ = false;
+    resume_session_id_ = session_id_;
 
     websocket_ = Board::GetInstance().CreateWebSocket();
     
@@ -116,55 +155,56 @@ bool WebsocketProtocol::OpenAudioChannel() {
     websocket_->OnData([this](const char* data, size_t len, bool binary) {
         if (binary) {
             if (on_incoming_audio_ != nullptr) {
+                // The header comes from the server, its payload size must stay within the frame
+                uint32_t timestamp = 0;
+                const char* payload = data;
+                size_t payload_size = len;
                 if (version_ == 2) {
+                    if (len < sizeof(BinaryProtocol2)) {
+                        ESP_LOGE(TAG, "Audio frame too short: %u", (unsigned)len);
+                        return;
+                    }
                     BinaryProtocol2* bp2 = (BinaryProtocol2*)data;
-                    bp2->version = ntohs(bp2->version);
-                    bp2->type = ntohs(bp2->type);
-                    bp2->timestamp = ntohl(bp2->timestamp);
-                    bp2->payload_size = ntohl(bp2->payload_size);
-                    auto payload = (uint8_t*)bp2->payload;
-                    on_incoming_audio_(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = bp2->timestamp,
-                        .payload = std::vector<uint8_t>(payload, payload + bp2->payload_size)
-                    });
+                    timestamp = ntohl(bp2->timestamp);
+                    payload = (const char*)bp2->payload;
+                    payload_size = ntohl(bp2->payload_size);
                 } else if (version_ == 3) {
+                    if (len < sizeof(BinaryProtocol3)) {
+                        ESP_LOGE(TAG, "Audio frame too short: %u", (unsigned)len);
+                        return;
+                    }
                     BinaryProtocol3* bp3 = (BinaryProtocol3*)data;
-                    bp3->type = bp3->type;
-                    bp3->payload_size = ntohs(bp3->payload_size);
-                    auto payload = (uint8_t*)bp3->payload;
-                    on_incoming_audio_(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = 0,
-                        .payload = std::vector<uint8_t>(payload, payload + bp3->payload_size)
-                    });
-                } else {
-                    on_incoming_audio_(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = 0,
-                        .payload = std::vector<uint8_t>((uint8_t*)data, (uint8_t*)data + len)
-                    });
+                    payload = (const char*)bp3->payload;
+                    payload_size = ntohs(bp3->payload_size);
+                }
+                if (payload_size > len - (payload - data)) {
+                    ESP_LOGE(TAG, "Audio payload size %u exceeds the frame of %u bytes", (unsigned)payload_size, (unsigned)len);
+                    return;
                 }
+
+                // The websocket reuses its receive buffer, so the payload is copied once into a recycled packet
+                auto packet = AllocatePacket();
+                packet->sample_rate = server_sample_rate_;
+                packet->frame_duration = server_frame_duration_;
+                packet->timestamp = timestamp;
+                packet->payload.resize(packet->headroom + payload_size);
+                memcpy(packet->opus_data(), payload, payload_size);
+                on_incoming_audio_(std::move(packet));
             }
         } else {
-            // Parse JSON data
-            auto root = cJSON_Parse(data);
-            auto type = cJSON_GetObjectItem(root, "type");
-            if (cJSON_IsString(type)) {
-                if (strcmp(type->valuestring, "hello") == 0) {
-                    ParseServerHello(root);
-                } else {
-                    if (on_incoming_json_ != nullptr) {
-                        on_incoming_json_(root);
-                    }
-                }
-            } else {
-                ESP_LOGE(TAG, "Missing message type, data: %s", data);
+            // Only the server hello is worth a cJSON tree, everything else is read in one pass
+            auto& message = incoming_message_;
+            if (!message.Parse(data, len)) {
+                ESP_LOGE(TAG, "Invalid JSON message: %.*s", (int)len, data);
+            } else if (message.type()[0] == '\0') {
+                ESP_LOGE(TAG, "Missing message type, data: %.*s", (int)len, data);
+            } else if (strcmp(message.type(), "hello") == 0) {
+                auto root = cJSON_ParseWithLength(data, len);
+                ParseServerHello(root);
+                cJSON_Delete(root);
+            } else if (on_incoming_message_ != nullptr) {
+                on_incoming_message_(message);
             }
-            cJSON_Delete(root);
         }
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
@@ -209,6 +249,7 @@ std::string WebsocketProtocol::GetHelloMessage() {
     cJSON* root = cJSON_CreateObject();
     cJSON_AddStringToObject(root, "type", "hello");
     cJSON_AddNumberToObject(root, "version", version_);
+    AddResumeSession(root);
     cJSON* features = cJSON_CreateObject();
 #if CONFIG_USE_SERVER_AEC
     cJSON_AddBoolToObject(features, "aec", true);
@@ -216,14 +257,10 @@ std::string WebsocketProtocol::GetHelloMessage() {
 #if CONFIG_IOT_PROTOCOL_MCP
     cJSON_AddBoolToObject(features, "mcp", true);
 #endif
+    AddBatchFeature(features);
     cJSON_AddItemToObject(root, "features", features);
     cJSON_AddStringToObject(root, "transport", "websocket");
-    cJSON* audio_params = cJSON_CreateObject();
-    cJSON_AddStringToObject(audio_params, "format", "opus");
-    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
-    cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
-    cJSON_AddItemToObject(root, "audio_params", audio_params);
+    cJSON_AddItemToObject(root, "audio_params", CreateAudioParams());
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
     cJSON_free(json_str);
@@ -244,17 +281,8 @@ void WebsocketProtocol::ParseServerHello(const cJSON* root) {
         ESP_LOGI(TAG, "Session ID: %s", session_id_.c_str());
     }
 
-    auto audio_params = cJSON_GetObjectItem(root, "audio_params");
-    if (cJSON_IsObject(audio_params)) {
-        auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
-        if (cJSON_IsNumber(sample_rate)) {
-            server_sample_rate_ = sample_rate->valueint;
-        }
-        auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
-        if (cJSON_IsNumber(frame_duration)) {
-            server_frame_duration_ = frame_duration->valueint;
-        }
-    }
+    ParseAudioParams(cJSON_GetObjectItem(root, "audio_params"));
+    ParseServerFeatures(cJSON_GetObjectItem(root, "features"));
 
     xEventGroupSetBits(event_group_handle_, WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT);
 }
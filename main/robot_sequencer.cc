@@ -0,0 +1,116 @@
+#include "robot_sequencer.h"
+#include "second_uart.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cJSON.h>
+
+#define TAG "RobotSequencer"
+
+bool RobotSequencer::Start(std::vector<RobotStep> steps) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (current_step_ >= 0) {
+            ESP_LOGI(TAG, "Replacing sequence at step %d/%d", current_step_ + 1, (int)steps_.size());
+        }
+        steps_ = std::move(steps);
+        current_step_ = steps_.empty() ? -1 : 0;
+        generation_++;
+        ESP_LOGI(TAG, "Start sequence of %d steps", (int)steps_.size());
+
+        if (task_handle_ == nullptr) {
+            BaseType_t ret = xTaskCreate([](void* arg) {
+                auto sequencer = (RobotSequencer*)arg;
+                sequencer->SequencerTask();
+                vTaskDelete(NULL);
+            }, "robot_seq", ROBOT_SEQUENCER_STACK_SIZE, this, 2, &task_handle_);
+            if (ret != pdPASS) {
+                // Back to idle, so Cancel() does not notify a task that does not exist and the next Start() tries again
+                ESP_LOGE(TAG, "Failed to create the sequencer task");
+                steps_.clear();
+                current_step_ = -1;
+                task_handle_ = nullptr;
+                return false;
+            }
+            return true;
+        }
+    }
+    xTaskNotifyGive(task_handle_);
+    return true;
+}
+
+void RobotSequencer::Cancel(const char* reason) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (current_step_ < 0) {
+            return;
+        }
+        ESP_LOGI(TAG, "Cancel sequence at step %d/%d: %s", current_step_ + 1, (int)steps_.size(), reason);
+        steps_.clear();
+        current_step_ = -1;
+        generation_++;
+    }
+    xTaskNotifyGive(task_handle_);
+}
+
+bool RobotSequencer::IsRunning() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_step_ >= 0;
+}
+
+std::string RobotSequencer::GetStatusJson() {
+    cJSON* json = cJSON_CreateObject();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cJSON_AddBoolToObject(json, "running", current_step_ >= 0);
+        if (current_step_ >= 0) {
+            cJSON_AddNumberToObject(json, "step", current_step_);
+            cJSON_AddNumberToObject(json, "steps", steps_.size());
+            cJSON_AddStringToObject(json, "command", steps_[current_step_].command.c_str());
+            cJSON_AddNumberToObject(json, "elapsed_ms", (esp_timer_get_time() - step_start_time_) / 1000);
+        }
+    }
+    auto json_str = cJSON_PrintUnformatted(json);
+    std::string result(json_str);
+    cJSON_free(json_str);
+    cJSON_Delete(json);
+    return result;
+}
+
+bool RobotSequencer::NextStep(RobotStep& step, uint32_t& generation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_step_ < 0) {
+        return false;
+    }
+    if (current_step_ >= (int)steps_.size()) {
+        ESP_LOGI(TAG, "Sequence of %d steps finished", (int)steps_.size());
+        steps_.clear();
+        current_step_ = -1;
+        return false;
+    }
+    step = steps_[current_step_];
+    generation = generation_;
+    step_start_time_ = esp_timer_get_time();
+    return true;
+}
+
+void RobotSequencer::SequencerTask() {
+    RobotStep step;
+    uint32_t generation;
+    while (true) {
+        if (!NextStep(step, generation)) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        ESP_LOGI(TAG, "Step: %s for %d ms", step.command.c_str(), step.duration_ms);
+        SecondUart::GetInstance().SendString(step.command);
+        // Start and Cancel notify the task, a replaced or cancelled sequence does not sit out the step
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(step.duration_ms));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation == generation_) {
+            current_step_++;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef ROBOT_SEQUENCER_H
+#define ROBOT_SEQUENCER_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define ROBOT_SEQUENCE_MAX_STEPS        16
+#define ROBOT_STEP_MAX_DURATION_MS      10000
+#define ROBOT_SEQUENCER_STACK_SIZE      3072
+
+struct RobotStep {
+    std::string command;
+    int duration_ms = 0;    // Time given to the command before the next step is sent
+};
+
+/*
+ * Plays a timed list of robot commands on its own task, so a multi-action request is one MCP call
+ * instead of one call per action with the LLM waiting in between.
+ *
+ * Start() replaces whatever sequence is running, Cancel() stops it between two steps; both wake the
+ * task out of its step wait at once. The command already sent is not undone.
+ */
+class RobotSequencer {
+public:
+    static RobotSequencer& GetInstance() {
+        static RobotSequencer instance;
+        return instance;
+    }
+    RobotSequencer(const RobotSequencer&) = delete;
+    RobotSequencer& operator=(const RobotSequencer&) = delete;
+
+    // False when the sequencer task could not be created, nothing runs then
+    bool Start(std::vector<RobotStep> steps);
+    // Safe to call when nothing runs, reason is only logged
+    void Cancel(const char* reason);
+    bool IsRunning();
+    // {"running":true,"step":1,"steps":3,"command":"ksit","elapsed_ms":420}, step counts from 0
+    std::string GetStatusJson();
+
+private:
+    RobotSequencer() = default;
+
+    std::mutex mutex_;
+    std::vector<RobotStep> steps_;
+    int current_step_ = -1;         // -1 while idle
+    uint32_t generation_ = 0;       // Bumped by Start and Cancel, a step of an older generation is not advanced
+    int64_t step_start_time_ = 0;
+    TaskHandle_t task_handle_ = nullptr;
+
+    bool NextStep(RobotStep& step, uint32_t& generation);
+    void SequencerTask();
+};
+
+#endif // ROBOT_SEQUENCER_H
@@ -1,4 +1,109 @@
 #include "second_uart.h"
 
+#define TAG "SecondUart"
+
 // 静态成员定义
-SecondUart* SecondUart::instance_ = nullptr; 
\ No newline at end of file
+SecondUart* SecondUart::instance_ = nullptr;
+
+// 持续运动的步态，会一直执行到下一条指令，排在另一条步态前面的步态实际上不会被执行
+bool SecondUart::IsGaitCommand(const std::string& command) {
+    static const char* const kGaitPrefixes[] = {"kwk", "kbk", "kvt", "ktr", "krn", "kcr"};
+    for (auto prefix : kGaitPrefixes) {
+        if (command.compare(0, strlen(prefix), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SecondUart::SendData(const char* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    std::string command(data, length);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 去重：与前一条指令完全相同则不重复发送
+        const std::string& previous = queue_.empty() ? last_command_ : queue_.back();
+        if (command == previous) {
+            ESP_LOGI(TAG, "Skip duplicate command: %s", command.c_str());
+            return;
+        }
+
+        if (command == ROBOT_REST_CMD) {
+            // 休息优先，尚未发送的动作不再执行
+            if (!queue_.empty()) {
+                ESP_LOGI(TAG, "Rest supersedes %d queued commands", (int)queue_.size());
+                queue_.clear();
+            }
+        } else if (!queue_.empty() && IsGaitCommand(command) && IsGaitCommand(queue_.back())) {
+            ESP_LOGI(TAG, "Replace queued gait %s with %s", queue_.back().c_str(), command.c_str());
+            queue_.back() = std::move(command);
+            return;
+        } else if (queue_.size() >= SECOND_UART_TX_QUEUE_LENGTH) {
+            ESP_LOGW(TAG, "TX queue full, drop %s", queue_.front().c_str());
+            queue_.pop_front();
+        }
+        queue_.push_back(std::move(command));
+
+        if (writer_task_ == nullptr) {
+            BaseType_t ret = xTaskCreate([](void* arg) {
+                auto uart = (SecondUart*)arg;
+                uart->WriterTask();
+                vTaskDelete(NULL);
+            }, "uart_tx", SECOND_UART_WRITER_STACK_SIZE, this, 3, &writer_task_);
+            if (ret != pdPASS) {
+                // 指令留在队列中，下一条指令到来时再尝试创建发送任务
+                ESP_LOGE(TAG, "Failed to create the writer task, %d commands queued", (int)queue_.size());
+                writer_task_ = nullptr;
+            }
+            return;
+        }
+    }
+    xTaskNotifyGive(writer_task_);
+}
+
+void SecondUart::WriterTask() {
+    while (true) {
+        std::string command;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!queue_.empty()) {
+                command = std::move(queue_.front());
+                queue_.pop_front();
+                last_command_ = command;
+            }
+        }
+        if (command.empty()) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        WriteCommand(command);
+        // 指令之间留出间隔，避免指令发送过快
+        vTaskDelay(pdMS_TO_TICKS(SECOND_UART_COMMAND_GAP_MS));
+    }
+}
+
+void SecondUart::WriteCommand(const std::string& command) {
+    if (!initialized_) {
+        ESP_LOGW(TAG, "UART not initialized, attempting to initialize...");
+        if (Initialize() != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to initialize UART, drop %s", command.c_str());
+            std::lock_guard<std::mutex> lock(mutex_);
+            last_command_.clear();
+            return;
+        }
+    }
+
+    // 机器人的回传数据没有人读取，发送前清空接收缓冲区，避免残留数据
+    uart_flush_input(SECOND_UART_NUM);
+    int written = uart_write_bytes(SECOND_UART_NUM, command.data(), command.size());
+    // 等待发送完成，间隔从线路空闲开始计算
+    uart_wait_tx_done(SECOND_UART_NUM, pdMS_TO_TICKS(100));
+    if (written != (int)command.size()) {
+        ESP_LOGW(TAG, "Only wrote %d bytes out of %d", written, (int)command.size());
+    } else {
+        ESP_LOGI(TAG, "Sent robot command: %s (written %d bytes)", command.c_str(), written);
+    }
+}
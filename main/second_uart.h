@@ -8,6 +8,8 @@
 #include <freertos/task.h>
 #include <string>
 #include <cstring>
+#include <deque>
+#include <mutex>
 
 // 第二串口配置 - ESP32C3只支持UART0和UART1
 // 使用UART1，但配置到U0默认引脚GPIO21/20，释放GPIO18/19用于USB通信
@@ -21,13 +23,25 @@
 #define ROBOT_STAND_UP_CMD      "kup"
 #define ROBOT_REST_CMD          "d"
 
+// 发送队列
+#define SECOND_UART_TX_QUEUE_LENGTH     16      // 尚未发送的指令上限，队列满时丢弃最旧的指令
+#define SECOND_UART_COMMAND_GAP_MS      10      // 两条指令之间的间隔，由发送任务保证
+#define SECOND_UART_WRITER_STACK_SIZE   3072
+
 class SecondUart {
 private:
     static SecondUart* instance_;
     bool initialized_;
-    std::string last_command_;
+    std::mutex mutex_;
+    std::deque<std::string> queue_;
+    std::string last_command_;          // 发送任务最近一次取出的指令
+    TaskHandle_t writer_task_ = nullptr;
     
     SecondUart() : initialized_(false) {}
+
+    static bool IsGaitCommand(const std::string& command);
+    void WriterTask();
+    void WriteCommand(const std::string& command);
     
 public:
     static SecondUart& GetInstance() {
@@ -93,32 +107,10 @@ public:
         return ESP_OK;
     }
     
-    // 向第二串口发送数据
-    void SendData(const char* data, size_t length) {
-        if (!initialized_) {
-            ESP_LOGW("SecondUart", "UART not initialized, attempting to initialize...");
-            if (Initialize() != ESP_OK) {
-                ESP_LOGE("SecondUart", "Failed to initialize UART");
-                return;
-            }
-        }
-        
-        // 去重：若与上次完全相同则不重复发送
-        if (last_command_.size() == length && memcmp(last_command_.data(), data, length) == 0) {
-            ESP_LOGI("SecondUart", "Skip duplicate command: %.*s", (int)length, data);
-            return;
-        }
-
-        int written = uart_write_bytes(SECOND_UART_NUM, data, length);
-        if (written != length) {
-            ESP_LOGW("SecondUart", "Only wrote %d bytes out of %d", written, length);
-        } else {
-            ESP_LOGI("SecondUart", "Sent robot command: %.*s (written %d bytes)", (int)length, data, written);
-        }
-
-        // 记录最近一次命令
-        last_command_.assign(data, length);
-    }
+    // 把指令放入发送队列后立即返回，由发送任务写入串口，调用方不会被串口阻塞。
+    // 与队尾（或最近一次已发送）相同的指令被丢弃；休息指令清空队列中尚未发送的指令；
+    // 新的步态指令（行走、后退、转向等）替换队尾尚未发送的步态指令
+    void SendData(const char* data, size_t length);
     
     // 向第二串口发送字符串
     void SendString(const std::string& str) {
@@ -133,70 +125,12 @@ public:
     
     // 发送机器人起立指令 - 只发送纯指令，不包含换行符
     void SendStandUpCommand() {
-        if (!initialized_) {
-            ESP_LOGW("SecondUart", "UART not initialized, attempting to initialize...");
-            if (Initialize() != ESP_OK) {
-                ESP_LOGE("SecondUart", "Failed to initialize UART");
-                return;
-            }
-        }
-        
-        // 去重：若与上次完全相同则不重复发送
-        if (last_command_.size() == strlen(ROBOT_STAND_UP_CMD) && memcmp(last_command_.data(), ROBOT_STAND_UP_CMD, strlen(ROBOT_STAND_UP_CMD)) == 0) {
-            ESP_LOGI("SecondUart", "Skip duplicate command: %s", ROBOT_STAND_UP_CMD);
-            return;
-        }
-
-        // 强制刷新和清空UART缓冲区，确保完全清除任何残留数据
-        uart_flush(SECOND_UART_NUM);
-        vTaskDelay(pdMS_TO_TICKS(10));  // 等待10ms确保刷新完成
-        
-        // 重新刷新一次，确保绝对干净
-        uart_flush(SECOND_UART_NUM);
-        
-        // 直接发送纯指令，不添加任何额外字符
-        int written = uart_write_bytes(SECOND_UART_NUM, ROBOT_STAND_UP_CMD, strlen(ROBOT_STAND_UP_CMD));
-        
-        // 等待发送完成
-        uart_wait_tx_done(SECOND_UART_NUM, pdMS_TO_TICKS(100));
-        
-        // 记录最近一次命令
-        last_command_.assign(ROBOT_STAND_UP_CMD, strlen(ROBOT_STAND_UP_CMD));
-        ESP_LOGI("SecondUart", "Sent pure stand up command: %s (written %d bytes)", ROBOT_STAND_UP_CMD, written);
+        SendData(ROBOT_STAND_UP_CMD, strlen(ROBOT_STAND_UP_CMD));
     }
     
     // 发送机器人休息指令 - 只发送纯指令，不包含换行符
     void SendRestCommand() {
-        if (!initialized_) {
-            ESP_LOGW("SecondUart", "UART not initialized, attempting to initialize...");
-            if (Initialize() != ESP_OK) {
-                ESP_LOGE("SecondUart", "Failed to initialize UART");
-                return;
-            }
-        }
-        
-        // 去重：若与上次完全相同则不重复发送
-        if (last_command_.size() == strlen(ROBOT_REST_CMD) && memcmp(last_command_.data(), ROBOT_REST_CMD, strlen(ROBOT_REST_CMD)) == 0) {
-            ESP_LOGI("SecondUart", "Skip duplicate command: %s", ROBOT_REST_CMD);
-            return;
-        }
-
-        // 强制刷新和清空UART缓冲区，确保完全清除任何残留数据
-        uart_flush(SECOND_UART_NUM);
-        vTaskDelay(pdMS_TO_TICKS(10));  // 等待10ms确保刷新完成
-        
-        // 重新刷新一次，确保绝对干净
-        uart_flush(SECOND_UART_NUM);
-        
-        // 直接发送纯指令，不添加任何额外字符
-        int written = uart_write_bytes(SECOND_UART_NUM, ROBOT_REST_CMD, strlen(ROBOT_REST_CMD));
-        
-        // 等待发送完成
-        uart_wait_tx_done(SECOND_UART_NUM, pdMS_TO_TICKS(100));
-        
-        // 记录最近一次命令
-        last_command_.assign(ROBOT_REST_CMD, strlen(ROBOT_REST_CMD));
-        ESP_LOGI("SecondUart", "Sent pure rest command: %s (written %d bytes)", ROBOT_REST_CMD, written);
+        SendData(ROBOT_REST_CMD, strlen(ROBOT_REST_CMD));
     }
     
     // 反初始化（清理资源）
@@ -8,6 +8,10 @@ HEADER_TEMPLATE = """// Auto-generated language config
 #pragma once
 
 #include <string_view>
+#include <cstdint>
+#include <iterator>
+
+#include "ogg_sound_index.h"
 
 #ifndef {lang_code_for_font}
     #define {lang_code_for_font}  // 預設語言
@@ -25,6 +29,11 @@ namespace Lang {{
     // 音效资源 (en-US as fallback for missing audio files)
     namespace Sounds {{
 {sounds}
+
+        // 预索引的 Opus 包表，AudioService::PlaySound 按数据地址查找，播放时无需扫描 Ogg 页
+        inline const OggSoundIndex SOUND_INDEX[] = {{
+{sound_index}
+        }};
     }}
 }}
 """
@@ -44,20 +53,87 @@ def load_base_language(assets_dir):
         print("Warning: en-US base language file not found, fallback mechanism disabled")
     return {'strings': {}}
 
+# Opus TOC config -> frame duration in 0.1 ms (RFC 6716 section 3.1)
+OPUS_FRAME_DURATIONS = [100, 200, 400, 600] * 3 + [100, 200] * 2 + [25, 50, 100, 200] * 4
+
+def index_ogg(path):
+    """解析 Ogg/Opus 文件，返回 (sample_rate, frame_duration_ms, [(offset, size), ...])"""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    packets = []
+    sample_rate = 16000
+    frame_duration = 60
+    seen_head = False
+    seen_tags = False
+    offset = 0
+    while offset + 27 <= len(data):
+        if data[offset:offset + 4] != b'OggS':
+            raise ValueError(f"{path}: missing Ogg page at offset {offset}")
+        page_segments = data[offset + 26]
+        lacing = data[offset + 27:offset + 27 + page_segments]
+        cursor = offset + 27 + page_segments
+        segment = 0
+        while segment < page_segments:
+            start = cursor
+            size = 0
+            while True:
+                length = lacing[segment]
+                segment += 1
+                size += length
+                cursor += length
+                if length < 255 or segment >= page_segments:
+                    break
+            if size == 0:
+                continue
+            packet = data[start:start + size]
+            if not seen_head:
+                if packet[:8] == b'OpusHead' and size >= 16:
+                    sample_rate = int.from_bytes(packet[12:16], 'little')
+                    seen_head = True
+                continue
+            if not seen_tags:
+                if packet[:8] == b'OpusTags':
+                    seen_tags = True
+                continue
+            if not packets:
+                toc = packet[0]
+                frames = [1, 2, 2, packet[1] & 0x3f if size > 1 else 1][toc & 0x3]
+                frame_duration = OPUS_FRAME_DURATIONS[toc >> 3] * frames // 10
+            packets.append((start, size))
+        offset = cursor
+    return sample_rate, frame_duration, packets
+
 def get_sound_files(directory):
     """获取目录中的音效文件列表"""
     if not os.path.exists(directory):
         return []
     return [f for f in os.listdir(directory) if f.endswith('.ogg')]
 
-def generate_header(lang_code, output_path):
-    # 从输出路径推导项目结构
-    # output_path 通常是 main/assets/lang_config.h
-    main_dir = os.path.dirname(output_path)  # main/assets
-    if os.path.basename(main_dir) == 'assets':
-        main_dir = os.path.dirname(main_dir)  # main
-    project_dir = os.path.dirname(main_dir)  # 项目根目录
-    assets_dir = os.path.join(main_dir, 'assets')
+def generate_embed_asm(sound_paths, output_path):
+    """生成 .incbin 汇编，为没有 EMBED_FILES 的构建（如 Linux host 构建）提供 _binary_*_ogg 符号"""
+    lines = []
+    for path in sound_paths:
+        base_name = os.path.splitext(os.path.basename(path))[0]
+        lines.append(f'    .section .rodata.{base_name}_ogg, "a"')
+        lines.append(f'    .global _binary_{base_name}_ogg_start')
+        lines.append(f'    .global _binary_{base_name}_ogg_end')
+        lines.append(f'_binary_{base_name}_ogg_start:')
+        lines.append(f'    .incbin "{os.path.abspath(path)}"')
+        lines.append(f'_binary_{base_name}_ogg_end:')
+    lines.append('    .section .note.GNU-stack, "", @progbits')
+    os.makedirs(os.path.dirname(output_path), exist_ok=True)
+    with open(output_path, 'w', encoding='utf-8') as f:
+        f.write("\n".join(lines) + "\n")
+
+def generate_header(lang_code, output_path, assets_dir=None, embed_asm_path=None):
+    if assets_dir is None:
+        # 从输出路径推导项目结构
+        # output_path 通常是 main/assets/lang_config.h
+        main_dir = os.path.dirname(output_path)  # main/assets
+        if os.path.basename(main_dir) == 'assets':
+            main_dir = os.path.dirname(main_dir)  # main
+        assets_dir = os.path.join(main_dir, 'assets')
     
     # 构建语言JSON文件路径
     input_path = os.path.join(assets_dir, 'locales', lang_code, 'language.json')
@@ -133,39 +209,48 @@ def generate_header(lang_code, output_path):
         print(f"  - Sound fallback to en-US: {sound_fallback_count} sounds")
     
     # 生成语言特定音效常量
+    sound_paths = []
     for file in sorted(all_sound_files):
-        base_name = os.path.splitext(file)[0]
         # 优先使用当前语言的音效，如果不存在则回退到 en-US
         if file in current_sounds:
-            sound_lang = lang_code.replace('-', '_').lower()
+            sound_paths.append(os.path.join(current_lang_dir, file))
         else:
-            sound_lang = 'en_us'
-            
-        sounds.append(f'''
-        extern const char ogg_{base_name}_start[] asm("_binary_{base_name}_ogg_start");
-        extern const char ogg_{base_name}_end[] asm("_binary_{base_name}_ogg_end");
-        static const std::string_view OGG_{base_name.upper()} {{
-        static_cast<const char*>(ogg_{base_name}_start),
-        static_cast<size_t>(ogg_{base_name}_end - ogg_{base_name}_start)
-        }};''')
-    
+            sound_paths.append(os.path.join(base_lang_dir, file))
+
     # 生成公共音效常量
     for file in sorted(common_sounds):
-        base_name = os.path.splitext(file)[0]
-        sounds.append(f'''
+        sound_paths.append(os.path.join(common_dir, file))
+
+    sound_index = []
+    for path in sound_paths:
+        base_name = os.path.splitext(os.path.basename(path))[0]
+        sample_rate, frame_duration, packets = index_ogg(path)
+        sound = f'''
         extern const char ogg_{base_name}_start[] asm("_binary_{base_name}_ogg_start");
         extern const char ogg_{base_name}_end[] asm("_binary_{base_name}_ogg_end");
         static const std::string_view OGG_{base_name.upper()} {{
         static_cast<const char*>(ogg_{base_name}_start),
         static_cast<size_t>(ogg_{base_name}_end - ogg_{base_name}_start)
-        }};''')
+        }};'''
+        if packets:
+            packet_table = ", ".join(f"{{{offset}, {size}}}" for offset, size in packets)
+            sound += f'''
+        inline constexpr OggPacketRef OGG_{base_name.upper()}_PACKETS[] = {{{packet_table}}};'''
+            packet_ref = f"OGG_{base_name.upper()}_PACKETS, std::size(OGG_{base_name.upper()}_PACKETS)"
+        else:
+            # 零长度数组不是合法的 C++，没有音频包的文件只登记空表
+            print(f"Warning: {path} has no audio packets")
+            packet_ref = "nullptr, 0"
+        sounds.append(sound)
+        sound_index.append(f"            {{ogg_{base_name}_start, {sample_rate}, {frame_duration}, {packet_ref}}},")
 
     # 填充模板
     content = HEADER_TEMPLATE.format(
         lang_code=lang_code,
         lang_code_for_font=lang_code.replace('-', '_').lower(),
         strings="\n".join(sorted(strings)),
-        sounds="\n".join(sorted(sounds))
+        sounds="\n".join(sorted(sounds)),
+        sound_index="\n".join(sorted(sound_index))
     )
 
     # 写入文件
@@ -173,14 +258,19 @@ def generate_header(lang_code, output_path):
     with open(output_path, 'w', encoding='utf-8') as f:
         f.write(content)
 
+    if embed_asm_path is not None:
+        generate_embed_asm(sound_paths, embed_asm_path)
+
 if __name__ == "__main__":
     parser = argparse.ArgumentParser(description="Generate language configuration header file with en-US fallback")
     parser.add_argument("--language", required=True, help="Language code (e.g: zh-CN, en-US, ja-JP)")
     parser.add_argument("--output", required=True, help="Output header file path")
+    parser.add_argument("--assets", help="Assets directory (default: derived from --output)")
+    parser.add_argument("--embed-asm", help="Also write a .S file embedding the sounds with .incbin")
     args = parser.parse_args()
 
     try:
-        generate_header(args.language, args.output)
+        generate_header(args.language, args.output, args.assets, args.embed_asm)
         print(f"Successfully generated language config file: {args.output}")
     except Exception as e:
         print(f"Error: {e}")
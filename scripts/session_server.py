@@ -0,0 +1,552 @@
+#!/usr/bin/env python3
+"""
+Record real server sessions and replay them from a local stand-in server.
+
+  record       websocket proxy between the device and the real server, writes every JSON message
+               and Opus frame in both directions with its arrival time to a session file
+  serve        stand-in websocket server (docs/websocket.md), replays a recorded session turn by
+               turn, or echoes the uplink audio back when no session is given
+  serve-mqtt   the same over MQTT + UDP, needs a running MQTT broker that the device is configured for
+  dump         print the records of a session file
+
+Downlink audio can be impaired with --loss, --latency and --jitter. Over UDP jitter can reorder
+frames; over websocket (TCP) frames stay in order and are only delayed.
+
+Examples:
+  python session_server.py record --upstream wss://api.example.com/xiaozhi/v1/ --out turn.xzs
+  python session_server.py serve --session turn.xzs --speed 2 --loss 0.05 --jitter 60
+  python session_server.py serve-mqtt --broker 192.168.1.10 --udp-host 192.168.1.10 \\
+      --device-topic devices/p2p/AA_BB_CC_DD_EE_FF --server-topic device-server
+
+Requires: pip install -r requirements.txt  (websockets; serve-mqtt also paho-mqtt and cryptography)
+"""
+import argparse
+import asyncio
+import json
+import os
+import random
+import struct
+import time
+import uuid
+
+# Session file: magic, then records of |direction 1B|kind 1B|time_ms 4B|length 4B|data|, little endian
+SESSION_MAGIC = b"XZS1"
+RECORD_HEADER = struct.Struct("<BBII")
+UPLINK, DOWNLINK = 0, 1
+KIND_JSON, KIND_OPUS = 0, 1
+
+BATCH_HEADER = struct.Struct(">BBHI")  # BinaryProtocol4: type, frame_count, payload_size, timestamp
+UDP_HEADER_SIZE = 16
+
+
+class SessionWriter:
+    def __init__(self, path):
+        self.file = open(path, "wb")
+        self.file.write(SESSION_MAGIC)
+        self.start = time.monotonic()
+        self.count = 0
+
+    def write(self, direction, kind, data):
+        if isinstance(data, str):
+            data = data.encode("utf-8")
+        time_ms = int((time.monotonic() - self.start) * 1000)
+        self.file.write(RECORD_HEADER.pack(direction, kind, time_ms, len(data)))
+        self.file.write(data)
+        self.count += 1
+
+    def close(self):
+        self.file.close()
+
+
+def read_session(path):
+    with open(path, "rb") as f:
+        if f.read(4) != SESSION_MAGIC:
+            raise ValueError(f"{path} is not a session file")
+        records = []
+        while True:
+            header = f.read(RECORD_HEADER.size)
+            if len(header) < RECORD_HEADER.size:
+                break
+            direction, kind, time_ms, length = RECORD_HEADER.unpack(header)
+            data = f.read(length)
+            records.append((direction, kind, time_ms, data.decode("utf-8") if kind == KIND_JSON else data))
+        return records
+
+
+def is_turn_start(message):
+    return message.get("type") == "listen" and message.get("state") in ("start", "detect")
+
+
+def split_turns(records):
+    """Returns the recorded server hello and the downlink of each turn, times relative to the listen message"""
+    server_hello = None
+    turns = []
+    turn_start = None
+    for direction, kind, time_ms, data in records:
+        if direction == UPLINK:
+            if kind == KIND_JSON and is_turn_start(json.loads(data)):
+                turn_start = time_ms
+                turns.append([])
+            continue
+        if kind == KIND_JSON and server_hello is None and json.loads(data).get("type") == "hello":
+            server_hello = json.loads(data)
+            continue
+        if turn_start is not None:
+            turns[-1].append((time_ms - turn_start, kind, data))
+    return server_hello, [turn for turn in turns if turn]
+
+
+# ---------------------------------------------------------------------------------------------
+# Websocket audio framing, see BinaryProtocol2/3/4 in main/protocols/protocol.h
+
+def parse_batch(payload, count):
+    sizes = struct.unpack(f">{count}H", payload[:count * 2])
+    frames, offset = [], count * 2
+    for size in sizes:
+        frames.append(payload[offset:offset + size])
+        offset += size
+    return frames
+
+
+def parse_ws_audio(data, version, batching):
+    if batching:
+        _, count, size, _ = BATCH_HEADER.unpack_from(data)
+        return parse_batch(data[BATCH_HEADER.size:BATCH_HEADER.size + size], count)
+    if version == 2:
+        _, _, _, _, size = struct.unpack_from(">HHIII", data)
+        return [data[16:16 + size]]
+    if version == 3:
+        _, _, size = struct.unpack_from(">BBH", data)
+        return [data[4:4 + size]]
+    return [data]
+
+
+def pack_ws_audio(opus, version, timestamp):
+    if version == 2:
+        return struct.pack(">HHIII", version, 0, 0, timestamp, len(opus)) + opus
+    if version == 3:
+        return struct.pack(">BBH", 0, 0, len(opus)) + opus
+    return opus
+
+
+# ---------------------------------------------------------------------------------------------
+
+class Impairment:
+    """Loss, fixed latency and uniform jitter applied to downlink audio frames"""
+
+    def __init__(self, loss, latency_ms, jitter_ms, ordered, seed):
+        self.loss = loss
+        self.latency = latency_ms / 1000
+        self.jitter = jitter_ms / 1000
+        self.ordered = ordered
+        self.random = random.Random(seed)
+        self.last_due = 0
+        self.sent = self.dropped = 0
+
+    def due_time(self, now):
+        """Delivery time for a frame handed over at now, None if it is lost"""
+        if self.random.random() < self.loss:
+            self.dropped += 1
+            return None
+        due = now + self.latency + self.random.uniform(0, self.jitter)
+        if self.ordered:
+            due = max(due, self.last_due)
+        self.last_due = due
+        self.sent += 1
+        return due
+
+
+class Session:
+    """Turn logic shared by the transports: answers listen messages with a recorded turn or an echo"""
+
+    def __init__(self, args, transport):
+        self.args = args
+        self.transport = transport
+        self.session_id = str(uuid.uuid4())
+        self.server_hello = None
+        self.turns = []
+        if args.session:
+            self.server_hello, self.turns = split_turns(read_session(args.session))
+            print(f"Loaded {len(self.turns)} turns from {args.session}")
+        self.next_turn = 0
+        self.reply_task = None
+        self.echo_frames = []
+        self.echo_timer = None
+        self.frame_duration = 60
+        self.downlink_frame_duration = 60
+        self.uplink_frames = self.uplink_messages = 0
+        self.impairment = Impairment(args.loss, args.latency, args.jitter, transport.ordered, args.seed)
+        self.pending = set()
+
+    def hello_reply(self, hello, transport_name):
+        params = (hello.get("audio_params") or {})
+        self.frame_duration = params.get("frame_duration", 60)
+        if self.server_hello and not self.args.echo:
+            audio_params = self.server_hello.get("audio_params", {})
+        else:
+            # Echo sends the device's own 16 kHz frames back
+            audio_params = {"format": "opus", "sample_rate": 16000, "channels": 1, "frame_duration": self.frame_duration}
+        reply = {
+            "type": "hello",
+            "transport": transport_name,
+            "session_id": hello.get("session_id") or self.session_id,
+            "audio_params": audio_params,
+        }
+        batching = bool((hello.get("features") or {}).get("audio_batch")) and not self.args.no_batch
+        if batching:
+            reply["features"] = {"audio_batch": True}
+        self.session_id = reply["session_id"]
+        self.downlink_frame_duration = audio_params.get("frame_duration", 60)
+        return reply, batching
+
+    async def on_json(self, message):
+        message_type = message.get("type")
+        if is_turn_start(message):
+            self.cancel_reply()
+            self.echo_frames = []
+            if self.args.echo or not self.turns:
+                self.start_echo_timer()
+            else:
+                if self.next_turn >= len(self.turns) and not self.args.loop:
+                    print("All recorded turns played, use --loop to start over")
+                    return
+                turn = self.turns[self.next_turn % len(self.turns)]
+                self.next_turn += 1
+                self.reply_task = asyncio.ensure_future(self.replay_turn(turn))
+        elif message_type == "listen" and message.get("state") == "stop":
+            if self.echo_timer is not None:
+                self.echo_timer.cancel()
+                self.reply_task = asyncio.ensure_future(self.echo())
+        elif message_type == "abort":
+            self.cancel_reply()
+            await self.transport.send_json({"session_id": self.session_id, "type": "tts", "state": "stop"})
+
+    def on_audio(self, frames, messages=1):
+        self.uplink_frames += len(frames)
+        self.uplink_messages += messages
+        if self.echo_timer is not None:
+            self.echo_frames.extend(frames)
+
+    def start_echo_timer(self):
+        loop = asyncio.get_event_loop()
+        self.echo_timer = loop.call_later(self.args.echo_after, lambda: setattr(
+            self, "reply_task", asyncio.ensure_future(self.echo())))
+
+    def cancel_reply(self):
+        if self.echo_timer is not None:
+            self.echo_timer.cancel()
+            self.echo_timer = None
+        if self.reply_task is not None:
+            self.reply_task.cancel()
+            self.reply_task = None
+        for task in self.pending:
+            task.cancel()
+        self.pending.clear()
+
+    def send_audio_impaired(self, opus, timestamp):
+        loop = asyncio.get_event_loop()
+        due = self.impairment.due_time(loop.time())
+        if due is None:
+            return
+
+        async def deliver():
+            await asyncio.sleep(max(0, due - loop.time()))
+            await self.transport.send_audio(opus, timestamp)
+
+        task = asyncio.ensure_future(deliver())
+        self.pending.add(task)
+        task.add_done_callback(self.pending.discard)
+
+    async def replay_turn(self, turn):
+        start = asyncio.get_event_loop().time()
+        timestamp = 0
+        for offset_ms, kind, data in turn:
+            delay = start + offset_ms / 1000 / self.args.speed - asyncio.get_event_loop().time()
+            if delay > 0:
+                await asyncio.sleep(delay)
+            if kind == KIND_JSON:
+                message = json.loads(data)
+                if "session_id" in message:
+                    message["session_id"] = self.session_id
+                # Let delayed audio drain before the end of speech is announced
+                if message.get("type") == "tts" and message.get("state") == "stop" and self.pending:
+                    await asyncio.gather(*self.pending, return_exceptions=True)
+                await self.transport.send_json(message)
+            else:
+                self.send_audio_impaired(data, timestamp)
+                timestamp += self.downlink_frame_duration
+        self.print_stats()
+
+    async def echo(self):
+        self.echo_timer = None
+        frames, self.echo_frames = self.echo_frames, []
+        await self.transport.send_json({"session_id": self.session_id, "type": "tts", "state": "start"})
+        await self.transport.send_json({"session_id": self.session_id, "type": "tts", "state": "sentence_start",
+                                        "text": f"Echo of {len(frames)} frames"})
+        start = asyncio.get_event_loop().time()
+        for index, opus in enumerate(frames):
+            due = start + index * self.frame_duration / 1000 / self.args.speed
+            await asyncio.sleep(max(0, due - asyncio.get_event_loop().time()))
+            self.send_audio_impaired(opus, index * self.frame_duration)
+        if self.pending:
+            await asyncio.gather(*self.pending, return_exceptions=True)
+        await self.transport.send_json({"session_id": self.session_id, "type": "tts", "state": "stop"})
+        self.print_stats()
+
+    def print_stats(self):
+        impairment = self.impairment
+        print(f"Uplink {self.uplink_frames} frames in {self.uplink_messages} messages, "
+              f"downlink {impairment.sent} frames sent, {impairment.dropped} dropped")
+
+
+# ---------------------------------------------------------------------------------------------
+
+def request_headers(websocket):
+    request = getattr(websocket, "request", None)
+    return request.headers if request is not None else websocket.request_headers
+
+
+class WebsocketTransport:
+    ordered = True
+
+    def __init__(self, websocket, version):
+        self.websocket = websocket
+        self.version = version
+
+    async def send_json(self, message):
+        await self.websocket.send(json.dumps(message, ensure_ascii=False))
+
+    async def send_audio(self, opus, timestamp):
+        await self.websocket.send(pack_ws_audio(opus, self.version, timestamp))
+
+
+async def serve_websocket(args):
+    import websockets
+
+    async def handle(websocket, path=None):
+        version = int(request_headers(websocket).get("Protocol-Version", "1"))
+        transport = WebsocketTransport(websocket, version)
+        session = Session(args, transport)
+        batching = False
+        print(f"Device connected, protocol version {version}")
+        try:
+            async for data in websocket:
+                if isinstance(data, bytes):
+                    frames = parse_ws_audio(data, version, batching)
+                    session.on_audio(frames)
+                    continue
+                message = json.loads(data)
+                if message.get("type") == "hello":
+                    reply, batching = session.hello_reply(message, "websocket")
+                    await transport.send_json(reply)
+                else:
+                    await session.on_json(message)
+        except websockets.ConnectionClosed:
+            pass
+        finally:
+            session.cancel_reply()
+            session.print_stats()
+            print("Device disconnected")
+
+    host, port = args.listen.rsplit(":", 1)
+    async with websockets.serve(handle, host, int(port), max_size=None):
+        print(f"Stand-in server listening on ws://{args.listen}")
+        await asyncio.Future()
+
+
+async def record_websocket(args):
+    import websockets
+
+    async def handle(device, path=None):
+        headers = request_headers(device)
+        forward = {name: headers[name] for name in ("Authorization", "Protocol-Version", "Device-Id", "Client-Id")
+                   if name in headers}
+        version = int(forward.get("Protocol-Version", "1"))
+        writer = SessionWriter(args.out)
+        state = {"batching": False}
+        print(f"Recording to {args.out}, protocol version {version}")
+        try:
+            connect = websockets.connect(args.upstream, additional_headers=forward, max_size=None)
+        except TypeError:
+            connect = websockets.connect(args.upstream, extra_headers=forward, max_size=None)
+        async with connect as server:
+            async def device_to_server():
+                async for data in device:
+                    if isinstance(data, bytes):
+                        for frame in parse_ws_audio(data, version, state["batching"]):
+                            writer.write(UPLINK, KIND_OPUS, frame)
+                    else:
+                        writer.write(UPLINK, KIND_JSON, data)
+                    await server.send(data)
+
+            async def server_to_device():
+                async for data in server:
+                    if isinstance(data, bytes):
+                        # The server sends single frames in the negotiated version
+                        writer.write(DOWNLINK, KIND_OPUS, parse_ws_audio(data, version, False)[0])
+                    else:
+                        message = json.loads(data)
+                        if message.get("type") == "hello":
+                            state["batching"] = bool((message.get("features") or {}).get("audio_batch"))
+                        writer.write(DOWNLINK, KIND_JSON, data)
+                    await device.send(data)
+
+            tasks = [asyncio.ensure_future(device_to_server()), asyncio.ensure_future(server_to_device())]
+            await asyncio.wait(tasks, return_when=asyncio.FIRST_COMPLETED)
+            for task in tasks:
+                task.cancel()
+        writer.close()
+        print(f"Session closed, {writer.count} records written")
+
+    host, port = args.listen.rsplit(":", 1)
+    async with websockets.serve(handle, host, int(port), max_size=None):
+        print(f"Recording proxy listening on ws://{args.listen}, forwarding to {args.upstream}")
+        await asyncio.Future()
+
+
+# ---------------------------------------------------------------------------------------------
+
+class UdpTransport(asyncio.DatagramProtocol):
+    """Server side of the encrypted UDP audio channel, see AudioDatagramCipher"""
+    ordered = False
+
+    def __init__(self):
+        self.key = os.urandom(16)
+        self.nonce = bytes([0x01, 0]) + b"\0\0" + os.urandom(4) + b"\0" * 8
+        self.address = None
+        self.sequence = 0
+        self.session = None
+        self.mqtt = None
+
+    def crypt(self, header, payload):
+        from cryptography.hazmat.primitives.ciphers import Cipher, algorithms, modes
+        cipher = Cipher(algorithms.AES(self.key), modes.CTR(header)).encryptor()
+        return cipher.update(payload) + cipher.finalize()
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, address):
+        if len(data) < UDP_HEADER_SIZE or self.session is None:
+            return
+        self.address = address
+        header, payload = data[:UDP_HEADER_SIZE], self.crypt(data[:UDP_HEADER_SIZE], data[UDP_HEADER_SIZE:])
+        if header[0] == 0x02:
+            self.session.on_audio(parse_batch(payload, header[1]))
+        elif header[0] == 0x01:
+            self.session.on_audio([payload])
+
+    async def send_json(self, message):
+        self.mqtt.publish(json.dumps(message, ensure_ascii=False))
+
+    async def send_audio(self, opus, timestamp):
+        if self.address is None:
+            return
+        self.sequence += 1
+        header = bytearray(self.nonce)
+        struct.pack_into(">H", header, 2, len(opus))
+        struct.pack_into(">II", header, 8, timestamp, self.sequence)
+        header = bytes(header)
+        self.transport.sendto(header + self.crypt(header, opus), self.address)
+
+
+async def serve_mqtt(args):
+    import paho.mqtt.client as mqtt
+
+    loop = asyncio.get_event_loop()
+    udp_host, udp_port = args.udp_host, args.udp_port
+    _, udp = await loop.create_datagram_endpoint(UdpTransport, local_addr=("0.0.0.0", udp_port))
+
+    class Publisher:
+        def publish(self, text):
+            client.publish(args.device_topic, text)
+
+    udp.mqtt = Publisher()
+
+    async def on_message(message):
+        if message.get("type") == "hello":
+            udp.session = Session(args, udp)
+            udp.sequence = 0
+            reply, _ = udp.session.hello_reply(message, "udp")
+            reply["udp"] = {"server": udp_host, "port": udp_port, "encryption": "aes-128-ctr",
+                            "key": udp.key.hex(), "nonce": udp.nonce.hex()}
+            await udp.send_json(reply)
+        elif message.get("type") == "goodbye":
+            if udp.session is not None:
+                udp.session.cancel_reply()
+                udp.session.print_stats()
+            udp.session = None
+        elif udp.session is not None:
+            await udp.session.on_json(message)
+
+    client = mqtt.Client()
+    if args.username:
+        client.username_pw_set(args.username, args.password)
+    client.on_message = lambda c, userdata, msg: asyncio.run_coroutine_threadsafe(
+        on_message(json.loads(msg.payload)), loop)
+    host, _, port = args.broker.partition(":")
+    client.connect(host, int(port or 1883))
+    client.subscribe(args.server_topic)
+    client.loop_start()
+    print(f"Stand-in server on MQTT {args.broker} topic {args.server_topic}, UDP {udp_host}:{udp_port}")
+    await asyncio.Future()
+
+
+def dump(args):
+    for direction, kind, time_ms, data in read_session(args.session):
+        arrow = "->" if direction == UPLINK else "<-"
+        text = data if kind == KIND_JSON else f"opus {len(data)} bytes"
+        print(f"{time_ms:8d} ms {arrow} {text}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    record = commands.add_parser("record", help="proxy a real server and record the session")
+    record.add_argument("--listen", default="0.0.0.0:8765")
+    record.add_argument("--upstream", required=True, help="websocket url of the real server")
+    record.add_argument("--out", default="session.xzs")
+
+    def add_replay_arguments(command):
+        command.add_argument("--session", help="recorded session to replay, echo the uplink if omitted")
+        command.add_argument("--echo", action="store_true", help="echo the uplink even with a session")
+        command.add_argument("--echo-after", type=float, default=4.0, help="seconds of uplink before echoing")
+        command.add_argument("--loop", action="store_true", help="start over once all turns are played")
+        command.add_argument("--speed", type=float, default=1.0, help="replay speed, 1 is real time")
+        command.add_argument("--loss", type=float, default=0.0, help="downlink frame loss probability")
+        command.add_argument("--latency", type=float, default=0.0, help="added downlink delay in ms")
+        command.add_argument("--jitter", type=float, default=0.0, help="extra random downlink delay in ms")
+        command.add_argument("--seed", type=int, default=1)
+        command.add_argument("--no-batch", action="store_true", help="do not accept uplink batching")
+
+    serve = commands.add_parser("serve", help="websocket stand-in server")
+    serve.add_argument("--listen", default="0.0.0.0:8765")
+    add_replay_arguments(serve)
+
+    serve_mqtt_parser = commands.add_parser("serve-mqtt", help="MQTT + UDP stand-in server")
+    serve_mqtt_parser.add_argument("--broker", required=True, help="host[:port] of the MQTT broker")
+    serve_mqtt_parser.add_argument("--username")
+    serve_mqtt_parser.add_argument("--password")
+    serve_mqtt_parser.add_argument("--server-topic", required=True, help="topic the device publishes to")
+    serve_mqtt_parser.add_argument("--device-topic", required=True, help="topic the device subscribes to")
+    serve_mqtt_parser.add_argument("--udp-host", required=True, help="address the device sends UDP audio to")
+    serve_mqtt_parser.add_argument("--udp-port", type=int, default=8888)
+    add_replay_arguments(serve_mqtt_parser)
+
+    dump_parser = commands.add_parser("dump", help="print a session file")
+    dump_parser.add_argument("session")
+
+    args = parser.parse_args()
+    if args.command == "dump":
+        dump(args)
+        return
+    runner = {"record": record_websocket, "serve": serve_websocket, "serve-mqtt": serve_mqtt}[args.command]
+    try:
+        asyncio.run(runner(args))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()